@@ -0,0 +1,387 @@
+/*
+ *  ble_adv.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_hs.h>
+#include <services/gap/ble_svc_gap.h>
+
+#include "config.h"
+#include "ble_stats.h"
+#include "ble_bond.h"
+#include "ble_boot.h"
+#include "gatt_server.h"
+#include "ble_adv.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "ADV";
+static ble_gap_event_fn *ble_adv_callback = NULL;
+static portMUX_TYPE ble_adv_lock = portMUX_INITIALIZER_UNLOCKED;
+static ble_adv_phase_t ble_adv_phase = BLE_ADV_PHASE_IDLE;
+static uint8_t ble_adv_own_addr_type;
+static ble_addr_t ble_adv_peer;
+static uint32_t ble_adv_started_at;
+static ble_adv_stats_t ble_adv_stats;
+
+/* Encoded payloads, rebuilt and handed to the controller only when dirty */
+static bool ble_adv_dirty = true;
+static uint8_t ble_adv_data[BLE_HS_ADV_MAX_SZ];
+static uint8_t ble_adv_data_len;
+static uint8_t ble_adv_rsp_data[BLE_HS_ADV_MAX_SZ];
+static uint8_t ble_adv_rsp_data_len;
+
+/* UART service UUID followed by the service data */
+static uint8_t ble_adv_service_data[2 + BLE_ADV_SERVICE_DATA_MAX];
+static uint8_t ble_adv_service_data_len;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static esp_err_t ble_adv_load(void);
+static esp_err_t ble_adv_run(ble_adv_phase_t phase);
+
+/******************************************************************************/
+
+/**
+ * @brief  Encode the payloads and hand them to the controller
+ */
+static esp_err_t ble_adv_load(void)
+{
+    struct ble_hs_adv_fields fields;
+    const char *name;
+    esp_err_t rc;
+
+    /**
+     *  Advertising data, fixed for the life of the firmware:
+     *     o Flags (general discoverable, BLE-only).
+     *     o Advertising tx power, filled by the stack.
+     *     o 16-bit service UUID of the UART service.
+     */
+    memset(&fields, 0, sizeof fields);
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.tx_pwr_lvl_is_present = 1;
+    fields.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
+    fields.uuids16 = (ble_uuid16_t[]) {
+        BLE_UUID16_INIT(UART_SERVICE_ULUID16)
+    };
+    fields.num_uuids16 = 1;
+    fields.uuids16_is_complete = 1;
+
+    rc = ble_hs_adv_set_fields(&fields, ble_adv_data, &ble_adv_data_len, sizeof(ble_adv_data));
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error encoding advertisement data; rc = %d", rc);
+        return rc;
+    }
+
+    /**
+     *  Scan response, changes with the application:
+     *     o Device name.
+     *     o Service data of the UART service.
+     */
+    memset(&fields, 0, sizeof fields);
+    name = ble_svc_gap_device_name();
+    fields.name = (uint8_t *)name;
+    fields.name_len = strlen(name);
+    fields.name_is_complete = 1;
+
+    portENTER_CRITICAL(&ble_adv_lock);
+    if(ble_adv_service_data_len > 0)
+    {
+        fields.svc_data_uuid16 = ble_adv_service_data;
+        fields.svc_data_uuid16_len = ble_adv_service_data_len;
+    }
+    rc = ble_hs_adv_set_fields(&fields, ble_adv_rsp_data, &ble_adv_rsp_data_len, sizeof(ble_adv_rsp_data));
+    portEXIT_CRITICAL(&ble_adv_lock);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error encoding scan response; rc = %d", rc);
+        return rc;
+    }
+
+    rc = ble_gap_adv_set_data(ble_adv_data, ble_adv_data_len);
+    if(rc == ESP_OK)
+    {
+        rc = ble_gap_adv_rsp_set_data(ble_adv_rsp_data, ble_adv_rsp_data_len);
+    }
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error setting advertisement data; rc = %d", rc);
+        return rc;
+    }
+
+    ble_adv_dirty = false;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Enable advertising in one phase
+ */
+static esp_err_t ble_adv_run(ble_adv_phase_t phase)
+{
+    struct ble_gap_adv_params adv_params;
+    int32_t duration;
+    esp_err_t rc;
+
+    if(ble_adv_dirty)
+    {
+        rc = ble_adv_load();
+        if(rc != ESP_OK)
+        {
+            return rc;
+        }
+    }
+
+    memset(&adv_params, 0, sizeof adv_params);
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    switch(phase)
+    {
+    /* Interval is fixed by the controller, no payload is sent */
+    case BLE_ADV_PHASE_DIRECTED:
+        adv_params.conn_mode = BLE_GAP_CONN_MODE_DIR;
+        adv_params.disc_mode = BLE_GAP_DISC_MODE_NON;
+        adv_params.high_duty_cycle = 1;
+        duration = BLE_BOND_DIRECTED_MS;
+        break;
+
+    /* Only bonded peers may connect, others do not see a connectable device */
+    case BLE_ADV_PHASE_RECONNECT:
+        adv_params.itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_ADV_FAST_ITVL_MIN_MS);
+        adv_params.itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_ADV_FAST_ITVL_MAX_MS);
+        adv_params.filter_policy = BLE_HCI_ADV_FILT_CONN;
+        duration = BLE_BOND_RECONNECT_MS;
+        break;
+
+    case BLE_ADV_PHASE_FAST:
+        adv_params.itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_ADV_FAST_ITVL_MIN_MS);
+        adv_params.itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_ADV_FAST_ITVL_MAX_MS);
+        duration = BLE_ADV_FAST_DURATION_MS;
+        break;
+
+    default:
+        adv_params.itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_ADV_SLOW_ITVL_MIN_MS);
+        adv_params.itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_ADV_SLOW_ITVL_MAX_MS);
+        duration = BLE_ADV_DURATION_MS;
+        break;
+    }
+
+    rc = ble_gap_adv_start(ble_adv_own_addr_type, phase == BLE_ADV_PHASE_DIRECTED ? &ble_adv_peer : NULL,
+                           duration, &adv_params, ble_adv_callback, NULL);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error enabling advertisement; rc = %d", rc);
+        return rc;
+    }
+
+    ble_adv_phase = phase;
+    ble_boot_mark(BLE_BOOT_ADVERTISING);
+    return ESP_OK;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Start the fast phase
+ */
+esp_err_t ble_adv_start(uint8_t own_addr_type)
+{
+    ble_adv_own_addr_type = own_addr_type;
+
+    if(ble_gap_adv_active())
+    {
+        if(ble_adv_phase == BLE_ADV_PHASE_FAST)
+        {
+            return ESP_OK;
+        }
+        ble_gap_adv_stop();
+    }
+    else
+    {
+        /* Latency is measured from the first start after a connection */
+        ble_adv_started_at = ble_stats_now();
+    }
+
+    return ble_adv_run(BLE_ADV_PHASE_FAST);
+}
+
+/**
+ * @brief  Start the reconnect phases for bonded peers
+ */
+esp_err_t ble_adv_start_reconnect(uint8_t own_addr_type, bool directed)
+{
+    struct ble_gap_conn_desc desc;
+
+    ble_adv_own_addr_type = own_addr_type;
+
+    /* The accept list cannot change while the controller advertises */
+    if(ble_gap_adv_active())
+    {
+        ble_gap_adv_stop();
+    }
+    else
+    {
+        ble_adv_started_at = ble_stats_now();
+    }
+
+    if(ble_bond_refresh() == 0)
+    {
+        ble_adv_phase = BLE_ADV_PHASE_IDLE;
+        return ble_adv_start(own_addr_type);
+    }
+
+    /* Directed advertising to a peer that is already connected is wasted */
+    if(directed && ble_bond_get_last(&ble_adv_peer) == ESP_OK &&
+       ble_gap_conn_find_by_addr(&ble_adv_peer, &desc) != 0)
+    {
+        return ble_adv_run(BLE_ADV_PHASE_DIRECTED);
+    }
+    return ble_adv_run(BLE_ADV_PHASE_RECONNECT);
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_ADV_COMPLETE
+ */
+void ble_adv_on_complete(int32_t reason)
+{
+    if(reason == BLE_HS_ETIMEOUT && ble_adv_phase != BLE_ADV_PHASE_IDLE && ble_adv_phase != BLE_ADV_PHASE_SLOW)
+    {
+        ble_adv_run(ble_adv_phase + 1);
+        return;
+    }
+
+    /* Reason 0 is a connection, BLE_GAP_EVENT_CONNECT takes over. Anything
+     * else (slow phase with a finite BLE_ADV_DURATION_MS, controller error)
+     * starts over */
+    if(reason != 0)
+    {
+        ble_adv_phase = BLE_ADV_PHASE_IDLE;
+        ble_adv_start(ble_adv_own_addr_type);
+    }
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONNECT
+ */
+void ble_adv_on_connect(void)
+{
+    uint32_t elapsed = (ble_stats_now() - ble_adv_started_at) / 1000;
+
+    if(ble_adv_phase == BLE_ADV_PHASE_IDLE)
+    {
+        return;
+    }
+
+    ble_adv_stats.connects[ble_adv_phase]++;
+    ble_adv_stats.last_connect_ms = elapsed;
+    if(elapsed > ble_adv_stats.max_connect_ms)
+    {
+        ble_adv_stats.max_connect_ms = elapsed;
+    }
+    ble_adv_phase = BLE_ADV_PHASE_IDLE;
+}
+
+/**
+ * @brief  Track a host reset
+ */
+void ble_adv_on_reset(void)
+{
+    ble_adv_dirty = true;
+    ble_adv_phase = BLE_ADV_PHASE_IDLE;
+}
+
+/**
+ * @brief  Set the device name
+ */
+esp_err_t ble_adv_set_name(const char *name)
+{
+    esp_err_t rc = ble_svc_gap_device_name_set(name);
+
+    if(rc == ESP_OK)
+    {
+        ble_adv_dirty = true;
+    }
+    return rc;
+}
+
+/**
+ * @brief  Set the service data advertised in the scan response
+ */
+esp_err_t ble_adv_set_service_data(const uint8_t *data, size_t size)
+{
+    if(size > BLE_ADV_SERVICE_DATA_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* Read by the host task when it encodes the payloads */
+    portENTER_CRITICAL(&ble_adv_lock);
+    ble_adv_service_data[0] = UART_SERVICE_ULUID16 & 0xFF;
+    ble_adv_service_data[1] = UART_SERVICE_ULUID16 >> 8;
+    if(data != NULL && size > 0)
+    {
+        memcpy(ble_adv_service_data + 2, data, size);
+        ble_adv_service_data_len = 2 + size;
+    }
+    else
+    {
+        ble_adv_service_data_len = 0;
+    }
+    ble_adv_dirty = true;
+    portEXIT_CRITICAL(&ble_adv_lock);
+
+    /* The slow phase may run forever, update it in place */
+    if(ble_gap_adv_active())
+    {
+        return ble_adv_load();
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get current phase
+ */
+ble_adv_phase_t ble_adv_get_phase(void)
+{
+    return ble_adv_phase;
+}
+
+/**
+ * @brief  Get reconnect latency counters
+ */
+void ble_adv_get_stats(ble_adv_stats_t *stats)
+{
+    *stats = ble_adv_stats;
+}
+
+/**
+ * @brief  Advertising initialization
+ */
+void ble_adv_init(ble_gap_event_fn *callback)
+{
+    ble_adv_callback = callback;
+    ble_adv_dirty = true;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*
+ *  ble_adv.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_ADV_H_
+#define _BLE_ADV_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_gap.h>
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_ADV_SERVICE_DATA_MAX                      8       /* Bytes, after the 16 bit UUID */
+
+/**
+ * Advertising runs in two phases. Every start (boot, disconnect, failed
+ * connect, free slot after a connect) advertises at the fast interval for
+ * BLE_ADV_FAST_DURATION_MS so a returning phone reconnects at once, then
+ * the controller drops to the slow interval until a central connects.
+ *
+ * A reconnect start puts two phases in front for bonded peers: high duty
+ * directed advertising to the last peer for BLE_BOND_DIRECTED_MS, then
+ * advertising to the filter accept list only for BLE_BOND_RECONNECT_MS.
+ */
+typedef enum
+{
+    BLE_ADV_PHASE_IDLE = 0,
+    BLE_ADV_PHASE_DIRECTED,
+    BLE_ADV_PHASE_RECONNECT,
+    BLE_ADV_PHASE_FAST,
+    BLE_ADV_PHASE_SLOW,
+    BLE_ADV_PHASES,
+} ble_adv_phase_t;
+
+typedef struct
+{
+    uint32_t connects[BLE_ADV_PHASES];  /* Connections made in each phase */
+    uint32_t last_connect_ms;           /* Advertising start to connection, last one */
+    uint32_t max_connect_ms;
+} ble_adv_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Start the fast phase, restarts it when the slow phase is running.
+ *         Payloads are handed to the controller only when they changed
+ * @param  own_addr_type : address type from ble_hs_id_infer_auto()
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_gap_adv_start
+ */
+esp_err_t ble_adv_start(uint8_t own_addr_type);
+
+/**
+ * @brief  Start the reconnect phases for bonded peers, restarts them when
+ *         another phase is running. Falls back to ble_adv_start when there
+ *         is no bond
+ * @param  own_addr_type : address type from ble_hs_id_infer_auto()
+ *         directed      : advertise directed to the last bonded peer first
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_gap_adv_start
+ */
+esp_err_t ble_adv_start_reconnect(uint8_t own_addr_type, bool directed);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_ADV_COMPLETE, moves a timed out phase to the
+ *         next one
+ * @param  reason : adv_complete.reason of the event
+ * @retval None
+ */
+void ble_adv_on_complete(int32_t reason);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONNECT, records the time to connect
+ * @param  None
+ * @retval None
+ */
+void ble_adv_on_connect(void);
+
+/**
+ * @brief  Track a host reset, the controller lost the payloads
+ * @param  None
+ * @retval None
+ */
+void ble_adv_on_reset(void);
+
+/**
+ * @brief  Set the device name, advertised in the scan response from the
+ *         next start
+ * @param  name : device name
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_svc_gap_device_name_set
+ */
+esp_err_t ble_adv_set_name(const char *name);
+
+/**
+ * @brief  Set the service data advertised with the UART service UUID in the
+ *         scan response, updated in place while advertising
+ * @param  data : service data, NULL to remove it
+ *         size : length of data (max is BLE_ADV_SERVICE_DATA_MAX)
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_SIZE if data is too long
+ *         Otherwise the NimBLE error of the payload update
+ */
+esp_err_t ble_adv_set_service_data(const uint8_t *data, size_t size);
+
+/**
+ * @brief  Get current phase
+ * @param  None
+ * @retval Advertising phase
+ */
+ble_adv_phase_t ble_adv_get_phase(void);
+
+/**
+ * @brief  Get reconnect latency counters
+ * @param  stats : filled with the counters
+ * @retval None
+ */
+void ble_adv_get_stats(ble_adv_stats_t *stats);
+
+/**
+ * @brief  Advertising initialization
+ * @param  callback : GAP event handler of connections made from advertising
+ * @retval None
+ */
+void ble_adv_init(ble_gap_event_fn *callback);
+
+/******************************************************************************/
+
+#endif /* _BLE_ADV_H_ */
\ No newline at end of file
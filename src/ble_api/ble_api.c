@@ -20,6 +20,19 @@
 
 #include "config.h"
 #include "gatt_server.h"
+#include "ble_tx_queue.h"
+#include "ble_session.h"
+#include "ble_coc.h"
+#include "ble_frame.h"
+#include "ble_pool.h"
+#include "ble_trace.h"
+#include "ble_adv.h"
+#include "ble_bond.h"
+#include "ble_ota.h"
+#include "ble_batch.h"
+#include "ble_pair.h"
+#include "ble_scan.h"
+#include "ble_boot.h"
 #include "ble_api.h"
 
 /******************************************************************************/
@@ -35,7 +48,29 @@
 static const char* TAG = "BLE";
 static uint8_t own_addr_type;
 static uint32_t ble_passkey = BLE_PIN_CODE;
-static uint16_t ble_conn_handle;
+
+static struct ble_npl_event ble_tx_event;
+static struct ble_npl_callout ble_tx_retry_timer;
+static struct ble_npl_callout ble_tx_coalesce_timer;
+static struct ble_npl_callout ble_link_adapt_timer;
+#if BLE_BOOT_FAST_START
+static struct ble_npl_event ble_init_late_event;
+static bool ble_init_late_done = false;
+#endif
+static uint32_t ble_tx_coalesce_deadline_ms = BLE_TX_COALESCE_DEADLINE_MS;
+static portMUX_TYPE ble_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static ble_tx_watermark_handler_t ble_tx_watermark_handler = NULL;
+static ble_tx_producer_t ble_tx_producer = NULL;
+static ble_tx_producer_stats_t ble_tx_producer_stats;
+static uint32_t ble_tx_producer_since;    /* Registration time */
+static uint32_t ble_tx_producer_idle_at;  /* Start of the current idle period, 0 while a peer listens */
+static struct ble_npl_callout ble_tx_producer_timer;
+static ble_link_profile_t ble_link_default_profile = BLE_LINK_DEFAULT_PROFILE;
+/* Host task only */
+static uint8_t ble_tx_batch[BLE_TX_BATCH_SIZE];
+#if BLE_LZ_COMPRESSION
+static uint8_t ble_tx_lz_block[BLE_TX_BATCH_SIZE + BLE_LZ_HEADER_SIZE];
+#endif
 
 /******************************************************************************/
 /*                              EXPORTED DATA                                 */
@@ -50,6 +85,22 @@ static uint16_t ble_conn_handle;
 static void ble_api_on_reset(int32_t reason);
 static void ble_api_on_sync(void);
 static void ble_api_host_task(void *arg);
+static void ble_api_advertise_bonded(void);
+static void ble_api_tx_update_watermark(ble_session_t *session);
+static esp_err_t ble_api_tx_batch_count(ble_session_t *session, ble_tx_channel_t channel, uint16_t *count);
+static uint16_t ble_api_tx_batch_build(ble_tx_queue_t *queue, uint16_t count, uint32_t *bytes);
+static esp_err_t ble_api_tx_send_one(ble_session_t *session);
+static esp_err_t ble_api_tx_send_channel(ble_session_t *session, ble_tx_channel_t channel);
+static esp_err_t ble_api_tx_notify_flat(ble_session_t *session, ble_tx_channel_t channel, const uint8_t *data,
+                                        uint16_t length, uint32_t bytes, uint32_t stamp);
+static esp_err_t ble_api_tx_produce(ble_session_t *session);
+static void ble_api_tx_producer_update_idle(void);
+static void ble_api_tx_drain(struct ble_npl_event *ev);
+static void ble_api_link_adapt(struct ble_npl_event *ev);
+static void ble_api_init_late(struct ble_npl_event *ev);
+#if BLE_BOOT_FAST_START
+static void ble_api_init_deferred(void);
+#endif
 
 /******************************************************************************/
 
@@ -59,6 +110,7 @@ static void ble_api_host_task(void *arg);
 static void ble_api_on_reset(int32_t reason)
 {
     ESP_LOGI(TAG, "on_reset() reason %d", reason);
+    ble_adv_on_reset();
 }
 
 /**
@@ -79,10 +131,41 @@ static void ble_api_on_sync(void)
         return;
     }
 
-    /* Begin advertising */
-    ble_api_advertise();
-
     ESP_LOGI(TAG, "on_sync()");
+    ble_boot_mark(BLE_BOOT_SYNCED);
+
+#if BLE_BOOT_FAST_START
+    /* Connectable first: bonds are not loaded yet and a pairing this early
+     * generates its key pair on demand */
+    if(!ble_init_late_done)
+    {
+        ble_api_advertise();
+        return;
+    }
+#endif
+
+#if BLE_PAIR_PRECOMPUTE_KEYS
+    /* Advertising waits for the key pair, a pairing must not race its generation */
+    if(ble_pair_prepare(ble_api_advertise_bonded) == ESP_OK)
+    {
+        return;
+    }
+#endif
+
+    /* Begin advertising, bonded peers get the first chance */
+    ble_api_advertise_bonded();
+}
+
+/**
+ * @brief  Advertise to bonded peers first, the last one directed
+ */
+static void ble_api_advertise_bonded(void)
+{
+#if BLE_BOND_RECONNECT
+    ble_adv_start_reconnect(own_addr_type, true);
+#else
+    ble_api_advertise();
+#endif
 }
 
 /**
@@ -97,6 +180,539 @@ static void ble_api_host_task(void *arg)
     nimble_port_freertos_deinit();
 }
 
+/**
+ * @brief  Notify the application when the default channel queue of a session
+ *         crosses a watermark
+ */
+static void ble_api_tx_update_watermark(ble_session_t *session)
+{
+    uint16_t count = ble_tx_queue_count(ble_tx_sched_queue(&session->tx_sched, BLE_TX_DEFAULT_CHANNEL));
+    bool changed = false;
+    bool throttled;
+
+    portENTER_CRITICAL(&ble_tx_lock);
+    if(!session->tx_throttled && count >= BLE_TX_QUEUE_HIGH_WATERMARK)
+    {
+        session->tx_throttled = 1;
+        changed = true;
+    }
+    else if(session->tx_throttled && count <= BLE_TX_QUEUE_LOW_WATERMARK)
+    {
+        session->tx_throttled = 0;
+        changed = true;
+    }
+    throttled = session->tx_throttled;
+    portEXIT_CRITICAL(&ble_tx_lock);
+
+    if(changed && ble_tx_watermark_handler != NULL)
+    {
+        ble_tx_watermark_handler(session->conn_handle, throttled);
+    }
+}
+
+/**
+ * @brief  Count the queued packets of a channel that fit in one batch, or
+ *         hold them until the batch fills or its oldest packet reaches the
+ *         coalescing deadline. The control channel is never held
+ * @retval ESP_OK when count packets are to be sent
+ *         ESP_ERR_NOT_FOUND while holding, the coalescing timer is armed
+ *         ESP_ERR_INVALID_SIZE when the oldest packet alone does not fit
+ */
+static esp_err_t ble_api_tx_batch_count(ble_session_t *session, ble_tx_channel_t channel, uint16_t *count)
+{
+    ble_tx_queue_t *queue = ble_tx_sched_queue(&session->tx_sched, channel);
+    ble_tx_item_t *item;
+    uint32_t max = session->mtu - BLE_FRAME_ATT_OVERHEAD;
+    uint32_t budget = ble_tx_sched_budget(&session->tx_sched, channel);
+    uint32_t used = 0;
+    uint32_t age;
+    uint16_t n = 0;
+
+    if(session->caps & GATT_SERVER_CAP_LZ)
+    {
+        max -= BLE_LZ_HEADER_SIZE;
+    }
+    if(max > BLE_TX_BATCH_SIZE)
+    {
+        max = BLE_TX_BATCH_SIZE;
+    }
+
+    /* Sized first, copied only once the batch goes. Records count against
+     * the channel budget, headers do not */
+    while((item = ble_tx_queue_peek_at(queue, n)) != NULL)
+    {
+        if(used + ble_batch_header_size(item->length) + item->length > max || item->length > budget)
+        {
+            break;
+        }
+        budget -= item->length;
+        used += ble_batch_header_size(item->length) + item->length;
+        n++;
+    }
+    *count = n;
+    if(n == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* Nothing more fits, nothing more is waiting, or nothing more can be
+     * queued: a full queue gains no record by waiting */
+    if(item != NULL || channel == BLE_TX_CHANNEL_CONTROL || ble_tx_coalesce_deadline_ms == 0 ||
+       max - used <= BLE_BATCH_HEADER_MAX || ble_tx_queue_space(queue) == 0)
+    {
+        return ESP_OK;
+    }
+
+    age = (ble_stats_now() - ble_tx_queue_peek(queue)->timestamp) / 1000;
+    if(age >= ble_tx_coalesce_deadline_ms)
+    {
+        return ESP_OK;
+    }
+    ble_npl_callout_reset(&ble_tx_coalesce_timer, ble_npl_time_ms_to_ticks32(ble_tx_coalesce_deadline_ms - age));
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief  Copy count queued packets of a channel into ble_tx_batch
+ * @retval Length of the batch
+ */
+static uint16_t ble_api_tx_batch_build(ble_tx_queue_t *queue, uint16_t count, uint32_t *bytes)
+{
+    ble_tx_item_t *item;
+    uint16_t length = 0;
+    uint16_t i;
+
+    *bytes = 0;
+    for(i = 0; i < count; i++)
+    {
+        item = ble_tx_queue_peek_at(queue, i);
+        length += ble_batch_put_header(ble_tx_batch + length, item->length);
+        memcpy(ble_tx_batch + length, item->data, item->length);
+        length += item->length;
+        *bytes += item->length;
+    }
+    return length;
+}
+
+/**
+ * @brief  Hand one credit to the channel picked by the scheduler, skipping
+ *         channels that hold a batch
+ * @retval Same as ble_api_tx_send_channel
+ */
+static esp_err_t ble_api_tx_send_one(ble_session_t *session)
+{
+    ble_tx_channel_t channel;
+    esp_err_t rc;
+    uint8_t i;
+
+    if(session->tx_in_flight >= BLE_TX_MAX_IN_FLIGHT)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for(i = 0; i < BLE_TX_CHANNELS; i++)
+    {
+        if(ble_tx_sched_next(&session->tx_sched, &channel) == NULL)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+        rc = ble_api_tx_send_channel(session, channel);
+        if(rc != ESP_ERR_NOT_FOUND)
+        {
+            return rc;
+        }
+        ble_tx_sched_skip(&session->tx_sched);
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief  Hand the oldest queued packet of a channel to the stack, or a
+ *         batch of them when the client asked for batches
+ * @retval ESP_OK when packets left the queue
+ *         ESP_ERR_NOT_FOUND when the channel holds a batch
+ *         ESP_ERR_NO_MEM when the mbuf pool is exhausted
+ */
+static esp_err_t ble_api_tx_send_channel(ble_session_t *session, ble_tx_channel_t channel)
+{
+    ble_tx_queue_t *queue = ble_tx_sched_queue(&session->tx_sched, channel);
+    ble_tx_item_t *item = ble_tx_queue_peek(queue);
+    const uint8_t *data;
+    uint16_t length;
+    uint16_t count = 1;
+    uint32_t bytes;
+    esp_err_t rc;
+
+    if(session->caps & GATT_SERVER_CAP_BATCH)
+    {
+        rc = ble_api_tx_batch_count(session, channel, &count);
+        if(rc == ESP_ERR_INVALID_SIZE)
+        {
+            /* Queued before the client asked for batches, too long now */
+            session->stats.notify_fails++;
+            BLE_TRACE(API, BLE_TRACE_ERROR, BLE_TRACE_EV_NOTIFY_FAIL, session->conn_handle, BLE_HS_EMSGSIZE);
+            ble_tx_sched_charge(&session->tx_sched, channel, 0, item->length);
+            ble_tx_queue_pop(queue);
+            return ESP_OK;
+        }
+        if(rc != ESP_OK)
+        {
+            return rc;
+        }
+    }
+
+    /* Leave room in the msys pool for incoming data and ATT responses */
+    if(os_msys_num_free() <= BLE_TX_MSYS_RESERVE)
+    {
+        session->stats.mbuf_fails++;
+        return ESP_ERR_NO_MEM;
+    }
+
+    if(session->caps & GATT_SERVER_CAP_BATCH)
+    {
+        length = ble_api_tx_batch_build(queue, count, &bytes);
+        data = ble_tx_batch;
+    }
+    else
+    {
+        length = item->length;
+        bytes = item->length;
+        data = item->data;
+    }
+
+    rc = ble_api_tx_notify_flat(session, channel, data, length, bytes, item->timestamp);
+    if(rc == ESP_ERR_NO_MEM)
+    {
+        return rc;
+    }
+
+    /* A failed batch is dropped whole, like a failed packet */
+    ble_tx_sched_charge(&session->tx_sched, channel, count, bytes);
+    while(count-- > 0)
+    {
+        ble_tx_queue_pop(queue);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief  Compress when negotiated and send one notification
+ * @retval ESP_OK when sent
+ *         ESP_ERR_NO_MEM when the mbuf pool is exhausted, to be retried
+ *         ESP_FAIL when the stack refused it, the data is lost
+ */
+static esp_err_t ble_api_tx_notify_flat(ble_session_t *session, ble_tx_channel_t channel, const uint8_t *data,
+                                        uint16_t length, uint32_t bytes, uint32_t stamp)
+{
+    struct os_mbuf *om;
+    esp_err_t rc;
+
+#if BLE_LZ_COMPRESSION
+    /* Encoded on every attempt, the history only moves once the stack
+     * accepted the block */
+    if(session->caps & GATT_SERVER_CAP_LZ)
+    {
+        length = ble_lz_encode(&session->lz, data, length, ble_tx_lz_block);
+        data = ble_tx_lz_block;
+    }
+#endif
+
+    om = ble_hs_mbuf_from_flat(data, length);
+    if(om == NULL)
+    {
+        session->stats.mbuf_fails++;
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* BLE_GAP_EVENT_NOTIFY_TX fires from inside the call, whatever the
+     * result, so the credit is taken and the item stamped before */
+    session->tx_in_flight++;
+    session->tx_stamp = stamp;
+    session->tx_channel = channel;
+
+    /* The stack consumes om whatever the result */
+    rc = ble_gattc_notify_custom(session->conn_handle, gatt_server_get_tx_handle(), om);
+    if(rc == BLE_HS_ENOMEM)
+    {
+        session->stats.mbuf_fails++;
+        return ESP_ERR_NO_MEM;
+    }
+    if(rc != ESP_OK)
+    {
+        session->stats.notify_fails++;
+        BLE_TRACE(API, BLE_TRACE_ERROR, BLE_TRACE_EV_NOTIFY_FAIL, session->conn_handle, rc);
+        return ESP_FAIL;
+    }
+
+#if BLE_LZ_COMPRESSION
+    if(session->caps & GATT_SERVER_CAP_LZ)
+    {
+        ble_lz_commit(&session->lz);
+    }
+#endif
+    ble_stats_tx(&session->stats, bytes);
+    session->stats.tx_wire_bytes += length;
+    BLE_TRACE(API, BLE_TRACE_DEBUG, BLE_TRACE_EV_NOTIFY, session->conn_handle, bytes);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Ask the producer for one notification, once the queues are empty
+ * @retval ESP_OK when the producer was called
+ *         ESP_ERR_NOT_FOUND when it is not to be called or had nothing
+ *         ESP_ERR_NO_MEM when the mbuf pool is exhausted
+ */
+static esp_err_t ble_api_tx_produce(ble_session_t *session)
+{
+    ble_tx_producer_t producer = ble_tx_producer;
+    uint8_t *buffer = ble_tx_batch + BLE_BATCH_HEADER_MAX;
+    uint32_t max = session->mtu - BLE_FRAME_ATT_OVERHEAD;
+    uint32_t start;
+    size_t size;
+    uint16_t header = 0;
+    uint8_t channel;
+    esp_err_t rc;
+
+    if(producer == NULL || !session->subscribed || session->tx_in_flight >= BLE_TX_MAX_IN_FLIGHT)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* A batch still coalescing is not sent yet either, it goes first */
+    for(channel = 0; channel < BLE_TX_CHANNELS; channel++)
+    {
+        if(ble_tx_queue_count(&session->tx_sched.queues[channel]) != 0)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    if(os_msys_num_free() <= BLE_TX_MSYS_RESERVE)
+    {
+        session->stats.mbuf_fails++;
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Room left around the payload for the batch header and the LZ block */
+    if(session->caps & GATT_SERVER_CAP_LZ)
+    {
+        max -= BLE_LZ_HEADER_SIZE;
+    }
+    if(session->caps & GATT_SERVER_CAP_BATCH)
+    {
+        max -= BLE_BATCH_HEADER_MAX;
+    }
+    if(max > BLE_TX_BATCH_SIZE - BLE_BATCH_HEADER_MAX)
+    {
+        max = BLE_TX_BATCH_SIZE - BLE_BATCH_HEADER_MAX;
+    }
+
+    start = ble_stats_now();
+    size = producer(session->conn_handle, buffer, max);
+    ble_tx_producer_stats.busy_us += ble_stats_now() - start;
+    ble_tx_producer_stats.calls++;
+    if(size > max)
+    {
+        /* Overran the buffer or miscounted, nothing of it can be trusted */
+        ble_tx_producer_stats.refused++;
+        BLE_TRACE(API, BLE_TRACE_ERROR, BLE_TRACE_EV_PRODUCER_REFUSED, session->conn_handle, size);
+        ble_npl_callout_reset(&ble_tx_producer_timer, ble_npl_time_ms_to_ticks32(BLE_TX_PRODUCER_POLL_MS));
+        return ESP_ERR_NOT_FOUND;
+    }
+    if(size == 0)
+    {
+        /* Nothing yet, ask again later rather than spinning on the credit */
+        ble_tx_producer_stats.empty++;
+        ble_npl_callout_reset(&ble_tx_producer_timer, ble_npl_time_ms_to_ticks32(BLE_TX_PRODUCER_POLL_MS));
+        return ESP_ERR_NOT_FOUND;
+    }
+    ble_tx_producer_stats.produced++;
+    ble_tx_producer_stats.bytes += size;
+
+    /* A batch of one record, its header right in front of the payload */
+    if(session->caps & GATT_SERVER_CAP_BATCH)
+    {
+        header = ble_batch_header_size(size);
+        ble_batch_put_header(buffer - header, size);
+    }
+
+    /* Produced on demand, the data is lost if the stack refuses it */
+    rc = ble_api_tx_notify_flat(session, BLE_TX_DEFAULT_CHANNEL, buffer - header, size + header, size, start);
+    return rc == ESP_ERR_NO_MEM ? rc : ESP_OK;
+}
+
+/**
+ * @brief  Track whether any peer listens, the producer is idle otherwise
+ */
+static void ble_api_tx_producer_update_idle(void)
+{
+    ble_session_t *session;
+    uint32_t now = ble_stats_now();
+    bool listening = false;
+    uint8_t i;
+
+    for(i = 0; i < BLE_SESSION_MAX; i++)
+    {
+        session = ble_session_at(i);
+        if(session != NULL && session->subscribed)
+        {
+            listening = true;
+            break;
+        }
+    }
+
+    if(listening && ble_tx_producer_idle_at != 0)
+    {
+        ble_tx_producer_stats.idle_us += now - ble_tx_producer_idle_at;
+        ble_tx_producer_idle_at = 0;
+    }
+    else if(!listening && ble_tx_producer_idle_at == 0)
+    {
+        ble_tx_producer_idle_at = now | 1;
+    }
+}
+
+/**
+ * @brief  Hand queued data to the stack while credits and mbufs are available
+ *         Sessions are served round robin, one packet each per pass. Always
+ *         runs in the host task so notifications keep their order
+ */
+static void ble_api_tx_drain(struct ble_npl_event *ev)
+{
+    ble_session_t *session;
+    bool progress = true;
+    esp_err_t rc;
+    uint8_t i;
+
+    /* Also picks up a producer registered from another task */
+    if(ble_tx_producer != NULL)
+    {
+        ble_api_tx_producer_update_idle();
+    }
+
+    while(progress)
+    {
+        progress = false;
+        for(i = 0; i < BLE_SESSION_MAX; i++)
+        {
+            session = ble_session_at(i);
+            if(session == NULL)
+            {
+                continue;
+            }
+
+            ble_frame_tx_refill(session);
+            rc = ble_api_tx_send_one(session);
+            if(rc == ESP_ERR_NOT_FOUND)
+            {
+                rc = ble_api_tx_produce(session);
+            }
+            if(rc == ESP_ERR_NO_MEM)
+            {
+                /* Pool exhausted, buffers are returned once the controller sends */
+                ble_npl_callout_reset(&ble_tx_retry_timer, ble_npl_time_ms_to_ticks32(BLE_TX_RETRY_MS));
+                progress = false;
+                break;
+            }
+            if(rc == ESP_OK)
+            {
+                progress = true;
+            }
+        }
+    }
+
+    for(i = 0; i < BLE_SESSION_MAX; i++)
+    {
+        session = ble_session_at(i);
+        if(session != NULL)
+        {
+            ble_api_tx_update_watermark(session);
+        }
+    }
+}
+
+/**
+ * @brief  Sample backlog and rx rate of ADAPTIVE links, runs every
+ *         BLE_LINK_ADAPT_PERIOD_MS while connected
+ */
+static void ble_api_link_adapt(struct ble_npl_event *ev)
+{
+    ble_link_adapt_level_t level;
+    ble_session_t *session;
+    uint32_t backlog;
+    uint8_t channel;
+    uint8_t i;
+
+    for(i = 0; i < BLE_SESSION_MAX; i++)
+    {
+        session = ble_session_at(i);
+        if(session == NULL || session->link.profile != BLE_LINK_PROFILE_ADAPTIVE)
+        {
+            continue;
+        }
+
+        /* Counts are read without the lock, an approximate backlog is enough */
+        backlog = session->tx_in_flight;
+        for(channel = 0; channel < BLE_TX_CHANNELS; channel++)
+        {
+            backlog += ble_tx_queue_count(&session->tx_sched.queues[channel]);
+        }
+
+        level = ble_link_adapt(session->conn_handle, &session->link, backlog, session->stats.rx_bytes);
+        if(level != BLE_LINK_ADAPT_KEEP)
+        {
+            BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_LINK_ADAPT, session->conn_handle, level);
+        }
+    }
+
+    if(ble_session_count() > 0)
+    {
+        ble_npl_callout_reset(&ble_link_adapt_timer, ble_npl_time_ms_to_ticks32(BLE_LINK_ADAPT_PERIOD_MS));
+    }
+}
+
+/**
+ * @brief  Initialization not needed to become connectable: bond store and
+ *         link cache, L2CAP CoC server. Host task once deferred
+ */
+static void ble_api_init_late(struct ble_npl_event *ev)
+{
+    esp_err_t rc;
+
+    ESP_ERROR_CHECK(ble_bond_init());
+#if BLE_BOOT_FAST_START
+    /* Keys have somewhere to go from now on */
+    ble_hs_cfg.sm_bonding = BLE_BONDING_FLAG;
+#endif
+
+    /* Bulk transport alongside the GATT UART */
+    rc = ble_coc_init();
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error starting L2CAP CoC server; rc = %d", rc);
+    }
+
+#if BLE_BOOT_FAST_START
+    ble_init_late_done = true;
+#if BLE_PAIR_PRECOMPUTE_KEYS
+    /* ble_api_on_sync() advertised without it, nothing waits for the pair */
+    ble_pair_prepare(NULL);
+#endif
+#endif
+    ble_boot_mark(BLE_BOOT_DEFERRED_DONE);
+}
+
+#if BLE_BOOT_FAST_START
+/**
+ * @brief  Deferred step, hands the late initialization to the host task
+ */
+static void ble_api_init_deferred(void)
+{
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ble_init_late_event);
+}
+#endif
+
 /**
  * The nimble host executes this callback when a GAP event occurs
  * The application associates a GAP event callback with each connection that forms
@@ -109,6 +725,8 @@ static void ble_api_host_task(void *arg)
 static int32_t ble_api_gap_event(struct ble_gap_event *event, void *arg)
 {
     struct ble_gap_conn_desc desc;
+    ble_link_cache_t cache;
+    ble_session_t *session;
     esp_err_t rc;
 
     switch(event->type)
@@ -122,49 +740,186 @@ static int32_t ble_api_gap_event(struct ble_gap_event *event, void *arg)
         {
             rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
             assert(rc == 0);
+            ble_adv_on_connect();
         }
         if(event->connect.status != 0)
         {
             /* Connection failed, resume advertising */
             ble_api_advertise();
+            break;
         }
         
-        ble_conn_handle = event->connect.conn_handle;
+        session = ble_session_open(event->connect.conn_handle);
+        if(session == NULL)
+        {
+            ESP_LOGE(TAG, "No free session for conn %d", event->connect.conn_handle);
+            ble_gap_terminate(event->connect.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+            break;
+        }
+        ble_pair_on_connect(&session->pair);
+        ble_boot_mark(BLE_BOOT_CONNECTED);
+
+#if BLE_PAIR_INITIATE
+        /* Saves the central a failed access before it pairs, bonded peers reencrypt */
+        rc = ble_gap_security_initiate(session->conn_handle);
+        if(rc != 0)
+        {
+            ESP_LOGE(TAG, "Error initiating security; rc = %d", rc);
+        }
+#endif
+
+        /* A bonded peer gets what it settled on last time, without renegotiating */
+        ble_link_open(session->conn_handle, &session->link, ble_link_default_profile,
+                      ble_bond_load(&desc.peer_id_addr, &cache) == ESP_OK ? &cache : NULL);
+        if(!ble_npl_callout_is_active(&ble_link_adapt_timer))
+        {
+            ble_npl_callout_reset(&ble_link_adapt_timer, ble_npl_time_ms_to_ticks32(BLE_LINK_ADAPT_PERIOD_MS));
+        }
+
+        /* Advertising stops on connect, keep accepting centrals while slots remain */
+        if(ble_session_count() < BLE_SESSION_MAX)
+        {
+            ble_api_advertise();
+        }
         break;
     
     /* Connection terminated, resume advertising */
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGI(TAG, "Disconnected, reason %d", event->disconnect.reason);
-        ble_api_advertise();
+        ble_frame_close(event->disconnect.conn.conn_handle);
+#if BLE_OTA_SERVICE
+        ble_ota_close(event->disconnect.conn.conn_handle);
+#endif
+        session = ble_session_find(event->disconnect.conn.conn_handle);
+        if(session != NULL && event->disconnect.conn.sec_state.bonded)
+        {
+            cache.mtu = session->mtu;
+            cache.conn_itvl = session->link.conn_itvl;
+            cache.conn_latency = session->link.conn_latency;
+            cache.supervision_timeout = session->link.supervision_timeout;
+            cache.tx_phy = session->link.tx_phy;
+            cache.rx_phy = session->link.rx_phy;
+            rc = ble_bond_save(&event->disconnect.conn.peer_id_addr, &cache);
+            if(rc != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Error saving bonded peer; rc = %d", rc);
+            }
+        }
+        ble_session_close(event->disconnect.conn.conn_handle);
+        ble_api_tx_producer_update_idle();
+
+        /* A bonded peer that dropped is the most likely next central */
+        if(session != NULL && event->disconnect.conn.sec_state.bonded)
+        {
+            ble_api_advertise_bonded();
+        }
+        else if(ble_gap_adv_active() == 0)
+        {
+            ble_api_advertise();
+        }
         break;
     
     case BLE_GAP_EVENT_CONN_UPDATE:
-        ESP_LOGI(TAG, "Connection updated");
+        BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_CONN_UPDATE, event->conn_update.conn_handle,
+                  event->conn_update.status);
         rc = ble_gap_conn_find(event->conn_update.conn_handle, &desc);
         assert(rc == ESP_OK);
+        session = ble_session_find(event->conn_update.conn_handle);
+        if(session != NULL)
+        {
+            ble_link_on_conn_update(session->conn_handle, &session->link, event->conn_update.status);
+        }
+        break;
+
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_PHY_UPDATE, event->phy_updated.conn_handle,
+                  (event->phy_updated.tx_phy << 8) | event->phy_updated.rx_phy);
+        session = ble_session_find(event->phy_updated.conn_handle);
+        if(session != NULL)
+        {
+            ble_link_on_phy_update(&session->link, event->phy_updated.status,
+                                   event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        }
         break;
 
     case BLE_GAP_EVENT_ADV_COMPLETE:
-        ESP_LOGI(TAG, "Advertise complete");
-        ble_api_advertise();
+        ESP_LOGI(TAG, "Advertise complete, reason %d", event->adv_complete.reason);
+        ble_adv_on_complete(event->adv_complete.reason);
         break;
     
     case BLE_GAP_EVENT_ENC_CHANGE:
-        ESP_LOGI(TAG, "Encryptrion change event");
+        BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_ENC_CHANGE, event->enc_change.conn_handle,
+                  event->enc_change.status);
         rc = ble_gap_conn_find(event->enc_change.conn_handle, &desc);
         assert(rc == ESP_OK);
+        session = ble_session_find(event->enc_change.conn_handle);
+        if(session != NULL)
+        {
+            ble_pair_on_enc_change(&session->pair, event->enc_change.status);
+            session->key_size = desc.sec_state.key_size;
+            session->security = desc.sec_state.authenticated ? BLE_SESSION_SECURITY_AUTHENTICATED :
+                                desc.sec_state.encrypted ? BLE_SESSION_SECURITY_ENCRYPTED :
+                                BLE_SESSION_SECURITY_NONE;
+        }
         break;
 
     case BLE_GAP_EVENT_SUBSCRIBE:
-        ESP_LOGI(TAG, "Subcribe event");
+        BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_SUBSCRIBE, event->subscribe.conn_handle,
+                  event->subscribe.cur_notify);
+        session = ble_session_find(event->subscribe.conn_handle);
+        if(session != NULL && event->subscribe.attr_handle == gatt_server_get_tx_handle())
+        {
+            session->subscribed = event->subscribe.cur_notify;
+            if(!session->subscribed)
+            {
+                ble_tx_sched_flush(&session->tx_sched);
+                ble_api_tx_update_watermark(session);
+            }
+            ble_api_tx_producer_update_idle();
+
+            /* A new listener gets its first notification from the producer */
+            ble_api_tx_schedule();
+        }
+        break;
+
+    /* Notification handed to the controller, release its credit */
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        BLE_TRACE(API, BLE_TRACE_DEBUG, BLE_TRACE_EV_NOTIFY_TX, event->notify_tx.conn_handle,
+                  event->notify_tx.status);
+        session = ble_session_find(event->notify_tx.conn_handle);
+        /* Rx stream acks and OTA notifications take no credit and carry no stamp */
+        if(session != NULL && !event->notify_tx.indication &&
+           event->notify_tx.attr_handle == gatt_server_get_tx_handle())
+        {
+            if(session->tx_in_flight > 0)
+            {
+                session->tx_in_flight--;
+            }
+            if(event->notify_tx.status == 0)
+            {
+                ble_stats_record(&session->stats, BLE_STATS_NOTIFY_TO_TX, session->tx_stamp);
+                ble_stats_record(&session->stats, BLE_STATS_CONTROL_TO_TX + session->tx_channel, session->tx_stamp);
+            }
+        }
+        ble_api_tx_schedule();
         break;
 
     case BLE_GAP_EVENT_MTU:
-        ESP_LOGI(TAG, "MTU update event, mtu %d", event->mtu.value);
+        BLE_TRACE(API, BLE_TRACE_INFO, BLE_TRACE_EV_MTU, event->mtu.conn_handle, event->mtu.value);
+        session = ble_session_find(event->mtu.conn_handle);
+        if(session != NULL)
+        {
+            session->mtu = event->mtu.value;
+        }
         break;
 
     case BLE_GAP_EVENT_PASSKEY_ACTION:
         ESP_LOGI(TAG, "Passkey event");
+        session = ble_session_find(event->passkey.conn_handle);
+        if(session != NULL)
+        {
+            ble_pair_on_passkey(&session->pair);
+        }
         struct ble_sm_io pkey = {0};
         if(event->passkey.params.action == BLE_SM_IOACT_DISP)
         {
@@ -189,90 +944,228 @@ static int32_t ble_api_gap_event(struct ble_gap_event *event, void *arg)
  */
 void ble_api_advertise(void)
 {
-    struct ble_gap_adv_params adv_params;
-    struct ble_hs_adv_fields fields;
-    const char *name;
-    esp_err_t rc;
+    ble_adv_start(own_addr_type);
+}
+
+#if BLE_SCAN_OBSERVER
+/**
+ * @brief  Start scanning for advertisers
+ */
+esp_err_t ble_api_scan_start(int32_t duration_ms)
+{
+    return ble_scan_start(own_addr_type, duration_ms);
+}
+#endif
 
-    /**
-     *  Set the advertisement data included in our advertisements:
-     *     o Flags (indicates advertisement type and other general info).
-     *     o Advertising tx power.
-     *     o Device name.
-     *     o 16-bit service UUIDs (alert notifications).
-     */
-    memset(&fields, 0, sizeof fields);
-
-    /* Advertise two flags:
-     *     o Discoverability in forthcoming advertisement (general)
-     *     o BLE-only (BR/EDR unsupported).
-     */
-    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
-
-    /* Indicate that the TX power level field should be included; have the
-     * stack fill this value automatically.  This is done by assigning the
-     * special value BLE_HS_ADV_TX_PWR_LVL_AUTO.
-     */
-    fields.tx_pwr_lvl_is_present = 1;
-    fields.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
-
-    name = ble_svc_gap_device_name();
-    fields.name = (uint8_t *)name;
-    fields.name_len = strlen(name);
-    fields.name_is_complete = 1;
-
-    fields.uuids16 = (ble_uuid16_t[]) {
-        BLE_UUID16_INIT(UART_SERVICE_ULUID16)
-    };
-    fields.num_uuids16 = 1;
-    fields.uuids16_is_complete = 1;
-
-    /* Setting advertisement data */
-    rc = ble_gap_adv_set_fields(&fields);
+/**
+ * @brief  Setup local mtu that will be used to negotiate mtu during request from client peer
+ */
+void ble_api_set_mtu(uint16_t mtu)
+{
+    esp_err_t rc = ble_att_set_preferred_mtu(mtu);
     if(rc != ESP_OK)
     {
-        ESP_LOGE(TAG, "Error setting advertisement data; rc = %d", rc);
-        return;
+        ESP_LOGE(TAG, "Error set local mtu; rc = %d", rc);
     }
+}
 
-    /* Begin advertising. */
-    memset(&adv_params, 0, sizeof adv_params);
-    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
-    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_ADV_DURATION_MS,
-                           &adv_params, ble_api_gap_event, NULL);
+/**
+ * @brief  Queue tx data for every subscribed peer, never blocks
+ */
+esp_err_t ble_api_tx_notify(const uint8_t *data, size_t size)
+{
+    ble_session_t *session;
+    esp_err_t result = ESP_ERR_INVALID_STATE;
+    esp_err_t rc;
+    uint8_t i;
 
-    if(rc != ESP_OK)
+    for(i = 0; i < BLE_SESSION_MAX; i++)
     {
-        ESP_LOGE(TAG, "Error enabling advertisement; rc = %d", rc);
-        return;
+        session = ble_session_at(i);
+        if(session == NULL || !session->subscribed)
+        {
+            continue;
+        }
+
+        rc = ble_tx_queue_push(ble_tx_sched_queue(&session->tx_sched, BLE_TX_DEFAULT_CHANNEL), data, size);
+        ble_api_tx_update_watermark(session);
+        if(rc != ESP_OK)
+        {
+            result = rc;
+        }
+        else if(result == ESP_ERR_INVALID_STATE)
+        {
+            result = ESP_OK;
+        }
     }
+
+    if(result == ESP_OK || result == ESP_ERR_NO_MEM)
+    {
+        ble_api_tx_schedule();
+    }
+    return result;
 }
 
 /**
- * @brief  Setup local mtu that will be used to negotiate mtu during request from client peer
+ * @brief  Queue tx data for one peer, never blocks
  */
-void ble_api_set_mtu(uint16_t mtu)
+esp_err_t ble_api_tx_notify_conn(uint16_t conn_handle, const uint8_t *data, size_t size)
 {
-    esp_err_t rc = ble_att_set_preferred_mtu(mtu);
+    return ble_api_tx_notify_channel(conn_handle, BLE_TX_DEFAULT_CHANNEL, data, size);
+}
+
+/**
+ * @brief  Queue tx data for one peer on one channel, never blocks
+ */
+esp_err_t ble_api_tx_notify_channel(uint16_t conn_handle, ble_tx_channel_t channel, const uint8_t *data, size_t size)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    esp_err_t rc;
+
+    if(session == NULL || !session->subscribed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(channel >= BLE_TX_CHANNELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    rc = ble_tx_queue_push(ble_tx_sched_queue(&session->tx_sched, channel), data, size);
+    ble_api_tx_update_watermark(session);
     if(rc != ESP_OK)
     {
-        ESP_LOGE(TAG, "Error set local mtu; rc = %d", rc);
+        return rc;
     }
+
+    ble_api_tx_schedule();
+    return ESP_OK;
 }
 
 /**
- * @brief  Send tx data via ble
+ * @brief  Wake the host task to drain the tx queues, safe from any task
  */
-void ble_api_tx_notify(uint8_t *data, size_t size)
+void ble_api_tx_schedule(void)
 {
-    struct os_mbuf *om;
-    esp_err_t rc;
+    /* Putting an already queued event is a no-op */
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ble_tx_event);
+}
 
-    om = ble_hs_mbuf_from_flat(data, size);
-    rc = ble_gattc_notify_custom(ble_conn_handle, gatt_server_get_tx_handle(), om);
-    assert(rc == ESP_OK);
-    ESP_LOGE(TAG, "Notify success");
+/**
+ * @brief  Set how long a partly filled batch waits for more packets
+ */
+void ble_api_set_tx_coalescing(uint32_t deadline_ms)
+{
+    ble_tx_coalesce_deadline_ms = deadline_ms;
+}
+
+/**
+ * @brief  Register callback to throttle producers on tx queue watermarks
+ */
+void ble_api_register_tx_watermark_handler(ble_tx_watermark_handler_t callback)
+{
+    ble_tx_watermark_handler = callback;
+}
+
+/**
+ * @brief  Register the pull source of notifications
+ */
+void ble_api_register_tx_producer(ble_tx_producer_t producer)
+{
+    memset(&ble_tx_producer_stats, 0, sizeof(ble_tx_producer_stats_t));
+    ble_tx_producer_since = ble_stats_now();
+    ble_tx_producer_idle_at = 0;
+    ble_tx_producer = producer;
+
+    /* Subscribed peers with free credits are served right away */
+    ble_api_tx_schedule();
+}
+
+/**
+ * @brief  Get invocation and idle counters of the producer
+ */
+void ble_api_get_tx_producer_stats(ble_tx_producer_stats_t *stats)
+{
+    uint32_t now = ble_stats_now();
+
+    *stats = ble_tx_producer_stats;
+    stats->elapsed_us = now - ble_tx_producer_since;
+    if(ble_tx_producer_idle_at != 0)
+    {
+        stats->idle_us += now - ble_tx_producer_idle_at;
+    }
+}
+
+/**
+ * @brief  Select the link profile requested on new connections
+ */
+void ble_api_set_default_link_profile(ble_link_profile_t profile)
+{
+    ble_link_default_profile = profile;
+}
+
+/**
+ * @brief  Request the link profile on an established connection
+ */
+esp_err_t ble_api_set_link_profile(uint16_t conn_handle, ble_link_profile_t profile)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+
+    if(session == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ble_link_apply(conn_handle, &session->link, profile);
+}
+
+/**
+ * @brief  Get the profile of a connection and what was actually negotiated
+ */
+esp_err_t ble_api_get_link_info(uint16_t conn_handle, ble_link_info_t *info)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+
+    if(session == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *info = session->link;
+    info->mtu = session->mtu;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get the hot path counters and latency histograms of a connection
+ */
+esp_err_t ble_api_get_stats(uint16_t conn_handle, ble_stats_t *stats)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+
+    if(session == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *stats = session->stats;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get the queue counters of one tx channel of a connection
+ */
+esp_err_t ble_api_get_tx_channel_stats(uint16_t conn_handle, ble_tx_channel_t channel, ble_tx_channel_stats_t *stats)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+
+    if(session == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(channel >= BLE_TX_CHANNELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ble_tx_sched_get_stats(&session->tx_sched, channel, stats);
+    return ESP_OK;
 }
 
 /**
@@ -284,30 +1177,70 @@ void ble_api_init(const char *dev_name, uint32_t pin_code)
     ble_passkey = pin_code;
     
     ESP_ERROR_CHECK(esp_nimble_hci_and_controller_init());
+    ble_boot_mark(BLE_BOOT_CONTROLLER_READY);
     nimble_port_init();
 
+    /* Packet buffers are carved out once, before the stack starts */
+    ESP_ERROR_CHECK(ble_pool_init());
+
+    /* TX queues are drained from the host task */
+    ble_session_init();
+    ble_npl_event_init(&ble_tx_event, ble_api_tx_drain, NULL);
+    ble_npl_callout_init(&ble_tx_retry_timer, nimble_port_get_dflt_eventq(), ble_api_tx_drain, NULL);
+    ble_npl_callout_init(&ble_tx_coalesce_timer, nimble_port_get_dflt_eventq(), ble_api_tx_drain, NULL);
+    ble_npl_callout_init(&ble_link_adapt_timer, nimble_port_get_dflt_eventq(), ble_api_link_adapt, NULL);
+    ble_npl_callout_init(&ble_tx_producer_timer, nimble_port_get_dflt_eventq(), ble_api_tx_drain, NULL);
+#if BLE_SCAN_OBSERVER
+    ble_scan_init();
+#endif
+
     /* Initialize the NimBLE host configuration */
     ble_hs_cfg.reset_cb = ble_api_on_reset;
     ble_hs_cfg.sync_cb = ble_api_on_sync;
     
     ble_hs_cfg.sm_io_cap = BLE_IO_TYPE;
+#if BLE_BOOT_FAST_START
+    /* No bond store until the late initialization: a pairing before it
+     * encrypts the link without bonding, keys it cannot store are not asked for */
+    ble_hs_cfg.sm_bonding = 0;
+#else
     ble_hs_cfg.sm_bonding = BLE_BONDING_FLAG;                 /* Security Manager Bond flag */
+#endif
     ble_hs_cfg.sm_mitm = BLE_MITM_FLAG;                       /* Security Manager MITM flag */
     ble_hs_cfg.sm_sc = BLE_USE_SC_FLAG;                       /* Security Manager Secure Connections flag */
 
     rc = gatt_server_init();
     assert(rc == ESP_OK);
 
+#if BLE_OTA_SERVICE
+    rc = ble_ota_init();
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error starting OTA service; rc = %d", rc);
+    }
+#endif
+
     /* Set MTU value and Tx power */
     ble_api_set_mtu(BLE_ATT_MTU_MAX);
 
     /* Set the device name */
-    rc = ble_svc_gap_device_name_set(dev_name);
+    ble_adv_init(ble_api_gap_event);
+    rc = ble_adv_set_name(dev_name);
     if(rc != ESP_OK)
     {
         ESP_LOGE(TAG, "Error set device name; rc = %d", rc);
     }
 
+    /* Bonds and CoC need no attribute handles, they may follow advertising */
+#if BLE_BOOT_FAST_START
+    ble_npl_event_init(&ble_init_late_event, ble_api_init_late, NULL);
+    ESP_ERROR_CHECK(ble_boot_defer(ble_api_init_deferred));
+#else
+    ble_api_init_late(NULL);
+#endif
+    ble_boot_mark(BLE_BOOT_HOST_READY);
+
     nimble_port_freertos_init(ble_api_host_task);
+    ble_boot_mark(BLE_BOOT_HOST_STARTED);
     ESP_LOGI(TAG, "BLE initialized");
 }
\ No newline at end of file
@@ -15,6 +15,10 @@
 
 #include <esp_bt.h>
 
+#include "ble_link.h"
+#include "ble_stats.h"
+#include "ble_tx_sched.h"
+
 /******************************************************************************/
 /*                     EXPORTED TYPES and DEFINITIONS                         */
 /******************************************************************************/
@@ -23,6 +27,29 @@
 #define BLE_MITM_FLAG                                 1
 #define BLE_USE_SC_FLAG                               1
 
+/* Called with true when a connection TX queue reaches BLE_TX_QUEUE_HIGH_WATERMARK
+ * and with false once it drains to BLE_TX_QUEUE_LOW_WATERMARK. Only the
+ * BLE_TX_DEFAULT_CHANNEL queue is watched */
+typedef void (*ble_tx_watermark_handler_t)(uint16_t, bool);
+
+/* Pull source of notifications. Called from the host task with a buffer of
+ * size bytes, the payload one notification carries on that connection, only
+ * when the peer is subscribed and a notify credit is free. Returns the bytes
+ * written, 0 when there is nothing to send yet. Must not block */
+typedef size_t (*ble_tx_producer_t)(uint16_t conn_handle, uint8_t *buffer, size_t size);
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t produced;                  /* Calls that returned data */
+    uint32_t empty;                     /* Calls that returned nothing */
+    uint32_t refused;                   /* Calls that returned more than size, dropped */
+    uint32_t bytes;
+    uint32_t busy_us;                   /* Time spent inside the producer */
+    uint32_t idle_us;                   /* Time without any subscribed peer */
+    uint32_t elapsed_us;                /* Since registration, rates are counts over it */
+} ble_tx_producer_stats_t;
+
 /******************************************************************************/
 /*                              PRIVATE DATA                                  */
 /******************************************************************************/
@@ -43,11 +70,24 @@
  * @brief  Enables advertising with the following parameters:
  *             General discoverable mode
  *             Undirected connectable mode
+ *             Fast interval first, slow interval after BLE_ADV_FAST_DURATION_MS
  * @param  None
  * @retval None
  */
 void ble_api_advertise(void);
 
+#if BLE_SCAN_OBSERVER
+/**
+ * @brief  Start scanning for advertisers, alongside advertising. Reports are
+ *         folded into the device table, read it with ble_scan_drain
+ * @param  duration_ms : scan duration, BLE_HS_FOREVER to scan until
+ *                       ble_scan_stop
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_gap_disc
+ */
+esp_err_t ble_api_scan_start(int32_t duration_ms);
+#endif
+
 /**
  * @brief  Setup local mtu that will be used to negotiate mtu during request from client peer
  * @param  MTU (ATT Maximum Transmission Unit) value
@@ -56,12 +96,136 @@ void ble_api_advertise(void);
 void ble_api_set_mtu(uint16_t mtu);
 
 /**
- * @brief  Send tx data via ble
- * @param  data   : buffer hold data to send
- *         length : length of data (max is BLE_UART_MAX_MTU)
+ * @brief  Queue tx data to be notified to every subscribed peer on
+ *         BLE_TX_DEFAULT_CHANNEL, never blocks
+ * @param  data   : buffer hold data to send, copied before return
+ *         length : length of data (max is BLE_TX_QUEUE_ITEM_SIZE)
+ * @retval ESP_OK when data is queued for every subscribed peer
+ *         ESP_ERR_INVALID_STATE if no peer is subscribed
+ *         ESP_ERR_INVALID_SIZE if data is too long
+ *         ESP_ERR_NO_MEM if the tx queue of at least one peer is full, data
+ *         is dropped for that peer only
+ */
+esp_err_t ble_api_tx_notify(const uint8_t *data, size_t size);
+
+/**
+ * @brief  Queue tx data to be notified to one peer on one channel, never
+ *         blocks. Data of a channel is notified in order, channels are
+ *         interleaved by priority
+ * @param  conn_handle : connection handle of the peer
+ *         channel     : BLE_TX_CHANNEL_CONTROL for short latency sensitive
+ *                       messages, BLE_TX_CHANNEL_REALTIME or
+ *                       BLE_TX_CHANNEL_BULK
+ *         data        : buffer hold data to send, copied before return
+ *         length      : length of data (max is BLE_TX_QUEUE_ITEM_SIZE)
+ * @retval ESP_OK when data is queued
+ *         ESP_ERR_INVALID_STATE if the peer is not connected or not subscribed
+ *         ESP_ERR_INVALID_ARG if channel is unknown
+ *         ESP_ERR_INVALID_SIZE if data is too long
+ *         ESP_ERR_NO_MEM if the channel queue is full, data is dropped
+ */
+esp_err_t ble_api_tx_notify_channel(uint16_t conn_handle, ble_tx_channel_t channel, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Queue tx data to be notified to one peer on BLE_TX_DEFAULT_CHANNEL,
+ *         never blocks
+ * @param  conn_handle : connection handle of the peer
+ *         data        : buffer hold data to send, copied before return
+ *         length      : length of data (max is BLE_TX_QUEUE_ITEM_SIZE)
+ * @retval ESP_OK when data is queued
+ *         ESP_ERR_INVALID_STATE if the peer is not connected or not subscribed
+ *         ESP_ERR_INVALID_SIZE if data is too long
+ *         ESP_ERR_NO_MEM if the tx queue is full, data is dropped
+ */
+esp_err_t ble_api_tx_notify_conn(uint16_t conn_handle, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Wake the host task to drain the tx queues, for layers that fill
+ *         session queues directly. Safe from any task
+ * @param  None
+ * @retval None
+ */
+void ble_api_tx_schedule(void);
+
+/**
+ * @brief  Set how long a partly filled batch waits for more packets, for
+ *         clients that enabled GATT_SERVER_CAP_BATCH
+ * @param  deadline_ms : longest wait of the oldest packet, 0 to send
+ *                       whatever is queued at once
+ * @retval None
+ */
+void ble_api_set_tx_coalescing(uint32_t deadline_ms);
+
+/**
+ * @brief  Register callback to throttle producers on tx queue watermarks
+ * @param  Callback function, called from the caller or the host task
  * @retval None
  */
-void ble_api_tx_notify(uint8_t *data, size_t size);
+void ble_api_register_tx_watermark_handler(ble_tx_watermark_handler_t callback);
+
+/**
+ * @brief  Register the pull source of notifications, served after the queued
+ *         packets. Resets the producer counters. Call after ble_api_init
+ * @param  producer : producer, NULL to remove it
+ * @retval None
+ */
+void ble_api_register_tx_producer(ble_tx_producer_t producer);
+
+/**
+ * @brief  Get invocation and idle counters of the producer
+ * @param  stats : filled with the counters
+ * @retval None
+ */
+void ble_api_get_tx_producer_stats(ble_tx_producer_stats_t *stats);
+
+/**
+ * @brief  Select the link profile requested on new connections
+ * @param  profile : link profile
+ * @retval None
+ */
+void ble_api_set_default_link_profile(ble_link_profile_t profile);
+
+/**
+ * @brief  Request DLE, PHY, connection interval and MTU of a link profile
+ *         on an established connection
+ * @param  conn_handle : connection handle of the peer
+ *         profile     : link profile
+ * @retval ESP_OK when the requests were issued
+ *         ESP_ERR_INVALID_STATE if the peer is not connected
+ *         ESP_ERR_INVALID_ARG for an unknown profile
+ */
+esp_err_t ble_api_set_link_profile(uint16_t conn_handle, ble_link_profile_t profile);
+
+/**
+ * @brief  Get the profile of a connection and what was actually negotiated
+ * @param  conn_handle : connection handle of the peer
+ *         info        : filled with the link state
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if the peer is not connected
+ */
+esp_err_t ble_api_get_link_info(uint16_t conn_handle, ble_link_info_t *info);
+
+/**
+ * @brief  Get the hot path counters and latency histograms of a connection
+ * @param  conn_handle : connection handle of the peer
+ *         stats       : filled with a copy of the counters
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if the peer is not connected
+ */
+esp_err_t ble_api_get_stats(uint16_t conn_handle, ble_stats_t *stats);
+
+/**
+ * @brief  Get the queue counters of one tx channel of a connection. Queueing
+ *         delays are in the BLE_STATS_<channel>_TO_TX histograms of
+ *         ble_api_get_stats
+ * @param  conn_handle : connection handle of the peer
+ *         channel     : channel
+ *         stats       : filled with the counters
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if the peer is not connected
+ *         ESP_ERR_INVALID_ARG if channel is unknown
+ */
+esp_err_t ble_api_get_tx_channel_stats(uint16_t conn_handle, ble_tx_channel_t channel, ble_tx_channel_stats_t *stats);
 
 /**
  * @brief  Init the ble and make it visible
@@ -0,0 +1,91 @@
+/*
+ *  ble_batch.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_batch.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Get the length of the header of a record
+ */
+size_t ble_batch_header_size(size_t size)
+{
+    return size < 0x80 ? 1 : 2;
+}
+
+/**
+ * @brief  Write the header of a record
+ */
+size_t ble_batch_put_header(uint8_t *out, size_t size)
+{
+    if(size < 0x80)
+    {
+        out[0] = size;
+        return 1;
+    }
+    out[0] = 0x80 | (size & 0x7F);
+    out[1] = size >> 7;
+    return 2;
+}
+
+/**
+ * @brief  Split a received batch into its records
+ */
+int32_t ble_batch_for_each(const uint8_t *data, size_t size, ble_batch_record_handler_t callback, void *arg)
+{
+    size_t offset = 0;
+    size_t length;
+    int32_t count = 0;
+
+    while(offset < size)
+    {
+        length = data[offset] & 0x7F;
+        if(data[offset++] & 0x80)
+        {
+            if(offset >= size || (data[offset] & 0x80))
+            {
+                return -1;
+            }
+            length |= data[offset++] << 7;
+        }
+        if(length > size - offset)
+        {
+            return -1;
+        }
+
+        callback(data + offset, length, arg);
+        offset += length;
+        count++;
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*
+ *  ble_batch.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_BATCH_H_
+#define _BLE_BATCH_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * A batch packs several records into one notification, each record led by
+ * its length as LEB128: one byte up to 127, two bytes up to 16383. Records
+ * are never split, a batch holds whole records only.
+ */
+#define BLE_BATCH_HEADER_MAX                          2
+#define BLE_BATCH_RECORD_MAX                          0x3FFF
+
+typedef void (*ble_batch_record_handler_t)(const uint8_t *record, size_t size, void *arg);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Get the length of the header of a record
+ * @param  size : length of the record (max is BLE_BATCH_RECORD_MAX)
+ * @retval Header length
+ */
+size_t ble_batch_header_size(size_t size);
+
+/**
+ * @brief  Write the header of a record
+ * @param  out  : destination, at least BLE_BATCH_HEADER_MAX bytes
+ *         size : length of the record (max is BLE_BATCH_RECORD_MAX)
+ * @retval Header length
+ */
+size_t ble_batch_put_header(uint8_t *out, size_t size);
+
+/**
+ * @brief  Split a received batch into its records, for clients
+ * @param  data     : batch
+ *         size     : length of data
+ *         callback : called once per record, in order
+ *         arg      : passed to callback
+ * @retval Number of records
+ *         -1 if the batch is malformed, records before the error were
+ *         delivered
+ */
+int32_t ble_batch_for_each(const uint8_t *data, size_t size, ble_batch_record_handler_t callback, void *arg);
+
+/******************************************************************************/
+
+#endif /* _BLE_BATCH_H_ */
\ No newline at end of file
@@ -0,0 +1,266 @@
+/*
+ *  ble_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <esp_system.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_api.h"
+#include "ble_session.h"
+#include "ble_frame.h"
+#include "ble_pool.h"
+#include "ble_bench.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_BENCH_SEQ_SIZE                            4       /* Sequence number leading every payload */
+
+static const uint32_t ble_bench_per_mille[BLE_BENCH_PERCENTILES] = { 500, 900, 990 };
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "BENCH";
+static volatile bool ble_bench_running = false;
+static ble_bench_config_t ble_bench_config;
+static ble_bench_done_handler_t ble_bench_callback;
+static ble_bench_report_t ble_bench_report;
+static uint8_t *ble_bench_payload;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_bench_pool_sample(uint32_t *peak, uint32_t *fails);
+static void ble_bench_task(void *arg);
+
+/******************************************************************************/
+
+/**
+ * @brief  Sum the packet pool counters over every class
+ */
+static void ble_bench_pool_sample(uint32_t *peak, uint32_t *fails)
+{
+    ble_pool_stats_t stats;
+    ble_pool_class_t pool_class;
+
+    *peak = 0;
+    *fails = 0;
+    for(pool_class = 0; pool_class < BLE_POOL_CLASSES; pool_class++)
+    {
+        ble_pool_get_stats(pool_class, &stats);
+        *peak += stats.peak;
+        *fails += stats.fails;
+    }
+}
+
+/**
+ * @brief  Flood the connection for the configured duration
+ */
+static void ble_bench_task(void *arg)
+{
+    ble_bench_report_t *report = &ble_bench_report;
+    ble_stats_t before;
+    ble_stats_t after;
+    uint32_t pool_fails;
+    uint32_t msys_free;
+    uint32_t heap = esp_get_free_heap_size();
+    uint32_t start;
+    uint32_t seq = 0;
+    uint32_t i;
+    esp_err_t rc;
+
+    ble_api_get_stats(report->conn_handle, &before);
+    ble_bench_pool_sample(&report->pool_peak, &pool_fails);
+    report->msys_min_free = os_msys_num_free();
+    start = ble_stats_now();
+
+    while(ble_stats_now() - start < ble_bench_config.duration_ms * 1000)
+    {
+        memcpy(ble_bench_payload, &seq, BLE_BENCH_SEQ_SIZE);
+        if(ble_bench_config.framed)
+        {
+            rc = ble_frame_send(report->conn_handle, ble_bench_payload, ble_bench_config.payload_size);
+        }
+        else
+        {
+            rc = ble_api_tx_notify_conn(report->conn_handle, ble_bench_payload, ble_bench_config.payload_size);
+        }
+
+        msys_free = os_msys_num_free();
+        if(msys_free < report->msys_min_free)
+        {
+            report->msys_min_free = msys_free;
+        }
+
+        if(rc == ESP_OK)
+        {
+            report->sent++;
+            seq++;
+        }
+        else if(rc == ESP_ERR_NO_MEM)
+        {
+            /* Queue full, let the host task drain it */
+            report->refused++;
+            vTaskDelay(1);
+        }
+        else
+        {
+            report->disconnected = 1;
+            break;
+        }
+    }
+
+    /* Let the queue drain so the tail of the run is in the counters */
+    for(i = 0; i < BLE_BENCH_DRAIN_MS / portTICK_PERIOD_MS; i++)
+    {
+        vTaskDelay(1);
+    }
+    report->elapsed_ms = (ble_stats_now() - start) / 1000;
+    report->heap_delta = (int32_t)(esp_get_free_heap_size() - heap);
+
+    if(ble_api_get_stats(report->conn_handle, &after) == ESP_OK)
+    {
+        ble_stats_diff(&before, &after, &report->stats);
+    }
+    else
+    {
+        report->disconnected = 1;
+    }
+    ble_bench_pool_sample(&report->pool_peak, &report->pool_fails);
+    report->pool_fails -= pool_fails;
+
+    if(report->elapsed_ms > 0)
+    {
+        report->tx_packets_per_s = (uint64_t)report->stats.tx_packets * 1000 / report->elapsed_ms;
+        report->tx_bytes_per_s = (uint64_t)report->stats.tx_bytes * 1000 / report->elapsed_ms;
+        report->rx_packets_per_s = (uint64_t)report->stats.rx_packets * 1000 / report->elapsed_ms;
+        report->rx_bytes_per_s = (uint64_t)report->stats.rx_bytes * 1000 / report->elapsed_ms;
+    }
+    for(i = 0; i < BLE_STATS_HISTS * BLE_BENCH_PERCENTILES; i++)
+    {
+        report->latency_us[i / BLE_BENCH_PERCENTILES][i % BLE_BENCH_PERCENTILES] =
+            ble_stats_percentile(report->stats.hist[i / BLE_BENCH_PERCENTILES],
+                                 ble_bench_per_mille[i % BLE_BENCH_PERCENTILES]);
+    }
+    report->notify_fails = report->stats.notify_fails;
+    report->mbuf_fails = report->stats.mbuf_fails;
+
+    ble_pool_free(ble_bench_payload);
+    ble_bench_payload = NULL;
+    if(ble_bench_callback != NULL)
+    {
+        ble_bench_callback(report);
+    }
+    ble_bench_running = false;
+    vTaskDelete(NULL);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Start a run on one connection, in its own task
+ */
+esp_err_t ble_bench_start(uint16_t conn_handle, const ble_bench_config_t *config,
+                          ble_bench_done_handler_t callback)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    uint32_t i;
+
+    if(ble_bench_running || session == NULL || !session->subscribed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(config->payload_size < BLE_BENCH_SEQ_SIZE ||
+       config->payload_size > (config->framed ? BLE_FRAME_MAX_MESSAGE_SIZE : BLE_TX_QUEUE_ITEM_SIZE))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ble_bench_payload = ble_pool_alloc(config->payload_size);
+    if(ble_bench_payload == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    for(i = 0; i < config->payload_size; i++)
+    {
+        ble_bench_payload[i] = i;
+    }
+
+    memset(&ble_bench_report, 0, sizeof(ble_bench_report));
+    ble_bench_report.conn_handle = conn_handle;
+    ble_bench_config = *config;
+    ble_bench_callback = callback;
+    ble_bench_running = true;
+
+    if(xTaskCreate(ble_bench_task, "ble_bench", BLE_BENCH_STACK_SIZE, NULL, BLE_BENCH_PRIORITY, NULL) != pdPASS)
+    {
+        ble_pool_free(ble_bench_payload);
+        ble_bench_payload = NULL;
+        ble_bench_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Run on conn %d: %u ms, %u byte %s", conn_handle, config->duration_ms,
+             config->payload_size, config->framed ? "messages" : "packets");
+    return ESP_OK;
+}
+
+/**
+ * @brief  Print a report on the console
+ */
+void ble_bench_log(const ble_bench_report_t *report)
+{
+    ESP_LOGI(TAG, "conn %d, %u ms%s, %u sent, %u refused", report->conn_handle, report->elapsed_ms,
+             report->disconnected ? " (disconnected)" : "", report->sent, report->refused);
+    ESP_LOGI(TAG, "tx %u pkt/s %u B/s, rx %u pkt/s %u B/s", report->tx_packets_per_s, report->tx_bytes_per_s,
+             report->rx_packets_per_s, report->rx_bytes_per_s);
+    ESP_LOGI(TAG, "notify to tx p50/p90/p99 %u/%u/%u us", report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P50],
+             report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P90],
+             report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P99]);
+    ESP_LOGI(TAG, "rx to handler p50/p90/p99 %u/%u/%u us, handler p50/p90/p99 %u/%u/%u us",
+             report->latency_us[BLE_STATS_RX_TO_HANDLER][BLE_BENCH_P50],
+             report->latency_us[BLE_STATS_RX_TO_HANDLER][BLE_BENCH_P90],
+             report->latency_us[BLE_STATS_RX_TO_HANDLER][BLE_BENCH_P99],
+             report->latency_us[BLE_STATS_HANDLER][BLE_BENCH_P50],
+             report->latency_us[BLE_STATS_HANDLER][BLE_BENCH_P90],
+             report->latency_us[BLE_STATS_HANDLER][BLE_BENCH_P99]);
+    ESP_LOGI(TAG, "notify fails %u, mbuf fails %u, msys min free %u, pool peak %u fails %u, heap %d",
+             report->notify_fails, report->mbuf_fails, report->msys_min_free, report->pool_peak,
+             report->pool_fails, report->heap_delta);
+}
+
+/**
+ * @brief  Format the headline numbers of a report
+ */
+int32_t ble_bench_format(const ble_bench_report_t *report, char *text, size_t size)
+{
+    return snprintf(text, size, "BENCH ms=%u sent=%u refused=%u tx_pps=%u tx_bps=%u rx_pps=%u rx_bps=%u "
+                    "lat_p50=%u lat_p90=%u lat_p99=%u mbuf_fails=%u pool_fails=%u msys_min=%u%s",
+                    report->elapsed_ms, report->sent, report->refused, report->tx_packets_per_s,
+                    report->tx_bytes_per_s, report->rx_packets_per_s, report->rx_bytes_per_s,
+                    report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P50],
+                    report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P90],
+                    report->latency_us[BLE_STATS_NOTIFY_TO_TX][BLE_BENCH_P99],
+                    report->mbuf_fails, report->pool_fails, report->msys_min_free,
+                    report->disconnected ? " disconnected" : "");
+}
\ No newline at end of file
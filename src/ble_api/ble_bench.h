@@ -0,0 +1,117 @@
+/*
+ *  ble_bench.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_BENCH_H_
+#define _BLE_BENCH_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_stats.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+typedef enum
+{
+    BLE_BENCH_P50 = 0,
+    BLE_BENCH_P90,
+    BLE_BENCH_P99,
+    BLE_BENCH_PERCENTILES
+} ble_bench_percentile_t;
+
+typedef struct
+{
+    uint32_t duration_ms;
+    uint16_t payload_size;              /* Bytes per packet, or per message when framed */
+    uint8_t framed;                     /* Send through ble_frame_send instead of raw notifications */
+} ble_bench_config_t;
+
+/**
+ * One run on a live connection. The device floods the connection with
+ * notifications while the client does whatever the scenario asks (writes,
+ * subscription changes, disconnect), every counter below is the difference
+ * over the run.
+ */
+typedef struct
+{
+    uint16_t conn_handle;
+    uint32_t elapsed_ms;
+    uint8_t disconnected;               /* Run cut short by the client */
+    uint32_t sent;                      /* Packets or messages accepted by the tx path */
+    uint32_t refused;                   /* Sends refused on a full queue */
+    uint32_t tx_packets_per_s;
+    uint32_t tx_bytes_per_s;            /* Payload bytes */
+    uint32_t rx_packets_per_s;
+    uint32_t rx_bytes_per_s;
+    uint32_t latency_us[BLE_STATS_HISTS][BLE_BENCH_PERCENTILES];
+    uint32_t notify_fails;
+    uint32_t mbuf_fails;
+    uint32_t msys_min_free;             /* Lowest free mbuf count seen */
+    uint32_t pool_peak;                 /* Packet pool blocks in use, highest */
+    uint32_t pool_fails;
+    int32_t heap_delta;                 /* Free heap after minus before */
+    ble_stats_t stats;                  /* Raw counters of the run */
+} ble_bench_report_t;
+
+/* Called from the benchmark task once a run ends */
+typedef void (*ble_bench_done_handler_t)(const ble_bench_report_t *report);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Start a run on one connection, in its own task
+ * @param  conn_handle : connection handle of the peer, subscribed to tx
+ *         config      : run parameters
+ *         callback    : called with the report once the run ends
+ * @retval ESP_OK when the run started
+ *         ESP_ERR_INVALID_STATE if a run is going on or the peer is not
+ *         subscribed
+ *         ESP_ERR_INVALID_SIZE if the payload does not fit
+ *         ESP_ERR_NO_MEM if the task or the payload cannot be allocated
+ */
+esp_err_t ble_bench_start(uint16_t conn_handle, const ble_bench_config_t *config,
+                          ble_bench_done_handler_t callback);
+
+/**
+ * @brief  Print a report on the console
+ * @param  report : report of a run
+ * @retval None
+ */
+void ble_bench_log(const ble_bench_report_t *report);
+
+/**
+ * @brief  Format the headline numbers of a report, to send them back to the
+ *         client
+ * @param  report : report of a run
+ *         text   : destination
+ *         size   : capacity of text
+ * @retval Length of the text, as snprintf
+ */
+int32_t ble_bench_format(const ble_bench_report_t *report, char *text, size_t size);
+
+/******************************************************************************/
+
+#endif /* _BLE_BENCH_H_ */
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*
+ *  ble_bond.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <nvs.h>
+#include <host/ble_hs.h>
+#include <host/ble_store.h>
+
+#include "config.h"
+#include "ble_bond.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_BOND_NVS_NAMESPACE                        "ble_bond"
+#define BLE_BOND_NVS_LAST                             "last"
+#define BLE_BOND_NVS_KEY_SIZE                         16      /* 12 hex digits, type and terminator */
+
+/* Not exported by the NimBLE headers, see the IDF examples */
+void ble_store_config_init(void);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "BOND";
+static nvs_handle_t ble_bond_nvs;
+static ble_addr_t ble_bond_last;
+static bool ble_bond_last_valid = false;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_bond_key(const ble_addr_t *addr, char *key);
+static void ble_bond_prune(const ble_addr_t *peers, int count);
+
+/******************************************************************************/
+
+/**
+ * @brief  NVS key of a peer, keys are limited to 15 characters
+ */
+static void ble_bond_key(const ble_addr_t *addr, char *key)
+{
+    snprintf(key, BLE_BOND_NVS_KEY_SIZE, "%02x%02x%02x%02x%02x%02x%u", addr->val[5], addr->val[4],
+             addr->val[3], addr->val[2], addr->val[1], addr->val[0], addr->type & 0x0F);
+}
+
+/**
+ * @brief  Erase the link parameters of peers whose bond was deleted, the
+ *         store drops the oldest bond when full and tells nobody
+ */
+static void ble_bond_prune(const ble_addr_t *peers, int count)
+{
+    char stale[BLE_BOND_MAX][BLE_BOND_NVS_KEY_SIZE];
+    char key[BLE_BOND_NVS_KEY_SIZE];
+    nvs_entry_info_t info;
+    nvs_iterator_t it;
+    int found = 0;
+    int i;
+
+    /* Keys are erased once the iterator is released */
+    it = nvs_entry_find(NVS_DEFAULT_PART_NAME, BLE_BOND_NVS_NAMESPACE, NVS_TYPE_BLOB);
+    while(it != NULL && found < BLE_BOND_MAX)
+    {
+        nvs_entry_info(it, &info);
+        for(i = 0; i < count; i++)
+        {
+            ble_bond_key(&peers[i], key);
+            if(strcmp(info.key, key) == 0)
+            {
+                break;
+            }
+        }
+        if(i == count && strcmp(info.key, BLE_BOND_NVS_LAST) != 0)
+        {
+            snprintf(stale[found++], BLE_BOND_NVS_KEY_SIZE, "%s", info.key);
+        }
+        it = nvs_entry_next(it);
+    }
+    nvs_release_iterator(it);
+
+    for(i = 0; i < found; i++)
+    {
+        ESP_LOGI(TAG, "Erasing link cache of unbonded peer %s", stale[i]);
+        nvs_erase_key(ble_bond_nvs, stale[i]);
+    }
+    if(found > 0)
+    {
+        nvs_commit(ble_bond_nvs);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Rebuild the filter accept list from the bond store, erase the
+ *         link parameters of peers no longer in it
+ */
+uint32_t ble_bond_refresh(void)
+{
+    ble_addr_t peers[BLE_BOND_MAX];
+    int count = 0;
+    int i;
+    esp_err_t rc;
+
+    rc = ble_store_util_bonded_peers(peers, &count, BLE_BOND_MAX);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error reading bonded peers; rc = %d", rc);
+        return 0;
+    }
+
+    /* The last peer may have been unpaired since it disconnected */
+    if(ble_bond_last_valid)
+    {
+        for(i = 0; i < count && ble_addr_cmp(&peers[i], &ble_bond_last) != 0; i++);
+        ble_bond_last_valid = (i < count);
+    }
+    ble_bond_prune(peers, count);
+
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    rc = ble_gap_wl_set(peers, count);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error setting accept list; rc = %d", rc);
+        return 0;
+    }
+    return count;
+}
+
+/**
+ * @brief  Get the bonded peer that disconnected last
+ */
+esp_err_t ble_bond_get_last(ble_addr_t *addr)
+{
+    if(!ble_bond_last_valid)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *addr = ble_bond_last;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get the link parameters a peer ran with on its last connection
+ */
+esp_err_t ble_bond_load(const ble_addr_t *addr, ble_link_cache_t *cache)
+{
+    char key[BLE_BOND_NVS_KEY_SIZE];
+    size_t size = sizeof(ble_link_cache_t);
+
+    ble_bond_key(addr, key);
+    if(nvs_get_blob(ble_bond_nvs, key, cache, &size) != ESP_OK || size != sizeof(ble_link_cache_t))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Store the link parameters of a bonded peer that disconnects
+ */
+esp_err_t ble_bond_save(const ble_addr_t *addr, const ble_link_cache_t *cache)
+{
+    char key[BLE_BOND_NVS_KEY_SIZE];
+    ble_link_cache_t stored;
+    bool dirty = false;
+    esp_err_t rc;
+
+    /* Every reconnect ends the same way, spare the flash */
+    if(ble_bond_load(addr, &stored) != ESP_OK || memcmp(&stored, cache, sizeof(ble_link_cache_t)) != 0)
+    {
+        ble_bond_key(addr, key);
+        rc = nvs_set_blob(ble_bond_nvs, key, cache, sizeof(ble_link_cache_t));
+        if(rc != ESP_OK)
+        {
+            return rc;
+        }
+        dirty = true;
+    }
+
+    if(!ble_bond_last_valid || ble_addr_cmp(&ble_bond_last, addr) != 0)
+    {
+        rc = nvs_set_blob(ble_bond_nvs, BLE_BOND_NVS_LAST, addr, sizeof(ble_addr_t));
+        if(rc != ESP_OK)
+        {
+            return rc;
+        }
+        ble_bond_last = *addr;
+        ble_bond_last_valid = true;
+        dirty = true;
+    }
+
+    return dirty ? nvs_commit(ble_bond_nvs) : ESP_OK;
+}
+
+/**
+ * @brief  Bond store initialization
+ */
+esp_err_t ble_bond_init(void)
+{
+    size_t size = sizeof(ble_addr_t);
+    esp_err_t rc;
+
+    /* Without it bonds live in RAM only and every reboot forces a new pairing */
+    ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
+    ble_store_config_init();
+
+    rc = nvs_open(BLE_BOND_NVS_NAMESPACE, NVS_READWRITE, &ble_bond_nvs);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error opening NVS; rc = %d", rc);
+        return rc;
+    }
+
+    ble_bond_last_valid = (nvs_get_blob(ble_bond_nvs, BLE_BOND_NVS_LAST, &ble_bond_last, &size) == ESP_OK &&
+                           size == sizeof(ble_addr_t));
+    return ESP_OK;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+ *  ble_bond.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_BOND_H_
+#define _BLE_BOND_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_gap.h>
+
+#include "config.h"
+#include "ble_link.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_BOND_MAX                                  MYNEWT_VAL(BLE_STORE_MAX_BONDS)
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Rebuild the filter accept list from the bond store. The controller
+ *         refuses it while advertising, stop advertising first. Link
+ *         parameters of peers no longer bonded are erased
+ * @param  None
+ * @retval Number of bonded peers in the list, 0 when the list is empty or
+ *         could not be set
+ */
+uint32_t ble_bond_refresh(void);
+
+/**
+ * @brief  Get the bonded peer that disconnected last
+ * @param  addr : filled with its identity address
+ * @retval ESP_OK on success
+ *         ESP_ERR_NOT_FOUND if no bonded peer has disconnected yet or its bond
+ *         was deleted since
+ */
+esp_err_t ble_bond_get_last(ble_addr_t *addr);
+
+/**
+ * @brief  Get the link parameters a peer ran with on its last connection
+ * @param  addr  : identity address of the peer
+ *         cache : filled with the parameters
+ * @retval ESP_OK on success
+ *         ESP_ERR_NOT_FOUND if the peer has none stored
+ */
+esp_err_t ble_bond_load(const ble_addr_t *addr, ble_link_cache_t *cache);
+
+/**
+ * @brief  Store the link parameters of a bonded peer that disconnects and
+ *         make it the last peer. Flash is written only when they changed
+ * @param  addr  : identity address of the peer
+ *         cache : parameters of the connection
+ * @retval ESP_OK on success
+ *         Otherwise the NVS error
+ */
+esp_err_t ble_bond_save(const ble_addr_t *addr, const ble_link_cache_t *cache);
+
+/**
+ * @brief  Bond store initialization, persists the NimBLE bond store in NVS
+ *         and loads the last peer. Call before the host task starts
+ * @param  None
+ * @retval ESP_OK on success
+ *         Otherwise the NVS error
+ */
+esp_err_t ble_bond_init(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_BOND_H_ */
\ No newline at end of file
@@ -0,0 +1,182 @@
+/*
+ *  ble_boot.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "config.h"
+#include "ble_boot.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "BOOT";
+
+static const char *const ble_boot_names[BLE_BOOT_STAGES] = {
+    [BLE_BOOT_APP_MAIN] = "app_main",
+    [BLE_BOOT_NVS_READY] = "nvs ready",
+    [BLE_BOOT_CONTROLLER_READY] = "controller ready",
+    [BLE_BOOT_HOST_READY] = "host ready",
+    [BLE_BOOT_HOST_STARTED] = "host started",
+    [BLE_BOOT_SYNCED] = "synced",
+    [BLE_BOOT_ADVERTISING] = "advertising",
+    [BLE_BOOT_CONNECTED] = "connected",
+    [BLE_BOOT_DEFERRED_DONE] = "deferred done",
+};
+
+static ble_boot_times_t ble_boot_times;
+static portMUX_TYPE ble_boot_lock = portMUX_INITIALIZER_UNLOCKED;
+#if BLE_BOOT_FAST_START
+static ble_boot_step_fn *ble_boot_steps[BLE_BOOT_DEFERRED_MAX];
+static uint8_t ble_boot_step_count;
+static bool ble_boot_deferring = true;  /* Until advertising starts */
+#endif
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+#if BLE_BOOT_FAST_START
+static void ble_boot_deferred_task(void *arg);
+#endif
+
+/******************************************************************************/
+
+#if BLE_BOOT_FAST_START
+/**
+ * @brief  Run the deferred steps, off the host core and below its priority
+ */
+static void ble_boot_deferred_task(void *arg)
+{
+    uint8_t i;
+
+    for(i = 0; i < ble_boot_step_count; i++)
+    {
+        ble_boot_steps[i]();
+    }
+    vTaskDelete(NULL);
+}
+#endif
+
+/******************************************************************************/
+
+/**
+ * @brief  Stamp a stage
+ */
+void ble_boot_mark(ble_boot_stage_t stage)
+{
+    uint32_t now = esp_timer_get_time();
+    bool first;
+
+    if(stage >= BLE_BOOT_STAGES)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&ble_boot_lock);
+    first = (ble_boot_times.us[stage] == 0);
+    if(first)
+    {
+        ble_boot_times.us[stage] = now;
+    }
+#if BLE_BOOT_FAST_START
+    if(stage == BLE_BOOT_ADVERTISING)
+    {
+        /* Steps given from now on run at once */
+        ble_boot_deferring = false;
+    }
+#endif
+    portEXIT_CRITICAL(&ble_boot_lock);
+
+#if BLE_BOOT_FAST_START
+    if(first && stage == BLE_BOOT_ADVERTISING && ble_boot_step_count > 0 &&
+       xTaskCreatePinnedToCore(ble_boot_deferred_task, "ble_boot", BLE_BOOT_DEFERRED_STACK_SIZE, NULL,
+                               BLE_BOOT_DEFERRED_PRIORITY, NULL, BLE_BOOT_DEFERRED_CORE) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Error starting deferred init, running it inline");
+        ble_boot_deferred_task(NULL);
+    }
+#endif
+}
+
+/**
+ * @brief  Run a step now or once advertising has started
+ */
+esp_err_t ble_boot_defer(ble_boot_step_fn *step)
+{
+#if BLE_BOOT_FAST_START
+    portENTER_CRITICAL(&ble_boot_lock);
+    if(ble_boot_deferring)
+    {
+        if(ble_boot_step_count >= BLE_BOOT_DEFERRED_MAX)
+        {
+            portEXIT_CRITICAL(&ble_boot_lock);
+            return ESP_ERR_NO_MEM;
+        }
+        ble_boot_steps[ble_boot_step_count++] = step;
+        portEXIT_CRITICAL(&ble_boot_lock);
+        return ESP_OK;
+    }
+    portEXIT_CRITICAL(&ble_boot_lock);
+#endif
+
+    step();
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get the stage timestamps
+ */
+void ble_boot_get_times(ble_boot_times_t *times)
+{
+    portENTER_CRITICAL(&ble_boot_lock);
+    *times = ble_boot_times;
+    portEXIT_CRITICAL(&ble_boot_lock);
+}
+
+/**
+ * @brief  Log the stages reached
+ */
+void ble_boot_log(void)
+{
+    ble_boot_times_t times;
+    uint32_t previous = 0;
+    uint8_t stage;
+
+    ble_boot_get_times(&times);
+    for(stage = 0; stage < BLE_BOOT_STAGES; stage++)
+    {
+        if(times.us[stage] == 0)
+        {
+            continue;
+        }
+        /* Deferred steps may finish after the first connection */
+        ESP_LOGI(TAG, "%-16s at %7u us, %+d us", ble_boot_names[stage], times.us[stage],
+                 (int32_t)(times.us[stage] - previous));
+        previous = times.us[stage];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ *  ble_boot.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_BOOT_H_
+#define _BLE_BOOT_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Milestones from reset to the first connection, each stamped the first
+ * time it is reached in us of esp_timer_get_time(). The timer starts during
+ * application startup, so the bootloader is not counted and APP_MAIN shows
+ * the startup code. 0 means not reached yet.
+ */
+typedef enum
+{
+    BLE_BOOT_APP_MAIN = 0,              /* app_main entered */
+    BLE_BOOT_NVS_READY,                 /* nvs_flash_init done */
+    BLE_BOOT_CONTROLLER_READY,          /* Controller and HCI enabled */
+    BLE_BOOT_HOST_READY,                /* GATT tables registered, host configured */
+    BLE_BOOT_HOST_STARTED,              /* Host task created */
+    BLE_BOOT_SYNCED,                    /* Host and controller synced */
+    BLE_BOOT_ADVERTISING,               /* First advertising start, connectable */
+    BLE_BOOT_CONNECTED,                 /* First central connected */
+    BLE_BOOT_DEFERRED_DONE,             /* Steps left for after advertising are done */
+    BLE_BOOT_STAGES,
+} ble_boot_stage_t;
+
+typedef struct
+{
+    uint32_t us[BLE_BOOT_STAGES];
+} ble_boot_times_t;
+
+/* A piece of initialization not needed to become connectable */
+typedef void ble_boot_step_fn(void);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Stamp a stage, only the first call for a stage counts. Any task
+ * @param  stage : stage reached
+ * @retval None
+ */
+void ble_boot_mark(ble_boot_stage_t stage);
+
+/**
+ * @brief  Run a step now, or with BLE_BOOT_FAST_START once advertising has
+ *         started, in a low priority task on BLE_BOOT_DEFERRED_CORE. Steps
+ *         run in the order they were given
+ * @param  step : step to run
+ * @retval ESP_OK on success
+ *         ESP_ERR_NO_MEM if BLE_BOOT_DEFERRED_MAX steps are waiting
+ */
+esp_err_t ble_boot_defer(ble_boot_step_fn *step);
+
+/**
+ * @brief  Get the stage timestamps
+ * @param  times : filled with the timestamps
+ * @retval None
+ */
+void ble_boot_get_times(ble_boot_times_t *times);
+
+/**
+ * @brief  Log the stages reached and the time each one took
+ * @param  None
+ * @retval None
+ */
+void ble_boot_log(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_BOOT_H_ */
\ No newline at end of file
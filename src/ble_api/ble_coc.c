@@ -0,0 +1,342 @@
+/*
+ *  ble_coc.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_hs.h>
+#include <host/ble_l2cap.h>
+
+#include "config.h"
+#include "ble_trace.h"
+#include "ble_coc.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_COC_BUF_COUNT                             (BLE_COC_BUF_PER_CHANNEL * BLE_COC_MAX_CHANNELS)
+#define BLE_COC_BLOCK_SIZE                            \
+    (BLE_COC_MTU + sizeof(struct os_mbuf) + sizeof(struct os_mbuf_pkthdr))
+
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t peer_mtu;
+    bool stalled;
+    struct ble_l2cap_chan *chan;
+} ble_coc_channel_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "COC";
+static ble_coc_channel_t ble_coc_channels[BLE_COC_MAX_CHANNELS];
+static ble_rx_packet_handler_t ble_coc_rx_handler = NULL;
+static ble_rx_mbuf_handler_t ble_coc_rx_mbuf_handler = NULL;
+static ble_coc_tx_ready_handler_t ble_coc_tx_ready_handler = NULL;
+
+/* SDU buffers come from a dedicated pool. The K-frames the stack segments
+ * them into still come from msys, so sends respect BLE_TX_MSYS_RESERVE */
+static os_membuf_t ble_coc_sdu_mem[OS_MEMPOOL_SIZE(BLE_COC_BUF_COUNT, BLE_COC_BLOCK_SIZE)];
+static struct os_mempool ble_coc_sdu_mempool;
+static struct os_mbuf_pool ble_coc_sdu_pool;
+
+/* Flattens chained SDUs for the flat handler, host task only */
+static uint8_t ble_coc_rx_buffer[BLE_COC_MTU];
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static ble_coc_channel_t *ble_coc_find(uint16_t conn_handle);
+static void ble_coc_rx_ready(struct ble_l2cap_chan *chan);
+static void ble_coc_rx_deliver(uint16_t conn_handle, struct os_mbuf *sdu);
+static int32_t ble_coc_event(struct ble_l2cap_event *event, void *arg);
+
+/******************************************************************************/
+
+/**
+ * @brief  Find the channel of a connection
+ */
+static ble_coc_channel_t *ble_coc_find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for(i = 0; i < BLE_COC_MAX_CHANNELS; i++)
+    {
+        if(ble_coc_channels[i].chan != NULL && ble_coc_channels[i].conn_handle == conn_handle)
+        {
+            return &ble_coc_channels[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Give the stack a buffer for the next SDU, the peer gets credits for it
+ */
+static void ble_coc_rx_ready(struct ble_l2cap_chan *chan)
+{
+    struct os_mbuf *sdu_rx;
+    esp_err_t rc;
+
+    sdu_rx = os_mbuf_get_pkthdr(&ble_coc_sdu_pool, 0);
+    if(sdu_rx == NULL)
+    {
+        ESP_LOGE(TAG, "No SDU buffer, channel stays without credits");
+        return;
+    }
+
+    rc = ble_l2cap_recv_ready(chan, sdu_rx);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error recv ready; rc = %d", rc);
+        os_mbuf_free_chain(sdu_rx);
+    }
+}
+
+/**
+ * @brief  Deliver a received SDU to the registered rx handler
+ */
+static void ble_coc_rx_deliver(uint16_t conn_handle, struct os_mbuf *sdu)
+{
+    uint16_t length;
+
+    if(ble_coc_rx_mbuf_handler != NULL)
+    {
+        ble_coc_rx_mbuf_handler(conn_handle, &sdu);
+    }
+    else if(ble_coc_rx_handler != NULL)
+    {
+        if(SLIST_NEXT(sdu, om_next) == NULL)
+        {
+            ble_coc_rx_handler(conn_handle, sdu->om_data, sdu->om_len);
+        }
+        else
+        {
+            ble_hs_mbuf_to_flat(sdu, ble_coc_rx_buffer, sizeof(ble_coc_rx_buffer), &length);
+            ble_coc_rx_handler(conn_handle, ble_coc_rx_buffer, length);
+        }
+    }
+
+    /* NULL when the mbuf handler took ownership */
+    os_mbuf_free_chain(sdu);
+}
+
+/**
+ * The nimble host executes this callback when an L2CAP event occurs on a
+ * channel of our server
+ */
+static int32_t ble_coc_event(struct ble_l2cap_event *event, void *arg)
+{
+    struct ble_l2cap_chan_info info;
+    ble_coc_channel_t *channel;
+    uint8_t i;
+
+    switch(event->type)
+    {
+    case BLE_L2CAP_EVENT_COC_CONNECTED:
+        ESP_LOGI(TAG, "Channel %s, conn %d status = %d",
+                    event->connect.status == 0 ? "connected" : "failed",
+                    event->connect.conn_handle, event->connect.status);
+        if(event->connect.status != 0)
+        {
+            break;
+        }
+
+        for(i = 0; i < BLE_COC_MAX_CHANNELS; i++)
+        {
+            channel = &ble_coc_channels[i];
+            if(channel->chan == NULL)
+            {
+                channel->conn_handle = event->connect.conn_handle;
+                channel->chan = event->connect.chan;
+                channel->stalled = false;
+                channel->peer_mtu = BLE_COC_MTU;
+                if(ble_l2cap_get_chan_info(channel->chan, &info) == 0 && info.peer_coc_mtu < BLE_COC_MTU)
+                {
+                    channel->peer_mtu = info.peer_coc_mtu;
+                }
+                break;
+            }
+        }
+        break;
+
+    case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        ESP_LOGI(TAG, "Channel disconnected, conn %d", event->disconnect.conn_handle);
+        for(i = 0; i < BLE_COC_MAX_CHANNELS; i++)
+        {
+            if(ble_coc_channels[i].chan == event->disconnect.chan)
+            {
+                ble_coc_channels[i].chan = NULL;
+            }
+        }
+        break;
+
+    /* Peer opens a channel, arm the first receive buffer */
+    case BLE_L2CAP_EVENT_COC_ACCEPT:
+        if(event->accept.peer_sdu_size > BLE_COC_MTU)
+        {
+            ESP_LOGI(TAG, "Peer SDU %d limited to %d", event->accept.peer_sdu_size, BLE_COC_MTU);
+        }
+        ble_coc_rx_ready(event->accept.chan);
+        break;
+
+    case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        /* Re-arm first so the peer does not wait on us for credits */
+        ble_coc_rx_ready(event->receive.chan);
+        if(event->receive.sdu_rx != NULL)
+        {
+            ble_coc_rx_deliver(event->receive.conn_handle, event->receive.sdu_rx);
+        }
+        break;
+
+    case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+        channel = ble_coc_find(event->tx_unstalled.conn_handle);
+        if(channel != NULL)
+        {
+            channel->stalled = false;
+        }
+        if(ble_coc_tx_ready_handler != NULL)
+        {
+            ble_coc_tx_ready_handler(event->tx_unstalled.conn_handle);
+        }
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Send one SDU over the L2CAP channel of a connection, never blocks
+ */
+esp_err_t ble_coc_send(uint16_t conn_handle, const uint8_t *data, size_t size)
+{
+    ble_coc_channel_t *channel = ble_coc_find(conn_handle);
+    struct os_mbuf *sdu_tx;
+    esp_err_t rc;
+
+    if(channel == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(size > channel->peer_mtu)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if(channel->stalled)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Every K-frame takes msys mbufs, leave the reserve to RX and GATT */
+    if(os_msys_num_free() <= BLE_TX_MSYS_RESERVE)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sdu_tx = os_mbuf_get_pkthdr(&ble_coc_sdu_pool, 0);
+    if(sdu_tx == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if(os_mbuf_append(sdu_tx, data, size) != 0)
+    {
+        os_mbuf_free_chain(sdu_tx);
+        return ESP_ERR_NO_MEM;
+    }
+
+    rc = ble_l2cap_send(channel->chan, sdu_tx);
+    if(rc == BLE_HS_ESTALLED)
+    {
+        /* Accepted, the rest goes out once the peer returns credits */
+        channel->stalled = true;
+        return ESP_OK;
+    }
+    if(rc == BLE_HS_EBUSY)
+    {
+        /* Previous SDU still in progress, the stack did not take this one */
+        os_mbuf_free_chain(sdu_tx);
+        channel->stalled = true;
+        return ESP_ERR_NO_MEM;
+    }
+    if(rc != ESP_OK)
+    {
+        BLE_TRACE(COC, BLE_TRACE_ERROR, BLE_TRACE_EV_COC_SEND_FAIL, channel->conn_handle, rc);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Register callback to handle received SDUs as flat data
+ */
+void ble_coc_register_rx_handler(ble_rx_packet_handler_t callback)
+{
+    ble_coc_rx_handler = callback;
+}
+
+/**
+ * @brief  Register callback to handle received SDUs in place
+ */
+void ble_coc_register_rx_mbuf_handler(ble_rx_mbuf_handler_t callback)
+{
+    ble_coc_rx_mbuf_handler = callback;
+}
+
+/**
+ * @brief  Register callback to resume sending after a stall
+ */
+void ble_coc_register_tx_ready_handler(ble_coc_tx_ready_handler_t callback)
+{
+    ble_coc_tx_ready_handler = callback;
+}
+
+/**
+ * @brief  Check whether a connection has an open channel
+ */
+bool ble_coc_is_connected(uint16_t conn_handle)
+{
+    return ble_coc_find(conn_handle) != NULL;
+}
+
+/**
+ * @brief  L2CAP CoC server initialization
+ */
+esp_err_t ble_coc_init(void)
+{
+    esp_err_t rc;
+
+    rc = os_mempool_init(&ble_coc_sdu_mempool, BLE_COC_BUF_COUNT, BLE_COC_BLOCK_SIZE,
+                         ble_coc_sdu_mem, "coc_sdu_pool");
+    if(rc != ESP_OK)
+    {
+        return rc;
+    }
+
+    rc = os_mbuf_pool_init(&ble_coc_sdu_pool, &ble_coc_sdu_mempool, BLE_COC_BLOCK_SIZE, BLE_COC_BUF_COUNT);
+    if(rc != ESP_OK)
+    {
+        return rc;
+    }
+
+    return ble_l2cap_create_server(BLE_COC_PSM, BLE_COC_MTU, ble_coc_event, NULL);
+}
\ No newline at end of file
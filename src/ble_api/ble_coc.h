@@ -0,0 +1,96 @@
+/*
+ *  ble_coc.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_COC_H_
+#define _BLE_COC_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "gatt_server.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_COC_MAX_CHANNELS                          CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM
+
+/* Called when a stalled channel got credits back and can send again */
+typedef void (*ble_coc_tx_ready_handler_t)(uint16_t conn_handle);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Send one SDU over the L2CAP channel of a connection, never blocks.
+ *         Segmentation and credit based flow control are done by the stack
+ * @param  conn_handle : connection handle of the peer
+ *         data        : buffer hold data to send, copied before return
+ *         size        : length of data (max is the peer CoC MTU, at most BLE_COC_MTU)
+ * @retval ESP_OK when the SDU is accepted
+ *         ESP_ERR_INVALID_STATE if the peer has no open channel
+ *         ESP_ERR_INVALID_SIZE if data is too long
+ *         ESP_ERR_NO_MEM if the previous SDU is still waiting for credits,
+ *         retry after the tx ready callback, or if no SDU buffer is free or
+ *         msys is down to BLE_TX_MSYS_RESERVE, retry later
+ */
+esp_err_t ble_coc_send(uint16_t conn_handle, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Register callback to handle received SDUs as flat data
+ * @param  Callback function, called from the host task
+ * @retval None
+ */
+void ble_coc_register_rx_handler(ble_rx_packet_handler_t callback);
+
+/**
+ * @brief  Register callback to handle received SDUs in place, takes
+ *         precedence over the flat handler
+ * @param  Callback function, called from the host task
+ * @retval None
+ */
+void ble_coc_register_rx_mbuf_handler(ble_rx_mbuf_handler_t callback);
+
+/**
+ * @brief  Register callback to resume sending after a stall
+ * @param  Callback function, called from the host task
+ * @retval None
+ */
+void ble_coc_register_tx_ready_handler(ble_coc_tx_ready_handler_t callback);
+
+/**
+ * @brief  Check whether a connection has an open channel
+ * @param  conn_handle : connection handle of the peer
+ * @retval true if a channel is open
+ */
+bool ble_coc_is_connected(uint16_t conn_handle);
+
+/**
+ * @brief  L2CAP CoC server initialization, listens on BLE_COC_PSM
+ * @param  None
+ * @retval ESP_OK on success
+ */
+esp_err_t ble_coc_init(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_COC_H_ */
\ No newline at end of file
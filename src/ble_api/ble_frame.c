@@ -0,0 +1,443 @@
+/*
+ *  ble_frame.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "gatt_server.h"
+#include "ble_session.h"
+#include "ble_api.h"
+#include "ble_pool.h"
+#include "ble_trace.h"
+#include "ble_batch.h"
+#include "ble_frame.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static ble_rx_packet_handler_t ble_frame_handler = NULL;
+static portMUX_TYPE ble_frame_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t ble_frame_rx_dropped;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static size_t ble_frame_size(ble_session_t *session);
+static uint8_t *ble_frame_rx_claim(ble_session_t *session, uint16_t conn_handle, uint8_t *gen);
+static void ble_frame_rx_release(ble_session_t *session, uint16_t conn_handle, uint8_t *buf, uint8_t gen);
+static void ble_frame_rx_abort(ble_session_t *session, uint8_t **buf);
+static int32_t ble_frame_rx_begin(ble_session_t *session, uint8_t **buf, const uint8_t *header, size_t size);
+static void ble_frame_rx_end(ble_session_t *session, uint8_t **buf, uint8_t header);
+
+/******************************************************************************/
+
+/**
+ * @brief  Get the largest frame that fits one notification on the link
+ */
+static size_t ble_frame_size(ble_session_t *session)
+{
+    size_t frame_size = session->mtu - BLE_FRAME_ATT_OVERHEAD;
+
+    if(session->caps & GATT_SERVER_CAP_LZ)
+    {
+        frame_size -= BLE_LZ_HEADER_SIZE;
+    }
+    if(session->caps & GATT_SERVER_CAP_BATCH)
+    {
+        frame_size -= BLE_BATCH_HEADER_MAX;
+    }
+    if(frame_size > BLE_TX_QUEUE_ITEM_SIZE)
+    {
+        frame_size = BLE_TX_QUEUE_ITEM_SIZE;
+    }
+    return frame_size;
+}
+
+/**
+ * @brief  Take the reassembly buffer out of the session for the duration of
+ *         one frame, so a close on the host task cannot free it under us
+ * @retval Buffer of the message in progress, NULL if none
+ */
+static uint8_t *ble_frame_rx_claim(ble_session_t *session, uint16_t conn_handle, uint8_t *gen)
+{
+    uint8_t *buf = NULL;
+
+    portENTER_CRITICAL(&ble_frame_lock);
+    if(session->conn_handle == conn_handle)
+    {
+        buf = session->frame_rx_buf;
+        session->frame_rx_buf = NULL;
+    }
+    *gen = session->frame_gen;
+    portEXIT_CRITICAL(&ble_frame_lock);
+    return buf;
+}
+
+/**
+ * @brief  Hand the reassembly buffer back, or free it if the connection was
+ *         closed meanwhile
+ */
+static void ble_frame_rx_release(ble_session_t *session, uint16_t conn_handle, uint8_t *buf, uint8_t gen)
+{
+    portENTER_CRITICAL(&ble_frame_lock);
+    if(session->frame_gen == gen && session->conn_handle == conn_handle)
+    {
+        session->frame_rx_buf = buf;
+        buf = NULL;
+    }
+    portEXIT_CRITICAL(&ble_frame_lock);
+    ble_pool_free(buf);
+}
+
+/**
+ * @brief  Drop the message in progress
+ */
+static void ble_frame_rx_abort(ble_session_t *session, uint8_t **buf)
+{
+    if(*buf != NULL)
+    {
+        BLE_TRACE(FRAME, BLE_TRACE_WARN, BLE_TRACE_EV_FRAME_DROP, session->conn_handle, session->frame_rx_len);
+        ble_pool_free(*buf);
+        *buf = NULL;
+        ble_frame_rx_dropped++;
+    }
+}
+
+/**
+ * @brief  Check a frame header against the reassembly state
+ * @retval Offset of the payload in the frame, -1 to drop the frame
+ */
+static int32_t ble_frame_rx_begin(ble_session_t *session, uint8_t **buf, const uint8_t *header, size_t size)
+{
+    uint8_t seq = header[0] & BLE_FRAME_SEQ_MASK;
+    uint16_t total;
+
+    if(header[0] & BLE_FRAME_START)
+    {
+        /* A new message while one is in progress means we lost its end */
+        ble_frame_rx_abort(session, buf);
+
+        total = header[1] | (header[2] << 8);
+        if(size < BLE_FRAME_START_HEADER_SIZE || total == 0 || total > BLE_FRAME_MAX_MESSAGE_SIZE)
+        {
+            ble_frame_rx_dropped++;
+            return -1;
+        }
+
+        *buf = ble_pool_alloc(total);
+        if(*buf == NULL)
+        {
+            ble_frame_rx_dropped++;
+            return -1;
+        }
+        session->frame_rx_total = total;
+        session->frame_rx_len = 0;
+        session->frame_rx_seq = seq;
+        return BLE_FRAME_START_HEADER_SIZE;
+    }
+
+    if(*buf == NULL)
+    {
+        /* Tail of a message we already dropped */
+        return -1;
+    }
+    if(seq != session->frame_rx_seq)
+    {
+        ble_frame_rx_abort(session, buf);
+        return -1;
+    }
+    return BLE_FRAME_HEADER_SIZE;
+}
+
+/**
+ * @brief  Advance the reassembly state, deliver the message on its last frame
+ */
+static void ble_frame_rx_end(ble_session_t *session, uint8_t **buf, uint8_t header)
+{
+    session->frame_rx_seq = (session->frame_rx_seq + 1) & BLE_FRAME_SEQ_MASK;
+    if(!(header & BLE_FRAME_END))
+    {
+        return;
+    }
+
+    if(session->frame_rx_len != session->frame_rx_total)
+    {
+        ble_frame_rx_abort(session, buf);
+        return;
+    }
+
+    if(ble_frame_handler != NULL)
+    {
+        ble_frame_handler(session->conn_handle, *buf, session->frame_rx_len);
+    }
+    ble_pool_free(*buf);
+    *buf = NULL;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Copy a message into the pending list of one peer, the host task
+ *         frames it as the tx queue drains
+ */
+esp_err_t ble_frame_send(uint16_t conn_handle, const uint8_t *data, size_t size)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    esp_err_t rc = ESP_OK;
+    uint8_t *buf;
+    uint8_t slot;
+    uint8_t gen;
+
+    if(session == NULL || !session->subscribed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(size == 0 || size > BLE_FRAME_MAX_MESSAGE_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* A close while we copy bumps the generation, the copy must not outlive it */
+    gen = session->frame_gen;
+    buf = ble_pool_alloc(size);
+    if(buf == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(buf, data, size);
+
+    portENTER_CRITICAL(&ble_frame_lock);
+    if(session->frame_gen != gen || session->conn_handle != conn_handle)
+    {
+        rc = ESP_ERR_INVALID_STATE;
+    }
+    else if(session->frame_tx_count == BLE_FRAME_TX_PENDING)
+    {
+        rc = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+        slot = (session->frame_tx_head + session->frame_tx_count) % BLE_FRAME_TX_PENDING;
+        session->frame_tx_buf[slot] = buf;
+        session->frame_tx_size[slot] = size;
+        session->frame_tx_count++;
+    }
+    portEXIT_CRITICAL(&ble_frame_lock);
+
+    if(rc != ESP_OK)
+    {
+        ble_pool_free(buf);
+        return rc;
+    }
+
+    ble_api_tx_schedule();
+    return ESP_OK;
+}
+
+/**
+ * @brief  Queue frames of the pending messages while BLE_TX_DEFAULT_CHANNEL
+ *         has room
+ */
+void ble_frame_tx_refill(ble_session_t *session)
+{
+    uint8_t header[BLE_FRAME_START_HEADER_SIZE];
+    ble_tx_queue_t *queue = ble_tx_sched_queue(&session->tx_sched, BLE_TX_DEFAULT_CHANNEL);
+    size_t frame_size = ble_frame_size(session);
+    size_t hdrlen;
+    size_t chunk;
+    size_t size;
+    uint8_t *buf;
+
+    while(session->frame_tx_count > 0)
+    {
+        /* Only the host task removes messages, the head stays put unlocked */
+        buf = session->frame_tx_buf[session->frame_tx_head];
+        size = session->frame_tx_size[session->frame_tx_head];
+
+        while(session->frame_tx_offset < size)
+        {
+            header[0] = session->frame_tx_seq;
+            if(session->frame_tx_offset == 0)
+            {
+                header[0] |= BLE_FRAME_START;
+                header[1] = size & 0xFF;
+                header[2] = size >> 8;
+                hdrlen = BLE_FRAME_START_HEADER_SIZE;
+            }
+            else
+            {
+                hdrlen = BLE_FRAME_HEADER_SIZE;
+            }
+
+            chunk = frame_size - hdrlen;
+            if(chunk >= size - session->frame_tx_offset)
+            {
+                chunk = size - session->frame_tx_offset;
+                header[0] |= BLE_FRAME_END;
+            }
+
+            if(ble_tx_queue_push_frame(queue, header, hdrlen, buf + session->frame_tx_offset, chunk) != ESP_OK)
+            {
+                /* Queue full, carry on from here once it drains */
+                return;
+            }
+            session->frame_tx_seq = (session->frame_tx_seq + 1) & BLE_FRAME_SEQ_MASK;
+            session->frame_tx_offset += chunk;
+        }
+
+        portENTER_CRITICAL(&ble_frame_lock);
+        session->frame_tx_head = (session->frame_tx_head + 1) % BLE_FRAME_TX_PENDING;
+        session->frame_tx_count--;
+        session->frame_tx_offset = 0;
+        portEXIT_CRITICAL(&ble_frame_lock);
+        ble_pool_free(buf);
+    }
+}
+
+/**
+ * @brief  Feed one received frame
+ */
+void ble_frame_rx(uint16_t conn_handle, const uint8_t *data, size_t size)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    uint8_t header[BLE_FRAME_START_HEADER_SIZE] = { 0 };
+    int32_t offset;
+    uint8_t *buf;
+    uint8_t gen;
+
+    if(session == NULL || size == 0)
+    {
+        return;
+    }
+
+    buf = ble_frame_rx_claim(session, conn_handle, &gen);
+    memcpy(header, data, size < sizeof(header) ? size : sizeof(header));
+    offset = ble_frame_rx_begin(session, &buf, header, size);
+    if(offset >= 0)
+    {
+        if(session->frame_rx_len + size - offset > session->frame_rx_total)
+        {
+            ble_frame_rx_abort(session, &buf);
+        }
+        else
+        {
+            memcpy(buf + session->frame_rx_len, data + offset, size - offset);
+            session->frame_rx_len += size - offset;
+            ble_frame_rx_end(session, &buf, header[0]);
+        }
+    }
+    ble_frame_rx_release(session, conn_handle, buf, gen);
+}
+
+/**
+ * @brief  Feed one received frame straight from the stack mbuf
+ */
+void ble_frame_rx_mbuf(uint16_t conn_handle, struct os_mbuf **om)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    uint8_t header[BLE_FRAME_START_HEADER_SIZE] = { 0 };
+    uint16_t size = OS_MBUF_PKTLEN(*om);
+    int32_t offset;
+    uint8_t *buf;
+    uint8_t gen;
+
+    if(session == NULL || size == 0)
+    {
+        return;
+    }
+
+    buf = ble_frame_rx_claim(session, conn_handle, &gen);
+    os_mbuf_copydata(*om, 0, size < sizeof(header) ? size : sizeof(header), header);
+    offset = ble_frame_rx_begin(session, &buf, header, size);
+    if(offset >= 0)
+    {
+        if(session->frame_rx_len + size - offset > session->frame_rx_total)
+        {
+            ble_frame_rx_abort(session, &buf);
+        }
+        else
+        {
+            os_mbuf_copydata(*om, offset, size - offset, buf + session->frame_rx_len);
+            session->frame_rx_len += size - offset;
+            ble_frame_rx_end(session, &buf, header[0]);
+        }
+    }
+    ble_frame_rx_release(session, conn_handle, buf, gen);
+}
+
+/**
+ * @brief  Release the buffers of a terminated connection
+ */
+void ble_frame_close(uint16_t conn_handle)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    uint8_t *pending[BLE_FRAME_TX_PENDING];
+    uint8_t *rx_buf;
+    uint8_t count;
+    uint8_t i;
+
+    if(session == NULL)
+    {
+        return;
+    }
+
+    /* A buffer claimed by the rx worker is freed there once it sees the new generation */
+    portENTER_CRITICAL(&ble_frame_lock);
+    rx_buf = session->frame_rx_buf;
+    session->frame_rx_buf = NULL;
+    session->frame_gen++;
+    count = session->frame_tx_count;
+    for(i = 0; i < count; i++)
+    {
+        pending[i] = session->frame_tx_buf[(session->frame_tx_head + i) % BLE_FRAME_TX_PENDING];
+    }
+    session->frame_tx_count = 0;
+    session->frame_tx_offset = 0;
+    portEXIT_CRITICAL(&ble_frame_lock);
+
+    ble_pool_free(rx_buf);
+    for(i = 0; i < count; i++)
+    {
+        ble_pool_free(pending[i]);
+    }
+}
+
+/**
+ * @brief  Get number of received messages dropped
+ */
+uint32_t ble_frame_get_rx_dropped(void)
+{
+    return ble_frame_rx_dropped;
+}
+
+/**
+ * @brief  Framing initialization
+ */
+esp_err_t ble_frame_init(ble_rx_packet_handler_t callback)
+{
+    ble_frame_handler = callback;
+    return ESP_OK;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+ *  ble_frame.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_FRAME_H_
+#define _BLE_FRAME_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "gatt_server.h"
+#include "ble_session.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Framing of messages larger than one ATT payload. Each frame is
+ *     [header][total length, le16, first frame only][payload]
+ * header bit 7 marks the first frame of a message, bit 6 the last one and
+ * bits 0-5 count frames modulo 64 so a lost frame drops its message
+ * instead of splicing two messages together.
+ */
+#define BLE_FRAME_START                               0x80
+#define BLE_FRAME_END                                 0x40
+#define BLE_FRAME_SEQ_MASK                            0x3F
+#define BLE_FRAME_HEADER_SIZE                         1
+#define BLE_FRAME_START_HEADER_SIZE                   3
+#define BLE_FRAME_ATT_OVERHEAD                        3       /* ATT opcode and handle of a notification */
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Accept a message for one peer. It is copied to the pool and framed
+ *         to the negotiated MTU by the host task as BLE_TX_DEFAULT_CHANNEL
+ *         drains, so messages up to BLE_FRAME_MAX_MESSAGE_SIZE go out
+ *         whatever the queue length. Messages leave in the order they were
+ *         accepted and their frames never interleave. Raw notifications on
+ *         a framed connection are not supported, the client cannot tell
+ *         them from frames
+ * @param  conn_handle : connection handle of the peer
+ *         data        : message, copied before return
+ *         size        : length of message (max is BLE_FRAME_MAX_MESSAGE_SIZE)
+ * @retval ESP_OK when the message is accepted
+ *         ESP_ERR_INVALID_STATE if the peer is not connected or not subscribed
+ *         ESP_ERR_INVALID_SIZE if the message is empty or too long
+ *         ESP_ERR_NO_MEM if BLE_FRAME_TX_PENDING messages are already
+ *         pending or the pool is empty, retry once the peer catches up
+ */
+esp_err_t ble_frame_send(uint16_t conn_handle, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Queue frames of the pending messages while the default channel
+ *         has room, called by the tx drain on the host task
+ * @param  session : session of the peer
+ * @retval None
+ */
+void ble_frame_tx_refill(ble_session_t *session);
+
+/**
+ * @brief  Feed one received frame, for applications that receive through
+ *         the rx worker. Complete messages go to the frame handler
+ * @param  conn_handle : connection handle of the peer
+ *         data        : frame
+ *         size        : length of frame
+ * @retval None
+ */
+void ble_frame_rx(uint16_t conn_handle, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Feed one received frame straight from the stack mbuf, suitable for
+ *         gatt_server_register_rx_mbuf_handler(). Payload is copied once,
+ *         into the reassembly buffer
+ * @param  conn_handle : connection handle of the peer
+ *         om          : frame
+ * @retval None
+ */
+void ble_frame_rx_mbuf(uint16_t conn_handle, struct os_mbuf **om);
+
+/**
+ * @brief  Release the reassembly buffer and pending messages of a terminated
+ *         connection. A frame being reassembled on the rx worker is
+ *         dropped there
+ * @param  conn_handle : connection handle of the peer
+ * @retval None
+ */
+void ble_frame_close(uint16_t conn_handle);
+
+/**
+ * @brief  Get number of received messages dropped on lost or malformed frames
+ * @param  None
+ * @retval Number of dropped messages
+ */
+uint32_t ble_frame_get_rx_dropped(void);
+
+/**
+ * @brief  Framing initialization
+ * @param  callback : handler of reassembled messages, the buffer is returned
+ *                    to the pool when it returns
+ * @retval ESP_OK
+ */
+esp_err_t ble_frame_init(ble_rx_packet_handler_t callback);
+
+/******************************************************************************/
+
+#endif /* _BLE_FRAME_H_ */
\ No newline at end of file
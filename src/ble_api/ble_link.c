@@ -0,0 +1,325 @@
+/*
+ *  ble_link.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_timer.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_link.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_LINK_DATA_LEN_DFLT                        27
+#define BLE_LINK_DATA_LEN_MAX                         251
+#define BLE_LINK_DATA_TIME_MAX                        2120    /* us, 251 octets on 1M PHY */
+
+typedef struct
+{
+    uint16_t data_len;                  /* 0 keeps the controller default */
+    uint16_t data_time;
+    uint8_t phy_mask;                   /* 0 keeps the current PHY */
+    uint8_t exchange_mtu;
+    struct ble_gap_upd_params params;
+    struct ble_gap_upd_params fallback; /* Used once when params are refused */
+} ble_link_profile_cfg_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "LINK";
+
+/* Interval in 1.25 ms units, supervision timeout in 10 ms units. Timeouts
+ * stay above (1 + latency) * itvl_max * 2 as the spec requires */
+static const ble_link_profile_cfg_t ble_link_profiles[BLE_LINK_PROFILE_MAX] = {
+    [BLE_LINK_PROFILE_NONE] = { 0 },
+    [BLE_LINK_PROFILE_BULK] = {
+        .data_len = BLE_LINK_DATA_LEN_MAX,
+        .data_time = BLE_LINK_DATA_TIME_MAX,
+        .phy_mask = BLE_HCI_LE_PHY_2M_PREF_MASK,
+        .exchange_mtu = 1,
+        .params = { .itvl_min = 6, .itvl_max = 12, .latency = 0, .supervision_timeout = 400 },
+        .fallback = { .itvl_min = 12, .itvl_max = 24, .latency = 0, .supervision_timeout = 400 },
+    },
+    [BLE_LINK_PROFILE_LOW_LATENCY] = {
+        .data_len = BLE_LINK_DATA_LEN_MAX,
+        .data_time = BLE_LINK_DATA_TIME_MAX,
+        .phy_mask = BLE_HCI_LE_PHY_2M_PREF_MASK,
+        .exchange_mtu = 1,
+        .params = { .itvl_min = 6, .itvl_max = 6, .latency = 0, .supervision_timeout = 200 },
+        .fallback = { .itvl_min = 12, .itvl_max = 12, .latency = 0, .supervision_timeout = 200 },
+    },
+    [BLE_LINK_PROFILE_LOW_POWER] = {
+        .data_len = 0,
+        .phy_mask = BLE_HCI_LE_PHY_1M_PREF_MASK,
+        .exchange_mtu = 0,
+        .params = { .itvl_min = 80, .itvl_max = 160, .latency = 4, .supervision_timeout = 600 },
+        .fallback = { .itvl_min = 160, .itvl_max = 320, .latency = 2, .supervision_timeout = 600 },
+    },
+    /* BUSY level, IDLE runs the LOW_POWER parameters */
+    [BLE_LINK_PROFILE_ADAPTIVE] = {
+        .data_len = BLE_LINK_DATA_LEN_MAX,
+        .data_time = BLE_LINK_DATA_TIME_MAX,
+        .phy_mask = BLE_HCI_LE_PHY_2M_PREF_MASK,
+        .exchange_mtu = 1,
+        .params = { .itvl_min = 6, .itvl_max = 12, .latency = 0, .supervision_timeout = 400 },
+        .fallback = { .itvl_min = 12, .itvl_max = 24, .latency = 0, .supervision_timeout = 400 },
+    },
+};
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_link_read_params(uint16_t conn_handle, ble_link_info_t *link);
+static const ble_link_profile_cfg_t *ble_link_params_cfg(const ble_link_info_t *link);
+static void ble_link_request(uint16_t conn_handle, ble_link_info_t *link, const ble_link_profile_cfg_t *cfg,
+                             const struct ble_gap_upd_params *params, uint8_t phy_mask, bool exchange_mtu);
+
+/******************************************************************************/
+
+/**
+ * @brief  Copy the connection parameters the controller runs with
+ */
+static void ble_link_read_params(uint16_t conn_handle, ble_link_info_t *link)
+{
+    struct ble_gap_conn_desc desc;
+
+    if(ble_gap_conn_find(conn_handle, &desc) == 0)
+    {
+        link->conn_itvl = desc.conn_itvl;
+        link->conn_latency = desc.conn_latency;
+        link->supervision_timeout = desc.supervision_timeout;
+    }
+}
+
+/**
+ * @brief  Profile whose connection parameters the link is meant to run, the
+ *         ones of the level requested while an ADAPTIVE update is pending
+ */
+static const ble_link_profile_cfg_t *ble_link_params_cfg(const ble_link_info_t *link)
+{
+    uint8_t level = link->adapt.pending != BLE_LINK_ADAPT_KEEP ? link->adapt.pending : link->adapt.level;
+
+    if(link->profile == BLE_LINK_PROFILE_ADAPTIVE && level == BLE_LINK_ADAPT_IDLE)
+    {
+        return &ble_link_profiles[BLE_LINK_PROFILE_LOW_POWER];
+    }
+    return &ble_link_profiles[link->profile];
+}
+
+/**
+ * @brief  Issue DLE, PHY, connection parameter and MTU requests
+ */
+static void ble_link_request(uint16_t conn_handle, ble_link_info_t *link, const ble_link_profile_cfg_t *cfg,
+                             const struct ble_gap_upd_params *params, uint8_t phy_mask, bool exchange_mtu)
+{
+    esp_err_t rc;
+
+    if(cfg->data_len != 0)
+    {
+        rc = ble_hs_hci_util_set_data_len(conn_handle, cfg->data_len, cfg->data_time);
+        if(rc != ESP_OK)
+        {
+            ESP_LOGW(TAG, "DLE refused, conn %d rc = %d", conn_handle, rc);
+            link->fallback |= BLE_LINK_FALLBACK_DATA_LEN;
+            link->data_len = BLE_LINK_DATA_LEN_DFLT;
+        }
+        else
+        {
+            link->data_len = cfg->data_len;
+        }
+    }
+
+    if(phy_mask != 0)
+    {
+        rc = ble_gap_set_prefered_le_phy(conn_handle, phy_mask, phy_mask, BLE_GAP_LE_PHY_CODED_ANY);
+        if(rc != ESP_OK)
+        {
+            ESP_LOGW(TAG, "PHY request refused, conn %d rc = %d", conn_handle, rc);
+            link->fallback |= BLE_LINK_FALLBACK_PHY;
+        }
+    }
+
+    rc = ble_gap_update_params(conn_handle, params);
+    if(rc != ESP_OK)
+    {
+        link->fallback |= BLE_LINK_FALLBACK_PARAMS;
+        rc = ble_gap_update_params(conn_handle, &cfg->fallback);
+    }
+    link->update_pending = (rc == ESP_OK);
+
+    /* Refused when the client already started the exchange, that is fine */
+    if(exchange_mtu)
+    {
+        ble_gattc_exchange_mtu(conn_handle, NULL, NULL);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Reset link state of a new connection and request its profile
+ */
+void ble_link_open(uint16_t conn_handle, ble_link_info_t *link, ble_link_profile_t profile,
+                   const ble_link_cache_t *cache)
+{
+    const ble_link_profile_cfg_t *cfg;
+    struct ble_gap_upd_params params;
+
+    memset(link, 0, sizeof(ble_link_info_t));
+    link->tx_phy = BLE_HCI_LE_PHY_1M;
+    link->rx_phy = BLE_HCI_LE_PHY_1M;
+    link->data_len = BLE_LINK_DATA_LEN_DFLT;
+    ble_link_read_params(conn_handle, link);
+
+    if(cache == NULL || profile == BLE_LINK_PROFILE_NONE || profile >= BLE_LINK_PROFILE_MAX)
+    {
+        ble_link_apply(conn_handle, link, profile);
+        return;
+    }
+
+    /* Known peer: ask for exactly what it settled on last time, the profile
+     * fallback still applies when it refuses */
+    cfg = &ble_link_profiles[profile];
+    link->profile = profile;
+    ble_link_adapt_init(&link->adapt, esp_timer_get_time() / 1000);
+    params = cfg->params;
+    params.itvl_min = cache->conn_itvl;
+    params.itvl_max = cache->conn_itvl;
+    params.latency = cache->conn_latency;
+    params.supervision_timeout = cache->supervision_timeout;
+    ble_link_request(conn_handle, link, cfg, &params,
+                     cache->tx_phy == BLE_HCI_LE_PHY_2M ? BLE_HCI_LE_PHY_2M_PREF_MASK : BLE_HCI_LE_PHY_1M_PREF_MASK,
+                     cfg->exchange_mtu || cache->mtu > BLE_ATT_MTU_DFLT);
+}
+
+/**
+ * @brief  Issue DLE, PHY, connection parameter and MTU requests of a profile
+ */
+esp_err_t ble_link_apply(uint16_t conn_handle, ble_link_info_t *link, ble_link_profile_t profile)
+{
+    const ble_link_profile_cfg_t *cfg;
+
+    if(profile >= BLE_LINK_PROFILE_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cfg = &ble_link_profiles[profile];
+    link->profile = profile;
+    link->fallback = 0;
+    ble_link_adapt_init(&link->adapt, esp_timer_get_time() / 1000);
+    if(profile == BLE_LINK_PROFILE_NONE)
+    {
+        return ESP_OK;
+    }
+
+    ble_link_request(conn_handle, link, cfg, &cfg->params, cfg->phy_mask, cfg->exchange_mtu);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONN_UPDATE
+ */
+void ble_link_on_conn_update(uint16_t conn_handle, ble_link_info_t *link, int32_t status)
+{
+    esp_err_t rc;
+
+    if(status != 0 && link->update_pending && link->profile != BLE_LINK_PROFILE_NONE &&
+       !(link->fallback & BLE_LINK_FALLBACK_PARAMS))
+    {
+        ESP_LOGW(TAG, "Parameters refused, conn %d status = %d, relaxing", conn_handle, status);
+        link->fallback |= BLE_LINK_FALLBACK_PARAMS;
+        rc = ble_gap_update_params(conn_handle, &ble_link_params_cfg(link)->fallback);
+        link->update_pending = (rc == ESP_OK);
+        if(!link->update_pending)
+        {
+            ble_link_adapt_updated(&link->adapt, false);
+        }
+        return;
+    }
+
+    link->update_pending = 0;
+    ble_link_adapt_updated(&link->adapt, status == 0);
+    ble_link_read_params(conn_handle, link);
+}
+
+/**
+ * @brief  Feed the interval controller one sample
+ */
+ble_link_adapt_level_t ble_link_adapt(uint16_t conn_handle, ble_link_info_t *link, uint32_t backlog,
+                                      uint32_t rx_bytes)
+{
+    const ble_link_profile_cfg_t *cfg;
+    ble_link_adapt_level_t level;
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    esp_err_t rc;
+
+    /* A second request is refused while one runs, sample once it completed */
+    if(link->profile != BLE_LINK_PROFILE_ADAPTIVE || link->update_pending)
+    {
+        return BLE_LINK_ADAPT_KEEP;
+    }
+
+    level = ble_link_adapt_sample(&link->adapt, backlog, rx_bytes, now_ms);
+    if(level == BLE_LINK_ADAPT_KEEP)
+    {
+        return level;
+    }
+
+    /* Each level gets its own fallback */
+    cfg = level == BLE_LINK_ADAPT_IDLE ? &ble_link_profiles[BLE_LINK_PROFILE_LOW_POWER] :
+                                         &ble_link_profiles[BLE_LINK_PROFILE_ADAPTIVE];
+    link->fallback &= ~BLE_LINK_FALLBACK_PARAMS;
+    rc = ble_gap_update_params(conn_handle, &cfg->params);
+    if(rc != ESP_OK)
+    {
+        link->fallback |= BLE_LINK_FALLBACK_PARAMS;
+        rc = ble_gap_update_params(conn_handle, &cfg->fallback);
+    }
+    link->update_pending = (rc == ESP_OK);
+
+    /* Not issued, the next sample asks again */
+    if(rc != ESP_OK)
+    {
+        return BLE_LINK_ADAPT_KEEP;
+    }
+    ble_link_adapt_requested(&link->adapt, level, now_ms);
+    return level;
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
+ */
+void ble_link_on_phy_update(ble_link_info_t *link, int32_t status, uint8_t tx_phy, uint8_t rx_phy)
+{
+    if(status == 0)
+    {
+        link->tx_phy = tx_phy;
+        link->rx_phy = rx_phy;
+    }
+
+    if(ble_link_profiles[link->profile].phy_mask == BLE_HCI_LE_PHY_2M_PREF_MASK &&
+       link->tx_phy != BLE_HCI_LE_PHY_2M)
+    {
+        link->fallback |= BLE_LINK_FALLBACK_PHY;
+    }
+}
\ No newline at end of file
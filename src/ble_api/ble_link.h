@@ -0,0 +1,144 @@
+/*
+ *  ble_link.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_LINK_H_
+#define _BLE_LINK_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "ble_link_adapt.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+typedef enum
+{
+    BLE_LINK_PROFILE_NONE = 0,          /* Leave everything to the central */
+    BLE_LINK_PROFILE_BULK,              /* DLE, 2M PHY, short interval, max MTU */
+    BLE_LINK_PROFILE_LOW_LATENCY,       /* DLE, 2M PHY, shortest interval */
+    BLE_LINK_PROFILE_LOW_POWER,         /* 1M PHY, long interval with slave latency */
+    BLE_LINK_PROFILE_ADAPTIVE,          /* As BULK, interval follows the traffic */
+    BLE_LINK_PROFILE_MAX,
+} ble_link_profile_t;
+
+/* Fallbacks taken when a request was refused */
+#define BLE_LINK_FALLBACK_PHY                         0x01    /* Stayed on 1M PHY */
+#define BLE_LINK_FALLBACK_PARAMS                      0x02    /* Relaxed interval range requested */
+#define BLE_LINK_FALLBACK_DATA_LEN                    0x04    /* Controller refused DLE */
+
+/**
+ * What was asked for and what the link actually runs with. Interval is in
+ * 1.25 ms units and supervision timeout in 10 ms units, as reported by
+ * the controller.
+ */
+typedef struct
+{
+    uint8_t profile;
+    uint8_t fallback;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    uint16_t conn_itvl;
+    uint16_t conn_latency;
+    uint16_t supervision_timeout;
+    uint16_t mtu;                       /* Filled from the session when read through ble_api */
+    uint16_t data_len;                  /* LL TX octets requested, 27 when DLE is not used */
+    uint8_t update_pending;
+    ble_link_adapt_t adapt;             /* Interval controller, ADAPTIVE profile only */
+} ble_link_info_t;
+
+/* What a bonded peer ran with at the end of its last connection, re-requested
+ * on reconnect so the central does not have to negotiate from scratch */
+typedef struct
+{
+    uint16_t mtu;
+    uint16_t conn_itvl;
+    uint16_t conn_latency;
+    uint16_t supervision_timeout;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+} ble_link_cache_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Reset link state of a new connection and request its profile
+ * @param  conn_handle : connection handle
+ *         link        : link state of the connection
+ *         profile     : profile to request
+ *         cache       : parameters of the last connection of a bonded peer,
+ *                       requested instead of the profile ones. NULL if none
+ * @retval None
+ */
+void ble_link_open(uint16_t conn_handle, ble_link_info_t *link, ble_link_profile_t profile,
+                   const ble_link_cache_t *cache);
+
+/**
+ * @brief  Issue DLE, PHY, connection parameter and MTU requests of a profile
+ * @param  conn_handle : connection handle
+ *         link        : link state of the connection
+ *         profile     : profile to request
+ * @retval ESP_OK when the requests were issued
+ *         ESP_ERR_INVALID_ARG for an unknown profile
+ */
+esp_err_t ble_link_apply(uint16_t conn_handle, ble_link_info_t *link, ble_link_profile_t profile);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONN_UPDATE, retries once with relaxed
+ *         parameters when the central refused the profile ones
+ * @param  conn_handle : connection handle
+ *         link        : link state of the connection
+ *         status      : event status
+ * @retval None
+ */
+void ble_link_on_conn_update(uint16_t conn_handle, ble_link_info_t *link, int32_t status);
+
+/**
+ * @brief  Feed the interval controller of an ADAPTIVE link one sample and
+ *         request the parameters of the level it picks. Call periodically
+ * @param  conn_handle : connection handle
+ *         link        : link state of the connection
+ *         backlog     : notifications queued for the connection
+ *         rx_bytes    : running count of bytes received on the connection
+ * @retval Level requested, BLE_LINK_ADAPT_KEEP when nothing was requested
+ */
+ble_link_adapt_level_t ble_link_adapt(uint16_t conn_handle, ble_link_info_t *link, uint32_t backlog,
+                                      uint32_t rx_bytes);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
+ * @param  link   : link state of the connection
+ *         status : event status
+ *         tx_phy : negotiated tx PHY
+ *         rx_phy : negotiated rx PHY
+ * @retval None
+ */
+void ble_link_on_phy_update(ble_link_info_t *link, int32_t status, uint8_t tx_phy, uint8_t rx_phy);
+
+/******************************************************************************/
+
+#endif /* _BLE_LINK_H_ */
\ No newline at end of file
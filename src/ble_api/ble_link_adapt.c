@@ -0,0 +1,133 @@
+/*
+ *  ble_link_adapt.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "config.h"
+#include "ble_link_adapt.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+_Static_assert(BLE_LINK_ADAPT_IDLE_ITEMS < BLE_LINK_ADAPT_BUSY_ITEMS,
+               "BLE_LINK_ADAPT_IDLE_ITEMS must be below BLE_LINK_ADAPT_BUSY_ITEMS");
+_Static_assert(BLE_LINK_ADAPT_IDLE_RX_BPS < BLE_LINK_ADAPT_BUSY_RX_BPS,
+               "BLE_LINK_ADAPT_IDLE_RX_BPS must be below BLE_LINK_ADAPT_BUSY_RX_BPS");
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Reset the controller
+ */
+void ble_link_adapt_init(ble_link_adapt_t *adapt, uint32_t now_ms)
+{
+    memset(adapt, 0, sizeof(ble_link_adapt_t));
+    adapt->level = BLE_LINK_ADAPT_BUSY;
+    adapt->pending = BLE_LINK_ADAPT_KEEP;
+    adapt->last_sample_ms = now_ms;
+    adapt->last_request_ms = now_ms;
+    adapt->quiet_since_ms = now_ms;
+}
+
+/**
+ * @brief  Feed one sample and get the level to request
+ */
+ble_link_adapt_level_t ble_link_adapt_sample(ble_link_adapt_t *adapt, uint32_t backlog, uint32_t rx_bytes,
+                                             uint32_t now_ms)
+{
+    uint32_t elapsed = now_ms - adapt->last_sample_ms;
+    uint32_t received = rx_bytes - adapt->rx_bytes;
+    uint8_t wanted;
+
+    /* Counters restart when the session stats are reset */
+    if(rx_bytes < adapt->rx_bytes || !adapt->started)
+    {
+        received = adapt->started ? rx_bytes : 0;
+        adapt->started = 1;
+    }
+    adapt->rx_bytes = rx_bytes;
+    if(elapsed == 0)
+    {
+        return BLE_LINK_ADAPT_KEEP;
+    }
+    adapt->rx_rate = (uint32_t)((uint64_t) received * 1000 / elapsed);
+    adapt->last_sample_ms = now_ms;
+
+    /* Between the two thresholds the current level holds */
+    if(backlog >= BLE_LINK_ADAPT_BUSY_ITEMS || adapt->rx_rate >= BLE_LINK_ADAPT_BUSY_RX_BPS)
+    {
+        adapt->quiet_since_ms = now_ms;
+        wanted = BLE_LINK_ADAPT_BUSY;
+    }
+    else if(backlog <= BLE_LINK_ADAPT_IDLE_ITEMS && adapt->rx_rate <= BLE_LINK_ADAPT_IDLE_RX_BPS)
+    {
+        wanted = now_ms - adapt->quiet_since_ms >= BLE_LINK_ADAPT_IDLE_MS ? BLE_LINK_ADAPT_IDLE : adapt->level;
+    }
+    else
+    {
+        adapt->quiet_since_ms = now_ms;
+        wanted = adapt->level;
+    }
+
+    if(wanted == adapt->level)
+    {
+        return BLE_LINK_ADAPT_KEEP;
+    }
+    if(now_ms - adapt->last_request_ms < BLE_LINK_ADAPT_MIN_GAP_MS)
+    {
+        adapt->deferred++;
+        return BLE_LINK_ADAPT_KEEP;
+    }
+
+    return wanted;
+}
+
+/**
+ * @brief  Record an issued request
+ */
+void ble_link_adapt_requested(ble_link_adapt_t *adapt, ble_link_adapt_level_t level, uint32_t now_ms)
+{
+    adapt->pending = level;
+    adapt->last_request_ms = now_ms;
+    adapt->requests[level]++;
+}
+
+/**
+ * @brief  Complete the pending request
+ */
+void ble_link_adapt_updated(ble_link_adapt_t *adapt, bool success)
+{
+    if(adapt->pending == BLE_LINK_ADAPT_KEEP)
+    {
+        return;
+    }
+    if(success)
+    {
+        adapt->level = adapt->pending;
+    }
+    adapt->pending = BLE_LINK_ADAPT_KEEP;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+ *  ble_link_adapt.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_LINK_ADAPT_H_
+#define _BLE_LINK_ADAPT_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+typedef enum
+{
+    BLE_LINK_ADAPT_IDLE = 0,            /* Long interval with slave latency */
+    BLE_LINK_ADAPT_BUSY,                /* Short interval */
+    BLE_LINK_ADAPT_LEVELS,
+    BLE_LINK_ADAPT_KEEP = BLE_LINK_ADAPT_LEVELS,
+} ble_link_adapt_level_t;
+
+/**
+ * Connection interval controller. Fed one sample per period with the
+ * outbound backlog and the received byte count, it answers the level the
+ * link should run at. It depends on nothing but its inputs, so recorded
+ * traffic can be replayed through it off target.
+ *     o A backlog or rx rate above the busy thresholds moves to BUSY at
+ *       once, the next data should not wait a long interval.
+ *     o Moving back to IDLE takes BLE_LINK_ADAPT_IDLE_MS of samples below
+ *       the idle thresholds, so a short pause inside a burst keeps BUSY.
+ *     o Two requests are at least BLE_LINK_ADAPT_MIN_GAP_MS apart, each
+ *       update costs the central a procedure and several connection events.
+ *     o A level is only recorded once its request was issued, and only run
+ *       once the update completed, so a refused one is asked for again.
+ */
+typedef struct
+{
+    uint8_t level;
+    uint8_t pending;                    /* Level requested, BLE_LINK_ADAPT_KEEP when none */
+    uint8_t started;                    /* First sample taken */
+    uint32_t last_sample_ms;
+    uint32_t last_request_ms;
+    uint32_t quiet_since_ms;
+    uint32_t rx_bytes;                  /* Counter value at the last sample */
+    uint32_t rx_rate;                   /* Bytes per second over the last period */
+    uint32_t requests[BLE_LINK_ADAPT_LEVELS];
+    uint32_t deferred;                  /* Changes held back by the rate limit */
+} ble_link_adapt_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Reset the controller, a new connection starts BUSY
+ * @param  adapt  : controller state
+ *         now_ms : current time
+ * @retval None
+ */
+void ble_link_adapt_init(ble_link_adapt_t *adapt, uint32_t now_ms);
+
+/**
+ * @brief  Feed one sample and get the level to request
+ * @param  adapt    : controller state
+ *         backlog  : notifications queued for the connection
+ *         rx_bytes : running count of bytes received on the connection
+ *         now_ms   : current time
+ * @retval Level to request, BLE_LINK_ADAPT_KEEP when nothing should change
+ */
+ble_link_adapt_level_t ble_link_adapt_sample(ble_link_adapt_t *adapt, uint32_t backlog, uint32_t rx_bytes,
+                                             uint32_t now_ms);
+
+/**
+ * @brief  Record the request of a level returned by ble_link_adapt_sample,
+ *         once it was issued
+ * @param  adapt  : controller state
+ *         level  : level requested
+ *         now_ms : current time
+ * @retval None
+ */
+void ble_link_adapt_requested(ble_link_adapt_t *adapt, ble_link_adapt_level_t level, uint32_t now_ms);
+
+/**
+ * @brief  Complete the pending request, the link runs its level on success
+ * @param  adapt   : controller state
+ *         success : parameters updated
+ * @retval None
+ */
+void ble_link_adapt_updated(ble_link_adapt_t *adapt, bool success);
+
+/******************************************************************************/
+
+#endif /* _BLE_LINK_ADAPT_H_ */
\ No newline at end of file
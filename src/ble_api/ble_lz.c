@@ -0,0 +1,188 @@
+/*
+ *  ble_lz.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_lz.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_LZ_HASH_NONE                              0xFFFF
+
+_Static_assert(BLE_LZ_WINDOW_SIZE <= 1024, "Match distance is 10 bits");
+_Static_assert(BLE_TX_QUEUE_ITEM_SIZE <= BLE_LZ_WINDOW_SIZE, "A block must fit in the second half of the buffer");
+_Static_assert(BLE_TX_BATCH_SIZE <= BLE_LZ_WINDOW_SIZE, "A block must fit in the second half of the buffer");
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint32_t ble_lz_hash(const uint8_t *data);
+static void ble_lz_slide(ble_lz_t *lz);
+
+/******************************************************************************/
+
+/**
+ * @brief  Hash of the BLE_LZ_MIN_MATCH bytes at data
+ */
+static uint32_t ble_lz_hash(const uint8_t *data)
+{
+    uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+
+    return (value * 2654435761u) >> (32 - BLE_LZ_HASH_BITS);
+}
+
+/**
+ * @brief  Keep the last window of history at the start of the buffer
+ */
+static void ble_lz_slide(ble_lz_t *lz)
+{
+    uint16_t shift = lz->history - BLE_LZ_WINDOW_SIZE;
+    uint32_t i;
+
+    memmove(lz->buffer, lz->buffer + shift, BLE_LZ_WINDOW_SIZE);
+    lz->history = BLE_LZ_WINDOW_SIZE;
+
+    for(i = 0; i < BLE_LZ_HASH_SIZE; i++)
+    {
+        lz->hash[i] = (lz->hash[i] != BLE_LZ_HASH_NONE && lz->hash[i] >= shift) ?
+                      lz->hash[i] - shift : BLE_LZ_HASH_NONE;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Empty the history
+ */
+void ble_lz_reset(ble_lz_t *lz)
+{
+    /* Entries left in the hash point at or past history, candidates at or
+     * past the current position are rejected, earlier ones hold bytes of
+     * the block being encoded */
+    lz->history = 0;
+    lz->pending = 0;
+    lz->reset = 1;
+}
+
+/**
+ * @brief  Encode one block
+ */
+size_t ble_lz_encode(ble_lz_t *lz, const uint8_t *data, size_t size, uint8_t *out)
+{
+    uint8_t *buffer = lz->buffer;
+    uint32_t pos;
+    uint32_t end;
+    uint32_t candidate;
+    uint32_t length;
+    uint32_t max;
+    uint32_t hash;
+    size_t control = 0;
+    size_t written = BLE_LZ_HEADER_SIZE;
+    uint32_t bits = 8;
+
+    if(lz->history + size > BLE_LZ_BUFFER_SIZE)
+    {
+        ble_lz_slide(lz);
+    }
+
+    pos = lz->history;
+    end = pos + size;
+    memcpy(buffer + pos, data, size);
+    lz->pending = size;
+
+    /* Greedy parse, one hash probe per position */
+    while(pos < end)
+    {
+        length = 0;
+        if(end - pos >= BLE_LZ_MIN_MATCH)
+        {
+            hash = ble_lz_hash(buffer + pos);
+            candidate = lz->hash[hash];
+            lz->hash[hash] = pos;
+            if(candidate < pos && pos - candidate <= BLE_LZ_WINDOW_SIZE)
+            {
+                max = end - pos < BLE_LZ_MAX_MATCH ? end - pos : BLE_LZ_MAX_MATCH;
+                while(length < max && buffer[candidate + length] == buffer[pos + length])
+                {
+                    length++;
+                }
+            }
+        }
+        if(length < BLE_LZ_MIN_MATCH)
+        {
+            length = 0;
+        }
+
+        /* Not shorter than the payload, send it raw */
+        if(written + (bits == 8) + (length ? 2 : 1) > size)
+        {
+            out[0] = BLE_LZ_BLOCK_RAW | (lz->reset ? BLE_LZ_BLOCK_RESET : 0);
+            memcpy(out + BLE_LZ_HEADER_SIZE, data, size);
+            return size + BLE_LZ_HEADER_SIZE;
+        }
+
+        if(bits == 8)
+        {
+            control = written++;
+            out[control] = 0;
+            bits = 0;
+        }
+
+        if(length == 0)
+        {
+            out[written++] = buffer[pos++];
+        }
+        else
+        {
+            out[control] |= 1 << bits;
+            out[written++] = (((pos - candidate - 1) << 6) | (length - BLE_LZ_MIN_MATCH)) & 0xFF;
+            out[written++] = ((pos - candidate - 1) << 6) >> 8;
+
+            /* Positions inside the match stay reachable for later blocks */
+            for(pos++, length--; length > 0; pos++, length--)
+            {
+                if(end - pos >= BLE_LZ_MIN_MATCH)
+                {
+                    lz->hash[ble_lz_hash(buffer + pos)] = pos;
+                }
+            }
+        }
+        bits++;
+    }
+
+    out[0] = BLE_LZ_BLOCK_LZ | (lz->reset ? BLE_LZ_BLOCK_RESET : 0);
+    return written;
+}
+
+/**
+ * @brief  Append the last encoded block to the history
+ */
+void ble_lz_commit(ble_lz_t *lz)
+{
+    lz->history += lz->pending;
+    lz->pending = 0;
+    lz->reset = 0;
+}
\ No newline at end of file
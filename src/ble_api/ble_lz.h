@@ -0,0 +1,106 @@
+/*
+ *  ble_lz.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_LZ_H_
+#define _BLE_LZ_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Streaming LZSS over the notifications of one connection. Each notification
+ * is one block, decoded on its own but against a shared history:
+ *     o Header byte: BLE_LZ_BLOCK_LZ when the body is tokens, raw payload
+ *       otherwise. BLE_LZ_BLOCK_RESET asks the decoder to empty its
+ *       history before the block.
+ *     o Tokens come in groups of one control byte and up to 8 tokens,
+ *       control bit n (LSB first) set for a match, clear for a literal byte.
+ *     o A match is a little endian uint16 (distance - 1) << 6 |
+ *       (length - BLE_LZ_MIN_MATCH). The decoder copies length bytes from
+ *       distance bytes back, one byte at a time as the copy may overlap.
+ *     o Every decoded payload, raw or not, is appended to the history, of
+ *       which the last BLE_LZ_WINDOW_SIZE bytes are referenced.
+ * A block never grows by more than its header: when tokens would not be
+ * shorter than the payload, the payload is sent raw.
+ */
+#define BLE_LZ_HEADER_SIZE                            1
+#define BLE_LZ_BLOCK_RAW                              0x00
+#define BLE_LZ_BLOCK_LZ                               0x01
+#define BLE_LZ_BLOCK_RESET                            0x80
+#define BLE_LZ_MIN_MATCH                              3
+#define BLE_LZ_MAX_MATCH                              (BLE_LZ_MIN_MATCH + 63)
+#define BLE_LZ_HASH_SIZE                              (1 << BLE_LZ_HASH_BITS)
+#define BLE_LZ_BUFFER_SIZE                            (2 * BLE_LZ_WINDOW_SIZE)
+
+/**
+ * Encoder state of one connection. The history and the block being encoded
+ * share one linear buffer, slid back by a window once full, so matches
+ * never wrap. Hash entries are only hints, every candidate is compared, so
+ * stale ones from a rolled back block are harmless.
+ */
+typedef struct
+{
+    uint16_t history;                   /* Committed bytes in buffer */
+    uint16_t pending;                   /* Bytes of the last block, until commit */
+    uint8_t reset;                      /* Next block carries BLE_LZ_BLOCK_RESET */
+    uint16_t hash[BLE_LZ_HASH_SIZE];
+    uint8_t buffer[BLE_LZ_BUFFER_SIZE];
+} ble_lz_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Empty the history, the next block tells the decoder to do the same
+ * @param  lz : encoder state
+ * @retval None
+ */
+void ble_lz_reset(ble_lz_t *lz);
+
+/**
+ * @brief  Encode one block. The history only moves on ble_lz_commit, so a
+ *         block that is not sent is simply encoded again or dropped
+ * @param  lz   : encoder state
+ *         data : payload
+ *         size : length of data (max is BLE_TX_BATCH_SIZE)
+ *         out  : block, at least size + BLE_LZ_HEADER_SIZE bytes
+ * @retval Length of the block
+ */
+size_t ble_lz_encode(ble_lz_t *lz, const uint8_t *data, size_t size, uint8_t *out);
+
+/**
+ * @brief  Append the last encoded block to the history, once the peer is
+ *         sure to receive it
+ * @param  lz : encoder state
+ * @retval None
+ */
+void ble_lz_commit(ble_lz_t *lz);
+
+/******************************************************************************/
+
+#endif /* _BLE_LZ_H_ */
\ No newline at end of file
@@ -0,0 +1,704 @@
+/*
+ *  ble_ota.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <nvs.h>
+#include <esp_crc.h>
+#include <esp_system.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <freertos/queue.h>
+#include <nimble/nimble_port.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_stats.h"
+#include "gatt_server.h"
+#include "ble_ota.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_OTA_NVS_NAMESPACE                         "ble_ota"
+#define BLE_OTA_NVS_RECORD                            "record"
+#define BLE_OTA_BUFFER_NONE                           0xFF
+#define BLE_OTA_JOB_FINISH                            0xFE
+
+/* Resume point, saved by the writer every BLE_OTA_COMMIT_SIZE bytes */
+typedef struct
+{
+    uint32_t address;                   /* Partition the image goes to */
+    uint32_t size;
+    uint32_t crc;                       /* Expected CRC of the whole image */
+    uint32_t offset;                    /* Bytes in flash */
+    uint32_t running_crc;               /* CRC of the bytes in flash */
+} ble_ota_record_t;
+
+/* One filled buffer handed to the writer, or the END check */
+typedef struct
+{
+    uint8_t index;
+    uint32_t generation;
+    uint32_t offset;
+    uint32_t length;
+} ble_ota_job_t;
+
+_Static_assert(BLE_OTA_BUFFER_SIZE % 4096 == 0, "Buffers are written as whole flash sectors");
+_Static_assert(BLE_OTA_COMMIT_SIZE % BLE_OTA_BUFFER_SIZE == 0, "Resume points must start a buffer");
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "OTA";
+static uint16_t ota_control_characteristic_handle;
+static uint16_t ota_data_characteristic_handle;
+static nvs_handle_t ble_ota_nvs;
+static bool ble_ota_nvs_open = false;   /* Opened by the first BEGIN, NVS may still be recovering at init */
+static QueueHandle_t ble_ota_jobs;
+static QueueHandle_t ble_ota_free;
+static struct ble_npl_event ble_ota_event;
+static struct ble_npl_callout ble_ota_reboot_timer;
+static uint8_t ble_ota_buffers[BLE_OTA_BUFFERS][BLE_OTA_BUFFER_SIZE];
+static const ble_ota_flash_t ble_ota_idf_flash = {
+    .erase = esp_partition_erase_range,
+    .write = esp_partition_write,
+    .set_boot = esp_ota_set_boot_partition,
+};
+
+/* Host task only */
+static ble_ota_state_t ble_ota_state = BLE_OTA_STATE_IDLE;
+static uint16_t ble_ota_conn = BLE_HS_CONN_HANDLE_NONE;
+static uint32_t ble_ota_received;
+static uint32_t ble_ota_resumed_at;
+static uint32_t ble_ota_started_at;
+static uint32_t ble_ota_notified;
+static uint8_t ble_ota_active = BLE_OTA_BUFFER_NONE;
+static uint32_t ble_ota_fill;
+static uint8_t ble_ota_nack_sent;
+
+/* Set by the host task while the writer is idle, read by the writer */
+static const ble_ota_flash_t *ble_ota_flash = &ble_ota_idf_flash;
+static const esp_partition_t *ble_ota_partition;
+static ble_ota_record_t ble_ota_record;
+static uint32_t ble_ota_erased;
+static volatile uint32_t ble_ota_generation;
+
+/* Written by the writer, read by the host task */
+static volatile uint32_t ble_ota_written;
+static volatile uint8_t ble_ota_status;
+static volatile uint8_t ble_ota_finished;
+
+/**
+ * The OTA service consists of two characteristics, see ble_ota.h:
+ *     o control: commands written by the client, answers and progress
+ *       notified by the device.
+ *     o data: image chunks, written without response.
+ * Both need an authenticated link.
+ */
+
+/* 5c3a659e-897e-45e1-b016-007107c96e00 */
+static const ble_uuid128_t gatt_ota_service_ulid =
+    BLE_UUID128_INIT(0x00, 0x6e, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+/* 5c3a659e-897e-45e1-b016-007107c96e01 */
+static const ble_uuid128_t gatt_ota_control_characteristic_ulid =
+    BLE_UUID128_INIT(0x01, 0x6e, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+/* 5c3a659e-897e-45e1-b016-007107c96e02 */
+static const ble_uuid128_t gatt_ota_data_characteristic_ulid =
+    BLE_UUID128_INIT(0x02, 0x6e, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+static esp_err_t ble_ota_control_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t ble_ota_data_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                             struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+static const struct ble_gatt_svc_def ble_ota_services[] = {
+    {
+        /*** Service: OTA */
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = &gatt_ota_service_ulid.u,
+        .characteristics = (struct ble_gatt_chr_def[])
+        {
+            /* Control Characteristic */
+            GATT_SERVER_CHR(&gatt_ota_control_characteristic_ulid.u, OTA_CONTROL_CHARACTERISTIC_FLAGS,
+                            ble_ota_control_access_handler, NULL, &ota_control_characteristic_handle),
+            /* Data Characteristic */
+            GATT_SERVER_CHR(&gatt_ota_data_characteristic_ulid.u, OTA_DATA_CHARACTERISTIC_FLAGS,
+                            ble_ota_data_access_handler, NULL, &ota_data_characteristic_handle),
+            {
+                0, /* No more characteristics in this service. */
+            }
+        },
+    },
+
+    {
+        0, /* No more services. */
+    },
+};
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static esp_err_t ble_ota_control_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t ble_ota_data_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                             struct ble_gatt_access_ctxt *ctxt, void *arg);
+static void ble_ota_notify(uint8_t op, uint8_t status, uint32_t offset);
+static uint8_t ble_ota_begin(uint32_t size, uint32_t crc);
+static void ble_ota_stop(void);
+static void ble_ota_submit(void);
+static void ble_ota_on_writer(struct ble_npl_event *ev);
+static void ble_ota_reboot(struct ble_npl_event *ev);
+static uint8_t ble_ota_write(const ble_ota_job_t *job);
+static uint8_t ble_ota_check(void);
+static void ble_ota_writer_task(void *arg);
+
+/******************************************************************************/
+
+/**
+ * @brief  Notify the control characteristic of the transfer owner
+ */
+static void ble_ota_notify(uint8_t op, uint8_t status, uint32_t offset)
+{
+    uint8_t message[BLE_OTA_NOTIFY_SIZE];
+    struct os_mbuf *om;
+
+    /* Owner gone while the END check finishes */
+    if(ble_ota_conn == BLE_HS_CONN_HANDLE_NONE)
+    {
+        return;
+    }
+
+    message[0] = op;
+    message[1] = status;
+    message[2] = offset & 0xFF;
+    message[3] = (offset >> 8) & 0xFF;
+    message[4] = (offset >> 16) & 0xFF;
+    message[5] = offset >> 24;
+
+    om = ble_hs_mbuf_from_flat(message, sizeof(message));
+    if(om != NULL)
+    {
+        ble_gattc_notify_custom(ble_ota_conn, ota_control_characteristic_handle, om);
+    }
+}
+
+/**
+ * @brief  Start or resume a transfer, writer is idle
+ * @retval BLE_OTA_STATUS_*
+ */
+static uint8_t ble_ota_begin(uint32_t size, uint32_t crc)
+{
+    ble_ota_record_t record;
+    size_t length = sizeof(record);
+
+    ble_ota_partition = esp_ota_get_next_update_partition(NULL);
+    if(ble_ota_partition == NULL || size == 0 || size > ble_ota_partition->size)
+    {
+        return BLE_OTA_STATUS_INVALID;
+    }
+
+    /* Without the resume record a transfer could not survive a reset, the
+     * client asks again once NVS is ready */
+    if(!ble_ota_nvs_open)
+    {
+        ble_ota_nvs_open = (nvs_open(BLE_OTA_NVS_NAMESPACE, NVS_READWRITE, &ble_ota_nvs) == ESP_OK);
+        if(!ble_ota_nvs_open)
+        {
+            return BLE_OTA_STATUS_BUSY;
+        }
+    }
+
+    /* Same image into the same slot: carry on from the resume point */
+    if(nvs_get_blob(ble_ota_nvs, BLE_OTA_NVS_RECORD, &record, &length) == ESP_OK &&
+       length == sizeof(record) && record.address == ble_ota_partition->address &&
+       record.size == size && record.crc == crc && record.offset <= size)
+    {
+        ble_ota_record = record;
+    }
+    else
+    {
+        ble_ota_record.address = ble_ota_partition->address;
+        ble_ota_record.size = size;
+        ble_ota_record.crc = crc;
+        ble_ota_record.offset = 0;
+        ble_ota_record.running_crc = 0;
+    }
+
+    /* Flash past the resume point may hold anything, it is erased again */
+    ble_ota_erased = ble_ota_record.offset;
+    ble_ota_written = ble_ota_record.offset;
+    ble_ota_status = BLE_OTA_STATUS_OK;
+    ble_ota_finished = 0;
+    ble_ota_generation++;
+
+    ble_ota_received = ble_ota_record.offset;
+    ble_ota_resumed_at = ble_ota_record.offset;
+    ble_ota_notified = ble_ota_record.offset;
+    ble_ota_started_at = ble_stats_now();
+    ble_ota_fill = 0;
+    ble_ota_nack_sent = 0;
+    ble_ota_state = BLE_OTA_STATE_RECEIVING;
+
+    ESP_LOGI(TAG, "Begin %u bytes into %s at offset %u", size, ble_ota_partition->label, ble_ota_received);
+    return BLE_OTA_STATUS_OK;
+}
+
+/**
+ * @brief  Drop the transfer, buffers already handed to the writer still land
+ */
+static void ble_ota_stop(void)
+{
+    if(ble_ota_active != BLE_OTA_BUFFER_NONE)
+    {
+        xQueueSend(ble_ota_free, &ble_ota_active, 0);
+        ble_ota_active = BLE_OTA_BUFFER_NONE;
+    }
+    ble_ota_state = BLE_OTA_STATE_IDLE;
+    ble_ota_conn = BLE_HS_CONN_HANDLE_NONE;
+}
+
+/**
+ * @brief  Hand the active buffer to the writer
+ */
+static void ble_ota_submit(void)
+{
+    ble_ota_job_t job;
+
+    job.index = ble_ota_active;
+    job.generation = ble_ota_generation;
+    job.offset = ble_ota_received - ble_ota_fill;
+    job.length = ble_ota_fill;
+
+    /* Never blocks, the queue holds every buffer */
+    xQueueSend(ble_ota_jobs, &job, 0);
+    ble_ota_active = BLE_OTA_BUFFER_NONE;
+    ble_ota_fill = 0;
+}
+
+/**
+ * @brief  Report what the writer did, runs in the host task
+ */
+static void ble_ota_on_writer(struct ble_npl_event *ev)
+{
+    uint32_t written = ble_ota_written;
+
+    if(ble_ota_state != BLE_OTA_STATE_RECEIVING && ble_ota_state != BLE_OTA_STATE_FINISHING)
+    {
+        return;
+    }
+
+    if(ble_ota_state == BLE_OTA_STATE_FINISHING && ble_ota_finished)
+    {
+        ble_ota_notify(BLE_OTA_OP_END, ble_ota_status, written);
+        if(ble_ota_status != BLE_OTA_STATUS_OK)
+        {
+            ble_ota_stop();
+            return;
+        }
+        ESP_LOGI(TAG, "Image accepted after %u ms, rebooting", (ble_stats_now() - ble_ota_started_at) / 1000);
+        ble_ota_state = BLE_OTA_STATE_DONE;
+        ble_npl_callout_reset(&ble_ota_reboot_timer, ble_npl_time_ms_to_ticks32(BLE_OTA_REBOOT_DELAY_MS));
+        return;
+    }
+
+    if(ble_ota_status != BLE_OTA_STATUS_OK)
+    {
+        ESP_LOGE(TAG, "Flash error at offset %u", written);
+        ble_ota_notify(BLE_OTA_OP_PROGRESS, ble_ota_status, written);
+        ble_ota_stop();
+        return;
+    }
+
+    if(written != ble_ota_notified)
+    {
+        ble_ota_notified = written;
+        ble_ota_notify(BLE_OTA_OP_PROGRESS, BLE_OTA_STATUS_OK, written);
+    }
+}
+
+/**
+ * @brief  Boot the new image
+ */
+static void ble_ota_reboot(struct ble_npl_event *ev)
+{
+    esp_restart();
+}
+
+/**
+ * @brief  Callback when the control characteristic is written
+ */
+static esp_err_t ble_ota_control_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    uint8_t command[1 + 2 * sizeof(uint32_t)];
+    uint16_t length = OS_MBUF_PKTLEN(ctxt->om);
+    ble_ota_job_t job;
+    uint8_t status;
+
+    if(ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+    {
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+    if(length == 0 || length > sizeof(command) || os_mbuf_copydata(ctxt->om, 0, length, command) != 0)
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    /* Only the owner talks to a running transfer */
+    if(ble_ota_state != BLE_OTA_STATE_IDLE && conn_handle != ble_ota_conn)
+    {
+        return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+
+    switch(command[0])
+    {
+    case BLE_OTA_OP_BEGIN:
+        if(length != sizeof(command))
+        {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        if(ble_ota_state == BLE_OTA_STATE_FINISHING)
+        {
+            ble_ota_notify(BLE_OTA_OP_BEGIN, BLE_OTA_STATUS_BUSY, ble_ota_received);
+            break;
+        }
+        ble_ota_stop();
+        ble_ota_conn = conn_handle;
+
+        /* Buffers of an interrupted transfer may still be on their way */
+        if(uxQueueMessagesWaiting(ble_ota_free) != BLE_OTA_BUFFERS)
+        {
+            status = BLE_OTA_STATUS_BUSY;
+        }
+        else
+        {
+            status = ble_ota_begin(command[1] | (command[2] << 8) | (command[3] << 16) | (command[4] << 24),
+                                   command[5] | (command[6] << 8) | (command[7] << 16) | (command[8] << 24));
+        }
+        ble_ota_notify(BLE_OTA_OP_BEGIN, status, ble_ota_received);
+        if(status != BLE_OTA_STATUS_OK)
+        {
+            ble_ota_stop();
+        }
+        break;
+
+    case BLE_OTA_OP_END:
+        if(ble_ota_state != BLE_OTA_STATE_RECEIVING || ble_ota_received != ble_ota_record.size)
+        {
+            ble_ota_conn = conn_handle;
+            ble_ota_notify(BLE_OTA_OP_END, BLE_OTA_STATUS_INVALID, ble_ota_received);
+            if(ble_ota_state == BLE_OTA_STATE_IDLE)
+            {
+                ble_ota_conn = BLE_HS_CONN_HANDLE_NONE;
+            }
+            break;
+        }
+
+        /* Queued behind the last buffer, answered from ble_ota_on_writer */
+        ble_ota_state = BLE_OTA_STATE_FINISHING;
+        job.index = BLE_OTA_JOB_FINISH;
+        job.generation = ble_ota_generation;
+        xQueueSend(ble_ota_jobs, &job, 0);
+        break;
+
+    case BLE_OTA_OP_ABORT:
+        /* Too late, the check may be switching the boot partition */
+        if(ble_ota_state == BLE_OTA_STATE_FINISHING)
+        {
+            ble_ota_notify(BLE_OTA_OP_ABORT, BLE_OTA_STATUS_BUSY, ble_ota_received);
+            break;
+        }
+        ble_ota_generation++;
+        nvs_erase_key(ble_ota_nvs, BLE_OTA_NVS_RECORD);
+        nvs_commit(ble_ota_nvs);
+        ble_ota_conn = conn_handle;
+        ble_ota_notify(BLE_OTA_OP_ABORT, BLE_OTA_STATUS_OK, 0);
+        ble_ota_stop();
+        break;
+
+    default:
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief  Callback when the data characteristic is written, copies the
+ *         chunk into the active buffer
+ */
+static esp_err_t ble_ota_data_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                             struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    uint16_t length = OS_MBUF_PKTLEN(ctxt->om);
+    uint8_t header[BLE_OTA_DATA_HEADER_SIZE];
+    uint32_t offset;
+    uint32_t chunk;
+    uint16_t done = BLE_OTA_DATA_HEADER_SIZE;
+
+    if(ble_ota_state != BLE_OTA_STATE_RECEIVING || conn_handle != ble_ota_conn ||
+       length <= BLE_OTA_DATA_HEADER_SIZE || os_mbuf_copydata(ctxt->om, 0, sizeof(header), header) != 0)
+    {
+        return ESP_OK;
+    }
+
+    offset = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
+    if(offset != ble_ota_received || offset + length - done > ble_ota_record.size)
+    {
+        /* Once per gap, duplicates from a resend are silently dropped */
+        if(offset > ble_ota_received && !ble_ota_nack_sent)
+        {
+            ble_ota_nack_sent = 1;
+            ble_ota_notify(BLE_OTA_OP_NACK, BLE_OTA_STATUS_OK, ble_ota_received);
+        }
+        return ESP_OK;
+    }
+
+    while(done < length)
+    {
+        if(ble_ota_active == BLE_OTA_BUFFER_NONE && xQueueReceive(ble_ota_free, &ble_ota_active, 0) != pdTRUE)
+        {
+            /* Client ran past BLE_OTA_WINDOW, the rest comes again */
+            ble_ota_active = BLE_OTA_BUFFER_NONE;
+            if(!ble_ota_nack_sent)
+            {
+                ble_ota_nack_sent = 1;
+                ble_ota_notify(BLE_OTA_OP_NACK, BLE_OTA_STATUS_OK, ble_ota_received);
+            }
+            return ESP_OK;
+        }
+
+        chunk = length - done;
+        if(chunk > BLE_OTA_BUFFER_SIZE - ble_ota_fill)
+        {
+            chunk = BLE_OTA_BUFFER_SIZE - ble_ota_fill;
+        }
+        os_mbuf_copydata(ctxt->om, done, chunk, ble_ota_buffers[ble_ota_active] + ble_ota_fill);
+        ble_ota_fill += chunk;
+        ble_ota_received += chunk;
+        done += chunk;
+
+        if(ble_ota_fill == BLE_OTA_BUFFER_SIZE || ble_ota_received == ble_ota_record.size)
+        {
+            ble_ota_submit();
+        }
+    }
+
+    ble_ota_nack_sent = 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Erase ahead, write one buffer and fold it into the CRC
+ * @retval BLE_OTA_STATUS_*
+ */
+static uint8_t ble_ota_write(const ble_ota_job_t *job)
+{
+    uint32_t end = job->offset + job->length;
+    uint32_t size;
+
+    /* Whole erase blocks are much faster than sectors, the first one after
+     * a resume point may start mid block */
+    while(ble_ota_erased < end)
+    {
+        size = BLE_OTA_ERASE_SIZE - (ble_ota_erased % BLE_OTA_ERASE_SIZE);
+        if(size > ble_ota_partition->size - ble_ota_erased)
+        {
+            size = ble_ota_partition->size - ble_ota_erased;
+        }
+        if(ble_ota_flash->erase(ble_ota_partition, ble_ota_erased, size) != ESP_OK)
+        {
+            return BLE_OTA_STATUS_FLASH;
+        }
+        ble_ota_erased += size;
+    }
+
+    if(ble_ota_flash->write(ble_ota_partition, job->offset, ble_ota_buffers[job->index], job->length) != ESP_OK)
+    {
+        return BLE_OTA_STATUS_FLASH;
+    }
+    ble_ota_record.running_crc = esp_crc32_le(ble_ota_record.running_crc, ble_ota_buffers[job->index],
+                                              job->length);
+    ble_ota_record.offset = end;
+
+    if(end % BLE_OTA_COMMIT_SIZE == 0 || end == ble_ota_record.size)
+    {
+        nvs_set_blob(ble_ota_nvs, BLE_OTA_NVS_RECORD, &ble_ota_record, sizeof(ble_ota_record));
+        nvs_commit(ble_ota_nvs);
+    }
+    return BLE_OTA_STATUS_OK;
+}
+
+/**
+ * @brief  Check the CRC and the image, select it for the next boot
+ * @retval BLE_OTA_STATUS_*
+ */
+static uint8_t ble_ota_check(void)
+{
+    if(ble_ota_record.offset != ble_ota_record.size)
+    {
+        return BLE_OTA_STATUS_INVALID;
+    }
+    if(ble_ota_record.running_crc != ble_ota_record.crc)
+    {
+        return BLE_OTA_STATUS_CRC;
+    }
+
+    /* Verifies the image header, segments and hash */
+    if(ble_ota_flash->set_boot(ble_ota_partition) != ESP_OK)
+    {
+        return BLE_OTA_STATUS_IMAGE;
+    }
+
+    nvs_erase_key(ble_ota_nvs, BLE_OTA_NVS_RECORD);
+    nvs_commit(ble_ota_nvs);
+    return BLE_OTA_STATUS_OK;
+}
+
+/**
+ * @brief  Flash writer, erase and write overlap with the radio filling the
+ *         other buffer
+ */
+static void ble_ota_writer_task(void *arg)
+{
+    ble_ota_job_t job;
+    uint8_t status;
+
+    while(1)
+    {
+        xQueueReceive(ble_ota_jobs, &job, portMAX_DELAY);
+
+        if(job.index == BLE_OTA_JOB_FINISH)
+        {
+            if(job.generation == ble_ota_generation)
+            {
+                ble_ota_status = ble_ota_status == BLE_OTA_STATUS_OK ? ble_ota_check() : ble_ota_status;
+                ble_ota_finished = 1;
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ble_ota_event);
+            }
+            continue;
+        }
+
+        /* Aborted transfers are not written, failed ones stop at the error */
+        if(job.generation == ble_ota_generation && ble_ota_status == BLE_OTA_STATUS_OK)
+        {
+            status = ble_ota_write(&job);
+            if(status == BLE_OTA_STATUS_OK)
+            {
+                ble_ota_written = ble_ota_record.offset;
+            }
+            ble_ota_status = status;
+        }
+        xQueueSend(ble_ota_free, &job.index, 0);
+
+        /* Putting an already queued event is a no-op, progress coalesces */
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ble_ota_event);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Release the transfer of a terminated connection
+ */
+void ble_ota_close(uint16_t conn_handle)
+{
+    if(conn_handle != ble_ota_conn)
+    {
+        return;
+    }
+
+    /* The writer may be switching the boot partition, which cannot be taken
+     * back: the check completes, only nobody is told */
+    if(ble_ota_state == BLE_OTA_STATE_FINISHING || ble_ota_state == BLE_OTA_STATE_DONE)
+    {
+        ble_ota_conn = BLE_HS_CONN_HANDLE_NONE;
+        return;
+    }
+    ble_ota_stop();
+}
+
+/**
+ * @brief  Get the state of the current transfer
+ */
+void ble_ota_get_progress(ble_ota_progress_t *progress)
+{
+    progress->state = ble_ota_state;
+    progress->size = ble_ota_record.size;
+    progress->received = ble_ota_received;
+    progress->written = ble_ota_written;
+    progress->resumed_at = ble_ota_resumed_at;
+    progress->elapsed_ms = ble_ota_state != BLE_OTA_STATE_IDLE ? (ble_stats_now() - ble_ota_started_at) / 1000 : 0;
+}
+
+/**
+ * @brief  Replace the flash operations of the writer
+ */
+esp_err_t ble_ota_register_flash(const ble_ota_flash_t *flash)
+{
+    if(ble_ota_state != BLE_OTA_STATE_IDLE ||
+       (ble_ota_free != NULL && uxQueueMessagesWaiting(ble_ota_free) != BLE_OTA_BUFFERS))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ble_ota_flash = flash != NULL ? flash : &ble_ota_idf_flash;
+    return ESP_OK;
+}
+
+/**
+ * @brief  OTA service initialization
+ */
+esp_err_t ble_ota_init(void)
+{
+    esp_err_t rc;
+    uint8_t i;
+
+    ble_ota_jobs = xQueueCreate(BLE_OTA_BUFFERS + 1, sizeof(ble_ota_job_t));
+    ble_ota_free = xQueueCreate(BLE_OTA_BUFFERS, sizeof(uint8_t));
+    if(ble_ota_jobs == NULL || ble_ota_free == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    for(i = 0; i < BLE_OTA_BUFFERS; i++)
+    {
+        xQueueSend(ble_ota_free, &i, 0);
+    }
+
+    ble_npl_event_init(&ble_ota_event, ble_ota_on_writer, NULL);
+    ble_npl_callout_init(&ble_ota_reboot_timer, nimble_port_get_dflt_eventq(), ble_ota_reboot, NULL);
+
+    if(xTaskCreatePinnedToCore(ble_ota_writer_task, "ble_ota", BLE_OTA_WRITER_STACK_SIZE,
+                               NULL, BLE_OTA_WRITER_PRIORITY, NULL, BLE_OTA_WRITER_CORE) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    rc = ble_gatts_count_cfg(ble_ota_services);
+    if(rc != ESP_OK)
+    {
+        return rc;
+    }
+    return ble_gatts_add_svcs(ble_ota_services);
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+/*
+ *  ble_ota.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_OTA_H_
+#define _BLE_OTA_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_partition.h>
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define OTA_CONTROL_CHARACTERISTIC_FLAGS              \
+    (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN | BLE_GATT_CHR_F_NOTIFY)
+#define OTA_DATA_CHARACTERISTIC_FLAGS                 \
+    (BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
+
+/**
+ * OTA protocol, one transfer at a time into the next update partition:
+ *     o The client subscribes to the control characteristic and writes
+ *       [BLE_OTA_OP_BEGIN][image size, le32][image CRC-32, le32]. The CRC
+ *       is the zlib one. The answer gives the offset to start from: 0, or
+ *       the last committed offset when the same image was interrupted.
+ *     o Data goes to the data characteristic with writes without response,
+ *       [offset, le32][payload]. A write not at the expected offset is
+ *       dropped and answered once with BLE_OTA_OP_NACK, the client resends
+ *       from the offset given.
+ *     o BLE_OTA_OP_PROGRESS reports the bytes written to flash. The client
+ *       keeps at most BLE_OTA_WINDOW bytes beyond it.
+ *     o Once every byte is sent the client writes [BLE_OTA_OP_END]. The
+ *       CRC and the image are checked, on success the device boots the new
+ *       image BLE_OTA_REBOOT_DELAY_MS after the answer.
+ *     o [BLE_OTA_OP_ABORT] drops the transfer and its resume point.
+ * Every notification is [op][BLE_OTA_STATUS_*][offset, le32].
+ */
+#define BLE_OTA_OP_BEGIN                              0x01
+#define BLE_OTA_OP_END                                0x02
+#define BLE_OTA_OP_ABORT                              0x03
+#define BLE_OTA_OP_PROGRESS                           0x10
+#define BLE_OTA_OP_NACK                               0x11
+
+#define BLE_OTA_STATUS_OK                             0x00
+#define BLE_OTA_STATUS_INVALID                        0x01    /* Bad size, command out of sequence */
+#define BLE_OTA_STATUS_BUSY                           0x02    /* Another transfer still owns the flash, or NVS not ready */
+#define BLE_OTA_STATUS_FLASH                          0x03
+#define BLE_OTA_STATUS_CRC                            0x04
+#define BLE_OTA_STATUS_IMAGE                          0x05    /* Image refused by the bootloader checks */
+
+#define BLE_OTA_DATA_HEADER_SIZE                      4
+#define BLE_OTA_NOTIFY_SIZE                           6
+#define BLE_OTA_WINDOW                                (BLE_OTA_BUFFERS * BLE_OTA_BUFFER_SIZE)
+
+typedef enum
+{
+    BLE_OTA_STATE_IDLE = 0,
+    BLE_OTA_STATE_RECEIVING,
+    BLE_OTA_STATE_FINISHING,            /* END received, last buffers being checked */
+    BLE_OTA_STATE_DONE,                 /* Rebooting into the new image */
+} ble_ota_state_t;
+
+typedef struct
+{
+    ble_ota_state_t state;
+    uint32_t size;
+    uint32_t received;                  /* Bytes accepted from the client */
+    uint32_t written;                   /* Bytes in flash */
+    uint32_t resumed_at;                /* Offset the transfer started from */
+    uint32_t elapsed_ms;                /* Since BEGIN */
+} ble_ota_progress_t;
+
+/**
+ * Flash operations of the writer task, the ESP-IDF partition and OTA calls
+ * unless replaced, for instance by a fake flash on the host.
+ */
+typedef struct
+{
+    esp_err_t (*erase)(const esp_partition_t *partition, size_t offset, size_t size);
+    esp_err_t (*write)(const esp_partition_t *partition, size_t offset, const void *data, size_t size);
+    esp_err_t (*set_boot)(const esp_partition_t *partition);   /* Checks the image, selects it for next boot */
+} ble_ota_flash_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Release the transfer of a terminated connection. Its resume point
+ *         stays, the client continues from it on the next BEGIN. A transfer
+ *         past END runs its check to the end, the boot partition may
+ *         already be switched
+ * @param  conn_handle : connection handle
+ * @retval None
+ */
+void ble_ota_close(uint16_t conn_handle);
+
+/**
+ * @brief  Get the state of the current transfer
+ * @param  progress : filled with the transfer state
+ * @retval None
+ */
+void ble_ota_get_progress(ble_ota_progress_t *progress);
+
+/**
+ * @brief  Replace the flash operations of the writer
+ * @param  flash : operations, NULL for the ESP-IDF ones
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if a transfer or its buffers are in flight
+ */
+esp_err_t ble_ota_register_flash(const ble_ota_flash_t *flash);
+
+/**
+ * @brief  OTA service initialization, registers the service and starts the
+ *         flash writer task. Call before the host task starts. NVS is not
+ *         needed yet, the first BEGIN opens it and is answered BUSY until
+ *         it is ready
+ * @param  None
+ * @retval ESP_OK on success
+ *         ESP_ERR_NO_MEM if the writer task cannot be created
+ *         Otherwise the NimBLE error
+ */
+esp_err_t ble_ota_init(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_OTA_H_ */
\ No newline at end of file
@@ -0,0 +1,189 @@
+/*
+ *  ble_pair.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <nimble/nimble_port.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_stats.h"
+#include "ble_pair.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+typedef enum
+{
+    BLE_PAIR_KEYS_NONE = 0,
+    BLE_PAIR_KEYS_GENERATING,
+    BLE_PAIR_KEYS_READY,
+} ble_pair_keys_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "BLE_PAIR";
+
+static volatile ble_pair_keys_t ble_pair_keys = BLE_PAIR_KEYS_NONE;
+static ble_pair_ready_fn *ble_pair_ready_callback = NULL;
+static struct ble_npl_event ble_pair_ready_event;
+static int32_t ble_pair_keygen_rc;
+static ble_pair_stats_t ble_pair_stats;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_pair_keygen_task(void *arg);
+static void ble_pair_ready(struct ble_npl_event *ev);
+static void ble_pair_record(ble_pair_phase_t phase, uint32_t start, uint32_t end);
+
+/******************************************************************************/
+
+/**
+ * @brief  Generate the key pair away from the host task
+ */
+static void ble_pair_keygen_task(void *arg)
+{
+    struct ble_sm_sc_oob_data oob;
+    uint32_t start = ble_stats_now();
+
+    /* The only public entry point that makes the stack generate its pair,
+     * the OOB data itself is not used */
+    ble_pair_keygen_rc = ble_sm_sc_oob_generate_data(&oob);
+    ble_pair_stats.keygen_us = ble_stats_now() - start;
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ble_pair_ready_event);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  Back in the host task once the key pair is ready
+ */
+static void ble_pair_ready(struct ble_npl_event *ev)
+{
+    if(ble_pair_keygen_rc != 0)
+    {
+        ESP_LOGE(TAG, "Key pair generation failed; rc = %d", ble_pair_keygen_rc);
+        ble_pair_stats.keygen_us = 0;
+        ble_pair_keys = BLE_PAIR_KEYS_NONE;
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Key pair ready in %u us", ble_pair_stats.keygen_us);
+        ble_pair_keys = BLE_PAIR_KEYS_READY;
+    }
+
+    if(ble_pair_ready_callback != NULL)
+    {
+        ble_pair_ready_callback();
+    }
+}
+
+/**
+ * @brief  Record the duration of one phase
+ */
+static void ble_pair_record(ble_pair_phase_t phase, uint32_t start, uint32_t end)
+{
+    ble_pair_stats.last_us[phase] = end - start;
+    if(ble_pair_stats.last_us[phase] > ble_pair_stats.max_us[phase])
+    {
+        ble_pair_stats.max_us[phase] = ble_pair_stats.last_us[phase];
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Generate the LE Secure Connections key pair in the background
+ */
+esp_err_t ble_pair_prepare(ble_pair_ready_fn *callback)
+{
+    if(ble_pair_keys == BLE_PAIR_KEYS_READY)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* A host reset while generating, the pending event calls the new one */
+    ble_pair_ready_callback = callback;
+    if(ble_pair_keys == BLE_PAIR_KEYS_GENERATING)
+    {
+        return ESP_OK;
+    }
+
+    ble_npl_event_init(&ble_pair_ready_event, ble_pair_ready, NULL);
+    ble_pair_keys = BLE_PAIR_KEYS_GENERATING;
+    if(xTaskCreatePinnedToCore(ble_pair_keygen_task, "ble_keygen", BLE_PAIR_KEYGEN_STACK_SIZE, NULL,
+                               BLE_PAIR_KEYGEN_PRIORITY, NULL, BLE_PAIR_KEYGEN_CORE) != pdPASS)
+    {
+        ble_pair_keys = BLE_PAIR_KEYS_NONE;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONNECT
+ */
+void ble_pair_on_connect(ble_pair_timing_t *timing)
+{
+    timing->connected = ble_stats_now();
+    timing->passkey = 0;
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_PASSKEY_ACTION
+ */
+void ble_pair_on_passkey(ble_pair_timing_t *timing)
+{
+    timing->passkey = ble_stats_now();
+}
+
+/**
+ * @brief  Track BLE_GAP_EVENT_ENC_CHANGE
+ */
+void ble_pair_on_enc_change(ble_pair_timing_t *timing, int32_t status)
+{
+    uint32_t now = ble_stats_now();
+
+    if(status != 0)
+    {
+        ble_pair_stats.failures++;
+        timing->passkey = 0;
+        return;
+    }
+
+    ble_pair_stats.encryptions++;
+    if(timing->passkey != 0)
+    {
+        ble_pair_stats.pairings++;
+        ble_pair_record(BLE_PAIR_PHASE_EXCHANGE, timing->connected, timing->passkey);
+        ble_pair_record(BLE_PAIR_PHASE_AUTHENTICATE, timing->passkey, now);
+        timing->passkey = 0;
+    }
+    ble_pair_record(BLE_PAIR_PHASE_TOTAL, timing->connected, now);
+}
+
+/**
+ * @brief  Get key generation and pairing phase timings
+ */
+void ble_pair_get_stats(ble_pair_stats_t *stats)
+{
+    *stats = ble_pair_stats;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+/*
+ *  ble_pair.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_PAIR_H_
+#define _BLE_PAIR_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Security setup of a connection, as seen from the peripheral. A passkey is
+ * displayed once the pairing features and the public keys are exchanged,
+ * the link is encrypted once the passkey rounds and the DHKey check are
+ * done. A bonded peer reencrypts without passkey, only the total counts.
+ */
+typedef enum
+{
+    BLE_PAIR_PHASE_EXCHANGE = 0,        /* Connection to passkey display */
+    BLE_PAIR_PHASE_AUTHENTICATE,        /* Passkey display to encryption */
+    BLE_PAIR_PHASE_TOTAL,               /* Connection to encryption */
+    BLE_PAIR_PHASES,
+} ble_pair_phase_t;
+
+/* Per connection timestamps, from ble_stats_now() */
+typedef struct
+{
+    uint32_t connected;
+    uint32_t passkey;                   /* 0 when no passkey was displayed */
+} ble_pair_timing_t;
+
+typedef struct
+{
+    uint32_t keygen_us;                 /* Background key pair generation, 0 until done */
+    uint32_t encryptions;               /* Links encrypted, paired or reencrypted */
+    uint32_t pairings;                  /* Of them, paired with a passkey */
+    uint32_t failures;
+    uint32_t last_us[BLE_PAIR_PHASES];
+    uint32_t max_us[BLE_PAIR_PHASES];
+} ble_pair_stats_t;
+
+typedef void ble_pair_ready_fn(void);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Generate the LE Secure Connections key pair on BLE_PAIR_KEYGEN_CORE,
+ *         so the first pairing does not run P-256 on the host task. The
+ *         stack keeps the pair until it is reinitialized. Call once the host
+ *         is synced, and hold off advertising until callback: the stack
+ *         would generate its own pair if a pairing started meanwhile
+ * @param  callback : called from the host task once the pair is ready or
+ *                    generation failed
+ * @retval ESP_OK when callback will be called
+ *         ESP_ERR_INVALID_STATE if the pair is already generated
+ *         ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t ble_pair_prepare(ble_pair_ready_fn *callback);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_CONNECT
+ * @param  timing : timestamps of the connection
+ * @retval None
+ */
+void ble_pair_on_connect(ble_pair_timing_t *timing);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_PASSKEY_ACTION
+ * @param  timing : timestamps of the connection
+ * @retval None
+ */
+void ble_pair_on_passkey(ble_pair_timing_t *timing);
+
+/**
+ * @brief  Track BLE_GAP_EVENT_ENC_CHANGE, records the phase timings
+ * @param  timing : timestamps of the connection
+ *         status : enc_change.status of the event
+ * @retval None
+ */
+void ble_pair_on_enc_change(ble_pair_timing_t *timing, int32_t status);
+
+/**
+ * @brief  Get key generation and pairing phase timings
+ * @param  stats : filled with the counters
+ * @retval None
+ */
+void ble_pair_get_stats(ble_pair_stats_t *stats);
+
+/******************************************************************************/
+
+#endif /* _BLE_PAIR_H_ */
\ No newline at end of file
@@ -0,0 +1,244 @@
+/*
+ *  ble_pool.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdatomic.h>
+#include <esp_heap_caps.h>
+
+#include "config.h"
+#include "ble_pool.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_POOL_EMPTY                                0xFFFF
+#define BLE_POOL_INDEX_MASK                           0xFFFF
+#define BLE_POOL_TAG_STEP                             0x10000
+
+/* Free list head packs a tag in the upper half and a block index in the lower
+ * half. The tag changes on every update, so a CAS never succeeds against a
+ * head that was popped and pushed back in between (ABA) */
+typedef struct
+{
+    uint8_t *base;
+    uint32_t block_size;
+    uint16_t blocks;
+    uint16_t *next;
+    _Atomic uint32_t head;
+    _Atomic uint32_t in_use;
+    _Atomic uint32_t peak;
+    _Atomic uint32_t fails;
+} ble_pool_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "POOL";
+
+static uint16_t ble_pool_small_next[BLE_POOL_SMALL_COUNT];
+static uint16_t ble_pool_medium_next[BLE_POOL_MEDIUM_COUNT];
+static uint16_t ble_pool_large_next[BLE_POOL_LARGE_COUNT];
+
+static ble_pool_t ble_pools[BLE_POOL_CLASSES] = {
+    [BLE_POOL_SMALL] = { .block_size = BLE_POOL_SMALL_SIZE, .blocks = BLE_POOL_SMALL_COUNT, .next = ble_pool_small_next },
+    [BLE_POOL_MEDIUM] = { .block_size = BLE_POOL_MEDIUM_SIZE, .blocks = BLE_POOL_MEDIUM_COUNT, .next = ble_pool_medium_next },
+    [BLE_POOL_LARGE] = { .block_size = BLE_POOL_LARGE_SIZE, .blocks = BLE_POOL_LARGE_COUNT, .next = ble_pool_large_next },
+};
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void *ble_pool_pop(ble_pool_t *pool);
+static void ble_pool_push(ble_pool_t *pool, uint16_t index);
+
+/******************************************************************************/
+
+/**
+ * @brief  Take the first free block of a class
+ */
+static void *ble_pool_pop(ble_pool_t *pool)
+{
+    uint32_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    uint32_t next;
+    uint32_t in_use;
+    uint32_t peak;
+    uint16_t index;
+
+    do
+    {
+        index = head & BLE_POOL_INDEX_MASK;
+        if(index == BLE_POOL_EMPTY)
+        {
+            return NULL;
+        }
+        next = ((head + BLE_POOL_TAG_STEP) & ~BLE_POOL_INDEX_MASK) | pool->next[index];
+    } while(!atomic_compare_exchange_weak_explicit(&pool->head, &head, next,
+                                                   memory_order_acq_rel, memory_order_acquire));
+
+    in_use = atomic_fetch_add_explicit(&pool->in_use, 1, memory_order_relaxed) + 1;
+    peak = atomic_load_explicit(&pool->peak, memory_order_relaxed);
+    while(in_use > peak &&
+          !atomic_compare_exchange_weak_explicit(&pool->peak, &peak, in_use,
+                                                 memory_order_relaxed, memory_order_relaxed));
+
+    return pool->base + index * pool->block_size;
+}
+
+/**
+ * @brief  Put a block back on top of its class
+ */
+static void ble_pool_push(ble_pool_t *pool, uint16_t index)
+{
+    uint32_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    uint32_t next;
+
+    do
+    {
+        pool->next[index] = head & BLE_POOL_INDEX_MASK;
+        next = ((head + BLE_POOL_TAG_STEP) & ~BLE_POOL_INDEX_MASK) | index;
+    } while(!atomic_compare_exchange_weak_explicit(&pool->head, &head, next,
+                                                   memory_order_release, memory_order_relaxed));
+
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Take a block from the smallest class that fits
+ */
+void *ble_pool_alloc(size_t size)
+{
+    void *block;
+    bool counted = false;
+    uint8_t i;
+
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        if(size > ble_pools[i].block_size)
+        {
+            continue;
+        }
+
+        block = ble_pool_pop(&ble_pools[i]);
+        if(block != NULL)
+        {
+            return block;
+        }
+
+        /* Only the class sized for the request counts the miss */
+        if(!counted)
+        {
+            atomic_fetch_add_explicit(&ble_pools[i].fails, 1, memory_order_relaxed);
+            counted = true;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Return a block to its class
+ */
+void ble_pool_free(void *block)
+{
+    uint8_t *ptr = block;
+    ble_pool_t *pool;
+    uint8_t i;
+
+    if(block == NULL)
+    {
+        return;
+    }
+
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        pool = &ble_pools[i];
+        if(ptr >= pool->base && ptr < pool->base + pool->block_size * pool->blocks)
+        {
+            ble_pool_push(pool, (ptr - pool->base) / pool->block_size);
+            return;
+        }
+    }
+
+    ESP_LOGE(TAG, "Block %p is not from the pool", block);
+}
+
+/**
+ * @brief  Get usage of one size class
+ */
+void ble_pool_get_stats(ble_pool_class_t pool_class, ble_pool_stats_t *stats)
+{
+    ble_pool_t *pool = &ble_pools[pool_class];
+
+    stats->block_size = pool->block_size;
+    stats->blocks = pool->blocks;
+    stats->in_use = atomic_load_explicit(&pool->in_use, memory_order_relaxed);
+    stats->peak = atomic_load_explicit(&pool->peak, memory_order_relaxed);
+    stats->fails = atomic_load_explicit(&pool->fails, memory_order_relaxed);
+}
+
+/**
+ * @brief  Pool initialization
+ */
+esp_err_t ble_pool_init(void)
+{
+    ble_pool_t *pool;
+    uint16_t j;
+    uint8_t i;
+
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        pool = &ble_pools[i];
+        if(pool->base != NULL)
+        {
+            continue;
+        }
+
+#if BLE_POOL_USE_PSRAM
+        pool->base = heap_caps_malloc(pool->block_size * pool->blocks, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(pool->base == NULL)
+        {
+            ESP_LOGW(TAG, "No PSRAM for class %d, using internal RAM", i);
+        }
+#endif
+        if(pool->base == NULL)
+        {
+            pool->base = heap_caps_malloc(pool->block_size * pool->blocks, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if(pool->base == NULL)
+        {
+            ESP_LOGE(TAG, "Error allocating class %d, %u x %u bytes", i, pool->blocks, pool->block_size);
+            return ESP_ERR_NO_MEM;
+        }
+
+        for(j = 0; j < pool->blocks; j++)
+        {
+            pool->next[j] = j + 1;
+        }
+        pool->next[pool->blocks - 1] = BLE_POOL_EMPTY;
+        atomic_init(&pool->head, 0);
+        atomic_init(&pool->in_use, 0);
+        atomic_init(&pool->peak, 0);
+        atomic_init(&pool->fails, 0);
+    }
+
+    return ESP_OK;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ *  ble_pool.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_POOL_H_
+#define _BLE_POOL_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Packet buffer pool. Every size class is one block array carved out at
+ * init, its free blocks form a lock-free stack of indices, so alloc and free
+ * are O(1), never touch the heap and may be called from any task.
+ */
+typedef enum
+{
+    BLE_POOL_SMALL = 0,                 /* One MTU sized packet */
+    BLE_POOL_MEDIUM,                    /* One attribute value */
+    BLE_POOL_LARGE,                     /* One framed message */
+    BLE_POOL_CLASSES
+} ble_pool_class_t;
+
+typedef struct
+{
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t in_use;
+    uint32_t peak;                      /* High watermark of in_use */
+    uint32_t fails;                     /* Allocations that found the class empty */
+} ble_pool_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Take a block from the smallest class that fits, falls back to the
+ *         larger classes when that one is empty
+ * @param  size : bytes needed
+ * @retval Block, NULL if size is too large or every fitting class is empty
+ */
+void *ble_pool_alloc(size_t size);
+
+/**
+ * @brief  Return a block to its class
+ * @param  block : block from ble_pool_alloc, NULL is ignored
+ * @retval None
+ */
+void ble_pool_free(void *block);
+
+/**
+ * @brief  Get usage of one size class
+ * @param  pool_class : size class
+ *         stats      : filled with the counters
+ * @retval None
+ */
+void ble_pool_get_stats(ble_pool_class_t pool_class, ble_pool_stats_t *stats);
+
+/**
+ * @brief  Pool initialization, allocates every class once, from PSRAM when
+ *         BLE_POOL_USE_PSRAM is set
+ * @param  None
+ * @retval ESP_OK on success
+ *         ESP_ERR_NO_MEM if a class cannot be allocated
+ */
+esp_err_t ble_pool_init(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_POOL_H_ */
\ No newline at end of file
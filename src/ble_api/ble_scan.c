@@ -0,0 +1,372 @@
+/*
+ *  ble_scan.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_timer.h>
+#include <nimble/nimble_port.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_scan.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_SCAN_TABLE_MASK                           (BLE_SCAN_TABLE_SIZE - 1)
+#define BLE_SCAN_TABLE_LIMIT                          (BLE_SCAN_TABLE_SIZE - BLE_SCAN_TABLE_SIZE / 4)
+#define BLE_SCAN_SWEEP_MS                             1000    /* Expired devices looked for every */
+#define BLE_SCAN_LOCK_SLOTS                           32      /* Slots walked per critical section */
+
+/**
+ * Open addressing with linear probing and no tombstones: a removed device
+ * is filled by shifting the rest of its cluster back, so a lookup stops at
+ * the first free slot. The table is kept below 3/4 full to bound clusters.
+ * Walks over the table take the lock BLE_SCAN_LOCK_SLOTS slots at a time,
+ * the table is consistent whenever it is released.
+ */
+typedef struct
+{
+    ble_scan_device_t device;
+    int16_t rssi_drained;               /* rssi_avg when last drained */
+    uint8_t used;
+    uint8_t changed;
+} ble_scan_slot_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "SCAN";
+
+static ble_scan_slot_t ble_scan_table[BLE_SCAN_TABLE_SIZE];
+static uint32_t ble_scan_cursor;
+static ble_scan_stats_t ble_scan_stats;
+static portMUX_TYPE ble_scan_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct ble_npl_callout ble_scan_sweep_timer;
+
+_Static_assert((BLE_SCAN_TABLE_SIZE & BLE_SCAN_TABLE_MASK) == 0, "BLE_SCAN_TABLE_SIZE must be a power of 2");
+_Static_assert(BLE_SCAN_DATA_SIZE <= 255, "Payload length is 8 bits");
+_Static_assert(BLE_SCAN_TABLE_SIZE % BLE_SCAN_LOCK_SLOTS == 0, "Walks end on a chunk boundary");
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint32_t ble_scan_hash(const ble_addr_t *addr);
+static uint32_t ble_scan_find(const ble_addr_t *addr);
+static void ble_scan_remove(uint32_t slot);
+static void ble_scan_report(const struct ble_gap_disc_desc *disc);
+static void ble_scan_sweep(struct ble_npl_event *ev);
+static int32_t ble_scan_gap_event(struct ble_gap_event *event, void *arg);
+
+/******************************************************************************/
+
+/**
+ * @brief  Home slot of an address, FNV-1a over type and value
+ */
+static uint32_t ble_scan_hash(const ble_addr_t *addr)
+{
+    uint32_t hash = 2166136261u;
+    uint8_t i;
+
+    hash = (hash ^ addr->type) * 16777619u;
+    for(i = 0; i < sizeof(addr->val); i++)
+    {
+        hash = (hash ^ addr->val[i]) * 16777619u;
+    }
+    return hash & BLE_SCAN_TABLE_MASK;
+}
+
+/**
+ * @brief  Slot holding an address, or the free slot where it goes. Lock held
+ */
+static uint32_t ble_scan_find(const ble_addr_t *addr)
+{
+    uint32_t slot = ble_scan_hash(addr);
+    uint32_t probes = 1;
+
+    while(ble_scan_table[slot].used &&
+          (ble_scan_table[slot].device.addr.type != addr->type ||
+           memcmp(ble_scan_table[slot].device.addr.val, addr->val, sizeof(addr->val)) != 0))
+    {
+        slot = (slot + 1) & BLE_SCAN_TABLE_MASK;
+        probes++;
+    }
+
+    if(probes > ble_scan_stats.max_probes)
+    {
+        ble_scan_stats.max_probes = probes;
+    }
+    return slot;
+}
+
+/**
+ * @brief  Remove a device, shifting back the devices probed past it. Lock
+ *         held
+ */
+static void ble_scan_remove(uint32_t slot)
+{
+    uint32_t next = slot;
+    uint32_t home;
+
+    while(true)
+    {
+        next = (next + 1) & BLE_SCAN_TABLE_MASK;
+        if(!ble_scan_table[next].used)
+        {
+            break;
+        }
+
+        /* Movable only if its home is not in the cyclic range (slot, next] */
+        home = ble_scan_hash(&ble_scan_table[next].device.addr);
+        if(((next - home) & BLE_SCAN_TABLE_MASK) >= ((next - slot) & BLE_SCAN_TABLE_MASK))
+        {
+            ble_scan_table[slot] = ble_scan_table[next];
+            slot = next;
+        }
+    }
+
+    ble_scan_table[slot].used = 0;
+    ble_scan_table[slot].changed = 0;
+    ble_scan_stats.devices--;
+}
+
+/**
+ * @brief  Fold one advertising report into the table, host task only
+ */
+static void ble_scan_report(const struct ble_gap_disc_desc *disc)
+{
+    uint32_t now = esp_timer_get_time() / 1000;
+    uint8_t length = disc->length_data < BLE_SCAN_DATA_SIZE ? disc->length_data : BLE_SCAN_DATA_SIZE;
+    ble_scan_device_t *device;
+    ble_scan_slot_t *slot;
+    int32_t moved;
+
+    portENTER_CRITICAL(&ble_scan_lock);
+    ble_scan_stats.reports++;
+    slot = &ble_scan_table[ble_scan_find(&disc->addr)];
+    device = &slot->device;
+
+    if(!slot->used)
+    {
+        if(ble_scan_stats.devices >= BLE_SCAN_TABLE_LIMIT)
+        {
+            ble_scan_stats.full++;
+            portEXIT_CRITICAL(&ble_scan_lock);
+            return;
+        }
+        slot->used = 1;
+        slot->changed = 1;
+        slot->rssi_drained = disc->rssi * BLE_SCAN_RSSI_FRACTION;
+        device->addr = disc->addr;
+        device->rssi_min = disc->rssi;
+        device->rssi_max = disc->rssi;
+        device->rssi_avg = disc->rssi * BLE_SCAN_RSSI_FRACTION;
+        device->reports = 0;
+        device->first_seen_ms = now;
+        device->data_len = 0;
+        device->event_type = disc->event_type;
+        ble_scan_stats.devices++;
+    }
+
+    /* A scan response updates the aggregates, the advertising payload stays */
+    if(disc->event_type != BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP)
+    {
+        if(device->reports > 0 && length == device->data_len && memcmp(device->data, disc->data, length) == 0)
+        {
+            ble_scan_stats.duplicates++;
+        }
+        else
+        {
+            memcpy(device->data, disc->data, length);
+            device->data_len = length;
+            device->event_type = disc->event_type;
+            slot->changed = 1;
+        }
+    }
+
+    device->rssi = disc->rssi;
+    if(disc->rssi < device->rssi_min)
+    {
+        device->rssi_min = disc->rssi;
+    }
+    if(disc->rssi > device->rssi_max)
+    {
+        device->rssi_max = disc->rssi;
+    }
+    device->rssi_avg += (disc->rssi * BLE_SCAN_RSSI_FRACTION - device->rssi_avg) >> BLE_SCAN_RSSI_EWMA_SHIFT;
+    device->reports++;
+    device->last_seen_ms = now;
+
+    moved = device->rssi_avg - slot->rssi_drained;
+    if(moved >= BLE_SCAN_RSSI_DELTA * BLE_SCAN_RSSI_FRACTION || moved <= -BLE_SCAN_RSSI_DELTA * BLE_SCAN_RSSI_FRACTION)
+    {
+        slot->changed = 1;
+    }
+    portEXIT_CRITICAL(&ble_scan_lock);
+}
+
+/**
+ * @brief  Drop devices unseen for BLE_SCAN_EXPIRY_MS, while scanning
+ */
+static void ble_scan_sweep(struct ble_npl_event *ev)
+{
+    uint32_t now = esp_timer_get_time() / 1000;
+    uint32_t slot = 0;
+    uint32_t end;
+
+    while(slot < BLE_SCAN_TABLE_SIZE)
+    {
+        end = slot + BLE_SCAN_LOCK_SLOTS;
+        portENTER_CRITICAL(&ble_scan_lock);
+        while(slot < end)
+        {
+            if(ble_scan_table[slot].used && now - ble_scan_table[slot].device.last_seen_ms > BLE_SCAN_EXPIRY_MS)
+            {
+                /* Look at the slot again, a device may have shifted into it */
+                ble_scan_remove(slot);
+                ble_scan_stats.expired++;
+                continue;
+            }
+            slot++;
+        }
+        portEXIT_CRITICAL(&ble_scan_lock);
+    }
+
+    if(ble_gap_disc_active())
+    {
+        ble_npl_callout_reset(&ble_scan_sweep_timer, ble_npl_time_ms_to_ticks32(BLE_SCAN_SWEEP_MS));
+    }
+}
+
+/**
+ * @brief  GAP events of the discovery procedure
+ */
+static int32_t ble_scan_gap_event(struct ble_gap_event *event, void *arg)
+{
+    switch(event->type)
+    {
+    case BLE_GAP_EVENT_DISC:
+        ble_scan_report(&event->disc);
+        break;
+
+    case BLE_GAP_EVENT_DISC_COMPLETE:
+        ESP_LOGI(TAG, "Scan complete, reason %d, %u devices", event->disc_complete.reason,
+                 ble_scan_stats.devices);
+        ble_npl_callout_stop(&ble_scan_sweep_timer);
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Start scanning
+ */
+esp_err_t ble_scan_start(uint8_t own_addr_type, int32_t duration_ms)
+{
+    struct ble_gap_disc_params params = {0};
+    esp_err_t rc;
+
+    params.itvl = BLE_GAP_SCAN_ITVL_MS(BLE_SCAN_ITVL_MS);
+    params.window = BLE_GAP_SCAN_WIN_MS(BLE_SCAN_WINDOW_MS);
+    params.passive = !BLE_SCAN_ACTIVE;
+    params.filter_duplicates = 0;
+
+    rc = ble_gap_disc(own_addr_type, duration_ms, &params, ble_scan_gap_event, NULL);
+    if(rc != 0)
+    {
+        ESP_LOGE(TAG, "Error starting scan; rc = %d", rc);
+        return rc;
+    }
+    ble_npl_callout_reset(&ble_scan_sweep_timer, ble_npl_time_ms_to_ticks32(BLE_SCAN_SWEEP_MS));
+    return ESP_OK;
+}
+
+/**
+ * @brief  Stop scanning
+ */
+esp_err_t ble_scan_stop(void)
+{
+    ble_npl_callout_stop(&ble_scan_sweep_timer);
+    return ble_gap_disc_cancel();
+}
+
+/**
+ * @brief  Copy the changed devices and mark them unchanged
+ */
+uint32_t ble_scan_drain(ble_scan_device_t *devices, uint32_t max)
+{
+    ble_scan_slot_t *slot;
+    uint32_t count = 0;
+    uint32_t visited = 0;
+    uint32_t end;
+
+    while(visited < BLE_SCAN_TABLE_SIZE && count < max)
+    {
+        end = visited + BLE_SCAN_LOCK_SLOTS;
+        portENTER_CRITICAL(&ble_scan_lock);
+        for(; visited < end && count < max; visited++)
+        {
+            slot = &ble_scan_table[ble_scan_cursor];
+            ble_scan_cursor = (ble_scan_cursor + 1) & BLE_SCAN_TABLE_MASK;
+            if(slot->used && slot->changed)
+            {
+                devices[count++] = slot->device;
+                slot->changed = 0;
+                slot->rssi_drained = slot->device.rssi_avg;
+            }
+        }
+        portEXIT_CRITICAL(&ble_scan_lock);
+    }
+
+    return count;
+}
+
+/**
+ * @brief  Forget every device
+ */
+void ble_scan_clear(void)
+{
+    portENTER_CRITICAL(&ble_scan_lock);
+    memset(ble_scan_table, 0, sizeof(ble_scan_table));
+    ble_scan_stats.devices = 0;
+    portEXIT_CRITICAL(&ble_scan_lock);
+}
+
+/**
+ * @brief  Get the report and table counters
+ */
+void ble_scan_get_stats(ble_scan_stats_t *stats)
+{
+    portENTER_CRITICAL(&ble_scan_lock);
+    *stats = ble_scan_stats;
+    portEXIT_CRITICAL(&ble_scan_lock);
+}
+
+/**
+ * @brief  Scanning initialization
+ */
+void ble_scan_init(void)
+{
+    ble_npl_callout_init(&ble_scan_sweep_timer, nimble_port_get_dflt_eventq(), ble_scan_sweep, NULL);
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*
+ *  ble_scan.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_SCAN_H_
+#define _BLE_SCAN_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_gap.h>
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_SCAN_RSSI_FRACTION                        16      /* rssi_avg unit is 1/16 dBm */
+
+/**
+ * One advertiser as last reported. A device is changed, and returned by the
+ * next ble_scan_drain, when it is first seen, when its payload changes and
+ * when its average RSSI moved by BLE_SCAN_RSSI_DELTA since it was drained.
+ * Reports repeating the payload only update the aggregates.
+ */
+typedef struct
+{
+    ble_addr_t addr;
+    uint8_t event_type;                 /* BLE_HCI_ADV_RPT_EVTYPE_* of the last report */
+    int8_t rssi;                        /* Last report */
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int16_t rssi_avg;                   /* Exponentially weighted, BLE_SCAN_RSSI_FRACTION */
+    uint32_t reports;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+    uint8_t data_len;
+    uint8_t data[BLE_SCAN_DATA_SIZE];   /* Payload of the last report, truncated */
+} ble_scan_device_t;
+
+typedef struct
+{
+    uint32_t reports;                   /* BLE_GAP_EVENT_DISC handled */
+    uint32_t duplicates;                /* Same payload as the previous report of the device */
+    uint32_t devices;                   /* Devices tracked now */
+    uint32_t full;                      /* Reports of new devices dropped, table full */
+    uint32_t expired;                   /* Devices removed after BLE_SCAN_EXPIRY_MS unseen */
+    uint32_t max_probes;                /* Longest lookup, in slots */
+} ble_scan_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Start passive scanning, or active with BLE_SCAN_ACTIVE. The
+ *         controller duplicate filter is off so every report reaches the
+ *         table and updates the RSSI aggregates
+ * @param  own_addr_type : address type from ble_hs_id_infer_auto()
+ *         duration_ms   : scan duration, BLE_HS_FOREVER to scan until stopped
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_gap_disc
+ */
+esp_err_t ble_scan_start(uint8_t own_addr_type, int32_t duration_ms);
+
+/**
+ * @brief  Stop scanning, the table is kept
+ * @param  None
+ * @retval ESP_OK on success
+ *         Otherwise the NimBLE error of ble_gap_disc_cancel
+ */
+esp_err_t ble_scan_stop(void);
+
+/**
+ * @brief  Copy the changed devices and mark them unchanged, safe from any
+ *         task. Successive calls resume where the last one stopped, so a
+ *         small batch does not starve the end of the table
+ * @param  devices : destination
+ *         max     : capacity of devices
+ * @retval Number of devices copied, 0 when nothing changed
+ */
+uint32_t ble_scan_drain(ble_scan_device_t *devices, uint32_t max);
+
+/**
+ * @brief  Forget every device
+ * @param  None
+ * @retval None
+ */
+void ble_scan_clear(void);
+
+/**
+ * @brief  Get the report and table counters
+ * @param  stats : filled with the counters
+ * @retval None
+ */
+void ble_scan_get_stats(ble_scan_stats_t *stats);
+
+/**
+ * @brief  Scanning initialization, before the host starts
+ * @param  None
+ * @retval None
+ */
+void ble_scan_init(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_SCAN_H_ */
\ No newline at end of file
@@ -0,0 +1,228 @@
+/*
+ *  ble_session.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_session.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static ble_session_t ble_sessions[BLE_SESSION_MAX];
+
+/* Connection handle -> slot, open addressing with linear probing. The
+ * controller hands out small consecutive handles so probing is rare. */
+static uint8_t ble_session_index[BLE_SESSION_INDEX_SIZE];
+
+/* The host task changes the index while application tasks look it up */
+static portMUX_TYPE ble_session_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_session_index_insert(uint8_t *index, uint8_t slot);
+static void ble_session_index_rebuild(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Add slot to a lookup index
+ */
+static void ble_session_index_insert(uint8_t *index, uint8_t slot)
+{
+    uint8_t pos = ble_sessions[slot].conn_handle & (BLE_SESSION_INDEX_SIZE - 1);
+
+    while(index[pos] != BLE_SESSION_NONE)
+    {
+        pos = (pos + 1) & (BLE_SESSION_INDEX_SIZE - 1);
+    }
+    index[pos] = slot;
+}
+
+/**
+ * @brief  Rebuild the lookup index, only on disconnect so cost does not matter.
+ *         Built aside, readers only ever see a complete index
+ */
+static void ble_session_index_rebuild(void)
+{
+    uint8_t index[BLE_SESSION_INDEX_SIZE];
+    uint8_t slot;
+
+    memset(index, BLE_SESSION_NONE, sizeof(index));
+    for(slot = 0; slot < BLE_SESSION_MAX; slot++)
+    {
+        if(ble_sessions[slot].conn_handle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            ble_session_index_insert(index, slot);
+        }
+    }
+
+    portENTER_CRITICAL(&ble_session_lock);
+    memcpy(ble_session_index, index, sizeof(ble_session_index));
+    portEXIT_CRITICAL(&ble_session_lock);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Reset the session table
+ */
+void ble_session_init(void)
+{
+    uint8_t slot;
+
+    memset(ble_sessions, 0, sizeof(ble_sessions));
+    for(slot = 0; slot < BLE_SESSION_MAX; slot++)
+    {
+        ble_sessions[slot].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        ble_sessions[slot].index = slot;
+        ble_tx_sched_init(&ble_sessions[slot].tx_sched, ble_sessions[slot].tx_items);
+    }
+    ble_session_index_rebuild();
+}
+
+/**
+ * @brief  Allocate a session for a new connection
+ */
+ble_session_t *ble_session_open(uint16_t conn_handle)
+{
+    ble_session_t *session;
+    uint8_t slot;
+
+    for(slot = 0; slot < BLE_SESSION_MAX; slot++)
+    {
+        session = &ble_sessions[slot];
+        if(session->conn_handle == BLE_HS_CONN_HANDLE_NONE)
+        {
+            session->mtu = BLE_ATT_MTU_DFLT;
+            session->subscribed = 0;
+            session->security = BLE_SESSION_SECURITY_NONE;
+            session->key_size = 0;
+            session->tx_in_flight = 0;
+            session->tx_throttled = 0;
+            session->rx_unacked = 0;
+            session->rx_nack_sent = 0;
+            session->caps = 0;
+            session->rx_expected_seq = 0;
+            session->frame_tx_seq = 0;
+            session->frame_tx_head = 0;
+            session->frame_tx_count = 0;
+            session->frame_tx_offset = 0;
+            session->frame_rx_buf = NULL;
+            ble_stats_reset(&session->stats);
+            ble_tx_sched_reset(&session->tx_sched);
+
+            portENTER_CRITICAL(&ble_session_lock);
+            session->conn_handle = conn_handle;
+            ble_session_index_insert(ble_session_index, slot);
+            portEXIT_CRITICAL(&ble_session_lock);
+            return session;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Release the session of a terminated connection
+ */
+void ble_session_close(uint16_t conn_handle)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+
+    if(session == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&ble_session_lock);
+    session->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    portEXIT_CRITICAL(&ble_session_lock);
+    session->subscribed = 0;
+    ble_tx_sched_flush(&session->tx_sched);
+    ble_session_index_rebuild();
+}
+
+/**
+ * @brief  Find session by connection handle in constant time
+ */
+ble_session_t *ble_session_find(uint16_t conn_handle)
+{
+    ble_session_t *session = NULL;
+    uint8_t pos = conn_handle & (BLE_SESSION_INDEX_SIZE - 1);
+    uint8_t probes;
+    uint8_t slot;
+
+    portENTER_CRITICAL(&ble_session_lock);
+    for(probes = 0; probes < BLE_SESSION_INDEX_SIZE; probes++)
+    {
+        slot = ble_session_index[pos];
+        if(slot == BLE_SESSION_NONE)
+        {
+            break;
+        }
+        if(ble_sessions[slot].conn_handle == conn_handle)
+        {
+            session = &ble_sessions[slot];
+            break;
+        }
+        pos = (pos + 1) & (BLE_SESSION_INDEX_SIZE - 1);
+    }
+    portEXIT_CRITICAL(&ble_session_lock);
+
+    return session;
+}
+
+/**
+ * @brief  Get number of open sessions
+ */
+uint8_t ble_session_count(void)
+{
+    uint8_t count = 0;
+    uint8_t slot;
+
+    for(slot = 0; slot < BLE_SESSION_MAX; slot++)
+    {
+        if(ble_sessions[slot].conn_handle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief  Get session by table slot
+ */
+ble_session_t *ble_session_at(uint8_t index)
+{
+    if(index >= BLE_SESSION_MAX || ble_sessions[index].conn_handle == BLE_HS_CONN_HANDLE_NONE)
+    {
+        return NULL;
+    }
+    return &ble_sessions[index];
+}
\ No newline at end of file
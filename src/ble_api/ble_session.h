@@ -0,0 +1,140 @@
+/*
+ *  ble_session.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_SESSION_H_
+#define _BLE_SESSION_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_tx_queue.h"
+#include "ble_tx_sched.h"
+#include "ble_link.h"
+#include "ble_stats.h"
+#include "ble_lz.h"
+#include "ble_pair.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_SESSION_MAX                               CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define BLE_SESSION_INDEX_SIZE                        8       /* Power of 2, at least 2 * BLE_SESSION_MAX */
+#define BLE_SESSION_NONE                              0xFF
+
+typedef enum
+{
+    BLE_SESSION_SECURITY_NONE = 0,
+    BLE_SESSION_SECURITY_ENCRYPTED,
+    BLE_SESSION_SECURITY_AUTHENTICATED,
+} ble_session_security_t;
+
+/**
+ * Per connection state. Fields touched on every packet come first so they
+ * share a cache line, the tx slots follow.
+ */
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t mtu;
+    uint8_t index;
+    uint8_t subscribed;
+    uint8_t security;
+    uint8_t key_size;
+    uint8_t tx_in_flight;
+    uint8_t tx_throttled;
+    uint8_t rx_unacked;
+    uint8_t rx_nack_sent;
+    uint8_t caps;                       /* GATT_SERVER_CAP_* negotiated by the client */
+    uint16_t rx_expected_seq;
+    uint8_t frame_gen;                  /* Bumped on close, stales buffers held by other tasks */
+    uint8_t frame_tx_seq;
+    uint8_t frame_tx_head;              /* Oldest pending message, the one being framed */
+    uint8_t frame_tx_count;
+    uint16_t frame_tx_offset;           /* Bytes of the oldest message already queued */
+    uint8_t *frame_tx_buf[BLE_FRAME_TX_PENDING];
+    uint16_t frame_tx_size[BLE_FRAME_TX_PENDING];
+    uint8_t frame_rx_seq;
+    uint16_t frame_rx_len;
+    uint16_t frame_rx_total;
+    uint8_t *frame_rx_buf;
+    uint32_t tx_stamp;                  /* Queue timestamp of the notification being sent */
+    uint8_t tx_channel;                 /* Channel of the notification being sent */
+    ble_link_info_t link;
+    ble_pair_timing_t pair;
+    ble_stats_t stats;
+    ble_tx_sched_t tx_sched;
+    ble_tx_item_t tx_items[BLE_TX_SCHED_ITEMS];
+#if BLE_LZ_COMPRESSION
+    ble_lz_t lz;
+#endif
+} ble_session_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Reset the session table
+ * @param  None
+ * @retval None
+ */
+void ble_session_init(void);
+
+/**
+ * @brief  Allocate a session for a new connection, host task only
+ * @param  conn_handle : connection handle
+ * @retval Session, NULL if the table is full
+ */
+ble_session_t *ble_session_open(uint16_t conn_handle);
+
+/**
+ * @brief  Release the session of a terminated connection, host task only
+ * @param  conn_handle : connection handle
+ * @retval None
+ */
+void ble_session_close(uint16_t conn_handle);
+
+/**
+ * @brief  Find session by connection handle in constant time
+ * @param  conn_handle : connection handle
+ * @retval Session, NULL if the handle is not connected
+ */
+ble_session_t *ble_session_find(uint16_t conn_handle);
+
+/**
+ * @brief  Get number of open sessions
+ * @param  None
+ * @retval Number of open sessions
+ */
+uint8_t ble_session_count(void);
+
+/**
+ * @brief  Get session by table slot, used to iterate over connections
+ * @param  index : slot, 0 to BLE_SESSION_MAX - 1
+ * @retval Session, NULL if the slot is unused
+ */
+ble_session_t *ble_session_at(uint8_t index);
+
+/******************************************************************************/
+
+#endif /* _BLE_SESSION_H_ */
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+ *  ble_spsc_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <assert.h>
+
+#include "ble_spsc_queue.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Initialize queue over caller provided storage
+ */
+void ble_spsc_queue_init(ble_spsc_queue_t *queue, void *buffer, uint32_t item_size, uint32_t capacity)
+{
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    queue->buffer = buffer;
+    queue->item_size = item_size;
+    queue->mask = capacity - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+/**
+ * @brief  Producer: get the next free slot
+ */
+void *ble_spsc_queue_reserve(ble_spsc_queue_t *queue)
+{
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if(tail - head > queue->mask)
+    {
+        return NULL;
+    }
+    return queue->buffer + (tail & queue->mask) * queue->item_size;
+}
+
+/**
+ * @brief  Producer: publish the slot returned by the last reserve
+ */
+void ble_spsc_queue_commit(ble_spsc_queue_t *queue)
+{
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    /* Release orders the slot contents before the new tail */
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+/**
+ * @brief  Consumer: get the oldest published slot
+ */
+void *ble_spsc_queue_front(ble_spsc_queue_t *queue)
+{
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if(head == tail)
+    {
+        return NULL;
+    }
+    return queue->buffer + (head & queue->mask) * queue->item_size;
+}
+
+/**
+ * @brief  Consumer: give the slot returned by the last front back to the producer
+ */
+void ble_spsc_queue_release(ble_spsc_queue_t *queue)
+{
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    /* Release keeps our reads of the slot before the producer may reuse it */
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief  Get number of published slots
+ */
+uint32_t ble_spsc_queue_count(ble_spsc_queue_t *queue)
+{
+    return atomic_load_explicit(&queue->tail, memory_order_acquire) -
+           atomic_load_explicit(&queue->head, memory_order_acquire);
+}
\ No newline at end of file
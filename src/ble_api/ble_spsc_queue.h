@@ -0,0 +1,102 @@
+/*
+ *  ble_spsc_queue.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_SPSC_QUEUE_H_
+#define _BLE_SPSC_QUEUE_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Lock-free ring of fixed size slots for exactly one producer task and one
+ * consumer task. Indices run free and are masked on access, so capacity must
+ * be a power of 2. Slots are written and read in place through
+ * reserve/commit and front/release, nothing is copied by the queue itself.
+ */
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t item_size;
+    uint32_t mask;
+    atomic_uint_fast32_t head;          /* Written by the consumer only */
+    atomic_uint_fast32_t tail;          /* Written by the producer only */
+} ble_spsc_queue_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Initialize queue over caller provided storage
+ * @param  queue     : queue to initialize
+ *         buffer    : storage of capacity * item_size bytes
+ *         item_size : size of one slot, keep it a multiple of 4
+ *         capacity  : number of slots, power of 2
+ * @retval None
+ */
+void ble_spsc_queue_init(ble_spsc_queue_t *queue, void *buffer, uint32_t item_size, uint32_t capacity);
+
+/**
+ * @brief  Producer: get the next free slot
+ * @param  queue : queue
+ * @retval Slot to fill, NULL if the queue is full
+ */
+void *ble_spsc_queue_reserve(ble_spsc_queue_t *queue);
+
+/**
+ * @brief  Producer: publish the slot returned by the last reserve
+ * @param  queue : queue
+ * @retval None
+ */
+void ble_spsc_queue_commit(ble_spsc_queue_t *queue);
+
+/**
+ * @brief  Consumer: get the oldest published slot
+ * @param  queue : queue
+ * @retval Slot to read, NULL if the queue is empty
+ */
+void *ble_spsc_queue_front(ble_spsc_queue_t *queue);
+
+/**
+ * @brief  Consumer: give the slot returned by the last front back to the producer
+ * @param  queue : queue
+ * @retval None
+ */
+void ble_spsc_queue_release(ble_spsc_queue_t *queue);
+
+/**
+ * @brief  Get number of published slots, exact only from producer or consumer
+ * @param  queue : queue
+ * @retval Number of published slots
+ */
+uint32_t ble_spsc_queue_count(ble_spsc_queue_t *queue);
+
+/******************************************************************************/
+
+#endif /* _BLE_SPSC_QUEUE_H_ */
\ No newline at end of file
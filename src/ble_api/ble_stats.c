@@ -0,0 +1,138 @@
+/*
+ *  ble_stats.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_timer.h>
+
+#include "config.h"
+#include "ble_stats.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Get a timestamp for latency measurements
+ */
+uint32_t ble_stats_now(void)
+{
+    return (uint32_t) esp_timer_get_time();
+}
+
+/**
+ * @brief  Record the latency from start to now in one histogram
+ */
+void ble_stats_record(ble_stats_t *stats, ble_stats_hist_t hist, uint32_t start)
+{
+    uint32_t elapsed = ble_stats_now() - start;
+    uint32_t bucket = 0;
+
+    /* Bit length of the latency, one instruction on Xtensa (NSAU) */
+    if(elapsed != 0)
+    {
+        bucket = 32 - __builtin_clz(elapsed);
+        if(bucket >= BLE_STATS_HIST_BUCKETS)
+        {
+            bucket = BLE_STATS_HIST_BUCKETS - 1;
+        }
+    }
+    stats->hist[hist][bucket]++;
+}
+
+/**
+ * @brief  Get a percentile of one histogram
+ */
+uint32_t ble_stats_percentile(const uint32_t *hist, uint32_t per_mille)
+{
+    uint64_t total = 0;
+    uint64_t count = 0;
+    uint32_t bucket;
+
+    for(bucket = 0; bucket < BLE_STATS_HIST_BUCKETS; bucket++)
+    {
+        total += hist[bucket];
+    }
+    if(total == 0)
+    {
+        return 0;
+    }
+
+    for(bucket = 0; bucket < BLE_STATS_HIST_BUCKETS - 1; bucket++)
+    {
+        count += hist[bucket];
+        if(count * 1000 >= total * per_mille)
+        {
+            break;
+        }
+    }
+    return 1 << bucket;
+}
+
+/**
+ * @brief  Get what happened between two snapshots of the same connection
+ */
+void ble_stats_diff(const ble_stats_t *before, const ble_stats_t *after, ble_stats_t *delta)
+{
+    const uint32_t *a = (const uint32_t *) before;
+    const uint32_t *b = (const uint32_t *) after;
+    uint32_t *d = (uint32_t *) delta;
+    uint32_t i;
+
+    /* Every field is a wrapping uint32 counter */
+    for(i = 0; i < sizeof(ble_stats_t) / sizeof(uint32_t); i++)
+    {
+        d[i] = b[i] - a[i];
+    }
+}
+
+/**
+ * @brief  Count one received packet
+ */
+void ble_stats_rx(ble_stats_t *stats, size_t size)
+{
+    stats->rx_bytes += size;
+    stats->rx_packets++;
+}
+
+/**
+ * @brief  Count one packet handed to the stack
+ */
+void ble_stats_tx(ble_stats_t *stats, size_t size)
+{
+    stats->tx_bytes += size;
+    stats->tx_packets++;
+}
+
+/**
+ * @brief  Clear every counter
+ */
+void ble_stats_reset(ble_stats_t *stats)
+{
+    memset(stats, 0, sizeof(ble_stats_t));
+}
\ No newline at end of file
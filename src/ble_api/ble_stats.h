@@ -0,0 +1,131 @@
+/*
+ *  ble_stats.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_STATS_H_
+#define _BLE_STATS_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/* Bucket 0 counts latencies under 1 us, bucket i latencies in
+ * [2^(i-1), 2^i) us and the last bucket everything from 16.4 ms up */
+#define BLE_STATS_HIST_BUCKETS                        16
+
+typedef enum
+{
+    BLE_STATS_RX_TO_HANDLER = 0,        /* Write received to rx worker handler called */
+    BLE_STATS_HANDLER,                  /* Handler duration */
+    BLE_STATS_NOTIFY_TO_TX,             /* Notify queued to handed to the controller */
+    BLE_STATS_CONTROL_TO_TX,            /* Same, split by tx channel */
+    BLE_STATS_REALTIME_TO_TX,
+    BLE_STATS_BULK_TO_TX,
+    BLE_STATS_HISTS
+} ble_stats_hist_t;
+
+/**
+ * Per connection counters. Every field has a single writer task (rx and tx
+ * counters the host task, handler latencies the task running the handler),
+ * so updates are plain aligned 32 bit stores without lock. Readers may see
+ * a snapshot a few packets old, never a torn value. The diagnostics
+ * characteristic returns this struct as is, little endian.
+ */
+typedef struct
+{
+    uint32_t rx_bytes;
+    uint32_t rx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_packets;
+    uint32_t tx_wire_bytes;             /* tx_bytes once compressed, if negotiated */
+    uint32_t notify_fails;
+    uint32_t mbuf_fails;
+    uint32_t hist[BLE_STATS_HISTS][BLE_STATS_HIST_BUCKETS];
+} ble_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Get a timestamp for latency measurements
+ * @param  None
+ * @retval Microseconds since boot, wraps after 71 minutes
+ */
+uint32_t ble_stats_now(void);
+
+/**
+ * @brief  Record the latency from start to now in one histogram
+ * @param  stats : counters of the connection
+ *         hist  : histogram
+ *         start : timestamp from ble_stats_now()
+ * @retval None
+ */
+void ble_stats_record(ble_stats_t *stats, ble_stats_hist_t hist, uint32_t start);
+
+/**
+ * @brief  Get a percentile of one histogram
+ * @param  hist      : buckets of the histogram
+ *         per_mille : percentile, 500 for the median
+ * @retval Upper bound in us of the bucket holding the percentile, 0 if the
+ *         histogram is empty
+ */
+uint32_t ble_stats_percentile(const uint32_t *hist, uint32_t per_mille);
+
+/**
+ * @brief  Get what happened between two snapshots of the same connection
+ * @param  before : older snapshot
+ *         after  : newer snapshot
+ *         delta  : filled with after - before, counter by counter
+ * @retval None
+ */
+void ble_stats_diff(const ble_stats_t *before, const ble_stats_t *after, ble_stats_t *delta);
+
+/**
+ * @brief  Count one received packet
+ * @param  stats : counters of the connection
+ *         size  : length of packet
+ * @retval None
+ */
+void ble_stats_rx(ble_stats_t *stats, size_t size);
+
+/**
+ * @brief  Count one packet handed to the stack
+ * @param  stats : counters of the connection
+ *         size  : length of packet
+ * @retval None
+ */
+void ble_stats_tx(ble_stats_t *stats, size_t size);
+
+/**
+ * @brief  Clear every counter
+ * @param  stats : counters of the connection
+ * @retval None
+ */
+void ble_stats_reset(ble_stats_t *stats);
+
+/******************************************************************************/
+
+#endif /* _BLE_STATS_H_ */
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+ *  ble_trace.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "ble_stats.h"
+#include "ble_trace.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_TRACE_RING_MASK                           (BLE_TRACE_RING_SIZE - 1)
+
+/* seq is the write index plus one once the record is complete, 0 while a
+ * writer fills it, so readers detect records overwritten under them */
+typedef struct
+{
+    _Atomic uint32_t seq;
+    ble_trace_record_t record;
+} ble_trace_slot_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static ble_trace_slot_t ble_trace_ring[BLE_TRACE_RING_SIZE];
+static _Atomic uint32_t ble_trace_head;
+
+_Static_assert((BLE_TRACE_RING_SIZE & BLE_TRACE_RING_MASK) == 0, "BLE_TRACE_RING_SIZE must be a power of 2");
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static esp_err_t ble_trace_read_one(uint32_t index, ble_trace_record_t *record);
+
+/******************************************************************************/
+
+/**
+ * @brief  Copy the record written at index, if it is still in the ring
+ */
+static esp_err_t ble_trace_read_one(uint32_t index, ble_trace_record_t *record)
+{
+    ble_trace_slot_t *slot = &ble_trace_ring[index & BLE_TRACE_RING_MASK];
+
+    if(atomic_load_explicit(&slot->seq, memory_order_acquire) != index + 1)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *record = slot->record;
+
+    /* Keep the copy only if no writer touched the slot meanwhile */
+    atomic_thread_fence(memory_order_acquire);
+    if(atomic_load_explicit(&slot->seq, memory_order_relaxed) != index + 1)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Append one record to the ring
+ */
+void ble_trace_write(uint8_t module, uint8_t level, uint16_t event, uint32_t arg0, uint32_t arg1)
+{
+    uint32_t index = atomic_fetch_add_explicit(&ble_trace_head, 1, memory_order_relaxed);
+    ble_trace_slot_t *slot = &ble_trace_ring[index & BLE_TRACE_RING_MASK];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->record.timestamp = ble_stats_now();
+    slot->record.event = event;
+    slot->record.module = module;
+    slot->record.level = level;
+    slot->record.arg0 = arg0;
+    slot->record.arg1 = arg1;
+
+    atomic_store_explicit(&slot->seq, index + 1, memory_order_release);
+}
+
+/**
+ * @brief  Copy the records still in the ring, oldest first
+ */
+uint32_t ble_trace_read(ble_trace_record_t *records, uint32_t max)
+{
+    uint32_t head = atomic_load_explicit(&ble_trace_head, memory_order_acquire);
+    uint32_t index = head > BLE_TRACE_RING_SIZE ? head - BLE_TRACE_RING_SIZE : 0;
+    uint32_t count = 0;
+
+    for(; index < head && count < max; index++)
+    {
+        if(ble_trace_read_one(index, &records[count]) == ESP_OK)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief  Print the ring on the console
+ */
+void ble_trace_dump(void)
+{
+    ble_trace_record_t record;
+    const uint8_t *bytes = (const uint8_t *) &record;
+    uint32_t head = atomic_load_explicit(&ble_trace_head, memory_order_acquire);
+    uint32_t index = head > BLE_TRACE_RING_SIZE ? head - BLE_TRACE_RING_SIZE : 0;
+    uint32_t i;
+
+    printf("BLE_TRACE_BEGIN %u\n", head);
+    for(; index < head; index++)
+    {
+        /* One record at a time, so the dump needs no large buffer */
+        if(ble_trace_read_one(index, &record) != ESP_OK)
+        {
+            continue;
+        }
+
+        printf("BLE_TRACE %08x ", index);
+        for(i = 0; i < sizeof(ble_trace_record_t); i++)
+        {
+            printf("%02x", bytes[i]);
+        }
+        printf("\n");
+    }
+    printf("BLE_TRACE_END\n");
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+/*
+ *  ble_trace.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_TRACE_H_
+#define _BLE_TRACE_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/* Levels, set per module with BLE_TRACE_LEVEL_<module> in config.h */
+#define BLE_TRACE_NONE                                0
+#define BLE_TRACE_ERROR                               1
+#define BLE_TRACE_WARN                                2
+#define BLE_TRACE_INFO                                3
+#define BLE_TRACE_DEBUG                               4
+
+/**
+ * Record one event in the trace ring. The level test is a constant
+ * expression, so a site above the level of its module compiles to nothing,
+ * arguments included. Enabled sites cost one atomic increment and a 20 byte
+ * store, nothing is formatted or printed on the hot path.
+ */
+#define BLE_TRACE(_module, _level, _event, _arg0, _arg1)                       \
+    do                                                                         \
+    {                                                                          \
+        if((_level) <= BLE_TRACE_LEVEL_##_module)                              \
+        {                                                                      \
+            ble_trace_write(BLE_TRACE_MODULE_##_module, (_level), (_event),   \
+                            (uint32_t)(_arg0), (uint32_t)(_arg1));             \
+        }                                                                      \
+    } while(0)
+
+/* The host decoder (tools/ble_trace_decode.py) reads the names below and the
+ * argument names in the comments, keep one entry per line */
+typedef enum
+{
+    BLE_TRACE_MODULE_API = 0,
+    BLE_TRACE_MODULE_GATT,
+    BLE_TRACE_MODULE_COC,
+    BLE_TRACE_MODULE_FRAME,
+} ble_trace_module_t;
+
+typedef enum
+{
+    BLE_TRACE_EV_NOTIFY = 0,            /* conn, length */
+    BLE_TRACE_EV_NOTIFY_FAIL,           /* conn, rc */
+    BLE_TRACE_EV_NOTIFY_TX,             /* conn, status */
+    BLE_TRACE_EV_CONN_UPDATE,           /* conn, status */
+    BLE_TRACE_EV_PHY_UPDATE,            /* conn, phys (tx << 8 | rx) */
+    BLE_TRACE_EV_MTU,                   /* conn, mtu */
+    BLE_TRACE_EV_SUBSCRIBE,             /* conn, notify */
+    BLE_TRACE_EV_ENC_CHANGE,            /* conn, status */
+    BLE_TRACE_EV_TX_ACCESS,             /* conn, op */
+    BLE_TRACE_EV_RX,                    /* conn, length */
+    BLE_TRACE_EV_RX_DROP,               /* conn, length */
+    BLE_TRACE_EV_RX_NACK,               /* conn, expected_seq */
+    BLE_TRACE_EV_COC_SEND_FAIL,         /* conn, rc */
+    BLE_TRACE_EV_FRAME_DROP,            /* conn, received_length */
+    BLE_TRACE_EV_LINK_ADAPT,            /* conn, level */
+    BLE_TRACE_EV_PRODUCER_REFUSED,      /* conn, size */
+} ble_trace_event_t;
+
+/* One record as stored in the ring and dumped, little endian */
+typedef struct
+{
+    uint32_t timestamp;                 /* us since boot */
+    uint16_t event;
+    uint8_t module;
+    uint8_t level;
+    uint32_t arg0;
+    uint32_t arg1;
+} ble_trace_record_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Append one record to the ring, overwriting the oldest one. Lock
+ *         free, may be called from any task. Use BLE_TRACE instead
+ * @param  module : source module
+ *         level  : level of the event
+ *         event  : event id
+ *         arg0   : first event argument
+ *         arg1   : second event argument
+ * @retval None
+ */
+void ble_trace_write(uint8_t module, uint8_t level, uint16_t event, uint32_t arg0, uint32_t arg1);
+
+/**
+ * @brief  Copy the records still in the ring, oldest first. Records being
+ *         overwritten while copied are skipped
+ * @param  records : destination
+ *         max     : capacity of records
+ * @retval Number of records copied
+ */
+uint32_t ble_trace_read(ble_trace_record_t *records, uint32_t max);
+
+/**
+ * @brief  Print the ring on the console, one hex encoded record per line,
+ *         for tools/ble_trace_decode.py. Slow, never call it on the hot path
+ * @param  None
+ * @retval None
+ */
+void ble_trace_dump(void);
+
+/******************************************************************************/
+
+#endif /* _BLE_TRACE_H_ */
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+ *  ble_tx_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_stats.h"
+#include "ble_tx_queue.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Initialize queue over caller provided slot storage
+ */
+void ble_tx_queue_init(ble_tx_queue_t *queue, ble_tx_item_t *items, uint16_t capacity)
+{
+    memset(queue, 0, sizeof(ble_tx_queue_t));
+    queue->items = items;
+    queue->capacity = capacity;
+    queue->lock = (portMUX_TYPE) portMUX_INITIALIZER_UNLOCKED;
+}
+
+/**
+ * @brief  Copy data into the next free slot, never blocks
+ */
+esp_err_t ble_tx_queue_push(ble_tx_queue_t *queue, const uint8_t *data, size_t size)
+{
+    return ble_tx_queue_push_frame(queue, NULL, 0, data, size);
+}
+
+/**
+ * @brief  Copy a header followed by data into the next free slot, never blocks
+ */
+esp_err_t ble_tx_queue_push_frame(ble_tx_queue_t *queue, const uint8_t *header, size_t header_size,
+                                  const uint8_t *data, size_t size)
+{
+    ble_tx_item_t *item;
+
+    if(header_size + size > BLE_TX_QUEUE_ITEM_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    portENTER_CRITICAL(&queue->lock);
+    if(queue->count >= queue->capacity)
+    {
+        queue->dropped++;
+        portEXIT_CRITICAL(&queue->lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    item = &queue->items[queue->tail];
+    item->length = header_size + size;
+    item->timestamp = ble_stats_now();
+    if(header_size > 0)
+    {
+        memcpy(item->data, header, header_size);
+    }
+    memcpy(item->data + header_size, data, size);
+
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->count++;
+    if(queue->count > queue->peak)
+    {
+        queue->peak = queue->count;
+    }
+    portEXIT_CRITICAL(&queue->lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get number of free slots
+ */
+uint16_t ble_tx_queue_space(ble_tx_queue_t *queue)
+{
+    return queue->capacity - queue->count;
+}
+
+/**
+ * @brief  Get the oldest slot without removing it
+ */
+ble_tx_item_t *ble_tx_queue_peek(ble_tx_queue_t *queue)
+{
+    ble_tx_item_t *item = NULL;
+
+    portENTER_CRITICAL(&queue->lock);
+    if(queue->count > 0)
+    {
+        item = &queue->items[queue->head];
+    }
+    portEXIT_CRITICAL(&queue->lock);
+
+    return item;
+}
+
+/**
+ * @brief  Get a queued slot without removing it
+ */
+ble_tx_item_t *ble_tx_queue_peek_at(ble_tx_queue_t *queue, uint16_t index)
+{
+    ble_tx_item_t *item = NULL;
+
+    portENTER_CRITICAL(&queue->lock);
+    if(index < queue->count)
+    {
+        item = &queue->items[(queue->head + index) % queue->capacity];
+    }
+    portEXIT_CRITICAL(&queue->lock);
+
+    return item;
+}
+
+/**
+ * @brief  Remove the oldest slot
+ */
+void ble_tx_queue_pop(ble_tx_queue_t *queue)
+{
+    portENTER_CRITICAL(&queue->lock);
+    if(queue->count > 0)
+    {
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    portEXIT_CRITICAL(&queue->lock);
+}
+
+/**
+ * @brief  Drop every queued slot
+ */
+void ble_tx_queue_flush(ble_tx_queue_t *queue)
+{
+    portENTER_CRITICAL(&queue->lock);
+    queue->head = queue->tail;
+    queue->count = 0;
+    portEXIT_CRITICAL(&queue->lock);
+}
+
+/**
+ * @brief  Drop every queued slot and clear the counters
+ */
+void ble_tx_queue_reset(ble_tx_queue_t *queue)
+{
+    portENTER_CRITICAL(&queue->lock);
+    queue->head = queue->tail;
+    queue->count = 0;
+    queue->peak = 0;
+    queue->dropped = 0;
+    portEXIT_CRITICAL(&queue->lock);
+}
+
+/**
+ * @brief  Get number of queued slots
+ */
+uint16_t ble_tx_queue_count(ble_tx_queue_t *queue)
+{
+    return queue->count;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+/*
+ *  ble_tx_queue.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_TX_QUEUE_H_
+#define _BLE_TX_QUEUE_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+typedef struct
+{
+    uint16_t length;
+    uint32_t timestamp;                 /* ble_stats_now() at push */
+    uint8_t data[BLE_TX_QUEUE_ITEM_SIZE];
+} ble_tx_item_t;
+
+/**
+ * Bounded ring of fixed size slots. Any task may push, only the NimBLE host
+ * task peeks and pops, so the slot returned by peek stays valid until pop.
+ */
+typedef struct
+{
+    ble_tx_item_t *items;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t tail;
+    uint16_t count;
+    uint16_t peak;
+    uint32_t dropped;
+    portMUX_TYPE lock;
+} ble_tx_queue_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Initialize queue over caller provided slot storage
+ * @param  queue    : queue to initialize
+ *         items    : slot storage
+ *         capacity : number of slots in storage
+ * @retval None
+ */
+void ble_tx_queue_init(ble_tx_queue_t *queue, ble_tx_item_t *items, uint16_t capacity);
+
+/**
+ * @brief  Copy data into the next free slot, never blocks
+ * @param  queue : queue
+ *         data  : data to copy
+ *         size  : length of data (max is BLE_TX_QUEUE_ITEM_SIZE)
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_SIZE if data does not fit in a slot
+ *         ESP_ERR_NO_MEM if the queue is full, data is dropped
+ */
+esp_err_t ble_tx_queue_push(ble_tx_queue_t *queue, const uint8_t *data, size_t size);
+
+/**
+ * @brief  Copy a header followed by data into the next free slot, never blocks
+ * @param  queue       : queue
+ *         header      : header to copy first
+ *         header_size : length of header
+ *         data        : data to copy after the header
+ *         size        : length of data
+ * @retval Same as ble_tx_queue_push
+ */
+esp_err_t ble_tx_queue_push_frame(ble_tx_queue_t *queue, const uint8_t *header, size_t header_size,
+                                  const uint8_t *data, size_t size);
+
+/**
+ * @brief  Get number of free slots
+ * @param  queue : queue
+ * @retval Number of free slots
+ */
+uint16_t ble_tx_queue_space(ble_tx_queue_t *queue);
+
+/**
+ * @brief  Get the oldest slot without removing it
+ * @param  queue : queue
+ * @retval Oldest slot, NULL if queue is empty
+ */
+ble_tx_item_t *ble_tx_queue_peek(ble_tx_queue_t *queue);
+
+/**
+ * @brief  Get a queued slot without removing it
+ * @param  queue : queue
+ *         index : position from the oldest slot, 0 is the oldest
+ * @retval Slot, NULL if fewer slots are queued
+ */
+ble_tx_item_t *ble_tx_queue_peek_at(ble_tx_queue_t *queue, uint16_t index);
+
+/**
+ * @brief  Remove the oldest slot
+ * @param  queue : queue
+ * @retval None
+ */
+void ble_tx_queue_pop(ble_tx_queue_t *queue);
+
+/**
+ * @brief  Drop every queued slot
+ * @param  queue : queue
+ * @retval None
+ */
+void ble_tx_queue_flush(ble_tx_queue_t *queue);
+
+/**
+ * @brief  Drop every queued slot and clear the counters. Unlike
+ *         ble_tx_queue_init it keeps the lock, so a producer may be pushing
+ * @param  queue : queue
+ * @retval None
+ */
+void ble_tx_queue_reset(ble_tx_queue_t *queue);
+
+/**
+ * @brief  Get number of queued slots
+ * @param  queue : queue
+ * @retval Number of queued slots
+ */
+uint16_t ble_tx_queue_count(ble_tx_queue_t *queue);
+
+/******************************************************************************/
+
+#endif /* _BLE_TX_QUEUE_H_ */
\ No newline at end of file
@@ -0,0 +1,213 @@
+/*
+ *  ble_tx_sched.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_tx_queue.h"
+#include "ble_tx_sched.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define BLE_TX_SCHED_FIRST_WEIGHTED                   BLE_TX_CHANNEL_REALTIME
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const uint16_t ble_tx_sched_lengths[BLE_TX_CHANNELS] =
+{
+    BLE_TX_CONTROL_QUEUE_LENGTH,
+    BLE_TX_REALTIME_QUEUE_LENGTH,
+    BLE_TX_QUEUE_LENGTH,
+};
+
+/* Bytes added to the budget of a weighted channel each round. At least one
+ * full batch, so a channel given its turn always sends */
+static const int32_t ble_tx_sched_quanta[BLE_TX_CHANNELS] =
+{
+    0,
+    BLE_TX_REALTIME_WEIGHT * BLE_TX_BATCH_SIZE,
+    BLE_TX_BULK_WEIGHT * BLE_TX_BATCH_SIZE,
+};
+
+_Static_assert(BLE_TX_BATCH_SIZE >= BLE_TX_QUEUE_ITEM_SIZE, "A round must fit the largest slot");
+_Static_assert(BLE_TX_REALTIME_WEIGHT > 0 && BLE_TX_BULK_WEIGHT > 0, "Weights must be positive");
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void ble_tx_sched_advance(ble_tx_sched_t *sched);
+
+/******************************************************************************/
+
+/**
+ * @brief  Give the turn to the next weighted channel and top up its budget
+ */
+static void ble_tx_sched_advance(ble_tx_sched_t *sched)
+{
+    sched->current++;
+    if(sched->current >= BLE_TX_CHANNELS)
+    {
+        sched->current = BLE_TX_SCHED_FIRST_WEIGHTED;
+    }
+
+    /* A channel that skipped its turn already has a quantum left */
+    if(sched->deficit[sched->current] < ble_tx_sched_quanta[sched->current])
+    {
+        sched->deficit[sched->current] += ble_tx_sched_quanta[sched->current];
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Initialize the channel queues over caller provided slot storage
+ */
+void ble_tx_sched_init(ble_tx_sched_t *sched, ble_tx_item_t *items)
+{
+    uint8_t channel;
+
+    memset(sched, 0, sizeof(ble_tx_sched_t));
+    for(channel = 0; channel < BLE_TX_CHANNELS; channel++)
+    {
+        ble_tx_queue_init(&sched->queues[channel], items, ble_tx_sched_lengths[channel]);
+        items += ble_tx_sched_lengths[channel];
+    }
+    ble_tx_sched_flush(sched);
+}
+
+/**
+ * @brief  Get the queue of one channel
+ */
+ble_tx_queue_t *ble_tx_sched_queue(ble_tx_sched_t *sched, ble_tx_channel_t channel)
+{
+    return &sched->queues[channel];
+}
+
+/**
+ * @brief  Pick the channel to send from next
+ */
+ble_tx_queue_t *ble_tx_sched_next(ble_tx_sched_t *sched, ble_tx_channel_t *channel)
+{
+    ble_tx_item_t *item;
+    uint8_t i;
+
+    if(ble_tx_queue_peek(&sched->queues[BLE_TX_CHANNEL_CONTROL]) != NULL)
+    {
+        *channel = BLE_TX_CHANNEL_CONTROL;
+        return &sched->queues[BLE_TX_CHANNEL_CONTROL];
+    }
+
+    /* A fresh quantum always covers the oldest slot, so one visit of every
+     * weighted channel is enough */
+    for(i = 0; i <= BLE_TX_CHANNELS - BLE_TX_SCHED_FIRST_WEIGHTED; i++)
+    {
+        item = ble_tx_queue_peek(&sched->queues[sched->current]);
+        if(item == NULL)
+        {
+            /* An idle channel does not bank budget */
+            sched->deficit[sched->current] = 0;
+        }
+        else if(item->length <= sched->deficit[sched->current])
+        {
+            *channel = sched->current;
+            return &sched->queues[sched->current];
+        }
+        ble_tx_sched_advance(sched);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Get how many bytes a channel may send before its turn ends
+ */
+uint32_t ble_tx_sched_budget(ble_tx_sched_t *sched, ble_tx_channel_t channel)
+{
+    if(channel == BLE_TX_CHANNEL_CONTROL)
+    {
+        return BLE_TX_SCHED_UNLIMITED;
+    }
+    return sched->deficit[channel] > 0 ? sched->deficit[channel] : 0;
+}
+
+/**
+ * @brief  Charge a channel for packets handed to the stack
+ */
+void ble_tx_sched_charge(ble_tx_sched_t *sched, ble_tx_channel_t channel, uint16_t packets, uint32_t bytes)
+{
+    sched->sent[channel] += packets;
+    if(channel != BLE_TX_CHANNEL_CONTROL)
+    {
+        sched->deficit[channel] -= bytes;
+    }
+}
+
+/**
+ * @brief  End the turn of the weighted channel being served
+ */
+void ble_tx_sched_skip(ble_tx_sched_t *sched)
+{
+    ble_tx_sched_advance(sched);
+}
+
+/**
+ * @brief  Drop every queued slot of every channel and restart the rounds
+ */
+void ble_tx_sched_flush(ble_tx_sched_t *sched)
+{
+    uint8_t channel;
+
+    for(channel = 0; channel < BLE_TX_CHANNELS; channel++)
+    {
+        ble_tx_queue_flush(&sched->queues[channel]);
+        sched->deficit[channel] = 0;
+    }
+    sched->current = BLE_TX_SCHED_FIRST_WEIGHTED;
+    sched->deficit[sched->current] = ble_tx_sched_quanta[sched->current];
+}
+
+/**
+ * @brief  Empty every channel and clear the counters for a new connection
+ */
+void ble_tx_sched_reset(ble_tx_sched_t *sched)
+{
+    uint8_t channel;
+
+    for(channel = 0; channel < BLE_TX_CHANNELS; channel++)
+    {
+        ble_tx_queue_reset(&sched->queues[channel]);
+        sched->sent[channel] = 0;
+    }
+    ble_tx_sched_flush(sched);
+}
+
+/**
+ * @brief  Get the queue counters of one channel
+ */
+void ble_tx_sched_get_stats(ble_tx_sched_t *sched, ble_tx_channel_t channel, ble_tx_channel_stats_t *stats)
+{
+    ble_tx_queue_t *queue = &sched->queues[channel];
+
+    stats->queued = ble_tx_queue_count(queue);
+    stats->peak = queue->peak;
+    stats->dropped = queue->dropped;
+    stats->sent = sched->sent[channel];
+}
\ No newline at end of file
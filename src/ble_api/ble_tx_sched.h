@@ -0,0 +1,158 @@
+/*
+ *  ble_tx_sched.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _BLE_TX_SCHED_H_
+#define _BLE_TX_SCHED_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "config.h"
+#include "ble_tx_queue.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Logical channels multiplexed on the TX characteristic. Control has strict
+ * priority and is never held back to fill a batch. Realtime and bulk share
+ * what is left by deficit round robin, BLE_TX_REALTIME_WEIGHT to
+ * BLE_TX_BULK_WEIGHT in bytes, so a saturated bulk channel cannot starve
+ * telemetry. Order is kept within a channel, not across channels.
+ */
+typedef enum
+{
+    BLE_TX_CHANNEL_CONTROL = 0,
+    BLE_TX_CHANNEL_REALTIME,
+    BLE_TX_CHANNEL_BULK,
+    BLE_TX_CHANNELS,
+} ble_tx_channel_t;
+
+#define BLE_TX_SCHED_ITEMS                            (BLE_TX_CONTROL_QUEUE_LENGTH + BLE_TX_REALTIME_QUEUE_LENGTH + \
+                                                       BLE_TX_QUEUE_LENGTH)
+#define BLE_TX_SCHED_UNLIMITED                        UINT32_MAX
+
+/**
+ * Queues may be pushed from any task, everything else belongs to the
+ * NimBLE host task.
+ */
+typedef struct
+{
+    ble_tx_queue_t queues[BLE_TX_CHANNELS];
+    int32_t deficit[BLE_TX_CHANNELS];   /* Bytes a weighted channel may still send this round */
+    uint32_t sent[BLE_TX_CHANNELS];     /* Packets handed to the stack */
+    uint8_t current;                    /* Weighted channel being served */
+} ble_tx_sched_t;
+
+typedef struct
+{
+    uint16_t queued;
+    uint16_t peak;
+    uint32_t dropped;                   /* Pushed while full */
+    uint32_t sent;
+} ble_tx_channel_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Initialize the channel queues over caller provided slot storage
+ * @param  sched : scheduler to initialize
+ *         items : slot storage, BLE_TX_SCHED_ITEMS slots
+ * @retval None
+ */
+void ble_tx_sched_init(ble_tx_sched_t *sched, ble_tx_item_t *items);
+
+/**
+ * @brief  Get the queue of one channel, to push into it
+ * @param  sched   : scheduler
+ *         channel : channel
+ * @retval Queue of the channel
+ */
+ble_tx_queue_t *ble_tx_sched_queue(ble_tx_sched_t *sched, ble_tx_channel_t channel);
+
+/**
+ * @brief  Pick the channel to send from next, host task only
+ * @param  sched   : scheduler
+ *         channel : filled with the channel picked
+ * @retval Queue of the channel, its oldest slot fits the channel budget.
+ *         NULL if every channel is empty
+ */
+ble_tx_queue_t *ble_tx_sched_next(ble_tx_sched_t *sched, ble_tx_channel_t *channel);
+
+/**
+ * @brief  Get how many bytes a channel may send before its turn ends, host
+ *         task only
+ * @param  sched   : scheduler
+ *         channel : channel returned by ble_tx_sched_next
+ * @retval Bytes, BLE_TX_SCHED_UNLIMITED for the control channel
+ */
+uint32_t ble_tx_sched_budget(ble_tx_sched_t *sched, ble_tx_channel_t channel);
+
+/**
+ * @brief  Charge a channel for packets handed to the stack, host task only
+ * @param  sched   : scheduler
+ *         channel : channel the packets were popped from
+ *         packets : number of queue slots sent
+ *         bytes   : payload length sent
+ * @retval None
+ */
+void ble_tx_sched_charge(ble_tx_sched_t *sched, ble_tx_channel_t channel, uint16_t packets, uint32_t bytes);
+
+/**
+ * @brief  End the turn of the weighted channel being served, when it holds
+ *         its packets back. Its budget is kept for the next round. Host task
+ *         only
+ * @param  sched : scheduler
+ * @retval None
+ */
+void ble_tx_sched_skip(ble_tx_sched_t *sched);
+
+/**
+ * @brief  Drop every queued slot of every channel and restart the rounds,
+ *         host task only
+ * @param  sched : scheduler
+ * @retval None
+ */
+void ble_tx_sched_flush(ble_tx_sched_t *sched);
+
+/**
+ * @brief  Empty every channel and clear the counters for a new connection,
+ *         the queue locks are kept since producers may still hold them
+ * @param  sched : scheduler
+ * @retval None
+ */
+void ble_tx_sched_reset(ble_tx_sched_t *sched);
+
+/**
+ * @brief  Get the queue counters of one channel
+ * @param  sched   : scheduler
+ *         channel : channel
+ *         stats   : filled with the counters
+ * @retval None
+ */
+void ble_tx_sched_get_stats(ble_tx_sched_t *sched, ble_tx_channel_t channel, ble_tx_channel_stats_t *stats);
+
+/******************************************************************************/
+
+#endif /* _BLE_TX_SCHED_H_ */
\ No newline at end of file
@@ -0,0 +1,773 @@
+/*
+ *  gatt_client.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <nvs.h>
+#include <nimble/nimble_port.h>
+#include <host/ble_uuid.h>
+#include <host/ble_gatt.h>
+#include <host/ble_hs.h>
+
+#include "config.h"
+#include "ble_spsc_queue.h"
+#include "ble_stats.h"
+#include "gatt_client.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define GATT_CLIENT_NVS_NAMESPACE                     "gatt_client"
+#define GATT_CLIENT_NVS_KEY_SIZE                      16      /* 12 hex digits, type and terminator */
+
+typedef enum
+{
+    GATT_CLIENT_PEER_FREE = 0,
+    GATT_CLIENT_PEER_IDLE,              /* Waiting for a connection attempt */
+    GATT_CLIENT_PEER_CONNECTING,
+    GATT_CLIENT_PEER_DISCOVERING,
+    GATT_CLIENT_PEER_SUBSCRIBING,
+    GATT_CLIENT_PEER_READY,
+    GATT_CLIENT_PEER_REMOVING,          /* Freed once disconnected */
+} gatt_client_peer_state_t;
+
+/* Saved per peer address, valid for one target characteristic */
+typedef struct
+{
+    uint16_t start;                     /* Service range */
+    uint16_t end;
+    uint16_t value;
+    uint16_t cccd;
+    ble_uuid_any_t characteristic;
+} gatt_client_cache_t;
+
+typedef struct
+{
+    ble_addr_t addr;
+    uint16_t conn_handle;
+    uint8_t state;
+    uint8_t cached;                     /* Handles came from NVS */
+    uint32_t connected_at;
+    gatt_client_cache_t cache;
+} gatt_client_peer_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char* TAG = "GATT_CLIENT";
+
+static const ble_uuid_t *gatt_client_service;
+static const ble_uuid_t *gatt_client_characteristic;
+static nvs_handle_t gatt_client_nvs;
+
+/* State changes happen in the host task, add and remove only claim and
+ * flag slots under the lock and kick the host task. The host task changes
+ * a state under the lock too, never away from REMOVING */
+static gatt_client_peer_t gatt_client_peers[GATT_CLIENT_PEERS_MAX];
+static gatt_client_peer_t *gatt_client_connecting = NULL;
+static uint8_t gatt_client_next_peer;
+static portMUX_TYPE gatt_client_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct ble_npl_event gatt_client_kick_event;
+static struct ble_npl_callout gatt_client_retry_timer;
+static gatt_client_stats_t gatt_client_stats;
+
+/* Merged output, the host task produces and the application consumes */
+static gatt_client_item_t gatt_client_items[GATT_CLIENT_QUEUE_LENGTH];
+static ble_spsc_queue_t gatt_client_queue;
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void gatt_client_key(const ble_addr_t *addr, char *key);
+static esp_err_t gatt_client_cache_load(gatt_client_peer_t *peer);
+static void gatt_client_cache_save(gatt_client_peer_t *peer);
+static void gatt_client_cache_erase(gatt_client_peer_t *peer);
+static void gatt_client_push(gatt_client_peer_t *peer, gatt_client_item_type_t type, const struct os_mbuf *om);
+static bool gatt_client_set_state(gatt_client_peer_t *peer, gatt_client_peer_state_t state);
+static void gatt_client_release(gatt_client_peer_t *peer);
+static void gatt_client_connect_next(void);
+static void gatt_client_kick(struct ble_npl_event *ev);
+static void gatt_client_fail(gatt_client_peer_t *peer, const char *step, int32_t status);
+static void gatt_client_start(gatt_client_peer_t *peer);
+static void gatt_client_subscribe(gatt_client_peer_t *peer);
+static int32_t gatt_client_on_mtu(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t mtu, void *arg);
+static int32_t gatt_client_on_svc(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                  const struct ble_gatt_svc *service, void *arg);
+static int32_t gatt_client_on_chr(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                  const struct ble_gatt_chr *chr, void *arg);
+static int32_t gatt_client_on_dsc(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t chr_val_handle,
+                                  const struct ble_gatt_dsc *dsc, void *arg);
+static int32_t gatt_client_on_subscribed(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                         struct ble_gatt_attr *attr, void *arg);
+static int32_t gatt_client_on_read(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                   struct ble_gatt_attr *attr, void *arg);
+static int32_t gatt_client_gap_event(struct ble_gap_event *event, void *arg);
+
+/******************************************************************************/
+
+/**
+ * @brief  NVS key of a peer, keys are limited to 15 characters
+ */
+static void gatt_client_key(const ble_addr_t *addr, char *key)
+{
+    snprintf(key, GATT_CLIENT_NVS_KEY_SIZE, "%02x%02x%02x%02x%02x%02x%u", addr->val[5], addr->val[4],
+             addr->val[3], addr->val[2], addr->val[1], addr->val[0], addr->type & 0x0F);
+}
+
+/**
+ * @brief  Load the handles saved for a peer, if they are for the current target
+ */
+static esp_err_t gatt_client_cache_load(gatt_client_peer_t *peer)
+{
+    char key[GATT_CLIENT_NVS_KEY_SIZE];
+    size_t size = sizeof(gatt_client_cache_t);
+
+    gatt_client_key(&peer->addr, key);
+    if(nvs_get_blob(gatt_client_nvs, key, &peer->cache, &size) != ESP_OK || size != sizeof(gatt_client_cache_t) ||
+       ble_uuid_cmp(&peer->cache.characteristic.u, gatt_client_characteristic) != 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Save the handles of a discovered peer
+ */
+static void gatt_client_cache_save(gatt_client_peer_t *peer)
+{
+    char key[GATT_CLIENT_NVS_KEY_SIZE];
+    esp_err_t rc;
+
+    ble_uuid_copy(&peer->cache.characteristic, gatt_client_characteristic);
+    gatt_client_key(&peer->addr, key);
+    rc = nvs_set_blob(gatt_client_nvs, key, &peer->cache, sizeof(gatt_client_cache_t));
+    if(rc == ESP_OK)
+    {
+        rc = nvs_commit(gatt_client_nvs);
+    }
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error saving handles; rc = %d", rc);
+    }
+}
+
+/**
+ * @brief  Forget the handles of a peer, they no longer match its database
+ */
+static void gatt_client_cache_erase(gatt_client_peer_t *peer)
+{
+    char key[GATT_CLIENT_NVS_KEY_SIZE];
+
+    gatt_client_key(&peer->addr, key);
+    if(nvs_erase_key(gatt_client_nvs, key) == ESP_OK)
+    {
+        nvs_commit(gatt_client_nvs);
+    }
+}
+
+/**
+ * @brief  Queue a received value, host task only
+ */
+static void gatt_client_push(gatt_client_peer_t *peer, gatt_client_item_type_t type, const struct os_mbuf *om)
+{
+    gatt_client_item_t *item = ble_spsc_queue_reserve(&gatt_client_queue);
+
+    if(item == NULL)
+    {
+        gatt_client_stats.dropped++;
+        return;
+    }
+
+    item->timestamp = ble_stats_now();
+    item->addr = peer->addr;
+    item->type = type;
+    item->length = OS_MBUF_PKTLEN(om);
+    os_mbuf_copydata(om, 0, item->length < GATT_CLIENT_ITEM_SIZE ? item->length : GATT_CLIENT_ITEM_SIZE,
+                     item->data);
+    ble_spsc_queue_commit(&gatt_client_queue);
+}
+
+/**
+ * @brief  Move a peer on to its next step, unless it is being removed. A
+ *         completion of a removed peer stops there, its connection is
+ *         already being terminated
+ * @retval false if the peer is being removed
+ */
+static bool gatt_client_set_state(gatt_client_peer_t *peer, gatt_client_peer_state_t state)
+{
+    bool removing;
+
+    portENTER_CRITICAL(&gatt_client_lock);
+    removing = (peer->state == GATT_CLIENT_PEER_REMOVING);
+    if(!removing)
+    {
+        peer->state = state;
+    }
+    portEXIT_CRITICAL(&gatt_client_lock);
+    return !removing;
+}
+
+/**
+ * @brief  Connection gone or never made: a removed peer is freed, the
+ *         others wait for the next attempt
+ */
+static void gatt_client_release(gatt_client_peer_t *peer)
+{
+    portENTER_CRITICAL(&gatt_client_lock);
+    peer->state = peer->state == GATT_CLIENT_PEER_REMOVING ? GATT_CLIENT_PEER_FREE : GATT_CLIENT_PEER_IDLE;
+    portEXIT_CRITICAL(&gatt_client_lock);
+}
+
+/**
+ * @brief  Start connecting the next idle peer, round robin. The controller
+ *         runs one connection attempt at a time
+ */
+static void gatt_client_connect_next(void)
+{
+    gatt_client_peer_t *peer;
+    uint8_t own_addr_type;
+    uint8_t i;
+    esp_err_t rc;
+
+    if(gatt_client_connecting != NULL)
+    {
+        return;
+    }
+
+    for(i = 0; i < GATT_CLIENT_PEERS_MAX; i++)
+    {
+        peer = &gatt_client_peers[(gatt_client_next_peer + i) % GATT_CLIENT_PEERS_MAX];
+        if(peer->state != GATT_CLIENT_PEER_IDLE)
+        {
+            continue;
+        }
+
+        rc = ble_hs_id_infer_auto(0, &own_addr_type);
+        if(rc == ESP_OK)
+        {
+            rc = ble_gap_connect(own_addr_type, &peer->addr, GATT_CLIENT_CONNECT_TIMEOUT_MS, NULL,
+                                 gatt_client_gap_event, peer);
+        }
+        if(rc != ESP_OK)
+        {
+            /* Host not synced or busy, try again later */
+            ESP_LOGE(TAG, "Error connecting; rc = %d", rc);
+            ble_npl_callout_reset(&gatt_client_retry_timer, ble_npl_time_ms_to_ticks32(GATT_CLIENT_RETRY_MS));
+            return;
+        }
+
+        /* Removed meanwhile, the kick queued by the removal cancels it */
+        gatt_client_set_state(peer, GATT_CLIENT_PEER_CONNECTING);
+        gatt_client_connecting = peer;
+        gatt_client_next_peer = (peer - gatt_client_peers + 1) % GATT_CLIENT_PEERS_MAX;
+        return;
+    }
+}
+
+/**
+ * @brief  Act on peers added or removed from other tasks
+ */
+static void gatt_client_kick(struct ble_npl_event *ev)
+{
+    gatt_client_peer_t *peer;
+    uint8_t i;
+
+    for(i = 0; i < GATT_CLIENT_PEERS_MAX; i++)
+    {
+        peer = &gatt_client_peers[i];
+        if(peer->state != GATT_CLIENT_PEER_REMOVING)
+        {
+            continue;
+        }
+
+        if(peer->conn_handle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            ble_gap_terminate(peer->conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+        }
+        else if(peer == gatt_client_connecting)
+        {
+            ble_gap_conn_cancel();
+        }
+        else
+        {
+            portENTER_CRITICAL(&gatt_client_lock);
+            peer->state = GATT_CLIENT_PEER_FREE;
+            portEXIT_CRITICAL(&gatt_client_lock);
+        }
+    }
+
+    gatt_client_connect_next();
+}
+
+/**
+ * @brief  Give up on a connection after a failed step, it is retried from
+ *         the start once reconnected
+ */
+static void gatt_client_fail(gatt_client_peer_t *peer, const char *step, int32_t status)
+{
+    ESP_LOGE(TAG, "Error in %s; status = %d", step, status);
+    gatt_client_stats.errors++;
+    ble_gap_terminate(peer->conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+}
+
+/**
+ * @brief  Subscribe from saved handles, or discover them
+ */
+static void gatt_client_start(gatt_client_peer_t *peer)
+{
+    esp_err_t rc;
+
+    peer->cached = (gatt_client_cache_load(peer) == ESP_OK);
+    if(peer->cached)
+    {
+        gatt_client_subscribe(peer);
+        return;
+    }
+
+    memset(&peer->cache, 0, sizeof(gatt_client_cache_t));
+    if(!gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+    {
+        return;
+    }
+    rc = ble_gattc_disc_svc_by_uuid(peer->conn_handle, gatt_client_service, gatt_client_on_svc, peer);
+    if(rc != 0)
+    {
+        gatt_client_fail(peer, "service discovery", rc);
+    }
+}
+
+/**
+ * @brief  Enable notifications of the target characteristic
+ */
+static void gatt_client_subscribe(gatt_client_peer_t *peer)
+{
+    static const uint8_t enable[2] = {0x01, 0x00};
+    esp_err_t rc;
+
+    if(!gatt_client_set_state(peer, GATT_CLIENT_PEER_SUBSCRIBING))
+    {
+        return;
+    }
+    rc = ble_gattc_write_flat(peer->conn_handle, peer->cache.cccd, enable, sizeof(enable),
+                              gatt_client_on_subscribed, peer);
+    if(rc != 0)
+    {
+        gatt_client_fail(peer, "subscribe", rc);
+    }
+}
+
+/**
+ * @brief  MTU exchanged, values fit one notification from now on
+ */
+static int32_t gatt_client_on_mtu(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t mtu, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+
+    /* A peer refusing the exchange stays at the default MTU */
+    if(peer->conn_handle == conn_handle)
+    {
+        gatt_client_start(peer);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Service discovery, keeps the first instance
+ */
+static int32_t gatt_client_on_svc(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                  const struct ble_gatt_svc *service, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+    esp_err_t rc;
+
+    if(peer->conn_handle != conn_handle || !gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+    {
+        return 0;
+    }
+
+    if(error->status == 0)
+    {
+        if(peer->cache.start == 0)
+        {
+            peer->cache.start = service->start_handle;
+            peer->cache.end = service->end_handle;
+        }
+        return 0;
+    }
+    if(error->status != BLE_HS_EDONE || peer->cache.start == 0)
+    {
+        gatt_client_fail(peer, "service discovery", error->status);
+        return 0;
+    }
+
+    rc = ble_gattc_disc_chrs_by_uuid(conn_handle, peer->cache.start, peer->cache.end, gatt_client_characteristic,
+                                     gatt_client_on_chr, peer);
+    if(rc != 0)
+    {
+        gatt_client_fail(peer, "characteristic discovery", rc);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Characteristic discovery, keeps the first instance
+ */
+static int32_t gatt_client_on_chr(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                  const struct ble_gatt_chr *chr, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+    esp_err_t rc;
+
+    if(peer->conn_handle != conn_handle || !gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+    {
+        return 0;
+    }
+
+    if(error->status == 0)
+    {
+        if(peer->cache.value == 0)
+        {
+            peer->cache.value = chr->val_handle;
+        }
+        return 0;
+    }
+    if(error->status != BLE_HS_EDONE || peer->cache.value == 0)
+    {
+        gatt_client_fail(peer, "characteristic discovery", error->status);
+        return 0;
+    }
+
+    rc = ble_gattc_disc_all_dscs(conn_handle, peer->cache.value, peer->cache.end, gatt_client_on_dsc, peer);
+    if(rc != 0)
+    {
+        gatt_client_fail(peer, "descriptor discovery", rc);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Descriptor discovery, looks for the client configuration
+ */
+static int32_t gatt_client_on_dsc(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t chr_val_handle,
+                                  const struct ble_gatt_dsc *dsc, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+
+    if(peer->conn_handle != conn_handle || !gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+    {
+        return 0;
+    }
+
+    if(error->status == 0)
+    {
+        if(peer->cache.cccd == 0 && ble_uuid_cmp(&dsc->uuid.u, BLE_UUID16_DECLARE(BLE_GATT_DSC_CLT_CFG_UUID16)) == 0)
+        {
+            peer->cache.cccd = dsc->handle;
+        }
+        return 0;
+    }
+    if(error->status != BLE_HS_EDONE || peer->cache.cccd == 0)
+    {
+        gatt_client_fail(peer, "descriptor discovery", error->status);
+        return 0;
+    }
+
+    gatt_client_cache_save(peer);
+    gatt_client_subscribe(peer);
+    return 0;
+}
+
+/**
+ * @brief  Subscription written, the peer is ready
+ */
+static int32_t gatt_client_on_subscribed(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                         struct ble_gatt_attr *attr, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+
+    if(peer->conn_handle != conn_handle || !gatt_client_set_state(peer, GATT_CLIENT_PEER_SUBSCRIBING))
+    {
+        return 0;
+    }
+
+    if(error->status != 0)
+    {
+        if(peer->cached)
+        {
+            /* The peer database changed since the handles were saved */
+            ESP_LOGW(TAG, "Saved handles rejected, discovering");
+            gatt_client_cache_erase(peer);
+            peer->cached = 0;
+            memset(&peer->cache, 0, sizeof(gatt_client_cache_t));
+            if(!gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+            {
+                return 0;
+            }
+            if(ble_gattc_disc_svc_by_uuid(conn_handle, gatt_client_service, gatt_client_on_svc, peer) != 0)
+            {
+                gatt_client_fail(peer, "service discovery", error->status);
+            }
+            return 0;
+        }
+        gatt_client_fail(peer, "subscribe", error->status);
+        return 0;
+    }
+
+    if(!gatt_client_set_state(peer, GATT_CLIENT_PEER_READY))
+    {
+        return 0;
+    }
+    if(peer->cached)
+    {
+        gatt_client_stats.cache_hits++;
+    }
+    else
+    {
+        gatt_client_stats.discoveries++;
+    }
+    gatt_client_stats.last_ready_us = ble_stats_now() - peer->connected_at;
+    return 0;
+}
+
+/**
+ * @brief  Poll result of one peer
+ */
+static int32_t gatt_client_on_read(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                   struct ble_gatt_attr *attr, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+
+    if(peer->conn_handle != conn_handle)
+    {
+        return 0;
+    }
+
+    if(error->status != 0)
+    {
+        gatt_client_stats.errors++;
+        return 0;
+    }
+    gatt_client_stats.reads++;
+    gatt_client_push(peer, GATT_CLIENT_ITEM_READ, attr->om);
+    return 0;
+}
+
+/**
+ * @brief  GAP events of the connections made by the client, arg is the peer
+ */
+static int32_t gatt_client_gap_event(struct ble_gap_event *event, void *arg)
+{
+    gatt_client_peer_t *peer = arg;
+    esp_err_t rc;
+
+    switch(event->type)
+    {
+    case BLE_GAP_EVENT_CONNECT:
+        gatt_client_connecting = NULL;
+        if(event->connect.status != 0)
+        {
+            gatt_client_release(peer);
+            ble_npl_callout_reset(&gatt_client_retry_timer, ble_npl_time_ms_to_ticks32(GATT_CLIENT_RETRY_MS));
+            break;
+        }
+
+        peer->conn_handle = event->connect.conn_handle;
+        peer->connected_at = ble_stats_now();
+        gatt_client_stats.connects++;
+        if(!gatt_client_set_state(peer, GATT_CLIENT_PEER_DISCOVERING))
+        {
+            ble_gap_terminate(peer->conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+        }
+        else
+        {
+            rc = ble_gattc_exchange_mtu(peer->conn_handle, gatt_client_on_mtu, peer);
+            if(rc != 0)
+            {
+                gatt_client_start(peer);
+            }
+        }
+
+        /* The next peer connects while this one discovers */
+        gatt_client_connect_next();
+        break;
+
+    case BLE_GAP_EVENT_DISCONNECT:
+        ESP_LOGI(TAG, "Peer disconnected, reason %d", event->disconnect.reason);
+        peer->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        gatt_client_release(peer);
+        gatt_client_connect_next();
+        break;
+
+    case BLE_GAP_EVENT_NOTIFY_RX:
+        if(event->notify_rx.attr_handle == peer->cache.value)
+        {
+            gatt_client_stats.notifications++;
+            gatt_client_push(peer, GATT_CLIENT_ITEM_NOTIFY, event->notify_rx.om);
+        }
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Add a peripheral to the fleet
+ */
+esp_err_t gatt_client_add(const ble_addr_t *addr)
+{
+    gatt_client_peer_t *slot = NULL;
+    uint8_t i;
+
+    portENTER_CRITICAL(&gatt_client_lock);
+    for(i = 0; i < GATT_CLIENT_PEERS_MAX; i++)
+    {
+        if(gatt_client_peers[i].state == GATT_CLIENT_PEER_FREE)
+        {
+            if(slot == NULL)
+            {
+                slot = &gatt_client_peers[i];
+            }
+        }
+        else if(ble_addr_cmp(&gatt_client_peers[i].addr, addr) == 0)
+        {
+            portEXIT_CRITICAL(&gatt_client_lock);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    if(slot == NULL)
+    {
+        portEXIT_CRITICAL(&gatt_client_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    slot->addr = *addr;
+    slot->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    slot->state = GATT_CLIENT_PEER_IDLE;
+    portEXIT_CRITICAL(&gatt_client_lock);
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &gatt_client_kick_event);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Remove a peripheral from the fleet
+ */
+esp_err_t gatt_client_remove(const ble_addr_t *addr)
+{
+    uint8_t i;
+
+    portENTER_CRITICAL(&gatt_client_lock);
+    for(i = 0; i < GATT_CLIENT_PEERS_MAX; i++)
+    {
+        if(gatt_client_peers[i].state != GATT_CLIENT_PEER_FREE &&
+           ble_addr_cmp(&gatt_client_peers[i].addr, addr) == 0)
+        {
+            gatt_client_peers[i].state = GATT_CLIENT_PEER_REMOVING;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&gatt_client_lock);
+
+    if(i == GATT_CLIENT_PEERS_MAX)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &gatt_client_kick_event);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Read the target characteristic of every subscribed peer at once
+ */
+uint32_t gatt_client_poll(void)
+{
+    gatt_client_peer_t *peer;
+    uint32_t started = 0;
+    uint16_t conn_handle;
+    uint16_t value;
+    uint8_t i;
+
+    /* Every read is in flight before the first answer comes back */
+    for(i = 0; i < GATT_CLIENT_PEERS_MAX; i++)
+    {
+        peer = &gatt_client_peers[i];
+        portENTER_CRITICAL(&gatt_client_lock);
+        conn_handle = peer->state == GATT_CLIENT_PEER_READY ? peer->conn_handle : BLE_HS_CONN_HANDLE_NONE;
+        value = peer->cache.value;
+        portEXIT_CRITICAL(&gatt_client_lock);
+
+        if(conn_handle != BLE_HS_CONN_HANDLE_NONE &&
+           ble_gattc_read(conn_handle, value, gatt_client_on_read, peer) == 0)
+        {
+            started++;
+        }
+    }
+    return started;
+}
+
+/**
+ * @brief  Take the oldest queued value
+ */
+esp_err_t gatt_client_receive(gatt_client_item_t *item)
+{
+    gatt_client_item_t *front = ble_spsc_queue_front(&gatt_client_queue);
+
+    if(front == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *item = *front;
+    ble_spsc_queue_release(&gatt_client_queue);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get connection, discovery and queue counters
+ */
+void gatt_client_get_stats(gatt_client_stats_t *stats)
+{
+    *stats = gatt_client_stats;
+}
+
+/**
+ * @brief  GATT client initialization
+ */
+esp_err_t gatt_client_init(const ble_uuid_t *service, const ble_uuid_t *characteristic)
+{
+    esp_err_t rc;
+
+    rc = nvs_open(GATT_CLIENT_NVS_NAMESPACE, NVS_READWRITE, &gatt_client_nvs);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error opening NVS; rc = %d", rc);
+        return rc;
+    }
+
+    gatt_client_service = service;
+    gatt_client_characteristic = characteristic;
+    ble_spsc_queue_init(&gatt_client_queue, gatt_client_items, sizeof(gatt_client_item_t), GATT_CLIENT_QUEUE_LENGTH);
+    ble_npl_event_init(&gatt_client_kick_event, gatt_client_kick, NULL);
+    ble_npl_callout_init(&gatt_client_retry_timer, nimble_port_get_dflt_eventq(), gatt_client_kick, NULL);
+    return ESP_OK;
+}
\ No newline at end of file
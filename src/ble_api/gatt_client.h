@@ -0,0 +1,134 @@
+/*
+ *  gatt_client.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _GATT_CLIENT_H_
+#define _GATT_CLIENT_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <host/ble_gap.h>
+#include <host/ble_uuid.h>
+
+#include "config.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Central side aggregator. Every peer added is connected, its target
+ * characteristic found and subscribed, then its notifications and poll
+ * results land in one queue, in arrival order, stamped on reception.
+ *     o Peers advance independently: each GATT step is started from the
+ *       completion of the previous one on the same connection, so N peers
+ *       discover, subscribe and answer a poll in about one round trip each,
+ *       not N. Only connection setup is serialized, by the controller.
+ *     o Handles found by discovery are saved in NVS per peer address. A
+ *       reconnecting peer is subscribed straight away, discovery runs again
+ *       only if the saved handles are rejected.
+ *     o Dropped peers are reconnected until removed.
+ */
+typedef enum
+{
+    GATT_CLIENT_ITEM_NOTIFY = 0,
+    GATT_CLIENT_ITEM_READ,
+} gatt_client_item_type_t;
+
+typedef struct
+{
+    uint32_t timestamp;                 /* ble_stats_now() on reception */
+    ble_addr_t addr;                    /* Peer */
+    uint8_t type;                       /* gatt_client_item_type_t */
+    uint16_t length;                    /* Value length, data holds at most GATT_CLIENT_ITEM_SIZE */
+    uint8_t data[GATT_CLIENT_ITEM_SIZE];
+} gatt_client_item_t;
+
+typedef struct
+{
+    uint32_t connects;
+    uint32_t cache_hits;                /* Peers subscribed from saved handles */
+    uint32_t discoveries;               /* Peers discovered from scratch */
+    uint32_t notifications;
+    uint32_t reads;
+    uint32_t dropped;                   /* Queue full */
+    uint32_t errors;                    /* GATT procedures failed */
+    uint32_t last_ready_us;             /* Connection to subscribed, last peer */
+} gatt_client_stats_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Add a peripheral to the fleet, connected from the host task
+ * @param  addr : peer address
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if the peer is already added
+ *         ESP_ERR_NO_MEM if GATT_CLIENT_PEERS_MAX peers are added
+ */
+esp_err_t gatt_client_add(const ble_addr_t *addr);
+
+/**
+ * @brief  Remove a peripheral from the fleet, disconnects it
+ * @param  addr : peer address
+ * @retval ESP_OK on success
+ *         ESP_ERR_NOT_FOUND if the peer is not added
+ */
+esp_err_t gatt_client_remove(const ble_addr_t *addr);
+
+/**
+ * @brief  Read the target characteristic of every subscribed peer at once,
+ *         values are queued as GATT_CLIENT_ITEM_READ
+ * @param  None
+ * @retval Number of reads started
+ */
+uint32_t gatt_client_poll(void);
+
+/**
+ * @brief  Take the oldest queued value, single consumer task
+ * @param  item : filled with the value
+ * @retval ESP_OK on success
+ *         ESP_ERR_NOT_FOUND if the queue is empty
+ */
+esp_err_t gatt_client_receive(gatt_client_item_t *item);
+
+/**
+ * @brief  Get connection, discovery and queue counters
+ * @param  stats : filled with the counters
+ * @retval None
+ */
+void gatt_client_get_stats(gatt_client_stats_t *stats);
+
+/**
+ * @brief  GATT client initialization, after ble_api_init
+ * @param  service        : UUID of the service on the peers, kept by
+ *                          reference
+ *         characteristic : UUID of the characteristic subscribed and
+ *                          polled, kept by reference
+ * @retval ESP_OK on success
+ *         Otherwise the error of nvs_open
+ */
+esp_err_t gatt_client_init(const ble_uuid_t *service, const ble_uuid_t *characteristic);
+
+/******************************************************************************/
+
+#endif /* _GATT_CLIENT_H_ */
\ No newline at end of file
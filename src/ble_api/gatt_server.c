@@ -10,6 +10,7 @@
 /*                              INCLUDE FILES                                 */
 /******************************************************************************/
 
+#include <nimble/nimble_port.h>
 #include <host/ble_uuid.h>
 #include <host/ble_gatt.h>
 #include <host/ble_hs.h>
@@ -17,29 +18,61 @@
 #include <services/gatt/ble_svc_gatt.h>
 
 #include "config.h"
+#include "ble_spsc_queue.h"
+#include "ble_session.h"
+#include "ble_pool.h"
+#include "ble_trace.h"
 #include "gatt_server.h"
 
 /******************************************************************************/
 /*                     EXPORTED TYPES and DEFINITIONS                         */
 /******************************************************************************/
 
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t length;
+    uint32_t timestamp;                 /* ble_stats_now() when the write arrived */
+    uint8_t data[BLE_RX_QUEUE_ITEM_SIZE];
+} gatt_server_rx_item_t;
 
 
 /******************************************************************************/
 /*                              PRIVATE DATA                                  */
 /******************************************************************************/
 
-static const char* TAG = "GATT";
 static ble_rx_data_handler_t ble_rx_data_handler = NULL;
+static ble_rx_mbuf_handler_t ble_rx_mbuf_handler = NULL;
+static uint16_t rx_characteristic_handle;
 static uint16_t tx_characteristic_handle;
+static uint16_t rx_stream_characteristic_handle;
+static uint16_t rx_ack_characteristic_handle;
+static uint16_t caps_characteristic_handle;
+#if BLE_STATS_CHARACTERISTIC
+static uint16_t stats_characteristic_handle;
+#endif
+static struct ble_npl_callout gatt_server_ack_timer;
+
+/* Worker dispatch, the host task produces and the worker consumes */
+static gatt_server_rx_item_t gatt_server_rx_items[BLE_RX_QUEUE_LENGTH];
+static ble_spsc_queue_t gatt_server_rx_queue;
+static TaskHandle_t gatt_server_rx_worker;
+static ble_rx_packet_handler_t ble_rx_packet_handler = NULL;
+static volatile uint32_t gatt_server_rx_peak;
+static volatile uint32_t gatt_server_rx_delivered;
+static volatile uint32_t gatt_server_rx_dropped;
 
 /**
- * The vendor specific security test service consists of two characteristics:
- *     o random-number-generator: generates a random 32-bit number each time
- *       it is read.  This characteristic can only be read over an encrypted
- *       connection.
- *     o static-value: a single-byte characteristic that can always be read,
- *       but can only be written over an encrypted connection.
+ * The vendor specific UART service consists of two characteristics:
+ *     o rx: the client writes data to the device, delivered to the
+ *       registered rx handler. Writes need an authenticated link.
+ *     o tx: the device notifies data to subscribed clients.
+ * and the rx stream pair described in gatt_server.h:
+ *     o rx stream: sequenced writes without response.
+ *     o rx ack: windowed acknowledgments of the rx stream.
+ * the capabilities characteristic negotiating optional features, and, with
+ * BLE_STATS_CHARACTERISTIC, a read only diagnostics characteristic
+ * returning the ble_stats_t of the reading connection.
  */
 
 /* 59462f12-9543-9999-12c8-58b459a2712d */
@@ -57,27 +90,69 @@ static const ble_uuid128_t gatt_tx_characteristic_ulid =
     BLE_UUID128_INIT(0xf7, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
                      0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
 
-static esp_err_t gatt_server_char_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+/* 5c3a659e-897e-45e1-b016-007107c96df8 */
+static const ble_uuid128_t gatt_rx_stream_characteristic_ulid =
+    BLE_UUID128_INIT(0xf8, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+/* 5c3a659e-897e-45e1-b016-007107c96df9 */
+static const ble_uuid128_t gatt_rx_ack_characteristic_ulid =
+    BLE_UUID128_INIT(0xf9, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+/* 5c3a659e-897e-45e1-b016-007107c96dfb */
+static const ble_uuid128_t gatt_caps_characteristic_ulid =
+    BLE_UUID128_INIT(0xfb, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+#if BLE_STATS_CHARACTERISTIC
+/* 5c3a659e-897e-45e1-b016-007107c96dfa */
+static const ble_uuid128_t gatt_stats_characteristic_ulid =
+    BLE_UUID128_INIT(0xfa, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+#endif
+
+static esp_err_t gatt_server_rx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
                                                struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_tx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                               struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_rx_stream_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                      struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_caps_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                 struct ble_gatt_access_ctxt *ctxt, void *arg);
+#if BLE_STATS_CHARACTERISTIC
+static esp_err_t gatt_server_stats_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                  struct ble_gatt_access_ctxt *ctxt, void *arg);
+#endif
 
 static const struct ble_gatt_svc_def gatt_server_services[] = {
     {
-        /*** Service: Security test. */
+        /*** Service: UART */
         .type = BLE_GATT_SVC_TYPE_PRIMARY,
         .uuid = &gatt_uart_service_ulid.u,
         .characteristics = (struct ble_gatt_chr_def[])
-        { {
-                /* Rx Characteristic */
-                .uuid = &gatt_rx_characteristic_ulid.u,
-                .access_cb = gatt_server_char_access_handler,
-                .flags = RX_CHARACTERISTIC_FLAGS,
-            }, {
-                /* Tx Characteristic */
-                .uuid = &gatt_tx_characteristic_ulid.u,
-                .access_cb = gatt_server_char_access_handler,
-                .val_handle = &tx_characteristic_handle,
-                .flags = TX_CHARACTERISTIC_FLAGS,
-            }, {
+        {
+            /* Rx Characteristic */
+            GATT_SERVER_CHR(&gatt_rx_characteristic_ulid.u, RX_CHARACTERISTIC_FLAGS,
+                            gatt_server_rx_access_handler, NULL, &rx_characteristic_handle),
+            /* Tx Characteristic */
+            GATT_SERVER_CHR(&gatt_tx_characteristic_ulid.u, TX_CHARACTERISTIC_FLAGS,
+                            gatt_server_tx_access_handler, NULL, &tx_characteristic_handle),
+            /* Rx stream Characteristic */
+            GATT_SERVER_CHR(&gatt_rx_stream_characteristic_ulid.u, RX_STREAM_CHARACTERISTIC_FLAGS,
+                            gatt_server_rx_stream_access_handler, NULL, &rx_stream_characteristic_handle),
+            /* Rx ack Characteristic */
+            GATT_SERVER_CHR(&gatt_rx_ack_characteristic_ulid.u, RX_ACK_CHARACTERISTIC_FLAGS,
+                            gatt_server_tx_access_handler, NULL, &rx_ack_characteristic_handle),
+            /* Capabilities Characteristic */
+            GATT_SERVER_CHR(&gatt_caps_characteristic_ulid.u, CAPS_CHARACTERISTIC_FLAGS,
+                            gatt_server_caps_access_handler, NULL, &caps_characteristic_handle),
+#if BLE_STATS_CHARACTERISTIC
+            /* Diagnostics Characteristic */
+            GATT_SERVER_CHR(&gatt_stats_characteristic_ulid.u, STATS_CHARACTERISTIC_FLAGS,
+                            gatt_server_stats_access_handler, NULL, &stats_characteristic_handle),
+#endif
+            {
                 0, /* No more characteristics in this service. */
             }
         },
@@ -98,43 +173,365 @@ static const struct ble_gatt_svc_def gatt_server_services[] = {
 /*                                FUNCTIONS                                   */
 /******************************************************************************/
 
-static esp_err_t gatt_server_char_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+static esp_err_t gatt_server_rx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
                                                struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_tx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                               struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_rx_stream_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                      struct ble_gatt_access_ctxt *ctxt, void *arg);
+static esp_err_t gatt_server_caps_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                 struct ble_gatt_access_ctxt *ctxt, void *arg);
+#if BLE_STATS_CHARACTERISTIC
+static esp_err_t gatt_server_stats_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                  struct ble_gatt_access_ctxt *ctxt, void *arg);
+#endif
+static void gatt_server_rx_stream_ack(ble_session_t *session, uint8_t type);
+static void gatt_server_rx_stream_ack_timeout(struct ble_npl_event *ev);
+static esp_err_t gatt_server_rx_dispatch(uint16_t conn_handle, struct ble_gatt_access_ctxt *ctxt);
+static esp_err_t gatt_server_rx_enqueue(uint16_t conn_handle, struct os_mbuf *om, uint32_t timestamp);
+static void gatt_server_rx_worker_task(void *arg);
 
 /******************************************************************************/
 
 /**
- * @brief  Callback when characteristic is accessed
+ * @brief  Copy a write into the worker queue, never blocks the host task
+ */
+static esp_err_t gatt_server_rx_enqueue(uint16_t conn_handle, struct os_mbuf *om, uint32_t timestamp)
+{
+    gatt_server_rx_item_t *item;
+    uint16_t length = OS_MBUF_PKTLEN(om);
+    uint32_t depth;
+
+    item = ble_spsc_queue_reserve(&gatt_server_rx_queue);
+    if(item == NULL || length > BLE_RX_QUEUE_ITEM_SIZE)
+    {
+        BLE_TRACE(GATT, BLE_TRACE_WARN, BLE_TRACE_EV_RX_DROP, conn_handle, length);
+        gatt_server_rx_dropped++;
+        return item == NULL ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_SIZE;
+    }
+
+    item->conn_handle = conn_handle;
+    item->length = length;
+    item->timestamp = timestamp;
+    os_mbuf_copydata(om, 0, length, item->data);
+    ble_spsc_queue_commit(&gatt_server_rx_queue);
+
+    depth = ble_spsc_queue_count(&gatt_server_rx_queue);
+    if(depth > gatt_server_rx_peak)
+    {
+        gatt_server_rx_peak = depth;
+    }
+    xTaskNotifyGive(gatt_server_rx_worker);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Application worker, drains the rx queue off the host task
+ */
+static void gatt_server_rx_worker_task(void *arg)
+{
+    gatt_server_rx_item_t *item;
+    ble_session_t *session;
+    uint32_t start;
+
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while((item = ble_spsc_queue_front(&gatt_server_rx_queue)) != NULL)
+        {
+            /* The session may close meanwhile, its slot stays valid memory
+             * so at worst one sample lands in a recycled session */
+            session = ble_session_find(item->conn_handle);
+            if(session != NULL)
+            {
+                ble_stats_record(&session->stats, BLE_STATS_RX_TO_HANDLER, item->timestamp);
+            }
+            start = ble_stats_now();
+            ble_rx_packet_handler(item->conn_handle, item->data, item->length);
+            if(session != NULL)
+            {
+                ble_stats_record(&session->stats, BLE_STATS_HANDLER, start);
+            }
+            ble_spsc_queue_release(&gatt_server_rx_queue);
+            gatt_server_rx_delivered++;
+        }
+    }
+}
+
+/**
+ * @brief  Deliver a write to the registered rx handler
+ * @retval ESP_OK when delivered, or consumed because no handler is registered
+ *         ESP_ERR_NO_MEM when the worker queue or the pool is full
+ *         ESP_ERR_INVALID_SIZE when the write does not fit a worker queue item
+ *         ESP_ERR_INVALID_STATE when the connection has no session
+ */
+static esp_err_t gatt_server_rx_dispatch(uint16_t conn_handle, struct ble_gatt_access_ctxt *ctxt)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    struct os_mbuf *om = ctxt->om;
+    uint32_t start = ble_stats_now();
+    uint8_t *buffer;
+    uint16_t length;
+
+    if(session == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ble_stats_rx(&session->stats, OS_MBUF_PKTLEN(om));
+    BLE_TRACE(GATT, BLE_TRACE_DEBUG, BLE_TRACE_EV_RX, conn_handle, OS_MBUF_PKTLEN(om));
+
+    if(gatt_server_rx_worker != NULL)
+    {
+        return gatt_server_rx_enqueue(conn_handle, om, start);
+    }
+
+    if(ble_rx_mbuf_handler != NULL)
+    {
+        /* The stack frees whatever is left in ctxt->om once we return */
+        ble_rx_mbuf_handler(conn_handle, &ctxt->om);
+        ble_stats_record(&session->stats, BLE_STATS_HANDLER, start);
+        return ESP_OK;
+    }
+
+    if(ble_rx_data_handler == NULL)
+    {
+        return ESP_OK;
+    }
+
+    /* Single segment writes are passed in place, only chains are flattened */
+    if(SLIST_NEXT(om, om_next) == NULL)
+    {
+        ble_rx_data_handler(om->om_data, om->om_len);
+        ble_stats_record(&session->stats, BLE_STATS_HANDLER, start);
+        return ESP_OK;
+    }
+
+    length = OS_MBUF_PKTLEN(om);
+    buffer = ble_pool_alloc(length);
+    if(buffer == NULL)
+    {
+        gatt_server_rx_dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+    os_mbuf_copydata(om, 0, length, buffer);
+    ble_rx_data_handler(buffer, length);
+    ble_pool_free(buffer);
+    ble_stats_record(&session->stats, BLE_STATS_HANDLER, start);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Callback when rx characteristic is accessed. Writes are answered,
+ *         a dropped one gets an ATT error so the client can send it again
  */
-static esp_err_t gatt_server_char_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+static esp_err_t gatt_server_rx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
                                                struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
-    const ble_uuid_t *uuid;
-    esp_err_t rc = ESP_OK;
+    esp_err_t rc;
+
+    if(ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+    {
+        return ESP_OK;
+    }
+
+    rc = gatt_server_rx_dispatch(conn_handle, ctxt);
+    if(rc == ESP_ERR_INVALID_SIZE)
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    return rc == ESP_OK ? ESP_OK : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+/**
+ * @brief  Notify the rx stream acknowledgment state of a connection
+ */
+static void gatt_server_rx_stream_ack(ble_session_t *session, uint8_t type)
+{
+    uint8_t ack[RX_STREAM_ACK_SIZE];
+    struct os_mbuf *om;
+
+    ack[0] = type;
+    ack[1] = session->rx_expected_seq & 0xFF;
+    ack[2] = session->rx_expected_seq >> 8;
+    ack[3] = BLE_RX_STREAM_WINDOW & 0xFF;
+    ack[4] = BLE_RX_STREAM_WINDOW >> 8;
+
+    om = ble_hs_mbuf_from_flat(ack, sizeof(ack));
+    if(om == NULL || ble_gattc_notify_custom(session->conn_handle, rx_ack_characteristic_handle, om) != ESP_OK)
+    {
+        /* Keep the writes unacked, the timer retries */
+        ble_npl_callout_reset(&gatt_server_ack_timer, ble_npl_time_ms_to_ticks32(BLE_RX_STREAM_ACK_DELAY_MS));
+        return;
+    }
+    session->rx_unacked = 0;
+}
+
+/**
+ * @brief  Acknowledge streams that went quiet before BLE_RX_STREAM_ACK_EVERY writes
+ */
+static void gatt_server_rx_stream_ack_timeout(struct ble_npl_event *ev)
+{
+    ble_session_t *session;
+    uint8_t i;
+
+    for(i = 0; i < BLE_SESSION_MAX; i++)
+    {
+        session = ble_session_at(i);
+        if(session != NULL && session->rx_unacked > 0)
+        {
+            gatt_server_rx_stream_ack(session, RX_STREAM_ACK);
+        }
+    }
+}
+
+/**
+ * @brief  Callback when rx stream characteristic is accessed
+ */
+static esp_err_t gatt_server_rx_stream_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                      struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    ble_session_t *session;
+    uint8_t header[RX_STREAM_HEADER_SIZE];
+    uint16_t seq;
+
+    if(ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+    {
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+
+    session = ble_session_find(conn_handle);
+    if(session == NULL || os_mbuf_copydata(ctxt->om, 0, sizeof(header), header) != 0)
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
 
-    /* Determine which characteristic is being accessed by examining its 128-bit UUID */
-    uuid = ctxt->chr->uuid;
-    if(ble_uuid_cmp(uuid, &gatt_rx_characteristic_ulid.u) == 0)
+    seq = header[0] | (header[1] << 8);
+    if(seq != session->rx_expected_seq)
     {
-        if(ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR)
+        /* Lost or repeated write: NACK a gap once, re-ack duplicates so a
+         * client that missed our ack can move its window */
+        if((int16_t)(seq - session->rx_expected_seq) > 0)
         {
-            if(ble_rx_data_handler != NULL)
+            if(!session->rx_nack_sent)
             {
-                uint8_t buffer[BLE_ATT_ATTR_MAX_LEN];
-                uint16_t length;
-                ble_hs_mbuf_to_flat(ctxt->om, buffer, BLE_ATT_ATTR_MAX_LEN, &length);
-                ble_rx_data_handler(buffer, length);
+                BLE_TRACE(GATT, BLE_TRACE_INFO, BLE_TRACE_EV_RX_NACK, conn_handle, session->rx_expected_seq);
+                session->rx_nack_sent = 1;
+                gatt_server_rx_stream_ack(session, RX_STREAM_NACK);
             }
         }
+        else
+        {
+            gatt_server_rx_stream_ack(session, RX_STREAM_ACK);
+        }
+        return ESP_OK;
     }
 
-    /* Tx characteristic */
-    if(ble_uuid_cmp(uuid, &gatt_tx_characteristic_ulid.u) == 0)
+    /* Only a delivered write moves the window. A dropped one is asked
+     * for again, the client resends from it */
+    os_mbuf_adj(ctxt->om, RX_STREAM_HEADER_SIZE);
+    if(gatt_server_rx_dispatch(conn_handle, ctxt) != ESP_OK)
     {
-        ESP_LOGI(TAG, "Tx event %d", ctxt->op);
+        if(!session->rx_nack_sent)
+        {
+            BLE_TRACE(GATT, BLE_TRACE_INFO, BLE_TRACE_EV_RX_NACK, conn_handle, session->rx_expected_seq);
+            session->rx_nack_sent = 1;
+            gatt_server_rx_stream_ack(session, RX_STREAM_NACK);
+        }
+        return ESP_OK;
     }
+    session->rx_expected_seq++;
+    session->rx_nack_sent = 0;
 
-    return rc;
+    if(++session->rx_unacked >= BLE_RX_STREAM_ACK_EVERY)
+    {
+        gatt_server_rx_stream_ack(session, RX_STREAM_ACK);
+    }
+    else
+    {
+        ble_npl_callout_reset(&gatt_server_ack_timer, ble_npl_time_ms_to_ticks32(BLE_RX_STREAM_ACK_DELAY_MS));
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Callback when the capabilities characteristic is accessed
+ */
+static esp_err_t gatt_server_caps_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                 struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    ble_session_t *session = ble_session_find(conn_handle);
+    uint8_t caps[2];
+
+    if(session == NULL)
+    {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
+    {
+        caps[0] = GATT_SERVER_CAPS;
+        caps[1] = session->caps;
+        return os_mbuf_append(ctxt->om, caps, sizeof(caps)) == 0 ? ESP_OK : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+
+    if(ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+    {
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+    if(OS_MBUF_PKTLEN(ctxt->om) != 1 || os_mbuf_copydata(ctxt->om, 0, 1, caps) != 0)
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    /* Runs in the host task, like the drain, so no notification is sent
+     * half way through the switch */
+#if BLE_LZ_COMPRESSION
+    if(caps[0] & GATT_SERVER_CAP_LZ)
+    {
+        ble_lz_reset(&session->lz);
+    }
+#endif
+    session->caps = caps[0] & GATT_SERVER_CAPS;
+    return ESP_OK;
+}
+
+#if BLE_STATS_CHARACTERISTIC
+/**
+ * @brief  Callback when the diagnostics characteristic is read
+ */
+static esp_err_t gatt_server_stats_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                                  struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    ble_session_t *session;
+
+    if(ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR)
+    {
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+
+    session = ble_session_find(conn_handle);
+    if(session == NULL)
+    {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    /* Longer than one ATT MTU, the client reads it with read blob */
+    if(os_mbuf_append(ctxt->om, &session->stats, sizeof(ble_stats_t)) != 0)
+    {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief  Callback when tx characteristic is accessed
+ */
+static esp_err_t gatt_server_tx_access_handler(uint16_t conn_handle, uint16_t attr_handle,
+                                               struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    BLE_TRACE(GATT, BLE_TRACE_DEBUG, BLE_TRACE_EV_TX_ACCESS, conn_handle, ctxt->op);
+    return ESP_OK;
 }
 
 /******************************************************************************/
@@ -149,6 +546,70 @@ void gatt_server_register_rx_handler(ble_rx_data_handler_t callback)
     ble_rx_data_handler = callback;
 }
 
+/**
+ * @brief  Register callback to handle rx data in place
+ */
+void gatt_server_register_rx_mbuf_handler(ble_rx_mbuf_handler_t callback)
+{
+    ble_rx_mbuf_handler = callback;
+}
+
+/**
+ * @brief  Switch to worker dispatch
+ */
+esp_err_t gatt_server_start_rx_worker(ble_rx_packet_handler_t callback, BaseType_t core_id)
+{
+    TaskHandle_t worker;
+
+    if(gatt_server_rx_worker != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ble_spsc_queue_init(&gatt_server_rx_queue, gatt_server_rx_items,
+                        sizeof(gatt_server_rx_item_t), BLE_RX_QUEUE_LENGTH);
+    ble_rx_packet_handler = callback;
+
+    if(xTaskCreatePinnedToCore(gatt_server_rx_worker_task, "ble_rx", BLE_RX_WORKER_STACK_SIZE,
+                               NULL, BLE_RX_WORKER_PRIORITY, &worker, core_id) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Published last, the host task starts queueing once it sees the handle */
+    gatt_server_rx_worker = worker;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get rx worker queue counters
+ */
+void gatt_server_get_rx_stats(gatt_server_rx_stats_t *stats)
+{
+    stats->depth = gatt_server_rx_worker != NULL ? ble_spsc_queue_count(&gatt_server_rx_queue) : 0;
+    stats->peak = gatt_server_rx_peak;
+    stats->delivered = gatt_server_rx_delivered;
+    stats->dropped = gatt_server_rx_dropped;
+}
+
+/**
+ * @brief  Walk the segments of a received mbuf chain without copying
+ */
+size_t gatt_server_rx_for_each_segment(const struct os_mbuf *om, ble_rx_segment_handler_t callback, void *arg)
+{
+    size_t total = 0;
+
+    for(; om != NULL; om = SLIST_NEXT(om, om_next))
+    {
+        if(om->om_len > 0)
+        {
+            callback(om->om_data, om->om_len, arg);
+            total += om->om_len;
+        }
+    }
+    return total;
+}
+
 /**
  * @brief  Get TX characteristic handle
  */
@@ -167,6 +628,9 @@ esp_err_t gatt_server_init(void)
     ble_svc_gap_init();
     ble_svc_gatt_init();
 
+    ble_npl_callout_init(&gatt_server_ack_timer, nimble_port_get_dflt_eventq(),
+                         gatt_server_rx_stream_ack_timeout, NULL);
+
     /* Check services and characteristics */
     rc = ble_gatts_count_cfg(gatt_server_services);
     if(rc != ESP_OK)
@@ -24,9 +24,89 @@
     (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
 #define TX_CHARACTERISTIC_FLAGS                       \
     (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_NOTIFY)
+#define RX_STREAM_CHARACTERISTIC_FLAGS                \
+    (BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
+#define RX_ACK_CHARACTERISTIC_FLAGS                   \
+    (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_NOTIFY)
+#define STATS_CHARACTERISTIC_FLAGS                    \
+    (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC)
+#define CAPS_CHARACTERISTIC_FLAGS                     \
+    (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | \
+     BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
+
+/**
+ * Capability exchange, one bit per optional feature of the service:
+ *     o Reading the capabilities characteristic returns
+ *       [supported][enabled], both GATT_SERVER_CAP_* masks.
+ *     o The client writes the mask of features it wants, unsupported bits
+ *       are ignored. Features start with the write response: every
+ *       notification after it follows the new mask, none before it does.
+ *     o GATT_SERVER_CAP_LZ: tx notifications are LZ blocks (see ble_lz.h),
+ *       one header byte on top of the payload.
+ *     o GATT_SERVER_CAP_BATCH: tx notifications are batches of queued
+ *       packets (see ble_batch.h), packed up to the MTU or until the oldest
+ *       waited BLE_TX_COALESCE_DEADLINE_MS. With LZ too, the LZ block
+ *       decodes to the batch.
+ * Message frames leave room for these headers, clients sending their own
+ * packets keep them under MTU - 3 - BLE_LZ_HEADER_SIZE - BLE_BATCH_HEADER_MAX.
+ */
+#define GATT_SERVER_CAP_LZ                            0x01
+#define GATT_SERVER_CAP_BATCH                         0x02
+#define GATT_SERVER_CAPS                              ((BLE_LZ_COMPRESSION ? GATT_SERVER_CAP_LZ : 0) | \
+                                                       GATT_SERVER_CAP_BATCH)
+
+/**
+ * RX stream protocol, for clients pipelining writes without response:
+ *     o Each write to the stream characteristic starts with a little endian
+ *       uint16 sequence number, starting at 0 on every connection. The rest
+ *       is the payload, delivered like a write to the rx characteristic.
+ *     o The device notifies the ack characteristic with
+ *       [type][next expected seq, le16][window, le16] every
+ *       BLE_RX_STREAM_ACK_EVERY writes, or BLE_RX_STREAM_ACK_DELAY_MS after
+ *       the last write. The client keeps at most window writes unacked.
+ *     o A write out of sequence, or one the device had no room for, is
+ *       dropped and answered with a NACK, the client then resends from
+ *       next expected seq (go-back-N).
+ */
+#define RX_STREAM_HEADER_SIZE                         2
+#define RX_STREAM_ACK_SIZE                            5
+#define RX_STREAM_ACK                                 0x00
+#define RX_STREAM_NACK                                0x01
+
+/* Registry entry: each characteristic names its own access callback and the
+ * context it receives through arg, so NimBLE dispatches on the attribute
+ * handle and the access path never compares UUIDs. Adding a characteristic
+ * is one entry in gatt_server_services */
+#define GATT_SERVER_CHR(_uuid, _flags, _access_cb, _arg, _val_handle)          \
+    {                                                                          \
+        .uuid = (_uuid),                                                       \
+        .access_cb = (_access_cb),                                             \
+        .arg = (_arg),                                                         \
+        .flags = (_flags),                                                     \
+        .val_handle = (_val_handle),                                           \
+    }
+
+struct os_mbuf;
 
 typedef void (*ble_rx_data_handler_t)(uint8_t*, size_t);
 
+/* Receives the write as the stack mbuf chain, without copy. Set *om to NULL
+ * to take ownership, the handler then releases it with os_mbuf_free_chain() */
+typedef void (*ble_rx_mbuf_handler_t)(uint16_t conn_handle, struct os_mbuf **om);
+
+typedef void (*ble_rx_segment_handler_t)(const uint8_t *data, size_t size, void *arg);
+
+/* Called from the rx worker task with a packet copied out of the host task */
+typedef void (*ble_rx_packet_handler_t)(uint16_t conn_handle, uint8_t *data, size_t size);
+
+typedef struct
+{
+    uint32_t depth;                 /* Packets waiting for the worker */
+    uint32_t peak;                  /* Highest depth seen */
+    uint32_t delivered;             /* Packets handed to the worker callback */
+    uint32_t dropped;               /* Queue full or packet longer than BLE_RX_QUEUE_ITEM_SIZE */
+} gatt_server_rx_stats_t;
+
 /******************************************************************************/
 /*                              PRIVATE DATA                                  */
 /******************************************************************************/
@@ -50,6 +130,42 @@ typedef void (*ble_rx_data_handler_t)(uint8_t*, size_t);
  */
 void gatt_server_register_rx_handler(ble_rx_data_handler_t callback);
 
+/**
+ * @brief  Register callback to handle rx data in place, takes precedence over
+ *         the flat handler
+ * @param  Callback function, called from the host task
+ * @retval None
+ */
+void gatt_server_register_rx_mbuf_handler(ble_rx_mbuf_handler_t callback);
+
+/**
+ * @brief  Switch to worker dispatch: writes are copied into a lock-free queue
+ *         and handled by a dedicated task, so slow handlers no longer stall
+ *         the host task. Takes precedence over the other rx handlers
+ * @param  callback : packet handler, runs in the worker task
+ *         core_id  : core to pin the worker to, tskNO_AFFINITY to let it float
+ * @retval ESP_OK on success
+ *         ESP_ERR_INVALID_STATE if the worker is already running
+ *         ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t gatt_server_start_rx_worker(ble_rx_packet_handler_t callback, BaseType_t core_id);
+
+/**
+ * @brief  Get rx worker queue counters
+ * @param  stats : filled with current counters
+ * @retval None
+ */
+void gatt_server_get_rx_stats(gatt_server_rx_stats_t *stats);
+
+/**
+ * @brief  Walk the segments of a received mbuf chain without copying
+ * @param  om       : mbuf chain
+ *         callback : called once per non empty segment
+ *         arg      : passed to callback
+ * @retval Total length of the chain
+ */
+size_t gatt_server_rx_for_each_segment(const struct os_mbuf *om, ble_rx_segment_handler_t callback, void *arg);
+
 /**
  * @brief  Get TX characteristic handle
  * @param  None
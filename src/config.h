@@ -27,10 +27,147 @@
 /******************************************************************************/
 
 /* BLE */
-#define BLE_ADV_DURATION_MS                           BLE_HS_FOREVER
+#define BLE_ADV_DURATION_MS                           BLE_HS_FOREVER  /* Slow phase */
 #define BLE_IO_TYPE                                   BLE_SM_IO_CAP_DISP_ONLY
 #define BLE_DEVICE_NAME                               "ESP32 BLE"
 #define BLE_PIN_CODE                                  123456
+#define BLE_LINK_DEFAULT_PROFILE                      BLE_LINK_PROFILE_BULK
+
+/* BLE link adaptation, ADAPTIVE profile */
+#define BLE_LINK_ADAPT_PERIOD_MS                      250     /* Sampling period */
+#define BLE_LINK_ADAPT_BUSY_ITEMS                     4       /* Queued notifications, shorten the interval */
+#define BLE_LINK_ADAPT_IDLE_ITEMS                     0
+#define BLE_LINK_ADAPT_BUSY_RX_BPS                    2000    /* Received bytes per second */
+#define BLE_LINK_ADAPT_IDLE_RX_BPS                    200
+#define BLE_LINK_ADAPT_IDLE_MS                        3000    /* Quiet time before relaxing */
+#define BLE_LINK_ADAPT_MIN_GAP_MS                     1000    /* Between two update requests */
+
+/* Boot, the host tests build both orders */
+#ifndef BLE_BOOT_FAST_START
+#define BLE_BOOT_FAST_START                           0       /* Advertise first, load bonds and the rest afterwards */
+#endif
+#define BLE_BOOT_DEFERRED_MAX                         4       /* Steps waiting for the first advertisement */
+#define BLE_BOOT_DEFERRED_STACK_SIZE                  4096
+#define BLE_BOOT_DEFERRED_PRIORITY                    1
+#define BLE_BOOT_DEFERRED_CORE                        1       /* Not the NimBLE host core */
+
+/* BLE advertising */
+#define BLE_ADV_FAST_ITVL_MIN_MS                      20
+#define BLE_ADV_FAST_ITVL_MAX_MS                      30
+#define BLE_ADV_FAST_DURATION_MS                      30000
+#define BLE_ADV_SLOW_ITVL_MIN_MS                      1000
+#define BLE_ADV_SLOW_ITVL_MAX_MS                      1285
+
+/* BLE bonding */
+#define BLE_BOND_RECONNECT                            1       /* Advertise to bonded peers first */
+#define BLE_BOND_DIRECTED_MS                          1280    /* High duty directed, controller limit */
+#define BLE_BOND_RECONNECT_MS                         5000    /* Accept list only, fast interval */
+
+/* BLE pairing */
+#define BLE_PAIR_PRECOMPUTE_KEYS                      1       /* LE SC key pair generated at boot, off the host task */
+#define BLE_PAIR_INITIATE                             0       /* Request security as soon as a central connects */
+#define BLE_PAIR_KEYGEN_STACK_SIZE                    4096
+#define BLE_PAIR_KEYGEN_PRIORITY                      2
+#define BLE_PAIR_KEYGEN_CORE                          1       /* Not the NimBLE host core */
+
+/* BLE scanning */
+#define BLE_SCAN_OBSERVER                             0       /* Scanning gateway, ble_api_scan_start */
+#define BLE_SCAN_TABLE_SIZE                           512     /* Slots, power of 2, 3/4 usable */
+#define BLE_SCAN_DATA_SIZE                            31      /* Advertising payload kept per device */
+#define BLE_SCAN_ITVL_MS                              100
+#define BLE_SCAN_WINDOW_MS                            100     /* Equal to the interval, scan continuously */
+#define BLE_SCAN_ACTIVE                               0       /* Request scan responses */
+#define BLE_SCAN_RSSI_EWMA_SHIFT                      3       /* A report weighs 1/8 in the average */
+#define BLE_SCAN_RSSI_DELTA                           6       /* dB the average moves before a device is changed */
+#define BLE_SCAN_EXPIRY_MS                            30000   /* Unseen devices forgotten after */
+
+/* GATT client (central role) */
+#define GATT_CLIENT_PEERS_MAX                         2       /* Shares CONFIG_BT_NIMBLE_MAX_CONNECTIONS with the server */
+#define GATT_CLIENT_CONNECT_TIMEOUT_MS                3000    /* One attempt, then the next peer */
+#define GATT_CLIENT_RETRY_MS                          1000    /* After a failed attempt */
+#define GATT_CLIENT_QUEUE_LENGTH                      16      /* Power of 2 */
+#define GATT_CLIENT_ITEM_SIZE                         244     /* Longest value kept, truncated beyond */
+
+/* BLE TX queue */
+#define BLE_TX_QUEUE_LENGTH                           16
+#define BLE_TX_QUEUE_ITEM_SIZE                        256
+#define BLE_TX_QUEUE_HIGH_WATERMARK                   12
+#define BLE_TX_QUEUE_LOW_WATERMARK                    4
+#define BLE_TX_MAX_IN_FLIGHT                          4       /* Notifications awaiting BLE_GAP_EVENT_NOTIFY_TX */
+#define BLE_TX_MSYS_RESERVE                           4       /* mbufs kept free for RX and ATT responses */
+#define BLE_TX_RETRY_MS                               5
+#define BLE_TX_BATCH_SIZE                             512     /* Largest notification packed from several items */
+#define BLE_TX_COALESCE_DEADLINE_MS                   10      /* Partly filled batch waits at most */
+#define BLE_TX_PRODUCER_POLL_MS                       10      /* Producer asked again after it had nothing */
+
+/* BLE TX channels, BLE_TX_QUEUE_LENGTH is the bulk one */
+#define BLE_TX_CONTROL_QUEUE_LENGTH                   4
+#define BLE_TX_REALTIME_QUEUE_LENGTH                  4
+#define BLE_TX_REALTIME_WEIGHT                        3       /* Bytes sent per bulk byte when both are busy */
+#define BLE_TX_BULK_WEIGHT                            1
+#define BLE_TX_DEFAULT_CHANNEL                        BLE_TX_CHANNEL_BULK
+
+/* BLE RX worker */
+#define BLE_RX_QUEUE_LENGTH                           8       /* Power of 2 */
+#define BLE_RX_QUEUE_ITEM_SIZE                        512
+#define BLE_RX_WORKER_STACK_SIZE                      4096
+#define BLE_RX_WORKER_PRIORITY                        5
+#define BLE_RX_WORKER_CORE                            1
+
+/* BLE RX stream (write without response) */
+#define BLE_RX_STREAM_WINDOW                          32      /* Unacknowledged writes a client may have in flight */
+#define BLE_RX_STREAM_ACK_EVERY                       8
+#define BLE_RX_STREAM_ACK_DELAY_MS                    20
+
+/* BLE statistics */
+#define BLE_STATS_CHARACTERISTIC                      1       /* Expose per connection stats over GATT */
+
+/* BLE compression */
+#define BLE_LZ_COMPRESSION                            1       /* Offer LZ compressed notifications */
+#define BLE_LZ_WINDOW_SIZE                            1024    /* History referenced by matches, max 1024 */
+#define BLE_LZ_HASH_BITS                              8
+
+/* BLE OTA */
+#define BLE_OTA_SERVICE                               1       /* Firmware update over BLE */
+#define BLE_OTA_BUFFERS                               2       /* One fills while the other is flashed */
+#define BLE_OTA_BUFFER_SIZE                           4096    /* Multiple of the flash sector */
+#define BLE_OTA_ERASE_SIZE                            65536   /* Erased ahead, one flash block */
+#define BLE_OTA_COMMIT_SIZE                           65536   /* Resume point saved every */
+#define BLE_OTA_REBOOT_DELAY_MS                       1000
+#define BLE_OTA_WRITER_STACK_SIZE                     3072
+#define BLE_OTA_WRITER_PRIORITY                       4
+#define BLE_OTA_WRITER_CORE                           1
+
+/* BLE benchmark */
+#define BLE_BENCH_COMMANDS                            0       /* Accept "BENCH" messages from clients */
+#define BLE_BENCH_DRAIN_MS                            500     /* Waited after a run before reading the counters */
+#define BLE_BENCH_STACK_SIZE                          3072
+#define BLE_BENCH_PRIORITY                            3
+
+/* BLE trace */
+#define BLE_TRACE_RING_SIZE                           256     /* Records, power of 2 */
+#define BLE_TRACE_LEVEL_API                           BLE_TRACE_INFO
+#define BLE_TRACE_LEVEL_GATT                          BLE_TRACE_INFO
+#define BLE_TRACE_LEVEL_COC                           BLE_TRACE_WARN
+#define BLE_TRACE_LEVEL_FRAME                         BLE_TRACE_WARN
+
+/* BLE message framing */
+#define BLE_FRAME_MAX_MESSAGE_SIZE                    4096
+#define BLE_FRAME_TX_PENDING                          4       /* Messages accepted per peer ahead of the tx queue */
+
+/* BLE packet pool */
+#define BLE_POOL_SMALL_SIZE                           BLE_TX_QUEUE_ITEM_SIZE
+#define BLE_POOL_SMALL_COUNT                          16
+#define BLE_POOL_MEDIUM_SIZE                          512     /* BLE_ATT_ATTR_MAX_LEN */
+#define BLE_POOL_MEDIUM_COUNT                         8
+#define BLE_POOL_LARGE_SIZE                           BLE_FRAME_MAX_MESSAGE_SIZE
+#define BLE_POOL_LARGE_COUNT                          (2 * CONFIG_BT_NIMBLE_MAX_CONNECTIONS)  /* Reassembly and pending tx */
+#define BLE_POOL_USE_PSRAM                            0
+
+/* BLE L2CAP connection oriented channels */
+#define BLE_COC_PSM                                   0x0081
+#define BLE_COC_MTU                                   2048
+#define BLE_COC_BUF_PER_CHANNEL                       3       /* RX armed, RX held by the app, TX */
 
 /* Info */
 #define FIRMWARE_VERSION                              "1.0.0"
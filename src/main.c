@@ -10,11 +10,16 @@
 /*                              INCLUDE FILES                                 */
 /******************************************************************************/
 
+#include <stdio.h>
 #include <nvs_flash.h>
 
 #include "config.h"
 #include "ble_api/gatt_server.h"
 #include "ble_api/ble_api.h"
+#include "ble_api/ble_frame.h"
+#include "ble_api/ble_pool.h"
+#include "ble_api/ble_bench.h"
+#include "ble_api/ble_boot.h"
 
 /******************************************************************************/
 /*                     EXPORTED TYPES and DEFINITIONS                         */
@@ -36,21 +41,114 @@ static const char* TAG = "MAIN";
 /*                                FUNCTIONS                                   */
 /******************************************************************************/
 
-static void main_ble_handle_packet(uint8_t *data, size_t size);
+static void main_nvs_recover(void);
+static void main_ble_handle_packet(uint16_t conn_handle, uint8_t *data, size_t size);
+static void main_ble_handle_message(uint16_t conn_handle, uint8_t *data, size_t size);
+#if BLE_BENCH_COMMANDS
+static bool main_ble_bench_command(uint16_t conn_handle, uint8_t *data, size_t size);
+static void main_ble_bench_done(const ble_bench_report_t *report);
+#endif
 
 /******************************************************************************/
 
 /**
- * @brief  BLE data handler
+ * @brief  Erase and reformat an NVS partition that is full or from an older
+ *         layout. Slow, deferred past the first advertisement in fast start
  */
-static void main_ble_handle_packet(uint8_t *data, size_t size)
+static void main_nvs_recover(void)
 {
-    ESP_LOGI(TAG, "Received %u bytes", size);
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ble_boot_mark(BLE_BOOT_NVS_READY);
+}
+
+/**
+ * @brief  BLE data handler, runs in the rx worker task
+ */
+static void main_ble_handle_packet(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    ble_frame_rx(conn_handle, data, size);
+}
+
+/**
+ * @brief  BLE message handler, called once a message is reassembled
+ */
+static void main_ble_handle_message(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    ESP_LOGI(TAG, "Received %u bytes from conn %d", size, conn_handle);
+
+#if BLE_BENCH_COMMANDS
+    if(main_ble_bench_command(conn_handle, data, size))
+    {
+        return;
+    }
+#endif
     
     /* Send response */
-    ble_api_tx_notify(data, size);
+    esp_err_t rc = ble_frame_send(conn_handle, data, size);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Response dropped; rc = %d", rc);
+    }
 }
 
+#if BLE_BENCH_COMMANDS
+/**
+ * @brief  Start a benchmark run on "BENCH <duration ms> <payload size> [framed]"
+ * @retval true if the message was a benchmark command
+ */
+static bool main_ble_bench_command(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    ble_bench_config_t config;
+    char command[48];
+    char mode[8] = "";
+    uint32_t duration;
+    uint32_t payload;
+    esp_err_t rc;
+
+    if(size < 6 || size >= sizeof(command) || memcmp(data, "BENCH ", 6) != 0)
+    {
+        return false;
+    }
+    memcpy(command, data, size);
+    command[size] = '\0';
+    if(sscanf(command + 6, "%u %u %7s", &duration, &payload, mode) < 2)
+    {
+        return false;
+    }
+
+    config.duration_ms = duration;
+    config.payload_size = payload;
+    config.framed = (strcmp(mode, "framed") == 0);
+    rc = ble_bench_start(conn_handle, &config, main_ble_bench_done);
+    if(rc != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Benchmark not started; rc = %d", rc);
+    }
+    return true;
+}
+
+/**
+ * @brief  Log a finished benchmark run and send its summary to the client
+ */
+static void main_ble_bench_done(const ble_bench_report_t *report)
+{
+    char text[256];
+    int32_t length;
+
+    ble_bench_log(report);
+    length = ble_bench_format(report, text, sizeof(text));
+    if(length >= (int32_t)sizeof(text))
+    {
+        length = sizeof(text) - 1;
+    }
+    if(length > 0 && !report->disconnected)
+    {
+        ble_frame_send(report->conn_handle, (uint8_t *)text, length);
+    }
+}
+#endif
+
 /******************************************************************************/
 
 /**
@@ -58,11 +156,22 @@ static void main_ble_handle_packet(uint8_t *data, size_t size)
  */
 void app_main()
 {
-    /* Initialize NVS — it is used to store PHY calibration data */
+    ble_pool_stats_t pool_stats;
+    ble_pool_class_t pool_class;
+    ble_boot_times_t boot_times;
+    bool boot_logged = false;
+
+    ble_boot_mark(BLE_BOOT_APP_MAIN);
+
+    /* Initialize NVS — it is used to store PHY calibration data. Without it
+     * the controller calibrates from scratch, still faster than an erase */
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+        ret = ble_boot_defer(main_nvs_recover);
+    }
+    else if(ret == ESP_OK)
+    {
+        ble_boot_mark(BLE_BOOT_NVS_READY);
     }
     ESP_ERROR_CHECK(ret);
     ESP_LOGI(TAG, "Power up! Firmware version %s, hardware version %s", FIRMWARE_VERSION, HARDWARE_VERSION);
@@ -70,12 +179,27 @@ void app_main()
     /* BLE initialization */
     ble_api_init(BLE_DEVICE_NAME, BLE_PIN_CODE);
 
-    /* Register callback to handle data received */
-    gatt_server_register_rx_handler(main_ble_handle_packet);
+    ESP_ERROR_CHECK(ble_frame_init(main_ble_handle_message));
+
+    /* Handle data received in a worker on the core not running the host task */
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(main_ble_handle_packet, BLE_RX_WORKER_CORE));
 
     while(1)
     {
+        ble_boot_get_times(&boot_times);
+        if(!boot_logged && boot_times.us[BLE_BOOT_DEFERRED_DONE] != 0)
+        {
+            ble_boot_log();
+            boot_logged = true;
+        }
+
         ESP_LOGI(TAG, "Free heap %u", esp_get_minimum_free_heap_size());
+        for(pool_class = 0; pool_class < BLE_POOL_CLASSES; pool_class++)
+        {
+            ble_pool_get_stats(pool_class, &pool_stats);
+            ESP_LOGI(TAG, "Pool %u B: %u/%u in use, peak %u, fails %u", pool_stats.block_size,
+                     pool_stats.in_use, pool_stats.blocks, pool_stats.peak, pool_stats.fails);
+        }
         vTaskDelay(5000 / portTICK_RATE_MS);
     }
 }
\ No newline at end of file
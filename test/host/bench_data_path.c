@@ -0,0 +1,402 @@
+/*
+ *  bench_data_path.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_frame.h"
+#include "ble_pool.h"
+#include "ble_stats.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Data path benchmark on the host target. A scripted client drives the
+ * firmware while the fake controller holds every notification until a
+ * connection event releases BENCH_PACKETS_PER_EVENT of them, so msys and
+ * the tx queues see the back pressure of a real link. Each scenario
+ * reports packets/s and bytes/s handed to the controller, latency
+ * percentiles from the session histograms, heap allocations, the pool
+ * peaks and the msys low watermark. Numbers measure the firmware's CPU
+ * path, not air time.
+ */
+#define BENCH_DURATION_MS                             300
+#define BENCH_MTU                                     247
+#define BENCH_PAYLOAD_SIZE                            (BENCH_MTU - 3)
+#define BENCH_FRAME_SIZE                              1000
+#define BENCH_WRITE_SIZE                              200
+#define BENCH_WRITES_PER_EVENT                        4
+#define BENCH_PACKETS_PER_EVENT                       6
+#define BENCH_CHURN_PEERS                             CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define BENCH_CHURN_EVERY                             50      /* Loop iterations between churn steps */
+
+typedef struct
+{
+    const char *name;
+    int64_t duration_us;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t latency_us[3];             /* p50, p90, p99 */
+    uint32_t allocs;
+    uint32_t msys_min_free;
+    uint32_t pool_peak[BLE_POOL_CLASSES];
+    uint32_t pool_fails;
+    uint32_t drops;                     /* Producer calls refused, retried later */
+    uint32_t events;                    /* Connects, disconnects and subscription changes */
+} bench_result_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t bench_conns[BENCH_CHURN_PEERS];
+static uint32_t bench_notified;
+static uint32_t bench_notified_bytes;
+static uint32_t bench_msys_min_free;
+static volatile uint32_t bench_received;
+static volatile uint32_t bench_received_bytes;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void bench_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                              void *arg);
+static void bench_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static void bench_step(void);
+static void bench_begin(bench_result_t *result, const char *name);
+static void bench_end(bench_result_t *result, ble_stats_hist_t hist);
+static void bench_session_stats(ble_stats_t *stats);
+static void bench_print(const bench_result_t *result);
+static void bench_notify(bool framed);
+static void bench_writes(void);
+static void bench_churn(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Count what reaches the fake controller on the tx characteristic
+ */
+static void bench_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                              void *arg)
+{
+    uint32_t free = os_msys_num_free();
+
+    if(attr_handle == gatt_server_get_tx_handle())
+    {
+        bench_notified_bytes += length;
+        bench_notified++;
+    }
+    if(free < bench_msys_min_free)
+    {
+        bench_msys_min_free = free;
+    }
+}
+
+/**
+ * @brief  Rx worker handler
+ */
+static void bench_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    bench_received_bytes += size;
+    bench_received++;
+}
+
+/**
+ * @brief  One connection event: the peer acknowledges, the host task runs
+ */
+static void bench_step(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < BENCH_CHURN_PEERS; i++)
+    {
+        if(bench_conns[i] != BLE_HS_CONN_HANDLE_NONE)
+        {
+            fake_link_release(bench_conns[i], BENCH_PACKETS_PER_EVENT);
+        }
+    }
+    fake_run();
+}
+
+/**
+ * @brief  Reset the counters of a scenario, the session stats included
+ */
+static void bench_begin(bench_result_t *result, const char *name)
+{
+    uint8_t i;
+
+    for(i = 0; i < ble_session_count(); i++)
+    {
+        ble_stats_reset(&ble_session_at(i)->stats);
+    }
+    memset(result, 0, sizeof(*result));
+    result->name = name;
+    result->allocs = fake_heap_allocs();
+    result->duration_us = fake_time_us();
+    bench_notified = 0;
+    bench_notified_bytes = 0;
+    bench_received = 0;
+    bench_received_bytes = 0;
+    bench_msys_min_free = os_msys_num_free();
+}
+
+/**
+ * @brief  Sum the stats of every open session, a reconnected peer counts
+ *         from its new session only
+ */
+static void bench_session_stats(ble_stats_t *stats)
+{
+    ble_session_t *session;
+    uint32_t hist;
+    uint32_t bucket;
+    uint8_t i;
+
+    memset(stats, 0, sizeof(*stats));
+    for(i = 0; i < ble_session_count(); i++)
+    {
+        session = ble_session_at(i);
+        stats->tx_packets += session->stats.tx_packets;
+        stats->tx_bytes += session->stats.tx_bytes;
+        stats->rx_packets += session->stats.rx_packets;
+        stats->rx_bytes += session->stats.rx_bytes;
+        for(hist = 0; hist < BLE_STATS_HISTS; hist++)
+        {
+            for(bucket = 0; bucket < BLE_STATS_HIST_BUCKETS; bucket++)
+            {
+                stats->hist[hist][bucket] += session->stats.hist[hist][bucket];
+            }
+        }
+    }
+}
+
+/**
+ * @brief  Collect the results of a scenario
+ */
+static void bench_end(bench_result_t *result, ble_stats_hist_t hist)
+{
+    static const uint32_t per_mille[3] = { 500, 900, 990 };
+    ble_pool_stats_t pool_stats;
+    ble_stats_t stats;
+    uint32_t i;
+
+    result->duration_us = fake_time_us() - result->duration_us;
+    result->allocs = fake_heap_allocs() - result->allocs;
+    result->msys_min_free = bench_msys_min_free;
+
+    bench_session_stats(&stats);
+    for(i = 0; i < 3; i++)
+    {
+        result->latency_us[i] = ble_stats_percentile(stats.hist[hist], per_mille[i]);
+    }
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        ble_pool_get_stats(i, &pool_stats);
+        result->pool_peak[i] = pool_stats.peak;
+        result->pool_fails += pool_stats.fails;
+    }
+}
+
+/**
+ * @brief  Print one scenario
+ */
+static void bench_print(const bench_result_t *result)
+{
+    uint64_t duration_us = result->duration_us > 0 ? result->duration_us : 1;
+
+    printf("%-8s %8llu pkt/s %10llu B/s  p50/p90/p99 %5u/%5u/%5u us  allocs %4u  msys min %2u  "
+           "pool peak %u/%u/%u fails %u  drops %u  events %u\n",
+           result->name, (unsigned long long)(result->packets * 1000000ULL / duration_us),
+           (unsigned long long)(result->bytes * 1000000ULL / duration_us), result->latency_us[0],
+           result->latency_us[1], result->latency_us[2], result->allocs, result->msys_min_free,
+           result->pool_peak[BLE_POOL_SMALL], result->pool_peak[BLE_POOL_MEDIUM], result->pool_peak[BLE_POOL_LARGE],
+           result->pool_fails, result->drops, result->events);
+}
+
+/**
+ * @brief  Stream notifications to one peer, raw packets or framed messages
+ */
+static void bench_notify(bool framed)
+{
+    static uint8_t message[BENCH_FRAME_SIZE];
+    bench_result_t result;
+    int64_t deadline;
+    esp_err_t rc;
+
+    memset(message, 0x5A, sizeof(message));
+    bench_begin(&result, framed ? "framed" : "raw");
+    deadline = fake_time_us() + BENCH_DURATION_MS * 1000;
+    while(fake_time_us() < deadline)
+    {
+        do
+        {
+            rc = framed ? ble_frame_send(bench_conns[0], message, sizeof(message)) :
+                          ble_api_tx_notify_conn(bench_conns[0], message, BENCH_PAYLOAD_SIZE);
+            result.drops += rc != ESP_OK;
+        } while(rc == ESP_OK);
+        bench_step();
+    }
+    result.packets = bench_notified;
+    result.bytes = bench_notified_bytes;
+    bench_end(&result, BLE_STATS_NOTIFY_TO_TX);
+    bench_print(&result);
+    CHECK(result.packets > 0);
+}
+
+/**
+ * @brief  Client writes to the rx characteristic, handled by the rx worker
+ */
+static void bench_writes(void)
+{
+    uint16_t rx_handle = fake_gatt_find(&test_rx_uuid.u);
+    uint8_t data[BENCH_WRITE_SIZE];
+    gatt_server_rx_stats_t before;
+    gatt_server_rx_stats_t after;
+    bench_result_t result;
+    int64_t deadline;
+    uint32_t sent = 0;
+    uint32_t i;
+
+    memset(data, 0x3C, sizeof(data));
+    bench_begin(&result, "writes");
+    gatt_server_get_rx_stats(&before);
+    deadline = fake_time_us() + BENCH_DURATION_MS * 1000;
+    while(fake_time_us() < deadline)
+    {
+        for(i = 0; i < BENCH_WRITES_PER_EVENT; i++)
+        {
+            if(fake_gatt_write(bench_conns[0], rx_handle, data, sizeof(data)) == 0)
+            {
+                sent++;
+            }
+            else
+            {
+                result.drops++;
+            }
+        }
+        bench_step();
+        taskYIELD();
+    }
+    /* Writes without response the worker queue had no room for are
+     * dropped after the stack accepted them */
+    gatt_server_get_rx_stats(&after);
+    sent -= after.dropped - before.dropped;
+    result.drops += after.dropped - before.dropped;
+    while(bench_received < sent && fake_time_us() < deadline + TEST_TIMEOUT_MS * 1000)
+    {
+        vTaskDelay(1);
+    }
+    result.packets = bench_received;
+    result.bytes = bench_received_bytes;
+    bench_end(&result, BLE_STATS_RX_TO_HANDLER);
+    bench_print(&result);
+    CHECK(result.packets == sent);
+}
+
+/**
+ * @brief  Every peer connected and streaming while peers unsubscribe,
+ *         resubscribe, disconnect and reconnect
+ */
+static void bench_churn(void)
+{
+    uint8_t packet[BENCH_PAYLOAD_SIZE];
+    bench_result_t result;
+    int64_t deadline;
+    uint32_t iteration = 0;
+    uint32_t victim;
+    uint32_t i;
+
+    memset(packet, 0xC3, sizeof(packet));
+    for(i = 1; i < BENCH_CHURN_PEERS; i++)
+    {
+        bench_conns[i] = test_connect(i + 1, BENCH_MTU);
+        CHECK(bench_conns[i] != BLE_HS_CONN_HANDLE_NONE);
+    }
+
+    bench_begin(&result, "churn");
+    deadline = fake_time_us() + BENCH_DURATION_MS * 1000;
+    while(fake_time_us() < deadline)
+    {
+        while(ble_api_tx_notify(packet, sizeof(packet)) == ESP_OK)
+        {
+        }
+        result.drops++;
+        bench_step();
+
+        if(++iteration % BENCH_CHURN_EVERY != 0)
+        {
+            continue;
+        }
+        victim = (iteration / BENCH_CHURN_EVERY) % BENCH_CHURN_PEERS;
+        if((iteration / BENCH_CHURN_EVERY) % 2 == 0)
+        {
+            /* Unsubscribe and resubscribe one event later */
+            fake_subscribe(bench_conns[victim], gatt_server_get_tx_handle(), false);
+            bench_step();
+            fake_subscribe(bench_conns[victim], gatt_server_get_tx_handle(), true);
+            result.events += 2;
+        }
+        else
+        {
+            /* Drop the link with packets in flight and reconnect */
+            fake_disconnect(bench_conns[victim], BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+            bench_conns[victim] = BLE_HS_CONN_HANDLE_NONE;
+            bench_conns[victim] = test_connect(victim + 1, BENCH_MTU);
+            CHECK(bench_conns[victim] != BLE_HS_CONN_HANDLE_NONE);
+            result.events += 2;
+        }
+    }
+    result.packets = bench_notified;
+    result.bytes = bench_notified_bytes;
+    bench_end(&result, BLE_STATS_NOTIFY_TO_TX);
+    bench_print(&result);
+    CHECK(result.packets > 0);
+
+    /* Nothing leaks once every peer is gone */
+    for(i = 0; i < BENCH_CHURN_PEERS; i++)
+    {
+        fake_disconnect(bench_conns[i], BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+        bench_conns[i] = BLE_HS_CONN_HANDLE_NONE;
+    }
+    fake_run();
+    CHECK(ble_session_count() == 0);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Run the data path scenarios
+ */
+int main(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < BENCH_CHURN_PEERS; i++)
+    {
+        bench_conns[i] = BLE_HS_CONN_HANDLE_NONE;
+    }
+    test_setup();
+    ESP_ERROR_CHECK(ble_frame_init(bench_rx_handler));
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(bench_rx_handler, 1));
+    fake_notify_set_hook(bench_notify_hook, NULL);
+    fake_link_hold(true);
+
+    bench_conns[0] = test_connect(1, BENCH_MTU);
+    CHECK(bench_conns[0] != BLE_HS_CONN_HANDLE_NONE);
+
+    bench_notify(false);
+    bench_notify(true);
+    bench_writes();
+    bench_churn();
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+/*
+ *  fake.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _FAKE_H_
+#define _FAKE_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "fake_esp.h"
+#include "fake_freertos.h"
+#include "fake_nimble.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Test side of the fake platform. The thread calling fake_run() is the
+ * NimBLE host task: queued events, due callouts and every GAP event raised
+ * here run on it, the firmware's own tasks run on threads of their own.
+ *
+ * Notifications model the controller: with fake_link_hold() the mbufs of
+ * sent notifications stay out of msys until fake_link_release() frees them
+ * one connection event at a time, the way the controller returns them once
+ * the peer acknowledged. Without it they are freed as soon as they are sent.
+ *
+ * L2CAP channels are opened by the peer with fake_coc_connect(). An SDU takes
+ * one credit per FAKE_COC_MPS bytes and stalls once the peer is out of them,
+ * in loopback the peer sends every SDU back and returns the credits, so it
+ * must not give more than FAKE_COC_ECHO_MAX.
+ */
+#define FAKE_CONN_MAX                                 8
+#define FAKE_GATT_CHR_MAX                             32
+#define FAKE_LINK_HELD_MAX                            64
+#define FAKE_NOTIFY_DATA_MAX                          BLE_ATT_MTU_MAX
+#define FAKE_COC_MPS                                  247     /* K-frame payload, one credit each */
+#define FAKE_COC_SDU_MAX                              2048
+#define FAKE_COC_ECHO_MAX                             16      /* Credits a loopback peer may give */
+#define FAKE_GATTC_PROCS_MAX                          16      /* Client procedures in flight, all connections */
+#define FAKE_KEYGEN_MS                                5       /* P-256 key pair, tens of ms on target */
+
+typedef void (*fake_notify_hook_t)(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data,
+                                   uint16_t length, void *arg);
+
+typedef void (*fake_coc_hook_t)(uint16_t conn_handle, const uint8_t *data, uint16_t length, void *arg);
+
+/* Database of the peripherals a central connects to, one for all of them */
+typedef struct
+{
+    const ble_uuid_t *service;
+    uint16_t start;                     /* Service range */
+    uint16_t end;
+    const ble_uuid_t *characteristic;
+    uint16_t value;                     /* Reads answer the peer address */
+    uint16_t cccd;
+} fake_peer_db_t;
+
+typedef struct
+{
+    uint32_t notifies;                  /* Notifications handed to the fake controller */
+    uint32_t notify_bytes;
+    uint32_t notify_fails;              /* Returned an error, the mbuf was freed */
+    uint32_t update_requests;           /* ble_gap_update_params() calls */
+    uint32_t phy_requests;
+    uint32_t data_len_requests;
+    uint32_t security_requests;
+    uint32_t terminations;
+    uint32_t adv_starts;
+    uint32_t adv_data_sets;             /* Advertising and scan response payloads handed over */
+    uint32_t central_connects;          /* ble_gap_connect() calls */
+    uint32_t gattc_procedures;          /* Client procedures started */
+    uint32_t gattc_reads;
+    uint32_t gattc_in_flight;           /* Started, not answered yet */
+    uint32_t gattc_in_flight_max;
+    struct ble_gap_upd_params last_update;
+} fake_gap_stats_t;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/* Clock, esp_timer and the NPL tick share it */
+int64_t fake_time_us(void);
+void fake_advance_ms(uint32_t ms);
+
+/* Host task */
+uint32_t fake_run(void);
+bool fake_run_until(bool (*done)(void *arg), void *arg, uint32_t timeout_ms);
+void fake_sync(void);
+
+/* Peripheral connections, raised on the callback of the running advertisement */
+uint16_t fake_connect(const ble_addr_t *peer);
+void fake_disconnect(uint16_t conn_handle, int reason);
+void fake_set_mtu(uint16_t conn_handle, uint16_t mtu);
+void fake_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify);
+void fake_encrypt(uint16_t conn_handle, bool authenticated, bool bonded, uint8_t key_size);
+bool fake_adv_active(void);
+
+/* GATT server, as a client would access it */
+uint16_t fake_gatt_find(const ble_uuid_t *uuid);
+int fake_gatt_write(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t length);
+int fake_gatt_read(uint16_t conn_handle, uint16_t attr_handle, void *data, uint16_t max_length,
+                   uint16_t *length);
+
+/* Controller */
+void fake_notify_set_hook(fake_notify_hook_t hook, void *arg);
+void fake_notify_fail(int rc, uint32_t count);
+void fake_link_hold(bool hold);
+uint32_t fake_link_held(uint16_t conn_handle);
+uint32_t fake_link_release(uint16_t conn_handle, uint32_t packets);
+void fake_gap_set_update_rc(int rc);
+void fake_gap_set_central_min_itvl(uint16_t itvl);
+void fake_gap_set_data_len_rc(int rc);
+void fake_gap_set_central_phys(uint8_t phys_mask);
+void fake_gap_get_stats(fake_gap_stats_t *stats);
+
+/* Peripherals of central connections, they accept and answer at once by default */
+void fake_peer_set_db(const fake_peer_db_t *db);
+void fake_peer_accept(bool accept);
+void fake_peer_hold(bool hold);
+
+/* L2CAP peer */
+int fake_coc_connect(uint16_t conn_handle, uint16_t peer_mtu, uint16_t credits);
+void fake_coc_disconnect(uint16_t conn_handle);
+int fake_coc_send(uint16_t conn_handle, const void *data, uint16_t length);
+void fake_coc_credits(uint16_t conn_handle, uint16_t credits);
+uint16_t fake_coc_peer_credits(uint16_t conn_handle);
+void fake_coc_set_hook(fake_coc_hook_t hook, void *arg);
+void fake_coc_loopback(bool loopback);
+
+/* Observer */
+void fake_disc_report(const struct ble_gap_disc_desc *desc);
+bool fake_disc_active(void);
+
+/* Platform */
+void fake_set_log_level(int level);
+uint32_t fake_heap_allocs(void);
+uint32_t fake_restarts(void);
+const esp_partition_t *fake_boot_partition(void);
+bool fake_store_ready(void);
+
+/******************************************************************************/
+
+#endif /* _FAKE_H_ */
\ No newline at end of file
@@ -0,0 +1,704 @@
+/*
+ *  fake_esp.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fake.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define FAKE_HEAP_SIZE                                (320 * 1024)
+#define FAKE_NVS_ENTRIES                              64
+#define FAKE_NVS_NAMESPACES                           8
+#define FAKE_NVS_NAME_SIZE                            16
+
+typedef struct
+{
+    uint8_t used;
+    uint8_t ns;
+    char key[FAKE_NVS_NAME_SIZE];
+    size_t length;
+    uint8_t *value;
+} fake_nvs_entry_t;
+
+struct nvs_opaque_iterator_t
+{
+    uint8_t ns;
+    uint32_t index;
+};
+
+typedef struct
+{
+    size_t size;
+    uint64_t align;
+} fake_heap_header_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static portMUX_TYPE fake_esp_lock = portMUX_INITIALIZER_UNLOCKED;
+static int fake_log_level = FAKE_LOG_WARN;
+static int64_t fake_clock_start_us;
+static int64_t fake_clock_offset_us;
+
+static uint32_t fake_heap_used;
+static uint32_t fake_heap_peak;
+static uint32_t fake_heap_alloc_count;
+static uint32_t fake_restart_count;
+
+static bool fake_nvs_ready;
+static char fake_nvs_namespaces[FAKE_NVS_NAMESPACES][FAKE_NVS_NAME_SIZE];
+static fake_nvs_entry_t fake_nvs[FAKE_NVS_ENTRIES];
+
+/* Layout of partitions.csv */
+static const esp_partition_t fake_partitions[] = {
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, 0x010000, FAKE_OTA_PARTITION_SIZE, "factory", false },
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x110000, FAKE_OTA_PARTITION_SIZE, "ota_0", false },
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x210000, FAKE_OTA_PARTITION_SIZE, "ota_1", false },
+};
+static uint8_t *fake_partition_data[sizeof(fake_partitions) / sizeof(fake_partitions[0])];
+static const esp_partition_t *fake_running = &fake_partitions[0];
+static const esp_partition_t *fake_boot = &fake_partitions[0];
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static fake_nvs_entry_t *fake_nvs_find(nvs_handle_t handle, const char *key);
+static nvs_iterator_t fake_nvs_seek(nvs_iterator_t iterator, uint32_t index);
+static uint8_t *fake_partition_map(const esp_partition_t *partition, size_t offset, size_t size);
+
+/******************************************************************************/
+
+/**
+ * @brief  Find the entry of a key, NULL if not set
+ */
+static fake_nvs_entry_t *fake_nvs_find(nvs_handle_t handle, const char *key)
+{
+    uint32_t i;
+
+    for(i = 0; i < FAKE_NVS_ENTRIES; i++)
+    {
+        if(fake_nvs[i].used && fake_nvs[i].ns == handle && strncmp(fake_nvs[i].key, key, FAKE_NVS_NAME_SIZE) == 0)
+        {
+            return &fake_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Move an iterator to the first key of its namespace from index on,
+ *         released when there is none like the IDF 4.x iterators
+ */
+static nvs_iterator_t fake_nvs_seek(nvs_iterator_t iterator, uint32_t index)
+{
+    for(; index < FAKE_NVS_ENTRIES; index++)
+    {
+        if(fake_nvs[index].used && fake_nvs[index].ns == iterator->ns)
+        {
+            iterator->index = index;
+            return iterator;
+        }
+    }
+    free(iterator);
+    return NULL;
+}
+
+/**
+ * @brief  Get the backing memory of a partition range, erased on first use
+ * @retval Memory at offset, NULL if the range is outside the partition
+ */
+static uint8_t *fake_partition_map(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    uint32_t index = partition - fake_partitions;
+
+    if(index >= sizeof(fake_partitions) / sizeof(fake_partitions[0]) ||
+       offset > partition->size || size > partition->size - offset)
+    {
+        return NULL;
+    }
+    if(fake_partition_data[index] == NULL)
+    {
+        fake_partition_data[index] = malloc(partition->size);
+        if(fake_partition_data[index] == NULL)
+        {
+            return NULL;
+        }
+        memset(fake_partition_data[index], 0xFF, partition->size);
+    }
+    return fake_partition_data[index] + offset;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Print a log line at or above the configured level
+ */
+void fake_log(int level, const char *tag, const char *format, ...)
+{
+    va_list args;
+
+    if(level > fake_log_level)
+    {
+        return;
+    }
+    fprintf(stderr, "%c (%lld) %s: ", "NEWID"[level], (long long)(fake_time_us() / 1000), tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+/**
+ * @brief  ESP_ERROR_CHECK aborts like on the device
+ */
+void fake_error_check(esp_err_t rc, const char *expression, const char *file, int line)
+{
+    if(rc != ESP_OK)
+    {
+        fprintf(stderr, "ESP_ERROR_CHECK failed: 0x%x at %s:%d\nexpression: %s\n", rc, file, line, expression);
+        abort();
+    }
+}
+
+/**
+ * @brief  Set the level of fake_log
+ */
+void fake_set_log_level(int level)
+{
+    fake_log_level = level;
+}
+
+/**
+ * @brief  Get microseconds since the first call, plus fake_advance_ms jumps.
+ *         Lock free, the firmware reads the clock on every packet
+ */
+int64_t fake_time_us(void)
+{
+    struct timespec now;
+    int64_t now_us;
+    int64_t start_us = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+    if(!__atomic_compare_exchange_n(&fake_clock_start_us, &start_us, now_us, false, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED))
+    {
+        now_us -= start_us;
+    }
+    else
+    {
+        now_us = 0;
+    }
+    return now_us + __atomic_load_n(&fake_clock_offset_us, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  Move the clock forward, callouts due by then fire on the next fake_run
+ */
+void fake_advance_ms(uint32_t ms)
+{
+    __atomic_add_fetch(&fake_clock_offset_us, (int64_t)ms * 1000, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  Microseconds since boot
+ */
+int64_t esp_timer_get_time(void)
+{
+    return fake_time_us();
+}
+
+/**
+ * @brief  Random word
+ */
+uint32_t esp_random(void)
+{
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+/**
+ * @brief  Count restarts, the process keeps running
+ */
+void esp_restart(void)
+{
+    portENTER_CRITICAL(&fake_esp_lock);
+    fake_restart_count++;
+    portEXIT_CRITICAL(&fake_esp_lock);
+}
+
+/**
+ * @brief  Get number of esp_restart calls
+ */
+uint32_t fake_restarts(void)
+{
+    return fake_restart_count;
+}
+
+/**
+ * @brief  Free heap, FAKE_HEAP_SIZE less what heap_caps handed out
+ */
+uint32_t esp_get_free_heap_size(void)
+{
+    return FAKE_HEAP_SIZE - fake_heap_used;
+}
+
+/**
+ * @brief  Lowest free heap so far
+ */
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return FAKE_HEAP_SIZE - fake_heap_peak;
+}
+
+/**
+ * @brief  Get number of heap_caps allocations so far
+ */
+uint32_t fake_heap_allocs(void)
+{
+    return fake_heap_alloc_count;
+}
+
+/**
+ * @brief  Allocate and count, every capability is plain heap
+ */
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    fake_heap_header_t *header;
+
+    (void)caps;
+    if(size > FAKE_HEAP_SIZE - fake_heap_used)
+    {
+        return NULL;
+    }
+    header = malloc(sizeof(*header) + size);
+    if(header == NULL)
+    {
+        return NULL;
+    }
+    header->size = size;
+
+    portENTER_CRITICAL(&fake_esp_lock);
+    fake_heap_used += size;
+    if(fake_heap_used > fake_heap_peak)
+    {
+        fake_heap_peak = fake_heap_used;
+    }
+    fake_heap_alloc_count++;
+    portEXIT_CRITICAL(&fake_esp_lock);
+    return header + 1;
+}
+
+/**
+ * @brief  Allocate zeroed memory
+ */
+void *heap_caps_calloc(size_t count, size_t size, uint32_t caps)
+{
+    void *ptr = heap_caps_malloc(count * size, caps);
+
+    if(ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief  Free memory from heap_caps_malloc
+ */
+void heap_caps_free(void *ptr)
+{
+    fake_heap_header_t *header;
+
+    if(ptr == NULL)
+    {
+        return;
+    }
+    header = (fake_heap_header_t *)ptr - 1;
+    portENTER_CRITICAL(&fake_esp_lock);
+    fake_heap_used -= header->size;
+    portEXIT_CRITICAL(&fake_esp_lock);
+    free(header);
+}
+
+/**
+ * @brief  Free heap of one capability
+ */
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return esp_get_free_heap_size();
+}
+
+/**
+ * @brief  CRC-32 of the ROM, reflected with inverted input and output
+ */
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length)
+{
+    uint32_t i;
+    uint8_t bit;
+
+    crc = ~crc;
+    for(i = 0; i < length; i++)
+    {
+        crc ^= buffer[i];
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * @brief  Mount NVS, it starts empty
+ */
+esp_err_t nvs_flash_init(void)
+{
+    fake_nvs_ready = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Drop every key, NVS needs nvs_flash_init again
+ */
+esp_err_t nvs_flash_erase(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < FAKE_NVS_ENTRIES; i++)
+    {
+        free(fake_nvs[i].value);
+    }
+    memset(fake_nvs, 0, sizeof(fake_nvs));
+    memset(fake_nvs_namespaces, 0, sizeof(fake_nvs_namespaces));
+    fake_nvs_ready = false;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Open a namespace, ESP_ERR_NVS_NOT_INITIALIZED before nvs_flash_init
+ */
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    uint32_t i;
+
+    (void)mode;
+    if(!fake_nvs_ready)
+    {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    for(i = 0; i < FAKE_NVS_NAMESPACES; i++)
+    {
+        if(fake_nvs_namespaces[i][0] == 0)
+        {
+            strncpy(fake_nvs_namespaces[i], name, FAKE_NVS_NAME_SIZE - 1);
+        }
+        if(strncmp(fake_nvs_namespaces[i], name, FAKE_NVS_NAME_SIZE) == 0)
+        {
+            *handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief  Nothing to release
+ */
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+/**
+ * @brief  Read a blob, or its length when value is NULL
+ */
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    fake_nvs_entry_t *entry = fake_nvs_find(handle, key);
+
+    if(entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if(value == NULL)
+    {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if(*length < entry->length)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(value, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Write a blob
+ */
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    fake_nvs_entry_t *entry = fake_nvs_find(handle, key);
+    uint8_t *copy = malloc(length > 0 ? length : 1);
+    uint32_t i;
+
+    if(copy == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, length);
+
+    for(i = 0; entry == NULL && i < FAKE_NVS_ENTRIES; i++)
+    {
+        if(!fake_nvs[i].used)
+        {
+            entry = &fake_nvs[i];
+            entry->used = 1;
+            entry->ns = handle;
+            strncpy(entry->key, key, FAKE_NVS_NAME_SIZE - 1);
+        }
+    }
+    if(entry == NULL)
+    {
+        free(copy);
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+
+    free(entry->value);
+    entry->value = copy;
+    entry->length = length;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Read a 32 bit value
+ */
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value)
+{
+    size_t length = sizeof(*value);
+
+    return nvs_get_blob(handle, key, value, &length);
+}
+
+/**
+ * @brief  Write a 32 bit value
+ */
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+/**
+ * @brief  Remove a key
+ */
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    fake_nvs_entry_t *entry = fake_nvs_find(handle, key);
+
+    if(entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(entry->value);
+    memset(entry, 0, sizeof(*entry));
+    return ESP_OK;
+}
+
+/**
+ * @brief  Writes are immediate
+ */
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Find the first key of a namespace, every entry is reported as a
+ *         blob whatever type is asked for
+ * @retval Iterator, NULL when the namespace has no key
+ */
+nvs_iterator_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type)
+{
+    nvs_iterator_t iterator;
+    uint32_t i;
+
+    (void)part_name;
+    (void)type;
+    if(!fake_nvs_ready)
+    {
+        return NULL;
+    }
+    for(i = 0; i < FAKE_NVS_NAMESPACES; i++)
+    {
+        if(fake_nvs_namespaces[i][0] != 0 &&
+           strncmp(fake_nvs_namespaces[i], namespace_name, FAKE_NVS_NAME_SIZE) == 0)
+        {
+            break;
+        }
+    }
+    if(i == FAKE_NVS_NAMESPACES)
+    {
+        return NULL;
+    }
+
+    iterator = malloc(sizeof(*iterator));
+    if(iterator == NULL)
+    {
+        return NULL;
+    }
+    iterator->ns = i + 1;
+    return fake_nvs_seek(iterator, 0);
+}
+
+/**
+ * @brief  Move to the next key, NULL and released past the last one
+ */
+nvs_iterator_t nvs_entry_next(nvs_iterator_t iterator)
+{
+    return fake_nvs_seek(iterator, iterator->index + 1);
+}
+
+/**
+ * @brief  Get the key an iterator is on
+ */
+void nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    memset(out_info, 0, sizeof(*out_info));
+    strncpy(out_info->namespace_name, fake_nvs_namespaces[iterator->ns - 1], NVS_KEY_NAME_MAX_SIZE - 1);
+    strncpy(out_info->key, fake_nvs[iterator->index].key, NVS_KEY_NAME_MAX_SIZE - 1);
+    out_info->type = NVS_TYPE_BLOB;
+}
+
+/**
+ * @brief  Release an iterator, NULL is fine
+ */
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    free(iterator);
+}
+
+/**
+ * @brief  Erase whole sectors of a partition
+ */
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    uint8_t *data;
+
+    if(offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    data = fake_partition_map(partition, offset, size);
+    if(data == NULL)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(data, 0xFF, size);
+    return ESP_OK;
+}
+
+/**
+ * @brief  Program a partition, bits only go from 1 to 0 like on flash
+ */
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size)
+{
+    uint8_t *data = fake_partition_map(partition, offset, size);
+    const uint8_t *bytes = src;
+    size_t i;
+
+    if(data == NULL)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for(i = 0; i < size; i++)
+    {
+        data[i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  Read a partition
+ */
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    uint8_t *data = fake_partition_map(partition, offset, size);
+
+    if(data == NULL)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, data, size);
+    return ESP_OK;
+}
+
+/**
+ * @brief  The image runs from the partition it booted
+ */
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return fake_running;
+}
+
+/**
+ * @brief  The OTA slot after the running one
+ */
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start)
+{
+    if(start == NULL)
+    {
+        start = fake_running;
+    }
+    return start == &fake_partitions[1] ? &fake_partitions[2] : &fake_partitions[1];
+}
+
+/**
+ * @brief  Record the partition the next boot runs
+ */
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    if(partition != &fake_partitions[1] && partition != &fake_partitions[2])
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_boot = partition;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Get the partition set by esp_ota_set_boot_partition
+ */
+const esp_partition_t *fake_boot_partition(void)
+{
+    return fake_boot;
+}
+
+/**
+ * @brief  No controller to start
+ */
+esp_err_t esp_nimble_hci_and_controller_init(void)
+{
+    return ESP_OK;
+}
\ No newline at end of file
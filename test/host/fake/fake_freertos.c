@@ -0,0 +1,401 @@
+/*
+ *  fake_freertos.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "fake_freertos.h"
+#include "fake.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+struct fake_task
+{
+    pthread_t thread;
+    TaskFunction_t function;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notified;
+};
+
+struct fake_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static pthread_mutex_t fake_critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct fake_task *fake_current_task;
+
+/* The thread running main() is a task too, so it can take notifications */
+static struct fake_task fake_main_task = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void *fake_task_entry(void *arg);
+static void fake_deadline(struct timespec *deadline, TickType_t ticks);
+static bool fake_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline);
+static struct fake_task *fake_task_self(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Thread body of a task
+ */
+static void *fake_task_entry(void *arg)
+{
+    struct fake_task *task = arg;
+
+    fake_current_task = task;
+    task->function(task->arg);
+    return NULL;
+}
+
+/**
+ * @brief  Absolute time ticks from now
+ */
+static void fake_deadline(struct timespec *deadline, TickType_t ticks)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += ticks / 1000;
+    deadline->tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if(deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief  Wait on a condition for up to ticks, false once the time is up
+ */
+static bool fake_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline)
+{
+    if(ticks == 0)
+    {
+        return false;
+    }
+    if(ticks == portMAX_DELAY)
+    {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+/**
+ * @brief  Get the task of the calling thread
+ */
+static struct fake_task *fake_task_self(void)
+{
+    return fake_current_task != NULL ? fake_current_task : &fake_main_task;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Enter the process wide critical section
+ */
+void fake_critical_enter(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&fake_critical_lock);
+}
+
+/**
+ * @brief  Leave the process wide critical section
+ */
+void fake_critical_exit(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&fake_critical_lock);
+}
+
+/**
+ * @brief  Start a task on its own thread, the core is ignored
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id)
+{
+    struct fake_task *task = calloc(1, sizeof(*task));
+
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    (void)core_id;
+
+    if(task == NULL)
+    {
+        return pdFAIL;
+    }
+    task->function = function;
+    task->arg = arg;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->cond, NULL);
+
+    if(handle != NULL)
+    {
+        *handle = task;
+    }
+    if(pthread_create(&task->thread, NULL, fake_task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+/**
+ * @brief  Start a task on its own thread
+ */
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stack_size, arg, priority, handle, tskNO_AFFINITY);
+}
+
+/**
+ * @brief  End the calling task, other tasks are never deleted
+ */
+void vTaskDelete(TaskHandle_t task)
+{
+    if(task == NULL || task == fake_current_task)
+    {
+        pthread_exit(NULL);
+    }
+}
+
+/**
+ * @brief  Sleep for real, ticks are milliseconds
+ */
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec delay = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+
+    nanosleep(&delay, NULL);
+}
+
+/**
+ * @brief  Get milliseconds on the simulated clock
+ */
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(fake_time_us() / 1000);
+}
+
+/**
+ * @brief  Every task runs on core 0
+ */
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+/**
+ * @brief  Wait for notifications of the calling task
+ */
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct fake_task *task = fake_task_self();
+    struct timespec deadline;
+    uint32_t value;
+
+    fake_deadline(&deadline, ticks);
+    pthread_mutex_lock(&task->lock);
+    while(task->notified == 0 && fake_wait(&task->cond, &task->lock, ticks, &deadline))
+    {
+    }
+    value = task->notified;
+    if(value > 0)
+    {
+        task->notified = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+/**
+ * @brief  Notify a task
+ */
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notified++;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+/**
+ * @brief  Create a queue of fixed size items
+ */
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct fake_queue *queue = calloc(1, sizeof(*queue));
+
+    if(queue == NULL)
+    {
+        return NULL;
+    }
+    queue->items = calloc(length, item_size > 0 ? item_size : 1);
+    if(queue->items == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    return queue;
+}
+
+/**
+ * @brief  Free a queue nobody waits on
+ */
+void vQueueDelete(QueueHandle_t queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->cond);
+    free(queue->items);
+    free(queue);
+}
+
+/**
+ * @brief  Copy an item to the back of a queue
+ */
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    BaseType_t rc = pdFAIL;
+
+    fake_deadline(&deadline, ticks);
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == queue->length && fake_wait(&queue->cond, &queue->lock, ticks, &deadline))
+    {
+    }
+    if(queue->count < queue->length)
+    {
+        if(queue->item_size > 0)
+        {
+            memcpy(queue->items + ((queue->head + queue->count) % queue->length) * queue->item_size,
+                   item, queue->item_size);
+        }
+        queue->count++;
+        pthread_cond_broadcast(&queue->cond);
+        rc = pdPASS;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return rc;
+}
+
+/**
+ * @brief  Take the item at the front of a queue
+ */
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    BaseType_t rc = pdFALSE;
+
+    fake_deadline(&deadline, ticks);
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == 0 && fake_wait(&queue->cond, &queue->lock, ticks, &deadline))
+    {
+    }
+    if(queue->count > 0)
+    {
+        if(queue->item_size > 0)
+        {
+            memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->cond);
+        rc = pdTRUE;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return rc;
+}
+
+/**
+ * @brief  Get number of items in a queue
+ */
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count;
+
+    pthread_mutex_lock(&queue->lock);
+    count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+/**
+ * @brief  A mutex is a queue of one empty item, given once
+ */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+
+    if(semaphore != NULL)
+    {
+        semaphore->count = 1;
+    }
+    return semaphore;
+}
+
+/**
+ * @brief  Take a mutex
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    return xQueueReceive(semaphore, NULL, ticks);
+}
+
+/**
+ * @brief  Give a mutex back
+ */
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+
+/**
+ * @brief  Free a mutex
+ */
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    vQueueDelete(semaphore);
+}
\ No newline at end of file
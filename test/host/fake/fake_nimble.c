@@ -0,0 +1,2847 @@
+/*
+ *  fake_nimble.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fake.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define FAKE_MSYS_BLOCK_COUNT                         CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT
+#define FAKE_MSYS_BLOCK_SIZE                          (CONFIG_BT_NIMBLE_MSYS1_BLOCK_SIZE + sizeof(struct os_mbuf))
+#define FAKE_GATT_FIRST_HANDLE                        10      /* GAP and GATT services come first */
+#define FAKE_CONN_ITVL                                24      /* 30 ms */
+#define FAKE_CONN_TIMEOUT                             400     /* 4 s */
+#define FAKE_ATT_ERR_INSUFFICIENT_AUTHEN              0x05
+#define FAKE_ATT_ERR_INSUFFICIENT_ENC                 0x0F
+#define FAKE_SUBSCRIBE_REASON_WRITE                   1
+#define FAKE_COC_SDU_HEADER                           2       /* SDU length in the first K-frame */
+
+typedef struct
+{
+    bool used;
+    struct ble_gap_conn_desc desc;
+    ble_gap_event_fn *cb;
+    void *cb_arg;
+    uint16_t mtu;
+    struct os_mbuf *held[FAKE_LINK_HELD_MAX];
+    uint32_t held_head;
+    uint32_t held_count;
+    struct ble_npl_event terminate_event;
+    struct ble_npl_event update_event;
+    struct ble_gap_upd_params update;
+    int update_status;
+    uint8_t phy;
+    uint8_t phy_mask;                   /* Preferred by the host */
+    struct ble_npl_event phy_event;
+} fake_conn_t;
+
+typedef struct
+{
+    uint16_t val_handle;
+    const struct ble_gatt_chr_def *chr;
+} fake_gatt_chr_t;
+
+typedef enum
+{
+    FAKE_GATTC_MTU = 0,
+    FAKE_GATTC_DISC_SVC,
+    FAKE_GATTC_DISC_CHR,
+    FAKE_GATTC_DISC_DSC,
+    FAKE_GATTC_READ,
+    FAKE_GATTC_WRITE,
+} fake_gattc_op_t;
+
+typedef struct
+{
+    uint8_t op;                         /* fake_gattc_op_t */
+    uint16_t conn_handle;
+    uint16_t start_handle;              /* Attribute of a read or write */
+    uint16_t end_handle;
+    ble_uuid_any_t uuid;
+    union
+    {
+        ble_gatt_mtu_fn *mtu;
+        ble_gatt_disc_svc_fn *svc;
+        ble_gatt_chr_fn *chr;
+        ble_gatt_dsc_fn *dsc;
+        ble_gatt_attr_fn *attr;
+    } cb;
+    void *cb_arg;
+} fake_gattc_proc_t;
+
+typedef struct
+{
+    uint16_t length;
+    uint8_t data[FAKE_COC_SDU_MAX];
+} fake_coc_sdu_t;
+
+struct ble_l2cap_chan
+{
+    bool used;
+    uint16_t conn_handle;
+    uint16_t peer_mtu;                  /* Largest SDU the peer takes */
+    uint16_t peer_credits;              /* K-frames the peer can take */
+    struct os_mbuf *sdu_rx;             /* Armed by ble_l2cap_recv_ready() */
+    struct os_mbuf *sdu_tx;             /* Waiting for credits */
+    uint16_t sdu_tx_frames;             /* K-frames of sdu_tx not sent yet */
+    fake_coc_sdu_t echo[FAKE_COC_ECHO_MAX];
+    uint32_t echo_head;
+    uint32_t echo_count;
+    struct ble_npl_event echo_event;
+    struct ble_npl_event disconnect_event;
+};
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+struct ble_hs_cfg ble_hs_cfg;
+
+static portMUX_TYPE fake_nimble_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* msys, the pool ble_hs_mbuf_from_flat and notifications draw from */
+static os_membuf_t fake_msys_mem[OS_MEMPOOL_SIZE(FAKE_MSYS_BLOCK_COUNT, FAKE_MSYS_BLOCK_SIZE)];
+static struct os_mempool fake_msys_mempool;
+static struct os_mbuf_pool fake_msys_pool;
+static bool fake_msys_ready;
+
+/* Host task */
+static struct ble_npl_eventq fake_dflt_eventq;
+static struct ble_npl_callout *fake_callouts;
+
+/* GAP */
+static fake_conn_t fake_conns[FAKE_CONN_MAX];
+static uint16_t fake_next_conn_handle = 1;
+static ble_gap_event_fn *fake_adv_cb;
+static void *fake_adv_cb_arg;
+static bool fake_adv_running;
+static struct ble_npl_callout fake_adv_timer;
+static ble_gap_event_fn *fake_disc_cb;
+static void *fake_disc_cb_arg;
+static bool fake_disc_running;
+static ble_gap_event_fn *fake_connect_cb;
+static void *fake_connect_cb_arg;
+static ble_addr_t fake_connect_peer;
+static bool fake_connect_pending;
+static bool fake_connect_cancelled;
+static struct ble_npl_event fake_connect_event;
+static uint16_t fake_preferred_mtu = BLE_ATT_MTU_DFLT;
+static int fake_update_rc;
+static uint16_t fake_central_min_itvl;
+static int fake_data_len_rc;
+static uint8_t fake_central_phys = BLE_HCI_LE_PHY_1M_PREF_MASK | BLE_HCI_LE_PHY_2M_PREF_MASK;
+static fake_gap_stats_t fake_gap_stats;
+static char fake_device_name[32] = "nimble";
+static bool fake_store_initialized;
+static ble_addr_t fake_bonds[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
+static int fake_bond_count;
+
+/* GATT server */
+static fake_gatt_chr_t fake_gatt_chrs[FAKE_GATT_CHR_MAX];
+static uint32_t fake_gatt_chr_count;
+static uint16_t fake_gatt_next_handle = FAKE_GATT_FIRST_HANDLE;
+
+/* GATT client, answered by the peer database */
+static fake_gattc_proc_t fake_gattc_procs[FAKE_GATTC_PROCS_MAX];
+static uint32_t fake_gattc_head;
+static uint32_t fake_gattc_count;
+static struct ble_npl_event fake_gattc_event;
+static fake_peer_db_t fake_peer_db;
+static bool fake_peer_refusing;
+static bool fake_peer_holding;
+
+/* Controller */
+static fake_notify_hook_t fake_notify_hook;
+static void *fake_notify_hook_arg;
+static int fake_notify_fail_rc;
+static uint32_t fake_notify_fail_count;
+static bool fake_link_holding;
+
+/* L2CAP */
+static ble_l2cap_event_fn *fake_l2cap_cb;
+static void *fake_l2cap_cb_arg;
+static uint16_t fake_l2cap_mtu;
+static struct ble_l2cap_chan fake_coc_chans[FAKE_CONN_MAX];
+static fake_coc_hook_t fake_coc_hook;
+static void *fake_coc_hook_arg;
+static bool fake_coc_echoing;
+
+/* Port */
+static void (*fake_host_task)(void *arg);
+static volatile bool fake_port_stopped;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void fake_msys_init(void);
+static void *fake_mempool_get(struct os_mempool *mp);
+static void fake_mempool_put(struct os_mempool *mp, void *block);
+static void fake_callouts_fire(void);
+static struct ble_npl_event *fake_eventq_pop(struct ble_npl_eventq *evq);
+static struct os_mbuf *fake_mbuf_last(struct os_mbuf *om);
+static fake_conn_t *fake_conn_find(uint16_t conn_handle);
+static fake_conn_t *fake_conn_open(const ble_addr_t *peer, uint8_t role, ble_gap_event_fn *cb, void *cb_arg);
+static void fake_conn_close(fake_conn_t *conn, int reason);
+static int fake_gap_event(fake_conn_t *conn, struct ble_gap_event *event);
+static void fake_terminate(struct ble_npl_event *ev);
+static void fake_conn_updated(struct ble_npl_event *ev);
+static void fake_phy_updated(struct ble_npl_event *ev);
+static void fake_adv_timeout(struct ble_npl_event *ev);
+static void fake_bond_add(const ble_addr_t *peer);
+static void fake_central_connect(struct ble_npl_event *ev);
+static int fake_gattc_start(const fake_gattc_proc_t *proc);
+static void fake_gattc_answer(struct ble_npl_event *ev);
+static fake_gatt_chr_t *fake_gatt_chr(uint16_t attr_handle);
+static int fake_gatt_check_security(fake_conn_t *conn, const struct ble_gatt_chr_def *chr, bool write);
+static int fake_adv_put(uint8_t *dst, uint8_t *dst_len, uint8_t max_len, uint8_t type, const void *data,
+                        uint8_t length);
+static struct ble_l2cap_chan *fake_coc_find(uint16_t conn_handle);
+static int fake_coc_event(struct ble_l2cap_event *event);
+static uint16_t fake_coc_frames(uint16_t length);
+static void fake_coc_peer_rx(struct ble_l2cap_chan *chan, struct os_mbuf *sdu);
+static void fake_coc_echo(struct ble_npl_event *ev);
+static void fake_coc_disconnected(struct ble_npl_event *ev);
+static void fake_coc_close(struct ble_l2cap_chan *chan);
+
+/******************************************************************************/
+
+/**
+ * @brief  Carve msys on first use
+ */
+static void fake_msys_init(void)
+{
+    if(!fake_msys_ready)
+    {
+        os_mempool_init(&fake_msys_mempool, FAKE_MSYS_BLOCK_COUNT, FAKE_MSYS_BLOCK_SIZE, fake_msys_mem, "msys_1");
+        os_mbuf_pool_init(&fake_msys_pool, &fake_msys_mempool, FAKE_MSYS_BLOCK_SIZE, FAKE_MSYS_BLOCK_COUNT);
+        fake_msys_ready = true;
+    }
+}
+
+/**
+ * @brief  Take a block off the free list of a mempool
+ */
+static void *fake_mempool_get(struct os_mempool *mp)
+{
+    void **block;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    block = mp->mp_free_list;
+    if(block != NULL)
+    {
+        mp->mp_free_list = *block;
+        mp->mp_num_free--;
+        if(mp->mp_num_free < mp->mp_min_free)
+        {
+            mp->mp_min_free = mp->mp_num_free;
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return block;
+}
+
+/**
+ * @brief  Give a block back to its mempool
+ */
+static void fake_mempool_put(struct os_mempool *mp, void *block)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    *(void **)block = mp->mp_free_list;
+    mp->mp_free_list = block;
+    mp->mp_num_free++;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Queue the events of callouts that are due
+ */
+static void fake_callouts_fire(void)
+{
+    ble_npl_time_t now = ble_npl_time_get();
+    struct ble_npl_callout *co;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(co = fake_callouts; co != NULL; co = co->next)
+    {
+        if(co->active && (ble_npl_stime_t)(now - co->expiry) >= 0)
+        {
+            co->active = false;
+            ble_npl_eventq_put(co->evq, &co->ev);
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Take the first event of a queue
+ */
+static struct ble_npl_event *fake_eventq_pop(struct ble_npl_eventq *evq)
+{
+    struct ble_npl_event *ev;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    ev = evq->head;
+    if(ev != NULL)
+    {
+        evq->head = ev->next;
+        if(evq->head == NULL)
+        {
+            evq->tail = NULL;
+        }
+        ev->next = NULL;
+        ev->queued = false;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return ev;
+}
+
+/**
+ * @brief  Get the last mbuf of a chain
+ */
+static struct os_mbuf *fake_mbuf_last(struct os_mbuf *om)
+{
+    while(SLIST_NEXT(om, om_next) != NULL)
+    {
+        om = SLIST_NEXT(om, om_next);
+    }
+    return om;
+}
+
+/**
+ * @brief  Find an open connection
+ */
+static fake_conn_t *fake_conn_find(uint16_t conn_handle)
+{
+    uint32_t i;
+
+    for(i = 0; i < FAKE_CONN_MAX; i++)
+    {
+        if(fake_conns[i].used && fake_conns[i].desc.conn_handle == conn_handle)
+        {
+            return &fake_conns[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Open a connection with the link defaults of the controller
+ */
+static fake_conn_t *fake_conn_open(const ble_addr_t *peer, uint8_t role, ble_gap_event_fn *cb, void *cb_arg)
+{
+    fake_conn_t *conn = NULL;
+    uint32_t i;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(i = 0; i < FAKE_CONN_MAX && conn == NULL; i++)
+    {
+        if(!fake_conns[i].used)
+        {
+            conn = &fake_conns[i];
+        }
+    }
+    if(conn != NULL)
+    {
+        memset(conn, 0, sizeof(*conn));
+        conn->used = true;
+        conn->desc.conn_handle = fake_next_conn_handle++;
+        conn->desc.peer_id_addr = *peer;
+        conn->desc.peer_ota_addr = *peer;
+        conn->desc.conn_itvl = FAKE_CONN_ITVL;
+        conn->desc.supervision_timeout = FAKE_CONN_TIMEOUT;
+        conn->desc.role = role;
+        conn->cb = cb;
+        conn->cb_arg = cb_arg;
+        conn->mtu = BLE_ATT_MTU_DFLT;
+        conn->phy = BLE_HCI_LE_PHY_1M;
+        ble_npl_event_init(&conn->terminate_event, fake_terminate, conn);
+        ble_npl_event_init(&conn->update_event, fake_conn_updated, conn);
+        ble_npl_event_init(&conn->phy_event, fake_phy_updated, conn);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return conn;
+}
+
+/**
+ * @brief  Drop a connection, return what the controller held and tell the
+ *         application, like the host does once the link is gone
+ */
+static void fake_conn_close(fake_conn_t *conn, int reason)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_DISCONNECT };
+
+    event.disconnect.reason = reason;
+    event.disconnect.conn = conn->desc;
+
+    if(fake_coc_find(conn->desc.conn_handle) != NULL)
+    {
+        fake_coc_close(fake_coc_find(conn->desc.conn_handle));
+    }
+    fake_link_release(conn->desc.conn_handle, FAKE_LINK_HELD_MAX);
+    ble_npl_eventq_remove(&fake_dflt_eventq, &conn->terminate_event);
+    ble_npl_eventq_remove(&fake_dflt_eventq, &conn->update_event);
+    ble_npl_eventq_remove(&fake_dflt_eventq, &conn->phy_event);
+    portENTER_CRITICAL(&fake_nimble_lock);
+    conn->used = false;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+
+    if(conn->cb != NULL)
+    {
+        conn->cb(&event, conn->cb_arg);
+    }
+}
+
+/**
+ * @brief  Raise a GAP event on the callback of a connection
+ */
+static int fake_gap_event(fake_conn_t *conn, struct ble_gap_event *event)
+{
+    return conn->cb != NULL ? conn->cb(event, conn->cb_arg) : 0;
+}
+
+/**
+ * @brief  Local termination completes on the host task
+ */
+static void fake_terminate(struct ble_npl_event *ev)
+{
+    fake_conn_t *conn = ble_npl_event_get_arg(ev);
+
+    if(conn->used)
+    {
+        fake_conn_close(conn, BLE_HS_HCI_ERR(BLE_ERR_CONN_TERM_LOCAL));
+    }
+}
+
+/**
+ * @brief  The controller ends a timed advertisement like the host reports it
+ */
+static void fake_adv_timeout(struct ble_npl_event *ev)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_ADV_COMPLETE };
+
+    if(!fake_adv_running)
+    {
+        return;
+    }
+    fake_adv_running = false;
+    event.adv_complete.reason = BLE_HS_ETIMEOUT;
+    fake_adv_cb(&event, fake_adv_cb_arg);
+}
+
+/**
+ * @brief  Keep the bond of a peer, the oldest one makes room like
+ *         ble_store_util_status_rr does
+ */
+static void fake_bond_add(const ble_addr_t *peer)
+{
+    int i;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(i = 0; i < fake_bond_count && ble_addr_cmp(&fake_bonds[i], peer) != 0; i++);
+    if(i == fake_bond_count)
+    {
+        if(fake_bond_count == MYNEWT_VAL(BLE_STORE_MAX_BONDS))
+        {
+            memmove(&fake_bonds[0], &fake_bonds[1], (fake_bond_count - 1) * sizeof(ble_addr_t));
+            fake_bond_count--;
+        }
+        fake_bonds[fake_bond_count++] = *peer;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  A central connection completes on the host task, or ends
+ *         cancelled
+ */
+static void fake_central_connect(struct ble_npl_event *ev)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_CONNECT };
+    fake_conn_t *conn = NULL;
+
+    if(!fake_connect_pending)
+    {
+        return;
+    }
+    fake_connect_pending = false;
+    if(fake_connect_cancelled)
+    {
+        event.connect.status = BLE_HS_EAPP;
+    }
+    else
+    {
+        conn = fake_conn_open(&fake_connect_peer, BLE_GAP_ROLE_MASTER, fake_connect_cb, fake_connect_cb_arg);
+        event.connect.status = conn != NULL ? 0 : BLE_HS_ECONTROLLER;
+    }
+    event.connect.conn_handle = conn != NULL ? conn->desc.conn_handle : BLE_HS_CONN_HANDLE_NONE;
+    fake_connect_cb(&event, fake_connect_cb_arg);
+}
+
+/**
+ * @brief  Queue a client procedure, the peer answers it on the host task
+ */
+static int fake_gattc_start(const fake_gattc_proc_t *proc)
+{
+    int rc = 0;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    if(fake_conn_find(proc->conn_handle) == NULL)
+    {
+        rc = BLE_HS_ENOTCONN;
+    }
+    else if(fake_gattc_count == FAKE_GATTC_PROCS_MAX)
+    {
+        rc = BLE_HS_ENOMEM;
+    }
+    else
+    {
+        fake_gattc_procs[(fake_gattc_head + fake_gattc_count++) % FAKE_GATTC_PROCS_MAX] = *proc;
+        fake_gap_stats.gattc_procedures++;
+        fake_gap_stats.gattc_reads += (proc->op == FAKE_GATTC_READ);
+        fake_gap_stats.gattc_in_flight = fake_gattc_count;
+        if(fake_gattc_count > fake_gap_stats.gattc_in_flight_max)
+        {
+            fake_gap_stats.gattc_in_flight_max = fake_gattc_count;
+        }
+        if(!fake_peer_holding)
+        {
+            ble_npl_eventq_put(&fake_dflt_eventq, &fake_gattc_event);
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  The peer answers the oldest client procedure from its database,
+ *         one per event so other connections interleave. A procedure of a
+ *         connection gone ends with BLE_HS_ENOTCONN
+ */
+static void fake_gattc_answer(struct ble_npl_event *ev)
+{
+    struct ble_gatt_error error = { 0 };
+    struct ble_gatt_attr attr = { 0 };
+    struct ble_gatt_svc svc;
+    struct ble_gatt_chr chr;
+    struct ble_gatt_dsc dsc;
+    fake_gattc_proc_t proc;
+    fake_conn_t *conn;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    if(fake_gattc_count == 0 || fake_peer_holding)
+    {
+        portEXIT_CRITICAL(&fake_nimble_lock);
+        return;
+    }
+    proc = fake_gattc_procs[fake_gattc_head];
+    fake_gattc_head = (fake_gattc_head + 1) % FAKE_GATTC_PROCS_MAX;
+    fake_gap_stats.gattc_in_flight = --fake_gattc_count;
+    if(fake_gattc_count > 0)
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &fake_gattc_event);
+    }
+    conn = fake_conn_find(proc.conn_handle);
+    portEXIT_CRITICAL(&fake_nimble_lock);
+
+    error.status = conn != NULL ? 0 : BLE_HS_ENOTCONN;
+    switch(proc.op)
+    {
+    case FAKE_GATTC_MTU:
+        if(conn != NULL)
+        {
+            conn->mtu = fake_preferred_mtu;
+        }
+        proc.cb.mtu(proc.conn_handle, &error, conn != NULL ? conn->mtu : 0, proc.cb_arg);
+        break;
+
+    case FAKE_GATTC_DISC_SVC:
+        if(conn != NULL && fake_peer_db.service != NULL && ble_uuid_cmp(&proc.uuid.u, fake_peer_db.service) == 0)
+        {
+            svc.start_handle = fake_peer_db.start;
+            svc.end_handle = fake_peer_db.end;
+            ble_uuid_copy(&svc.uuid, fake_peer_db.service);
+            proc.cb.svc(proc.conn_handle, &error, &svc, proc.cb_arg);
+        }
+        error.status = conn != NULL ? BLE_HS_EDONE : error.status;
+        proc.cb.svc(proc.conn_handle, &error, NULL, proc.cb_arg);
+        break;
+
+    case FAKE_GATTC_DISC_CHR:
+        if(conn != NULL && fake_peer_db.characteristic != NULL &&
+           ble_uuid_cmp(&proc.uuid.u, fake_peer_db.characteristic) == 0 &&
+           fake_peer_db.value > proc.start_handle && fake_peer_db.value <= proc.end_handle)
+        {
+            chr.def_handle = fake_peer_db.value - 1;
+            chr.val_handle = fake_peer_db.value;
+            chr.properties = BLE_GATT_CHR_PROP_READ | BLE_GATT_CHR_PROP_NOTIFY;
+            ble_uuid_copy(&chr.uuid, fake_peer_db.characteristic);
+            proc.cb.chr(proc.conn_handle, &error, &chr, proc.cb_arg);
+        }
+        error.status = conn != NULL ? BLE_HS_EDONE : error.status;
+        proc.cb.chr(proc.conn_handle, &error, NULL, proc.cb_arg);
+        break;
+
+    case FAKE_GATTC_DISC_DSC:
+        if(conn != NULL && fake_peer_db.cccd > proc.start_handle && fake_peer_db.cccd <= proc.end_handle)
+        {
+            dsc.handle = fake_peer_db.cccd;
+            ble_uuid_copy(&dsc.uuid, BLE_UUID16_DECLARE(BLE_GATT_DSC_CLT_CFG_UUID16));
+            proc.cb.dsc(proc.conn_handle, &error, proc.start_handle, &dsc, proc.cb_arg);
+        }
+        error.status = conn != NULL ? BLE_HS_EDONE : error.status;
+        proc.cb.dsc(proc.conn_handle, &error, proc.start_handle, NULL, proc.cb_arg);
+        break;
+
+    case FAKE_GATTC_READ:
+        attr.handle = proc.start_handle;
+        if(conn != NULL && proc.start_handle != fake_peer_db.value)
+        {
+            error.status = BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE);
+            error.att_handle = proc.start_handle;
+        }
+        if(error.status == 0)
+        {
+            attr.om = ble_hs_mbuf_from_flat(conn->desc.peer_id_addr.val, sizeof(conn->desc.peer_id_addr.val));
+        }
+        proc.cb.attr(proc.conn_handle, &error, &attr, proc.cb_arg);
+        os_mbuf_free_chain(attr.om);
+        break;
+
+    default:
+        attr.handle = proc.start_handle;
+        if(conn != NULL && proc.start_handle != fake_peer_db.cccd)
+        {
+            error.status = BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE);
+            error.att_handle = proc.start_handle;
+        }
+        proc.cb.attr(proc.conn_handle, &error, &attr, proc.cb_arg);
+        break;
+    }
+}
+
+/**
+ * @brief  The central answers a parameter update one event later, it refuses
+ *         intervals below the one set by fake_gap_set_central_min_itvl()
+ */
+static void fake_conn_updated(struct ble_npl_event *ev)
+{
+    fake_conn_t *conn = ble_npl_event_get_arg(ev);
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_CONN_UPDATE };
+
+    if(!conn->used)
+    {
+        return;
+    }
+    if(conn->update_status == 0)
+    {
+        conn->desc.conn_itvl = conn->update.itvl_max;
+        conn->desc.conn_latency = conn->update.latency;
+        conn->desc.supervision_timeout = conn->update.supervision_timeout;
+    }
+    event.conn_update.status = conn->update_status;
+    event.conn_update.conn_handle = conn->desc.conn_handle;
+    fake_gap_event(conn, &event);
+}
+
+/**
+ * @brief  The controllers settle on the fastest PHY both prefer, the event
+ *         comes even when the PHY did not change
+ */
+static void fake_phy_updated(struct ble_npl_event *ev)
+{
+    fake_conn_t *conn = ble_npl_event_get_arg(ev);
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_PHY_UPDATE_COMPLETE };
+    uint8_t phy;
+
+    if(!conn->used)
+    {
+        return;
+    }
+    phy = (conn->phy_mask & fake_central_phys & BLE_HCI_LE_PHY_2M_PREF_MASK) ? BLE_HCI_LE_PHY_2M :
+                                                                                BLE_HCI_LE_PHY_1M;
+    conn->phy = phy;
+    event.phy_updated.status = 0;
+    event.phy_updated.conn_handle = conn->desc.conn_handle;
+    event.phy_updated.tx_phy = phy;
+    event.phy_updated.rx_phy = phy;
+    fake_gap_event(conn, &event);
+}
+
+/**
+ * @brief  Find a registered characteristic by value handle
+ */
+static fake_gatt_chr_t *fake_gatt_chr(uint16_t attr_handle)
+{
+    uint32_t i;
+
+    for(i = 0; i < fake_gatt_chr_count; i++)
+    {
+        if(fake_gatt_chrs[i].val_handle == attr_handle)
+        {
+            return &fake_gatt_chrs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Permission checks the host does before calling the access callback
+ * @retval 0 or the ATT error of the refused access
+ */
+static int fake_gatt_check_security(fake_conn_t *conn, const struct ble_gatt_chr_def *chr, bool write)
+{
+    ble_gatt_chr_flags enc = write ? BLE_GATT_CHR_F_WRITE_ENC : BLE_GATT_CHR_F_READ_ENC;
+    ble_gatt_chr_flags authen = write ? BLE_GATT_CHR_F_WRITE_AUTHEN : BLE_GATT_CHR_F_READ_AUTHEN;
+
+    if(!(chr->flags & (write ? (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP) : BLE_GATT_CHR_F_READ)))
+    {
+        return write ? BLE_ATT_ERR_WRITE_NOT_PERMITTED : BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+    if((chr->flags & (enc | authen)) && !conn->desc.sec_state.encrypted)
+    {
+        return FAKE_ATT_ERR_INSUFFICIENT_ENC;
+    }
+    if((chr->flags & authen) && !conn->desc.sec_state.authenticated)
+    {
+        return FAKE_ATT_ERR_INSUFFICIENT_AUTHEN;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Append one AD structure
+ */
+static int fake_adv_put(uint8_t *dst, uint8_t *dst_len, uint8_t max_len, uint8_t type, const void *data,
+                        uint8_t length)
+{
+    if(*dst_len + 2 + length > max_len)
+    {
+        return BLE_HS_EMSGSIZE;
+    }
+    dst[*dst_len] = length + 1;
+    dst[*dst_len + 1] = type;
+    memcpy(dst + *dst_len + 2, data, length);
+    *dst_len += 2 + length;
+    return 0;
+}
+
+/**
+ * @brief  Find the open channel of a connection
+ */
+static struct ble_l2cap_chan *fake_coc_find(uint16_t conn_handle)
+{
+    uint32_t i;
+
+    for(i = 0; i < FAKE_CONN_MAX; i++)
+    {
+        if(fake_coc_chans[i].used && fake_coc_chans[i].conn_handle == conn_handle)
+        {
+            return &fake_coc_chans[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Raise an L2CAP event on the server callback
+ */
+static int fake_coc_event(struct ble_l2cap_event *event)
+{
+    return fake_l2cap_cb != NULL ? fake_l2cap_cb(event, fake_l2cap_cb_arg) : 0;
+}
+
+/**
+ * @brief  Number of K-frames, and so of credits, an SDU takes
+ */
+static uint16_t fake_coc_frames(uint16_t length)
+{
+    return (length + FAKE_COC_SDU_HEADER + FAKE_COC_MPS - 1) / FAKE_COC_MPS;
+}
+
+/**
+ * @brief  The peer reassembled an SDU: hand it to the hook, queue the echo
+ *         and free it
+ */
+static void fake_coc_peer_rx(struct ble_l2cap_chan *chan, struct os_mbuf *sdu)
+{
+    fake_coc_sdu_t *echo = &chan->echo[(chan->echo_head + chan->echo_count) % FAKE_COC_ECHO_MAX];
+    uint8_t data[FAKE_COC_SDU_MAX];
+    uint16_t length = OS_MBUF_PKTLEN(sdu);
+
+    os_mbuf_copydata(sdu, 0, length, data);
+    os_mbuf_free_chain(sdu);
+    if(fake_coc_hook != NULL)
+    {
+        fake_coc_hook(chan->conn_handle, data, length, fake_coc_hook_arg);
+    }
+    if(fake_coc_echoing && chan->echo_count < FAKE_COC_ECHO_MAX)
+    {
+        echo->length = length;
+        memcpy(echo->data, data, length);
+        chan->echo_count++;
+        ble_npl_eventq_put(&fake_dflt_eventq, &chan->echo_event);
+    }
+}
+
+/**
+ * @brief  Loopback peer: send received SDUs back while we have a buffer
+ *         armed, then return the credits they took
+ */
+static void fake_coc_echo(struct ble_npl_event *ev)
+{
+    struct ble_l2cap_chan *chan = ble_npl_event_get_arg(ev);
+    fake_coc_sdu_t *echo;
+    uint16_t frames;
+
+    while(chan->used && chan->echo_count > 0)
+    {
+        echo = &chan->echo[chan->echo_head];
+        frames = fake_coc_frames(echo->length);
+        if(fake_coc_send(chan->conn_handle, echo->data, echo->length) != 0)
+        {
+            return;
+        }
+        chan->echo_head = (chan->echo_head + 1) % FAKE_COC_ECHO_MAX;
+        chan->echo_count--;
+        fake_coc_credits(chan->conn_handle, frames);
+    }
+}
+
+/**
+ * @brief  Local disconnection completes on the host task
+ */
+static void fake_coc_disconnected(struct ble_npl_event *ev)
+{
+    struct ble_l2cap_chan *chan = ble_npl_event_get_arg(ev);
+
+    if(chan->used)
+    {
+        fake_coc_close(chan);
+    }
+}
+
+/**
+ * @brief  Close a channel, the buffers the stack holds go back to their pools
+ */
+static void fake_coc_close(struct ble_l2cap_chan *chan)
+{
+    struct ble_l2cap_event event = { .type = BLE_L2CAP_EVENT_COC_DISCONNECTED };
+
+    ble_npl_eventq_remove(&fake_dflt_eventq, &chan->echo_event);
+    ble_npl_eventq_remove(&fake_dflt_eventq, &chan->disconnect_event);
+    os_mbuf_free_chain(chan->sdu_rx);
+    os_mbuf_free_chain(chan->sdu_tx);
+    chan->sdu_rx = NULL;
+    chan->sdu_tx = NULL;
+    chan->used = false;
+
+    event.disconnect.conn_handle = chan->conn_handle;
+    event.disconnect.chan = chan;
+    fake_coc_event(&event);
+}
+
+
+/******************************************************************************/
+
+/**
+ * @brief  Chain the blocks of a memory area into a free list
+ */
+int os_mempool_init(struct os_mempool *mp, uint16_t blocks, uint32_t block_size, void *membuf, const char *name)
+{
+    uint32_t i;
+
+    if(mp == NULL || membuf == NULL || blocks == 0)
+    {
+        return OS_EINVAL;
+    }
+    mp->mp_block_size = OS_ALIGN(block_size, OS_ALIGNMENT);
+    mp->mp_num_blocks = blocks;
+    mp->mp_num_free = blocks;
+    mp->mp_min_free = blocks;
+    mp->mp_membuf_addr = membuf;
+    mp->mp_free_list = NULL;
+    mp->name = name;
+    for(i = blocks; i > 0; i--)
+    {
+        void **block = (void **)(mp->mp_membuf_addr + (i - 1) * mp->mp_block_size);
+
+        *block = mp->mp_free_list;
+        mp->mp_free_list = block;
+    }
+    return OS_OK;
+}
+
+/**
+ * @brief  Serve mbufs out of a mempool, buf_len includes the mbuf header
+ */
+int os_mbuf_pool_init(struct os_mbuf_pool *omp, struct os_mempool *mp, uint16_t buf_len, uint16_t nbufs)
+{
+    if(omp == NULL || mp == NULL || buf_len <= sizeof(struct os_mbuf) || nbufs > mp->mp_num_blocks)
+    {
+        return OS_EINVAL;
+    }
+    omp->omp_databuf_len = buf_len - sizeof(struct os_mbuf);
+    omp->omp_pool = mp;
+    return OS_OK;
+}
+
+/**
+ * @brief  Get a plain mbuf
+ */
+struct os_mbuf *os_mbuf_get(struct os_mbuf_pool *omp, uint16_t leadingspace)
+{
+    struct os_mbuf *om;
+
+    if(leadingspace > omp->omp_databuf_len)
+    {
+        return NULL;
+    }
+    om = fake_mempool_get(omp->omp_pool);
+    if(om != NULL)
+    {
+        om->om_flags = 0;
+        om->om_pkthdr_len = 0;
+        om->om_len = 0;
+        om->om_omp = omp;
+        SLIST_NEXT(om, om_next) = NULL;
+        om->om_data = om->om_databuf + leadingspace;
+    }
+    return om;
+}
+
+/**
+ * @brief  Get the first mbuf of a packet
+ */
+struct os_mbuf *os_mbuf_get_pkthdr(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len)
+{
+    uint16_t pkthdr_len = sizeof(struct os_mbuf_pkthdr) + user_pkthdr_len;
+    struct os_mbuf *om;
+
+    om = os_mbuf_get(omp, pkthdr_len);
+    if(om != NULL)
+    {
+        om->om_pkthdr_len = pkthdr_len;
+        OS_MBUF_PKTHDR(om)->omp_len = 0;
+        OS_MBUF_PKTHDR(om)->omp_flags = 0;
+    }
+    return om;
+}
+
+/**
+ * @brief  Get the first mbuf of a packet from msys
+ */
+struct os_mbuf *os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len)
+{
+    (void)dsize;
+    fake_msys_init();
+    return os_mbuf_get_pkthdr(&fake_msys_pool, user_hdr_len);
+}
+
+/**
+ * @brief  Number of free msys blocks
+ */
+int os_msys_num_free(void)
+{
+    fake_msys_init();
+    return fake_msys_mempool.mp_num_free;
+}
+
+/**
+ * @brief  Free every mbuf of a chain
+ */
+int os_mbuf_free_chain(struct os_mbuf *om)
+{
+    struct os_mbuf *next;
+
+    while(om != NULL)
+    {
+        next = SLIST_NEXT(om, om_next);
+        fake_mempool_put(om->om_omp->omp_pool, om);
+        om = next;
+    }
+    return OS_OK;
+}
+
+/**
+ * @brief  Append data to a chain, growing it from the pool of its first mbuf
+ */
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len)
+{
+    const uint8_t *src = data;
+    struct os_mbuf *last;
+    struct os_mbuf *next;
+    uint16_t space;
+
+    if(om == NULL)
+    {
+        return OS_EINVAL;
+    }
+    last = fake_mbuf_last(om);
+    while(len > 0)
+    {
+        space = OS_MBUF_TRAILINGSPACE(last);
+        if(space == 0)
+        {
+            next = os_mbuf_get(om->om_omp, 0);
+            if(next == NULL)
+            {
+                return OS_ENOMEM;
+            }
+            SLIST_NEXT(last, om_next) = next;
+            last = next;
+            continue;
+        }
+        if(space > len)
+        {
+            space = len;
+        }
+        memcpy(last->om_data + last->om_len, src, space);
+        last->om_len += space;
+        if(OS_MBUF_IS_PKTHDR(om))
+        {
+            OS_MBUF_PKTLEN(om) += space;
+        }
+        src += space;
+        len -= space;
+    }
+    return OS_OK;
+}
+
+/**
+ * @brief  Copy out of a chain
+ * @retval 0 or -1 if the chain is shorter than off + len
+ */
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst)
+{
+    uint8_t *out = dst;
+    int count;
+
+    while(om != NULL && off >= om->om_len)
+    {
+        off -= om->om_len;
+        om = SLIST_NEXT(om, om_next);
+    }
+    while(len > 0 && om != NULL)
+    {
+        count = om->om_len - off < len ? om->om_len - off : len;
+        memcpy(out, om->om_data + off, count);
+        out += count;
+        len -= count;
+        off = 0;
+        om = SLIST_NEXT(om, om_next);
+    }
+    return len > 0 ? -1 : 0;
+}
+
+/**
+ * @brief  Trim a chain, from the head when req_len is positive, from the tail otherwise
+ */
+void os_mbuf_adj(struct os_mbuf *om, int req_len)
+{
+    struct os_mbuf *head = om;
+    struct os_mbuf *m;
+    int len = req_len < 0 ? -req_len : req_len;
+    int total = 0;
+    int keep;
+
+    if(om == NULL)
+    {
+        return;
+    }
+    if(req_len >= 0)
+    {
+        for(m = om; m != NULL && len > 0; m = SLIST_NEXT(m, om_next))
+        {
+            keep = m->om_len < len ? m->om_len : len;
+            m->om_data += keep;
+            m->om_len -= keep;
+            len -= keep;
+        }
+        if(OS_MBUF_IS_PKTHDR(head))
+        {
+            OS_MBUF_PKTLEN(head) -= req_len - len;
+        }
+        return;
+    }
+
+    for(m = om; m != NULL; m = SLIST_NEXT(m, om_next))
+    {
+        total += m->om_len;
+    }
+    keep = total > len ? total - len : 0;
+    if(OS_MBUF_IS_PKTHDR(head))
+    {
+        OS_MBUF_PKTLEN(head) = keep;
+    }
+    for(m = om; m != NULL; m = SLIST_NEXT(m, om_next))
+    {
+        if(m->om_len >= keep)
+        {
+            m->om_len = keep;
+            keep = 0;
+        }
+        else
+        {
+            keep -= m->om_len;
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Init an event
+ */
+void ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn, void *arg)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->fn = fn;
+    ev->arg = arg;
+}
+
+/**
+ * @brief  Get the argument of an event
+ */
+void *ble_npl_event_get_arg(struct ble_npl_event *ev)
+{
+    return ev->arg;
+}
+
+/**
+ * @brief  Check if an event waits in a queue
+ */
+bool ble_npl_event_is_queued(struct ble_npl_event *ev)
+{
+    return ev->queued;
+}
+
+/**
+ * @brief  Queue an event, an event already queued stays where it is
+ */
+void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    if(!ev->queued)
+    {
+        ev->queued = true;
+        ev->next = NULL;
+        if(evq->tail != NULL)
+        {
+            evq->tail->next = ev;
+        }
+        else
+        {
+            evq->head = ev;
+        }
+        evq->tail = ev;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Take an event out of a queue
+ */
+void ble_npl_eventq_remove(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+{
+    struct ble_npl_event **link;
+    struct ble_npl_event *prev = NULL;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(link = &evq->head; ev->queued && *link != NULL; prev = *link, link = &(*link)->next)
+    {
+        if(*link == ev)
+        {
+            *link = ev->next;
+            if(evq->tail == ev)
+            {
+                evq->tail = prev;
+            }
+            ev->next = NULL;
+            ev->queued = false;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Init a callout posting to evq
+ */
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg)
+{
+    struct ble_npl_callout *it;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    memset(co, 0, sizeof(*co));
+    ble_npl_event_init(&co->ev, fn, arg);
+    co->evq = evq;
+    for(it = fake_callouts; it != NULL && it != co; it = it->next)
+    {
+    }
+    if(it == NULL)
+    {
+        co->next = fake_callouts;
+        fake_callouts = co;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Arm a callout, ticks are milliseconds
+ */
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    co->expiry = ble_npl_time_get() + ticks;
+    co->active = true;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return 0;
+}
+
+/**
+ * @brief  Disarm a callout and drop its pending event
+ */
+void ble_npl_callout_stop(struct ble_npl_callout *co)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    co->active = false;
+    if(co->evq != NULL)
+    {
+        ble_npl_eventq_remove(co->evq, &co->ev);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Check if a callout is armed
+ */
+bool ble_npl_callout_is_active(struct ble_npl_callout *co)
+{
+    return co->active;
+}
+
+/**
+ * @brief  Ticks since boot, one tick per millisecond
+ */
+ble_npl_time_t ble_npl_time_get(void)
+{
+    return (ble_npl_time_t)(fake_time_us() / 1000);
+}
+
+/**
+ * @brief  Milliseconds to ticks
+ */
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms)
+{
+    return ms;
+}
+
+/**
+ * @brief  Ticks to milliseconds
+ */
+uint32_t ble_npl_time_ticks_to_ms32(ble_npl_time_t ticks)
+{
+    return ticks;
+}
+
+/**
+ * @brief  Queue of the host task
+ */
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void)
+{
+    return &fake_dflt_eventq;
+}
+
+/**
+ * @brief  Init the port
+ */
+void nimble_port_init(void)
+{
+    fake_msys_init();
+    ble_npl_callout_init(&fake_adv_timer, &fake_dflt_eventq, fake_adv_timeout, NULL);
+    ble_npl_event_init(&fake_connect_event, fake_central_connect, NULL);
+    ble_npl_event_init(&fake_gattc_event, fake_gattc_answer, NULL);
+    fake_port_stopped = false;
+}
+
+/**
+ * @brief  Run the host task until nimble_port_stop()
+ */
+void nimble_port_run(void)
+{
+    while(!fake_port_stopped)
+    {
+        if(fake_run() == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+}
+
+/**
+ * @brief  Stop nimble_port_run()
+ */
+int nimble_port_stop(void)
+{
+    fake_port_stopped = true;
+    return 0;
+}
+
+/**
+ * @brief  The host task is the thread calling fake_run(), nothing is spawned
+ */
+void nimble_port_freertos_init(void (*host_task)(void *arg))
+{
+    fake_host_task = host_task;
+}
+
+/**
+ * @brief  Nothing to tear down
+ */
+void nimble_port_freertos_deinit(void)
+{
+    fake_host_task = NULL;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  The fake controller has a public address
+ */
+int ble_hs_util_ensure_addr(int prefer_random)
+{
+    (void)prefer_random;
+    return 0;
+}
+
+/**
+ * @brief  Use the public address
+ */
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type)
+{
+    (void)privacy;
+    *out_addr_type = BLE_OWN_ADDR_PUBLIC;
+    return 0;
+}
+
+/**
+ * @brief  Copy the identity address of the fake controller
+ */
+int ble_hs_id_copy_addr(uint8_t id_addr_type, uint8_t *out_id_addr, int *out_is_nrpa)
+{
+    static const uint8_t addr[6] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0xC0 };
+
+    (void)id_addr_type;
+    if(out_id_addr != NULL)
+    {
+        memcpy(out_id_addr, addr, sizeof(addr));
+    }
+    if(out_is_nrpa != NULL)
+    {
+        *out_is_nrpa = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Copy a flat buffer into an msys chain
+ */
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    struct os_mbuf *om = os_msys_get_pkthdr(len, 0);
+
+    if(om != NULL && os_mbuf_append(om, buf, len) != 0)
+    {
+        os_mbuf_free_chain(om);
+        om = NULL;
+    }
+    return om;
+}
+
+/**
+ * @brief  Copy a chain into a flat buffer
+ */
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len, uint16_t *out_copy_len)
+{
+    uint16_t length = OS_MBUF_PKTLEN(om) < max_len ? OS_MBUF_PKTLEN(om) : max_len;
+
+    os_mbuf_copydata(om, 0, length, flat);
+    if(out_copy_len != NULL)
+    {
+        *out_copy_len = length;
+    }
+    return length < OS_MBUF_PKTLEN(om) ? BLE_HS_EMSGSIZE : 0;
+}
+
+/**
+ * @brief  Count data length requests
+ */
+int ble_hs_hci_util_set_data_len(uint16_t conn_handle, uint16_t tx_octets, uint16_t tx_time)
+{
+    (void)tx_octets;
+    (void)tx_time;
+    fake_gap_stats.data_len_requests++;
+    return fake_conn_find(conn_handle) != NULL ? fake_data_len_rc : BLE_HS_ENOTCONN;
+}
+
+/**
+ * @brief  Random bytes
+ */
+int ble_hs_hci_util_rand(void *dst, int len)
+{
+    uint8_t *out = dst;
+
+    while(len-- > 0)
+    {
+        *out++ = (uint8_t)esp_random();
+    }
+    return 0;
+}
+
+/**
+ * @brief  Compare two addresses
+ */
+int ble_addr_cmp(const ble_addr_t *a, const ble_addr_t *b)
+{
+    if(a->type != b->type)
+    {
+        return (int)a->type - (int)b->type;
+    }
+    return memcmp(a->val, b->val, sizeof(a->val));
+}
+
+/**
+ * @brief  Compare two UUIDs
+ */
+int ble_uuid_cmp(const ble_uuid_t *uuid1, const ble_uuid_t *uuid2)
+{
+    if(uuid1->type != uuid2->type)
+    {
+        return (int)uuid1->type - (int)uuid2->type;
+    }
+    if(uuid1->type == BLE_UUID_TYPE_16)
+    {
+        return (int)((const ble_uuid16_t *)uuid1)->value - (int)((const ble_uuid16_t *)uuid2)->value;
+    }
+    return memcmp(((const ble_uuid128_t *)uuid1)->value, ((const ble_uuid128_t *)uuid2)->value, 16);
+}
+
+/**
+ * @brief  Copy a UUID
+ */
+void ble_uuid_copy(ble_uuid_any_t *dst, const ble_uuid_t *src)
+{
+    if(src->type == BLE_UUID_TYPE_16)
+    {
+        dst->u16 = *(const ble_uuid16_t *)src;
+    }
+    else
+    {
+        dst->u128 = *(const ble_uuid128_t *)src;
+    }
+}
+
+/**
+ * @brief  Set the MTU offered in exchanges
+ */
+int ble_att_set_preferred_mtu(uint16_t mtu)
+{
+    if(mtu < BLE_ATT_MTU_DFLT || mtu > BLE_ATT_MTU_MAX)
+    {
+        return BLE_HS_EINVAL;
+    }
+    fake_preferred_mtu = mtu;
+    return 0;
+}
+
+/**
+ * @brief  Get the MTU of a connection, 0 if there is none
+ */
+uint16_t ble_att_mtu(uint16_t conn_handle)
+{
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    return conn != NULL ? conn->mtu : 0;
+}
+
+/**
+ * @brief  Passkeys are accepted as is
+ */
+int ble_sm_inject_io(uint16_t conn_handle, struct ble_sm_io *pkey)
+{
+    (void)pkey;
+    return fake_conn_find(conn_handle) != NULL ? 0 : BLE_HS_ENOTCONN;
+}
+
+/**
+ * @brief  Random OOB data, after the time the key pair takes
+ */
+int ble_sm_sc_oob_generate_data(struct ble_sm_sc_oob_data *oob_data)
+{
+    vTaskDelay(pdMS_TO_TICKS(FAKE_KEYGEN_MS));
+    return ble_hs_hci_util_rand(oob_data, sizeof(*oob_data));
+}
+
+/**
+ * @brief  Nothing to overwrite
+ */
+int ble_store_util_status_rr(struct ble_store_status_event *event, void *arg)
+{
+    (void)event;
+    (void)arg;
+    return 0;
+}
+
+/**
+ * @brief  Peers bonded through fake_encrypt(), oldest first
+ */
+int ble_store_util_bonded_peers(ble_addr_t *out_peer_id_addrs, int *out_num_peers, int max_peers)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    *out_num_peers = fake_bond_count < max_peers ? fake_bond_count : max_peers;
+    memcpy(out_peer_id_addrs, fake_bonds, *out_num_peers * sizeof(ble_addr_t));
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return 0;
+}
+
+/**
+ * @brief  Mark the store ready, pairings from here on can persist their keys
+ */
+void ble_store_config_init(void)
+{
+    fake_store_initialized = true;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Start advertising, fake_connect() connects through cb. A finite
+ *         duration ends in BLE_GAP_EVENT_ADV_COMPLETE once the clock passed it
+ */
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *adv_params, ble_gap_event_fn *cb, void *cb_arg)
+{
+    (void)own_addr_type;
+    (void)direct_addr;
+    (void)adv_params;
+
+    if(fake_adv_running)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_adv_cb = cb;
+    fake_adv_cb_arg = cb_arg;
+    fake_adv_running = true;
+    fake_gap_stats.adv_starts++;
+    if(duration_ms != BLE_HS_FOREVER)
+    {
+        ble_npl_callout_reset(&fake_adv_timer, duration_ms);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Stop advertising
+ */
+int ble_gap_adv_stop(void)
+{
+    if(!fake_adv_running)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_adv_running = false;
+    ble_npl_callout_stop(&fake_adv_timer);
+    return 0;
+}
+
+/**
+ * @brief  Check if advertising
+ */
+int ble_gap_adv_active(void)
+{
+    return fake_adv_running;
+}
+
+/**
+ * @brief  Set raw advertising data
+ */
+int ble_gap_adv_set_data(const uint8_t *data, int data_len)
+{
+    (void)data;
+    fake_gap_stats.adv_data_sets++;
+    return data_len > BLE_HS_ADV_MAX_SZ ? BLE_HS_EMSGSIZE : 0;
+}
+
+/**
+ * @brief  Set raw scan response data
+ */
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int data_len)
+{
+    (void)data;
+    fake_gap_stats.adv_data_sets++;
+    return data_len > BLE_HS_ADV_MAX_SZ ? BLE_HS_EMSGSIZE : 0;
+}
+
+/**
+ * @brief  Set advertising data from fields
+ */
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *adv_fields)
+{
+    uint8_t data[BLE_HS_ADV_MAX_SZ];
+    uint8_t length = 0;
+
+    return ble_hs_adv_set_fields(adv_fields, data, &length, sizeof(data));
+}
+
+/**
+ * @brief  Set scan response data from fields
+ */
+int ble_gap_adv_rsp_set_fields(const struct ble_hs_adv_fields *rsp_fields)
+{
+    return ble_gap_adv_set_fields(rsp_fields);
+}
+
+/**
+ * @brief  Encode advertising fields as AD structures
+ */
+int ble_hs_adv_set_fields(const struct ble_hs_adv_fields *adv_fields, uint8_t *dst, uint8_t *dst_len,
+                          uint8_t max_len)
+{
+    uint8_t buffer[BLE_HS_ADV_MAX_SZ];
+    uint8_t length = 0;
+    int8_t tx_power;
+    uint32_t i;
+    int rc = 0;
+
+    *dst_len = 0;
+    if(adv_fields->flags != 0)
+    {
+        rc = fake_adv_put(dst, dst_len, max_len, 0x01, &adv_fields->flags, 1);
+    }
+    if(rc == 0 && adv_fields->num_uuids16 > 0)
+    {
+        for(i = 0; i < adv_fields->num_uuids16 && length + 2 <= sizeof(buffer); i++)
+        {
+            buffer[length++] = adv_fields->uuids16[i].value & 0xFF;
+            buffer[length++] = adv_fields->uuids16[i].value >> 8;
+        }
+        rc = fake_adv_put(dst, dst_len, max_len, adv_fields->uuids16_is_complete ? 0x03 : 0x02, buffer, length);
+    }
+    if(rc == 0 && adv_fields->num_uuids128 > 0)
+    {
+        rc = fake_adv_put(dst, dst_len, max_len, adv_fields->uuids128_is_complete ? 0x07 : 0x06,
+                          adv_fields->uuids128[0].value, 16 * adv_fields->num_uuids128);
+    }
+    if(rc == 0 && adv_fields->name != NULL)
+    {
+        rc = fake_adv_put(dst, dst_len, max_len, adv_fields->name_is_complete ? 0x09 : 0x08, adv_fields->name,
+                          adv_fields->name_len);
+    }
+    if(rc == 0 && adv_fields->tx_pwr_lvl_is_present)
+    {
+        tx_power = adv_fields->tx_pwr_lvl == BLE_HS_ADV_TX_PWR_LVL_AUTO ? 0 : adv_fields->tx_pwr_lvl;
+        rc = fake_adv_put(dst, dst_len, max_len, 0x0A, &tx_power, 1);
+    }
+    if(rc == 0 && adv_fields->svc_data_uuid16 != NULL)
+    {
+        rc = fake_adv_put(dst, dst_len, max_len, 0x16, adv_fields->svc_data_uuid16,
+                          adv_fields->svc_data_uuid16_len);
+    }
+    if(rc == 0 && adv_fields->mfg_data != NULL)
+    {
+        rc = fake_adv_put(dst, dst_len, max_len, 0xFF, adv_fields->mfg_data, adv_fields->mfg_data_len);
+    }
+    return rc;
+}
+
+/**
+ * @brief  Find a connection
+ */
+int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc *out_desc)
+{
+    fake_conn_t *conn;
+    int rc = BLE_HS_ENOTCONN;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    conn = fake_conn_find(handle);
+    if(conn != NULL)
+    {
+        if(out_desc != NULL)
+        {
+            *out_desc = conn->desc;
+        }
+        rc = 0;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  Find a connection by peer identity address
+ */
+int ble_gap_conn_find_by_addr(const ble_addr_t *addr, struct ble_gap_conn_desc *out_desc)
+{
+    uint32_t i;
+    int rc = BLE_HS_ENOTCONN;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(i = 0; i < FAKE_CONN_MAX && rc != 0; i++)
+    {
+        if(fake_conns[i].used && ble_addr_cmp(&fake_conns[i].desc.peer_id_addr, addr) == 0)
+        {
+            if(out_desc != NULL)
+            {
+                *out_desc = fake_conns[i].desc;
+            }
+            rc = 0;
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  Check if a central connection is being established
+ */
+int ble_gap_conn_active(void)
+{
+    return fake_connect_pending;
+}
+
+/**
+ * @brief  Request new connection parameters, the central applies them one event later
+ */
+int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params *params)
+{
+    fake_conn_t *conn;
+    int rc;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_gap_stats.update_requests++;
+    fake_gap_stats.last_update = *params;
+    conn = fake_conn_find(conn_handle);
+    rc = conn == NULL ? BLE_HS_ENOTCONN : fake_update_rc;
+    if(rc == 0)
+    {
+        conn->update = *params;
+        conn->update_status = params->itvl_max < fake_central_min_itvl ?
+                              BLE_HS_HCI_ERR(BLE_ERR_UNSUPP_LMP_LL_PARM) : 0;
+        ble_npl_eventq_put(&fake_dflt_eventq, &conn->update_event);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  Set the preferred PHYs, PHY_UPDATE_COMPLETE follows
+ */
+int ble_gap_set_prefered_le_phy(uint16_t conn_handle, uint8_t tx_phys_mask, uint8_t rx_phys_mask,
+                                uint16_t phy_opts)
+{
+    fake_conn_t *conn;
+
+    (void)rx_phys_mask;
+    (void)phy_opts;
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_gap_stats.phy_requests++;
+    conn = fake_conn_find(conn_handle);
+    if(conn != NULL)
+    {
+        conn->phy_mask = tx_phys_mask;
+        ble_npl_eventq_put(&fake_dflt_eventq, &conn->phy_event);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return conn != NULL ? 0 : BLE_HS_ENOTCONN;
+}
+
+/**
+ * @brief  Accept any white list
+ */
+int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count)
+{
+    (void)addrs;
+    (void)white_list_count;
+    return 0;
+}
+
+/**
+ * @brief  Delete the bond of a peer, a connection to it stays up
+ */
+int ble_gap_unpair(const ble_addr_t *peer_addr)
+{
+    int i;
+    int rc = BLE_HS_ENOENT;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    for(i = 0; i < fake_bond_count; i++)
+    {
+        if(ble_addr_cmp(&fake_bonds[i], peer_addr) == 0)
+        {
+            memmove(&fake_bonds[i], &fake_bonds[i + 1], (fake_bond_count - i - 1) * sizeof(ble_addr_t));
+            fake_bond_count--;
+            rc = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  Terminate a connection, DISCONNECT follows on the host task
+ */
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason)
+{
+    fake_conn_t *conn;
+    int rc = 0;
+
+    (void)hci_reason;
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_gap_stats.terminations++;
+    conn = fake_conn_find(conn_handle);
+    if(conn == NULL)
+    {
+        rc = BLE_HS_ENOTCONN;
+    }
+    else if(ble_npl_event_is_queued(&conn->terminate_event))
+    {
+        rc = BLE_HS_EALREADY;
+    }
+    else
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &conn->terminate_event);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return rc;
+}
+
+/**
+ * @brief  Count security requests, fake_encrypt() completes them
+ */
+int ble_gap_security_initiate(uint16_t conn_handle)
+{
+    fake_gap_stats.security_requests++;
+    return fake_conn_find(conn_handle) != NULL ? 0 : BLE_HS_ENOTCONN;
+}
+
+/**
+ * @brief  Start scanning, fake_disc_report() delivers reports through cb
+ */
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg)
+{
+    (void)own_addr_type;
+    (void)duration_ms;
+    (void)disc_params;
+
+    if(fake_disc_running)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_disc_cb = cb;
+    fake_disc_cb_arg = cb_arg;
+    fake_disc_running = true;
+    return 0;
+}
+
+/**
+ * @brief  Stop scanning
+ */
+int ble_gap_disc_cancel(void)
+{
+    if(!fake_disc_running)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_disc_running = false;
+    return 0;
+}
+
+/**
+ * @brief  Check if scanning
+ */
+int ble_gap_disc_active(void)
+{
+    return fake_disc_running;
+}
+
+/**
+ * @brief  Start a central connection, the peer accepts on the host task
+ *         unless fake_peer_accept(false), then it waits for a cancel
+ */
+int ble_gap_connect(uint8_t own_addr_type, const ble_addr_t *peer_addr, int32_t duration_ms,
+                    const struct ble_gap_conn_params *params, ble_gap_event_fn *cb, void *cb_arg)
+{
+    (void)own_addr_type;
+    (void)duration_ms;
+    (void)params;
+
+    if(fake_connect_pending)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_connect_peer = *peer_addr;
+    fake_connect_cb = cb;
+    fake_connect_cb_arg = cb_arg;
+    fake_connect_pending = true;
+    fake_connect_cancelled = false;
+    fake_gap_stats.central_connects++;
+    if(!fake_peer_refusing)
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &fake_connect_event);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Cancel a central connection, it ends with status BLE_HS_EAPP
+ */
+int ble_gap_conn_cancel(void)
+{
+    if(!fake_connect_pending || fake_connect_cancelled)
+    {
+        return BLE_HS_EALREADY;
+    }
+    fake_connect_cancelled = true;
+    ble_npl_eventq_put(&fake_dflt_eventq, &fake_connect_event);
+    return 0;
+}
+
+/**
+ * @brief  Get the device name
+ */
+const char *ble_svc_gap_device_name(void)
+{
+    return fake_device_name;
+}
+
+/**
+ * @brief  Set the device name
+ */
+int ble_svc_gap_device_name_set(const char *name)
+{
+    if(strlen(name) >= sizeof(fake_device_name))
+    {
+        return BLE_HS_EINVAL;
+    }
+    strcpy(fake_device_name, name);
+    return 0;
+}
+
+/**
+ * @brief  Nothing to register
+ */
+void ble_svc_gap_init(void)
+{
+}
+
+/**
+ * @brief  Nothing to register
+ */
+void ble_svc_gatt_init(void)
+{
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Every definition fits
+ */
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs)
+{
+    return defs != NULL ? 0 : BLE_HS_EINVAL;
+}
+
+/**
+ * @brief  Register services, handles are assigned like the host does: service,
+ *         then declaration, value and CCCD of each characteristic
+ */
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs)
+{
+    const struct ble_gatt_chr_def *chr;
+
+    for(; svcs->type != BLE_GATT_SVC_TYPE_END; svcs++)
+    {
+        fake_gatt_next_handle++;
+        for(chr = svcs->characteristics; chr != NULL && chr->uuid != NULL; chr++)
+        {
+            if(fake_gatt_chr_count >= FAKE_GATT_CHR_MAX)
+            {
+                return BLE_HS_ENOMEM;
+            }
+            fake_gatt_next_handle++;
+            fake_gatt_chrs[fake_gatt_chr_count].val_handle = fake_gatt_next_handle++;
+            fake_gatt_chrs[fake_gatt_chr_count].chr = chr;
+            if(chr->val_handle != NULL)
+            {
+                *chr->val_handle = fake_gatt_chrs[fake_gatt_chr_count].val_handle;
+            }
+            if(chr->flags & (BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE))
+            {
+                fake_gatt_next_handle++;
+            }
+            fake_gatt_chr_count++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  Hand a notification to the fake controller. Like the host, the mbuf
+ *         is consumed whatever the result and NOTIFY_TX reports the status
+ */
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_NOTIFY_TX };
+    uint8_t data[FAKE_NOTIFY_DATA_MAX];
+    fake_notify_hook_t hook;
+    void *hook_arg;
+    fake_conn_t *conn;
+    uint16_t length;
+    int rc = 0;
+
+    length = om != NULL ? OS_MBUF_PKTLEN(om) : 0;
+    if(length > sizeof(data))
+    {
+        length = sizeof(data);
+    }
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    conn = fake_conn_find(conn_handle);
+    if(conn == NULL)
+    {
+        rc = BLE_HS_ENOTCONN;
+    }
+    else if(fake_notify_fail_count > 0)
+    {
+        fake_notify_fail_count--;
+        rc = fake_notify_fail_rc;
+    }
+    else if(length > conn->mtu - 3)
+    {
+        rc = BLE_HS_EMSGSIZE;
+    }
+
+    if(rc != 0)
+    {
+        fake_gap_stats.notify_fails++;
+        os_mbuf_free_chain(om);
+        om = NULL;
+    }
+    else
+    {
+        fake_gap_stats.notifies++;
+        fake_gap_stats.notify_bytes += length;
+        if(om != NULL)
+        {
+            os_mbuf_copydata(om, 0, length, data);
+        }
+        if(om != NULL && fake_link_holding && conn->held_count < FAKE_LINK_HELD_MAX)
+        {
+            conn->held[(conn->held_head + conn->held_count) % FAKE_LINK_HELD_MAX] = om;
+            conn->held_count++;
+        }
+        else
+        {
+            os_mbuf_free_chain(om);
+        }
+    }
+    hook = fake_notify_hook;
+    hook_arg = fake_notify_hook_arg;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+
+    if(conn == NULL)
+    {
+        return rc;
+    }
+    if(rc == 0 && hook != NULL)
+    {
+        hook(conn_handle, att_handle, data, length, hook_arg);
+    }
+    event.notify_tx.status = rc;
+    event.notify_tx.conn_handle = conn_handle;
+    event.notify_tx.attr_handle = att_handle;
+    fake_gap_event(conn, &event);
+    return rc;
+}
+
+/**
+ * @brief  Exchange the MTU, the peer answers with the preferred MTU. Without
+ *         cb (peripheral connections) it is not answered
+ */
+int ble_gattc_exchange_mtu(uint16_t conn_handle, ble_gatt_mtu_fn *cb, void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_MTU, .conn_handle = conn_handle, .cb.mtu = cb, .cb_arg = cb_arg };
+
+    if(cb == NULL)
+    {
+        return fake_conn_find(conn_handle) != NULL ? 0 : BLE_HS_ENOTCONN;
+    }
+    return fake_gattc_start(&proc);
+}
+
+/**
+ * @brief  Discover a service of the peer database
+ */
+int ble_gattc_disc_svc_by_uuid(uint16_t conn_handle, const ble_uuid_t *uuid, ble_gatt_disc_svc_fn *cb,
+                               void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_DISC_SVC, .conn_handle = conn_handle, .cb.svc = cb, .cb_arg = cb_arg };
+
+    ble_uuid_copy(&proc.uuid, uuid);
+    return fake_gattc_start(&proc);
+}
+
+/**
+ * @brief  Discover a characteristic of the peer database in a range
+ */
+int ble_gattc_disc_chrs_by_uuid(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                const ble_uuid_t *uuid, ble_gatt_chr_fn *cb, void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_DISC_CHR, .conn_handle = conn_handle, .start_handle = start_handle,
+                               .end_handle = end_handle, .cb.chr = cb, .cb_arg = cb_arg };
+
+    ble_uuid_copy(&proc.uuid, uuid);
+    return fake_gattc_start(&proc);
+}
+
+/**
+ * @brief  Discover the descriptors after a characteristic value
+ */
+int ble_gattc_disc_all_dscs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_dsc_fn *cb, void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_DISC_DSC, .conn_handle = conn_handle, .start_handle = start_handle,
+                               .end_handle = end_handle, .cb.dsc = cb, .cb_arg = cb_arg };
+
+    return fake_gattc_start(&proc);
+}
+
+/**
+ * @brief  Read an attribute, the value of the peer database holds the peer
+ *         address, any other handle is refused
+ */
+int ble_gattc_read(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_READ, .conn_handle = conn_handle, .start_handle = attr_handle,
+                               .cb.attr = cb, .cb_arg = cb_arg };
+
+    return fake_gattc_start(&proc);
+}
+
+/**
+ * @brief  Write an attribute, only the client configuration of the peer
+ *         database is accepted
+ */
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len,
+                         ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    fake_gattc_proc_t proc = { .op = FAKE_GATTC_WRITE, .conn_handle = conn_handle, .start_handle = attr_handle,
+                               .cb.attr = cb, .cb_arg = cb_arg };
+
+    (void)data;
+    (void)data_len;
+    return fake_gattc_start(&proc);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Register the CoC server, peers open channels with fake_coc_connect()
+ */
+int ble_l2cap_create_server(uint16_t psm, uint16_t mtu, ble_l2cap_event_fn *cb, void *cb_arg)
+{
+    (void)psm;
+    fake_l2cap_mtu = mtu;
+    fake_l2cap_cb = cb;
+    fake_l2cap_cb_arg = cb_arg;
+    return 0;
+}
+
+/**
+ * @brief  Send an SDU, it stalls once the peer runs out of credits
+ */
+int ble_l2cap_send(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_tx)
+{
+    uint16_t frames;
+
+    if(chan == NULL || !chan->used)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if(chan->sdu_tx != NULL)
+    {
+        return BLE_HS_EBUSY;
+    }
+    if(OS_MBUF_PKTLEN(sdu_tx) > chan->peer_mtu)
+    {
+        return BLE_HS_EBADDATA;
+    }
+
+    frames = fake_coc_frames(OS_MBUF_PKTLEN(sdu_tx));
+    if(frames > chan->peer_credits)
+    {
+        chan->sdu_tx = sdu_tx;
+        chan->sdu_tx_frames = frames - chan->peer_credits;
+        chan->peer_credits = 0;
+        return BLE_HS_ESTALLED;
+    }
+    chan->peer_credits -= frames;
+    fake_coc_peer_rx(chan, sdu_tx);
+    return 0;
+}
+
+/**
+ * @brief  Arm the buffer of the next received SDU
+ */
+int ble_l2cap_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
+{
+    if(chan == NULL || !chan->used)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    os_mbuf_free_chain(chan->sdu_rx);
+    chan->sdu_rx = sdu_rx;
+    if(chan->echo_count > 0)
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &chan->echo_event);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Get the MTUs of a channel
+ */
+int ble_l2cap_get_chan_info(struct ble_l2cap_chan *chan, struct ble_l2cap_chan_info *chan_info)
+{
+    if(chan == NULL || !chan->used)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    memset(chan_info, 0, sizeof(*chan_info));
+    chan_info->our_coc_mtu = fake_l2cap_mtu;
+    chan_info->peer_coc_mtu = chan->peer_mtu;
+    chan_info->our_l2cap_mtu = FAKE_COC_MPS;
+    chan_info->peer_l2cap_mtu = FAKE_COC_MPS;
+    return 0;
+}
+
+/**
+ * @brief  Disconnect a channel, completes on the host task
+ */
+int ble_l2cap_disconnect(struct ble_l2cap_chan *chan)
+{
+    if(chan == NULL || !chan->used)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    ble_npl_eventq_put(&fake_dflt_eventq, &chan->disconnect_event);
+    return 0;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Run the host task until it is idle
+ * @retval Number of events run
+ */
+uint32_t fake_run(void)
+{
+    struct ble_npl_event *ev;
+    uint32_t count = 0;
+
+    fake_callouts_fire();
+    while((ev = fake_eventq_pop(&fake_dflt_eventq)) != NULL)
+    {
+        ev->fn(ev);
+        count++;
+        fake_callouts_fire();
+    }
+    return count;
+}
+
+/**
+ * @brief  Run the host task until done() holds or timeout_ms passed
+ */
+bool fake_run_until(bool (*done)(void *arg), void *arg, uint32_t timeout_ms)
+{
+    int64_t deadline = fake_time_us() + (int64_t)timeout_ms * 1000;
+
+    while(!done(arg))
+    {
+        if(fake_time_us() >= deadline)
+        {
+            return false;
+        }
+        if(fake_run() == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  Sync the host with the controller
+ */
+void fake_sync(void)
+{
+    if(ble_hs_cfg.sync_cb != NULL)
+    {
+        ble_hs_cfg.sync_cb();
+    }
+    fake_run();
+}
+
+/**
+ * @brief  Connect a central to the running advertisement
+ * @retval Connection handle, BLE_HS_CONN_HANDLE_NONE when not advertising
+ */
+uint16_t fake_connect(const ble_addr_t *peer)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_CONNECT };
+    fake_conn_t *conn;
+
+    if(!fake_adv_running)
+    {
+        return BLE_HS_CONN_HANDLE_NONE;
+    }
+    conn = fake_conn_open(peer, BLE_GAP_ROLE_SLAVE, fake_adv_cb, fake_adv_cb_arg);
+    if(conn == NULL)
+    {
+        return BLE_HS_CONN_HANDLE_NONE;
+    }
+    fake_adv_running = false;
+    ble_npl_callout_stop(&fake_adv_timer);
+    event.connect.status = 0;
+    event.connect.conn_handle = conn->desc.conn_handle;
+    fake_gap_event(conn, &event);
+    return event.connect.conn_handle;
+}
+
+/**
+ * @brief  The peer or the link drops a connection
+ */
+void fake_disconnect(uint16_t conn_handle, int reason)
+{
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    if(conn != NULL)
+    {
+        fake_conn_close(conn, reason);
+    }
+}
+
+/**
+ * @brief  The peer exchanges its MTU
+ */
+void fake_set_mtu(uint16_t conn_handle, uint16_t mtu)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_MTU };
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    if(conn == NULL)
+    {
+        return;
+    }
+    conn->mtu = mtu < fake_preferred_mtu ? mtu : fake_preferred_mtu;
+    event.mtu.conn_handle = conn_handle;
+    event.mtu.channel_id = 4;
+    event.mtu.value = conn->mtu;
+    fake_gap_event(conn, &event);
+}
+
+/**
+ * @brief  The peer writes the CCCD of a characteristic
+ */
+void fake_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_SUBSCRIBE };
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    if(conn == NULL)
+    {
+        return;
+    }
+    event.subscribe.conn_handle = conn_handle;
+    event.subscribe.attr_handle = attr_handle;
+    event.subscribe.reason = FAKE_SUBSCRIBE_REASON_WRITE;
+    event.subscribe.prev_notify = !notify;
+    event.subscribe.cur_notify = notify;
+    fake_gap_event(conn, &event);
+}
+
+/**
+ * @brief  Encryption completes on a connection
+ */
+void fake_encrypt(uint16_t conn_handle, bool authenticated, bool bonded, uint8_t key_size)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_ENC_CHANGE };
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    if(conn == NULL)
+    {
+        return;
+    }
+    conn->desc.sec_state.encrypted = 1;
+    conn->desc.sec_state.authenticated = authenticated;
+    conn->desc.sec_state.bonded = bonded && fake_store_initialized && ble_hs_cfg.sm_bonding;
+    conn->desc.sec_state.key_size = key_size;
+    if(conn->desc.sec_state.bonded)
+    {
+        fake_bond_add(&conn->desc.peer_id_addr);
+    }
+    event.enc_change.status = 0;
+    event.enc_change.conn_handle = conn_handle;
+    fake_gap_event(conn, &event);
+}
+
+/**
+ * @brief  Check if advertising
+ */
+bool fake_adv_active(void)
+{
+    return fake_adv_running;
+}
+
+/**
+ * @brief  Find the value handle of a characteristic
+ * @retval Handle or 0
+ */
+uint16_t fake_gatt_find(const ble_uuid_t *uuid)
+{
+    uint32_t i;
+
+    for(i = 0; i < fake_gatt_chr_count; i++)
+    {
+        if(ble_uuid_cmp(fake_gatt_chrs[i].chr->uuid, uuid) == 0)
+        {
+            return fake_gatt_chrs[i].val_handle;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  Write a characteristic the way the host delivers a client write
+ * @retval 0, the ATT error or BLE_HS_ENOTCONN
+ */
+int fake_gatt_write(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t length)
+{
+    struct ble_gatt_access_ctxt ctxt = { .op = BLE_GATT_ACCESS_OP_WRITE_CHR };
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+    fake_gatt_chr_t *chr = fake_gatt_chr(attr_handle);
+    int rc;
+
+    if(conn == NULL)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if(chr == NULL)
+    {
+        return BLE_ATT_ERR_INVALID_HANDLE;
+    }
+    rc = fake_gatt_check_security(conn, chr->chr, true);
+    if(rc != 0)
+    {
+        return rc;
+    }
+    ctxt.om = ble_hs_mbuf_from_flat(data, length);
+    if(ctxt.om == NULL)
+    {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    ctxt.chr = chr->chr;
+    rc = chr->chr->access_cb(conn_handle, attr_handle, &ctxt, chr->chr->arg);
+    os_mbuf_free_chain(ctxt.om);
+    return rc;
+}
+
+/**
+ * @brief  Read a characteristic the way the host serves a client read
+ * @retval 0, the ATT error or BLE_HS_ENOTCONN
+ */
+int fake_gatt_read(uint16_t conn_handle, uint16_t attr_handle, void *data, uint16_t max_length,
+                   uint16_t *length)
+{
+    struct ble_gatt_access_ctxt ctxt = { .op = BLE_GATT_ACCESS_OP_READ_CHR };
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+    fake_gatt_chr_t *chr = fake_gatt_chr(attr_handle);
+    int rc;
+
+    if(conn == NULL)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if(chr == NULL)
+    {
+        return BLE_ATT_ERR_INVALID_HANDLE;
+    }
+    rc = fake_gatt_check_security(conn, chr->chr, false);
+    if(rc != 0)
+    {
+        return rc;
+    }
+    ctxt.om = os_msys_get_pkthdr(0, 0);
+    if(ctxt.om == NULL)
+    {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    ctxt.chr = chr->chr;
+    rc = chr->chr->access_cb(conn_handle, attr_handle, &ctxt, chr->chr->arg);
+    if(rc == 0)
+    {
+        ble_hs_mbuf_to_flat(ctxt.om, data, max_length, length);
+    }
+    os_mbuf_free_chain(ctxt.om);
+    return rc;
+}
+
+/**
+ * @brief  Call hook with the payload of every notification sent
+ */
+void fake_notify_set_hook(fake_notify_hook_t hook, void *arg)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_notify_hook = hook;
+    fake_notify_hook_arg = arg;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Fail the next count notifications with rc
+ */
+void fake_notify_fail(int rc, uint32_t count)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_notify_fail_rc = rc;
+    fake_notify_fail_count = count;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Keep the mbufs of sent notifications until fake_link_release()
+ */
+void fake_link_hold(bool hold)
+{
+    fake_link_holding = hold;
+}
+
+/**
+ * @brief  Number of notifications the controller still holds for a connection
+ */
+uint32_t fake_link_held(uint16_t conn_handle)
+{
+    fake_conn_t *conn = fake_conn_find(conn_handle);
+
+    return conn != NULL ? conn->held_count : 0;
+}
+
+/**
+ * @brief  The peer acknowledged up to packets held notifications, free them
+ * @retval Number freed
+ */
+uint32_t fake_link_release(uint16_t conn_handle, uint32_t packets)
+{
+    struct os_mbuf *om;
+    fake_conn_t *conn;
+    uint32_t count = 0;
+
+    portENTER_CRITICAL(&fake_nimble_lock);
+    conn = fake_conn_find(conn_handle);
+    while(conn != NULL && conn->held_count > 0 && count < packets)
+    {
+        om = conn->held[conn->held_head];
+        conn->held_head = (conn->held_head + 1) % FAKE_LINK_HELD_MAX;
+        conn->held_count--;
+        os_mbuf_free_chain(om);
+        count++;
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+    return count;
+}
+
+/**
+ * @brief  Result of the following ble_gap_update_params() calls
+ */
+void fake_gap_set_update_rc(int rc)
+{
+    fake_update_rc = rc;
+}
+
+/**
+ * @brief  Shortest interval the central accepts, in 1.25 ms units
+ */
+void fake_gap_set_central_min_itvl(uint16_t itvl)
+{
+    fake_central_min_itvl = itvl;
+}
+
+/**
+ * @brief  Result of the following ble_hs_hci_util_set_data_len() calls
+ */
+void fake_gap_set_data_len_rc(int rc)
+{
+    fake_data_len_rc = rc;
+}
+
+/**
+ * @brief  PHYs the central supports, BLE_HCI_LE_PHY_*_PREF_MASK
+ */
+void fake_gap_set_central_phys(uint8_t phys_mask)
+{
+    fake_central_phys = phys_mask;
+}
+
+/**
+ * @brief  Get the GAP counters
+ */
+void fake_gap_get_stats(fake_gap_stats_t *stats)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    *stats = fake_gap_stats;
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  Deliver an advertising report to the running scan
+ */
+void fake_disc_report(const struct ble_gap_disc_desc *desc)
+{
+    struct ble_gap_event event = { .type = BLE_GAP_EVENT_DISC };
+
+    if(fake_disc_running && fake_disc_cb != NULL)
+    {
+        event.disc = *desc;
+        fake_disc_cb(&event, fake_disc_cb_arg);
+    }
+}
+
+/**
+ * @brief  Check if scanning
+ */
+bool fake_disc_active(void)
+{
+    return fake_disc_running;
+}
+
+/**
+ * @brief  Check if the bond store is initialized
+ */
+bool fake_store_ready(void)
+{
+    return fake_store_initialized;
+}
+
+/**
+ * @brief  Set the database of the peripherals, its UUIDs are kept by
+ *         reference
+ */
+void fake_peer_set_db(const fake_peer_db_t *db)
+{
+    fake_peer_db = *db;
+}
+
+/**
+ * @brief  Let peripherals accept central connections, a pending one
+ *         completes now
+ */
+void fake_peer_accept(bool accept)
+{
+    fake_peer_refusing = !accept;
+    if(accept && fake_connect_pending)
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &fake_connect_event);
+    }
+}
+
+/**
+ * @brief  Hold the answers to client procedures, released ones come in order
+ */
+void fake_peer_hold(bool hold)
+{
+    portENTER_CRITICAL(&fake_nimble_lock);
+    fake_peer_holding = hold;
+    if(!hold && fake_gattc_count > 0)
+    {
+        ble_npl_eventq_put(&fake_dflt_eventq, &fake_gattc_event);
+    }
+    portEXIT_CRITICAL(&fake_nimble_lock);
+}
+
+/**
+ * @brief  The peer opens a channel to our server
+ * @retval 0 when connected, BLE_HS_ENOTCONN without a connection,
+ *         BLE_HS_EALREADY when one is open, BLE_HS_ENOMEM when the server
+ *         did not arm a receive buffer
+ */
+int fake_coc_connect(uint16_t conn_handle, uint16_t peer_mtu, uint16_t credits)
+{
+    struct ble_l2cap_event event = { 0 };
+    struct ble_l2cap_chan *chan = NULL;
+    uint32_t i;
+
+    if(fake_conn_find(conn_handle) == NULL || fake_l2cap_cb == NULL)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if(fake_coc_find(conn_handle) != NULL)
+    {
+        return BLE_HS_EALREADY;
+    }
+    for(i = 0; i < FAKE_CONN_MAX && chan == NULL; i++)
+    {
+        if(!fake_coc_chans[i].used)
+        {
+            chan = &fake_coc_chans[i];
+        }
+    }
+    memset(chan, 0, sizeof(*chan));
+    chan->used = true;
+    chan->conn_handle = conn_handle;
+    chan->peer_mtu = peer_mtu;
+    chan->peer_credits = credits;
+    ble_npl_event_init(&chan->echo_event, fake_coc_echo, chan);
+    ble_npl_event_init(&chan->disconnect_event, fake_coc_disconnected, chan);
+
+    event.type = BLE_L2CAP_EVENT_COC_ACCEPT;
+    event.accept.conn_handle = conn_handle;
+    event.accept.peer_sdu_size = peer_mtu;
+    event.accept.chan = chan;
+    fake_coc_event(&event);
+    if(chan->sdu_rx == NULL)
+    {
+        chan->used = false;
+        return BLE_HS_ENOMEM;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.type = BLE_L2CAP_EVENT_COC_CONNECTED;
+    event.connect.status = 0;
+    event.connect.conn_handle = conn_handle;
+    event.connect.chan = chan;
+    fake_coc_event(&event);
+    return 0;
+}
+
+/**
+ * @brief  The peer closes its channel
+ */
+void fake_coc_disconnect(uint16_t conn_handle)
+{
+    struct ble_l2cap_chan *chan = fake_coc_find(conn_handle);
+
+    if(chan != NULL)
+    {
+        fake_coc_close(chan);
+    }
+}
+
+/**
+ * @brief  The peer sends an SDU, it needs the buffer armed by the server
+ * @retval 0 when received, BLE_HS_ESTALLED when the server gave no credits,
+ *         BLE_HS_EMSGSIZE when data does not fit our MTU or the buffer
+ */
+int fake_coc_send(uint16_t conn_handle, const void *data, uint16_t length)
+{
+    struct ble_l2cap_chan *chan = fake_coc_find(conn_handle);
+    struct ble_l2cap_event event = { .type = BLE_L2CAP_EVENT_COC_DATA_RECEIVED };
+
+    if(chan == NULL)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if(chan->sdu_rx == NULL)
+    {
+        return BLE_HS_ESTALLED;
+    }
+    if(length > fake_l2cap_mtu || os_mbuf_append(chan->sdu_rx, data, length) != 0)
+    {
+        return BLE_HS_EMSGSIZE;
+    }
+
+    event.receive.conn_handle = conn_handle;
+    event.receive.chan = chan;
+    event.receive.sdu_rx = chan->sdu_rx;
+    chan->sdu_rx = NULL;
+    fake_coc_event(&event);
+    return 0;
+}
+
+/**
+ * @brief  The peer returns credits, a stalled SDU goes out once it has all
+ *         it needs and the server is told it can send again
+ */
+void fake_coc_credits(uint16_t conn_handle, uint16_t credits)
+{
+    struct ble_l2cap_chan *chan = fake_coc_find(conn_handle);
+    struct ble_l2cap_event event = { .type = BLE_L2CAP_EVENT_COC_TX_UNSTALLED };
+    struct os_mbuf *sdu;
+
+    if(chan == NULL)
+    {
+        return;
+    }
+    chan->peer_credits += credits;
+    if(chan->sdu_tx == NULL)
+    {
+        return;
+    }
+    if(chan->sdu_tx_frames > chan->peer_credits)
+    {
+        chan->sdu_tx_frames -= chan->peer_credits;
+        chan->peer_credits = 0;
+        return;
+    }
+
+    chan->peer_credits -= chan->sdu_tx_frames;
+    sdu = chan->sdu_tx;
+    chan->sdu_tx = NULL;
+    fake_coc_peer_rx(chan, sdu);
+    event.tx_unstalled.conn_handle = conn_handle;
+    event.tx_unstalled.chan = chan;
+    event.tx_unstalled.status = 0;
+    fake_coc_event(&event);
+}
+
+/**
+ * @brief  Credits the peer has left
+ */
+uint16_t fake_coc_peer_credits(uint16_t conn_handle)
+{
+    struct ble_l2cap_chan *chan = fake_coc_find(conn_handle);
+
+    return chan != NULL ? chan->peer_credits : 0;
+}
+
+/**
+ * @brief  Call hook with every SDU the peer receives
+ */
+void fake_coc_set_hook(fake_coc_hook_t hook, void *arg)
+{
+    fake_coc_hook = hook;
+    fake_coc_hook_arg = arg;
+}
+
+/**
+ * @brief  Make peers send every SDU they receive back and return its
+ *         credits once it is through
+ */
+void fake_coc_loopback(bool loopback)
+{
+    fake_coc_echoing = loopback;
+}
\ No newline at end of file
@@ -0,0 +1 @@
+#include "fake_esp.h"
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*
+ *  fake_esp.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _FAKE_ESP_H_
+#define _FAKE_ESP_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * ESP-IDF services the firmware uses, on the host: the log goes to stderr
+ * above FAKE_LOG_LEVEL, heap_caps is malloc with counters, NVS and the
+ * update partitions live in memory and esp_timer runs on the simulated
+ * clock of fake.h.
+ */
+typedef int esp_err_t;
+
+#define ESP_OK                                        0
+#define ESP_FAIL                                      -1
+#define ESP_ERR_NO_MEM                                0x101
+#define ESP_ERR_INVALID_ARG                           0x102
+#define ESP_ERR_INVALID_STATE                         0x103
+#define ESP_ERR_INVALID_SIZE                          0x104
+#define ESP_ERR_NOT_FOUND                             0x105
+#define ESP_ERR_NOT_SUPPORTED                         0x106
+#define ESP_ERR_TIMEOUT                               0x107
+#define ESP_ERR_INVALID_RESPONSE                      0x108
+#define ESP_ERR_INVALID_CRC                           0x109
+#define ESP_ERR_NVS_BASE                              0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED                   (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND                         (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_NO_FREE_PAGES                     (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND                 (ESP_ERR_NVS_BASE + 0x10)
+
+#define ESP_ERROR_CHECK(x)                            fake_error_check((x), #x, __FILE__, __LINE__)
+
+#define FAKE_LOG_NONE                                 0
+#define FAKE_LOG_ERROR                                1
+#define FAKE_LOG_WARN                                 2
+#define FAKE_LOG_INFO                                 3
+#define FAKE_LOG_DEBUG                                4
+
+#define ESP_LOGE(tag, ...)                            fake_log(FAKE_LOG_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...)                            fake_log(FAKE_LOG_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...)                            fake_log(FAKE_LOG_INFO, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...)                            fake_log(FAKE_LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...)                            fake_log(FAKE_LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOG_BUFFER_HEX(tag, buffer, length)       ((void)(tag), (void)(buffer), (void)(length))
+
+#define MALLOC_CAP_EXEC                               (1 << 0)
+#define MALLOC_CAP_32BIT                              (1 << 1)
+#define MALLOC_CAP_8BIT                               (1 << 2)
+#define MALLOC_CAP_DMA                                (1 << 3)
+#define MALLOC_CAP_SPIRAM                             (1 << 10)
+#define MALLOC_CAP_INTERNAL                           (1 << 11)
+#define MALLOC_CAP_DEFAULT                            (1 << 12)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+#define NVS_DEFAULT_PART_NAME                         "nvs"
+#define NVS_KEY_NAME_MAX_SIZE                         16
+
+typedef enum
+{
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_BLOB = 0x42,
+    NVS_TYPE_ANY = 0xFF,
+} nvs_type_t;
+
+typedef struct
+{
+    char namespace_name[NVS_KEY_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+} nvs_entry_info_t;
+
+typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_APP_FACTORY = 0x00,
+    ESP_PARTITION_SUBTYPE_APP_OTA_0 = 0x10,
+    ESP_PARTITION_SUBTYPE_APP_OTA_1 = 0x11,
+} esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+#define SPI_FLASH_SEC_SIZE                            4096
+#define FAKE_OTA_PARTITION_SIZE                       0x100000    /* ota_0 and ota_1 of partitions.csv */
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+void fake_log(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void fake_error_check(esp_err_t rc, const char *expression, const char *file, int line);
+
+int64_t esp_timer_get_time(void);
+uint32_t esp_random(void);
+void esp_restart(void);
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length);
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t count, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t nvs_commit(nvs_handle_t handle);
+nvs_iterator_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type);
+nvs_iterator_t nvs_entry_next(nvs_iterator_t iterator);
+void nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t *out_info);
+void nvs_release_iterator(nvs_iterator_t iterator);
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size);
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+
+esp_err_t esp_nimble_hci_and_controller_init(void);
+
+/******************************************************************************/
+
+#endif /* _FAKE_ESP_H_ */
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+ *  fake_freertos.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _FAKE_FREERTOS_H_
+#define _FAKE_FREERTOS_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#include "sdkconfig.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * FreeRTOS on POSIX threads. Tasks are threads, a critical section takes
+ * one process wide recursive lock and a tick is one millisecond.
+ */
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct fake_task *TaskHandle_t;
+typedef struct fake_queue *QueueHandle_t;
+typedef struct fake_queue *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+typedef struct
+{
+    uint32_t unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED                  { 0 }
+#define portENTER_CRITICAL(mux)                       fake_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)                        fake_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux)                   fake_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)                    fake_critical_exit(mux)
+
+#define portTICK_PERIOD_MS                            1
+#define portTICK_RATE_MS                              portTICK_PERIOD_MS
+#define portMAX_DELAY                                 0xFFFFFFFFu
+#define taskYIELD()                                   sched_yield()
+#define pdMS_TO_TICKS(ms)                             ((TickType_t)(ms))
+#define pdTRUE                                        1
+#define pdFALSE                                       0
+#define pdPASS                                        pdTRUE
+#define pdFAIL                                        pdFALSE
+#define tskNO_AFFINITY                                0x7FFFFFFF
+#define tskIDLE_PRIORITY                              0
+#define configMAX_PRIORITIES                          25
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+void fake_critical_enter(portMUX_TYPE *mux);
+void fake_critical_exit(portMUX_TYPE *mux);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id);
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xPortGetCoreID(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+/******************************************************************************/
+
+#endif /* _FAKE_FREERTOS_H_ */
\ No newline at end of file
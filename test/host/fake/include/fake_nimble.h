@@ -0,0 +1,836 @@
+/*
+ *  fake_nimble.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _FAKE_NIMBLE_H_
+#define _FAKE_NIMBLE_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The part of the NimBLE host API the firmware uses. Mbufs, mempools and
+ * the event queue behave like the real ones; GAP, GATT and L2CAP calls are
+ * answered by fake_nimble.c, which tests drive through fake.h.
+ */
+
+/* OS */
+#define OS_OK                                         0
+#define OS_ENOMEM                                     1
+#define OS_EINVAL                                     2
+#define OS_ALIGNMENT                                  8
+
+typedef uint64_t os_membuf_t;
+
+#define OS_ALIGN(n, a)                                (((n) + ((a) - 1)) / (a) * (a))
+#define OS_MEMPOOL_SIZE(n, size)                      ((n) * (OS_ALIGN((size), OS_ALIGNMENT) / sizeof(os_membuf_t)))
+#define OS_MEMPOOL_BYTES(n, size)                     (sizeof(os_membuf_t) * OS_MEMPOOL_SIZE((n), (size)))
+
+struct os_mempool
+{
+    uint32_t mp_block_size;
+    uint16_t mp_num_blocks;
+    uint16_t mp_num_free;
+    uint16_t mp_min_free;
+    uint8_t *mp_membuf_addr;
+    void *mp_free_list;
+    const char *name;
+};
+
+struct os_mbuf_pool
+{
+    uint16_t omp_databuf_len;
+    struct os_mempool *omp_pool;
+};
+
+struct os_mbuf_pkthdr
+{
+    uint16_t omp_len;
+    uint16_t omp_flags;
+};
+
+struct os_mbuf
+{
+    uint8_t *om_data;
+    uint8_t om_flags;
+    uint8_t om_pkthdr_len;
+    uint16_t om_len;
+    struct os_mbuf_pool *om_omp;
+    struct
+    {
+        struct os_mbuf *sle_next;
+    } om_next;
+    uint8_t om_databuf[];
+};
+
+#define SLIST_NEXT(elm, field)                        ((elm)->field.sle_next)
+#define OS_MBUF_PKTHDR(om)                            ((struct os_mbuf_pkthdr *)(void *)(om)->om_databuf)
+#define OS_MBUF_PKTLEN(om)                            (OS_MBUF_PKTHDR(om)->omp_len)
+#define OS_MBUF_IS_PKTHDR(om)                         ((om)->om_pkthdr_len >= sizeof(struct os_mbuf_pkthdr))
+#define OS_MBUF_DATA(om, type)                        ((type)(om)->om_data)
+#define OS_MBUF_LEADINGSPACE(om)                      ((uint16_t)((om)->om_data - (om)->om_databuf - (om)->om_pkthdr_len))
+#define OS_MBUF_TRAILINGSPACE(om)                     ((uint16_t)((om)->om_databuf + (om)->om_omp->omp_databuf_len - \
+                                                                  ((om)->om_data + (om)->om_len)))
+
+/* NPL */
+typedef uint32_t ble_npl_time_t;
+typedef int32_t ble_npl_stime_t;
+
+struct ble_npl_event;
+typedef void ble_npl_event_fn(struct ble_npl_event *ev);
+
+struct ble_npl_event
+{
+    ble_npl_event_fn *fn;
+    void *arg;
+    bool queued;
+    struct ble_npl_event *next;
+};
+
+struct ble_npl_eventq
+{
+    struct ble_npl_event *head;
+    struct ble_npl_event *tail;
+};
+
+struct ble_npl_callout
+{
+    struct ble_npl_event ev;
+    struct ble_npl_eventq *evq;
+    ble_npl_time_t expiry;
+    bool active;
+    struct ble_npl_callout *next;
+};
+
+/* Host */
+#define BLE_HS_FOREVER                                INT32_MAX
+#define BLE_HS_CONN_HANDLE_NONE                       0xFFFF
+#define BLE_HS_EAGAIN                                 1
+#define BLE_HS_EALREADY                               2
+#define BLE_HS_EINVAL                                 3
+#define BLE_HS_EMSGSIZE                               4
+#define BLE_HS_ENOENT                                 5
+#define BLE_HS_ENOMEM                                 6
+#define BLE_HS_ENOTCONN                               7
+#define BLE_HS_ENOTSUP                                8
+#define BLE_HS_EAPP                                   9
+#define BLE_HS_EBADDATA                               10
+#define BLE_HS_EOS                                    11
+#define BLE_HS_ECONTROLLER                            12
+#define BLE_HS_ETIMEOUT                               13
+#define BLE_HS_EDONE                                  14
+#define BLE_HS_EBUSY                                  15
+#define BLE_HS_EREJECT                                16
+#define BLE_HS_ESTALLED                               29
+#define BLE_HS_ERR_ATT_BASE                           0x100
+#define BLE_HS_ERR_HCI_BASE                           0x200
+#define BLE_HS_HCI_ERR(x)                             ((x) ? BLE_HS_ERR_HCI_BASE + (x) : 0)
+#define BLE_HS_ATT_ERR(x)                             ((x) ? BLE_HS_ERR_ATT_BASE + (x) : 0)
+
+#define BLE_ERR_UNSUPP_REM_FEATURE                    0x1A
+#define BLE_ERR_REM_USER_CONN_TERM                    0x13
+#define BLE_ERR_CONN_TERM_LOCAL                       0x16
+#define BLE_ERR_UNSUPP_LMP_LL_PARM                    0x20
+
+#define BLE_ATT_MTU_DFLT                              23
+#define BLE_ATT_MTU_MAX                               527
+#define BLE_ATT_ATTR_MAX_LEN                          512
+#define BLE_ATT_ERR_INVALID_HANDLE                    0x01
+#define BLE_ATT_ERR_WRITE_NOT_PERMITTED               0x03
+#define BLE_ATT_ERR_REQ_NOT_SUPPORTED                 0x06
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN            0x0D
+#define BLE_ATT_ERR_UNLIKELY                          0x0E
+#define BLE_ATT_ERR_INSUFFICIENT_RES                  0x11
+#define BLE_ATT_ERR_VALUE_NOT_ALLOWED                 0x13
+
+#define BLE_ADDR_PUBLIC                               0
+#define BLE_ADDR_RANDOM                               1
+#define BLE_OWN_ADDR_PUBLIC                           0
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+#define BLE_ADDR_ANY                                  (&(ble_addr_t){ 0, { 0, 0, 0, 0, 0, 0 } })
+
+#define BLE_UUID_TYPE_16                              16
+#define BLE_UUID_TYPE_32                              32
+#define BLE_UUID_TYPE_128                             128
+
+typedef struct
+{
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint16_t value;
+} ble_uuid16_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint8_t value[16];
+} ble_uuid128_t;
+
+typedef union
+{
+    ble_uuid_t u;
+    ble_uuid16_t u16;
+    ble_uuid128_t u128;
+} ble_uuid_any_t;
+
+#define BLE_UUID16_INIT(uuid16)                       { .u = { .type = BLE_UUID_TYPE_16 }, .value = (uuid16) }
+#define BLE_UUID128_INIT(...)                         { .u = { .type = BLE_UUID_TYPE_128 }, .value = { __VA_ARGS__ } }
+#define BLE_UUID16_DECLARE(uuid16)                    ((ble_uuid_t *)(&(ble_uuid16_t)BLE_UUID16_INIT(uuid16)))
+
+/* Security manager and store */
+#define BLE_SM_IO_CAP_DISP_ONLY                       0x00
+#define BLE_SM_IO_CAP_DISP_YES_NO                     0x01
+#define BLE_SM_IO_CAP_KEYBOARD_ONLY                   0x02
+#define BLE_SM_IO_CAP_NO_IO                           0x03
+#define BLE_SM_IO_CAP_KEYBOARD_DISP                   0x04
+#define BLE_SM_IOACT_NONE                             0
+#define BLE_SM_IOACT_OOB                              1
+#define BLE_SM_IOACT_INPUT                            2
+#define BLE_SM_IOACT_DISP                             3
+#define BLE_SM_IOACT_NUMCMP                           4
+
+struct ble_sm_io
+{
+    uint8_t action;
+    union
+    {
+        uint32_t passkey;
+        uint8_t oob[16];
+        uint8_t numcmp_accept;
+    };
+};
+
+struct ble_sm_sc_oob_data
+{
+    uint8_t addr_type;
+    uint8_t a[6];
+    uint8_t r[16];
+    uint8_t c[16];
+};
+
+struct ble_store_status_event;
+typedef int ble_store_status_fn(struct ble_store_status_event *event, void *arg);
+
+struct ble_hs_cfg
+{
+    void (*reset_cb)(int reason);
+    void (*sync_cb)(void);
+    ble_store_status_fn *store_status_cb;
+    void *store_status_arg;
+    uint8_t sm_io_cap;
+    unsigned sm_oob_data_flag:1;
+    unsigned sm_bonding:1;
+    unsigned sm_mitm:1;
+    unsigned sm_sc:1;
+    unsigned sm_keypress:1;
+    uint8_t sm_our_key_dist;
+    uint8_t sm_their_key_dist;
+};
+
+extern struct ble_hs_cfg ble_hs_cfg;
+
+/* GAP */
+#define BLE_GAP_ROLE_MASTER                           0
+#define BLE_GAP_ROLE_SLAVE                            1
+#define BLE_GAP_CONN_MODE_NON                         0
+#define BLE_GAP_CONN_MODE_DIR                         1
+#define BLE_GAP_CONN_MODE_UND                         2
+#define BLE_GAP_DISC_MODE_NON                         0
+#define BLE_GAP_DISC_MODE_LTD                         1
+#define BLE_GAP_DISC_MODE_GEN                         2
+#define BLE_GAP_REPEAT_PAIRING_RETRY                  1
+#define BLE_GAP_REPEAT_PAIRING_IGNORE                 2
+#define BLE_GAP_ADV_FAST_INTERVAL1_MIN                48
+#define BLE_GAP_ADV_FAST_INTERVAL1_MAX                96
+#define BLE_GAP_ADV_ITVL_MS(t)                        ((t) * 1000 / 625)
+#define BLE_GAP_SCAN_ITVL_MS(t)                       ((t) * 1000 / 625)
+#define BLE_GAP_SCAN_WIN_MS(t)                        ((t) * 1000 / 625)
+#define BLE_GAP_CONN_ITVL_MS(t)                       ((t) * 1000 / 1250)
+#define BLE_GAP_SUPERVISION_TIMEOUT_MS(t)             ((t) / 10)
+#define BLE_GAP_LE_PHY_1M_MASK                        0x01
+#define BLE_GAP_LE_PHY_2M_MASK                        0x02
+#define BLE_GAP_LE_PHY_CODED_MASK                     0x04
+#define BLE_GAP_LE_PHY_CODED_ANY                      0
+
+#define BLE_HCI_ADV_FILT_NONE                         0
+#define BLE_HCI_ADV_FILT_SCAN                         1
+#define BLE_HCI_ADV_FILT_CONN                         2
+#define BLE_HCI_ADV_FILT_BOTH                         3
+#define BLE_HCI_ADV_RPT_EVTYPE_ADV_IND                0
+#define BLE_HCI_ADV_RPT_EVTYPE_DIR_IND                1
+#define BLE_HCI_ADV_RPT_EVTYPE_SCAN_IND               2
+#define BLE_HCI_ADV_RPT_EVTYPE_NONCONN_IND            3
+#define BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP               4
+#define BLE_HCI_LE_PHY_1M_PREF_MASK                   0x01
+#define BLE_HCI_LE_PHY_2M_PREF_MASK                   0x02
+#define BLE_HCI_LE_PHY_CODED_PREF_MASK                0x04
+#define BLE_HCI_LE_PHY_CODED_ANY                      0
+#define BLE_HCI_LE_PHY_1M                             1
+#define BLE_HCI_LE_PHY_2M                             2
+#define BLE_HCI_LE_PHY_CODED                          3
+
+struct ble_gap_sec_state
+{
+    unsigned encrypted:1;
+    unsigned authenticated:1;
+    unsigned bonded:1;
+    unsigned key_size:5;
+};
+
+struct ble_gap_conn_desc
+{
+    struct ble_gap_sec_state sec_state;
+    ble_addr_t our_id_addr;
+    ble_addr_t peer_id_addr;
+    ble_addr_t our_ota_addr;
+    ble_addr_t peer_ota_addr;
+    uint16_t conn_handle;
+    uint16_t conn_itvl;
+    uint16_t conn_latency;
+    uint16_t supervision_timeout;
+    uint8_t role;
+    uint8_t master_clock_accuracy;
+};
+
+struct ble_gap_upd_params
+{
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint16_t latency;
+    uint16_t supervision_timeout;
+    uint16_t min_ce_len;
+    uint16_t max_ce_len;
+};
+
+struct ble_gap_conn_params
+{
+    uint16_t scan_itvl;
+    uint16_t scan_window;
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint16_t latency;
+    uint16_t supervision_timeout;
+    uint16_t min_ce_len;
+    uint16_t max_ce_len;
+};
+
+struct ble_gap_adv_params
+{
+    uint8_t conn_mode;
+    uint8_t disc_mode;
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint8_t channel_map;
+    uint8_t filter_policy;
+    uint8_t high_duty_cycle;
+};
+
+struct ble_gap_disc_params
+{
+    uint16_t itvl;
+    uint16_t window;
+    uint8_t filter_policy;
+    uint8_t limited:1;
+    uint8_t passive:1;
+    uint8_t filter_duplicates:1;
+};
+
+struct ble_gap_disc_desc
+{
+    uint8_t event_type;
+    uint8_t length_data;
+    ble_addr_t addr;
+    int8_t rssi;
+    const uint8_t *data;
+    ble_addr_t direct_addr;
+};
+
+struct ble_gap_repeat_pairing
+{
+    uint16_t conn_handle;
+    uint8_t cur_key_size;
+    uint8_t cur_authenticated:1;
+    uint8_t cur_sc:1;
+    uint8_t new_key_size;
+    uint8_t new_authenticated:1;
+    uint8_t new_sc:1;
+    uint8_t new_bonding:1;
+};
+
+enum
+{
+    BLE_GAP_EVENT_CONNECT = 0,
+    BLE_GAP_EVENT_DISCONNECT,
+    BLE_GAP_EVENT_CONN_UPDATE,
+    BLE_GAP_EVENT_CONN_UPDATE_REQ,
+    BLE_GAP_EVENT_L2CAP_UPDATE_REQ,
+    BLE_GAP_EVENT_TERM_FAILURE,
+    BLE_GAP_EVENT_DISC,
+    BLE_GAP_EVENT_DISC_COMPLETE,
+    BLE_GAP_EVENT_ADV_COMPLETE,
+    BLE_GAP_EVENT_ENC_CHANGE,
+    BLE_GAP_EVENT_PASSKEY_ACTION,
+    BLE_GAP_EVENT_NOTIFY_RX,
+    BLE_GAP_EVENT_NOTIFY_TX,
+    BLE_GAP_EVENT_SUBSCRIBE,
+    BLE_GAP_EVENT_MTU,
+    BLE_GAP_EVENT_IDENTITY_RESOLVED,
+    BLE_GAP_EVENT_REPEAT_PAIRING,
+    BLE_GAP_EVENT_PHY_UPDATE_COMPLETE,
+};
+
+struct ble_gap_event
+{
+    uint8_t type;
+    union
+    {
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } connect;
+
+        struct
+        {
+            int reason;
+            struct ble_gap_conn_desc conn;
+        } disconnect;
+
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } conn_update;
+
+        struct
+        {
+            const struct ble_gap_upd_params *peer_params;
+            struct ble_gap_upd_params *self_params;
+            uint16_t conn_handle;
+        } conn_update_req;
+
+        struct
+        {
+            int reason;
+        } adv_complete;
+
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } enc_change;
+
+        struct
+        {
+            uint16_t conn_handle;
+            struct
+            {
+                uint8_t action;
+                uint32_t numcmp;
+            } params;
+        } passkey;
+
+        struct
+        {
+            struct os_mbuf *om;
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t indication:1;
+        } notify_rx;
+
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t indication:1;
+        } notify_tx;
+
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t reason;
+            uint8_t prev_notify:1;
+            uint8_t cur_notify:1;
+            uint8_t prev_indicate:1;
+            uint8_t cur_indicate:1;
+        } subscribe;
+
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t channel_id;
+            uint16_t value;
+        } mtu;
+
+        struct
+        {
+            uint16_t conn_handle;
+        } identity_resolved;
+
+        struct ble_gap_repeat_pairing repeat_pairing;
+
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+            uint8_t tx_phy;
+            uint8_t rx_phy;
+        } phy_updated;
+
+        struct ble_gap_disc_desc disc;
+
+        struct
+        {
+            int reason;
+        } disc_complete;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+
+/* Advertising data */
+#define BLE_HS_ADV_MAX_SZ                             31
+#define BLE_HS_ADV_F_DISC_LTD                         0x01
+#define BLE_HS_ADV_F_DISC_GEN                         0x02
+#define BLE_HS_ADV_F_BREDR_UNSUP                      0x04
+#define BLE_HS_ADV_TX_PWR_LVL_AUTO                    (-128)
+
+struct ble_hs_adv_fields
+{
+    uint8_t flags;
+    const ble_uuid16_t *uuids16;
+    uint8_t num_uuids16;
+    unsigned uuids16_is_complete:1;
+    const ble_uuid128_t *uuids128;
+    uint8_t num_uuids128;
+    unsigned uuids128_is_complete:1;
+    const uint8_t *name;
+    uint8_t name_len;
+    unsigned name_is_complete:1;
+    int8_t tx_pwr_lvl;
+    unsigned tx_pwr_lvl_is_present:1;
+    const uint8_t *svc_data_uuid16;
+    uint8_t svc_data_uuid16_len;
+    const uint8_t *mfg_data;
+    uint8_t mfg_data_len;
+};
+
+/* GATT */
+#define BLE_GATT_SVC_TYPE_END                         0
+#define BLE_GATT_SVC_TYPE_PRIMARY                     1
+#define BLE_GATT_SVC_TYPE_SECONDARY                   2
+#define BLE_GATT_ACCESS_OP_READ_CHR                   0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR                  1
+#define BLE_GATT_ACCESS_OP_READ_DSC                   2
+#define BLE_GATT_ACCESS_OP_WRITE_DSC                  3
+#define BLE_GATT_CHR_F_BROADCAST                      0x0001
+#define BLE_GATT_CHR_F_READ                           0x0002
+#define BLE_GATT_CHR_F_WRITE_NO_RSP                   0x0004
+#define BLE_GATT_CHR_F_WRITE                          0x0008
+#define BLE_GATT_CHR_F_NOTIFY                         0x0010
+#define BLE_GATT_CHR_F_INDICATE                       0x0020
+#define BLE_GATT_CHR_F_READ_ENC                       0x0200
+#define BLE_GATT_CHR_F_READ_AUTHEN                    0x0400
+#define BLE_GATT_CHR_F_READ_AUTHOR                    0x0800
+#define BLE_GATT_CHR_F_WRITE_ENC                      0x1000
+#define BLE_GATT_CHR_F_WRITE_AUTHEN                   0x2000
+#define BLE_GATT_CHR_F_WRITE_AUTHOR                   0x4000
+#define BLE_GATT_DSC_CLT_CFG_UUID16                   0x2902
+#define BLE_GATT_CHR_PROP_READ                        0x02
+#define BLE_GATT_CHR_PROP_NOTIFY                      0x10
+
+typedef uint16_t ble_gatt_chr_flags;
+
+struct ble_gatt_chr_def;
+struct ble_gatt_dsc_def;
+
+struct ble_gatt_access_ctxt
+{
+    uint8_t op;
+    struct os_mbuf *om;
+    union
+    {
+        const struct ble_gatt_chr_def *chr;
+        const struct ble_gatt_dsc_def *dsc;
+    };
+};
+
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt,
+                               void *arg);
+
+struct ble_gatt_chr_def
+{
+    const ble_uuid_t *uuid;
+    ble_gatt_access_fn *access_cb;
+    void *arg;
+    struct ble_gatt_dsc_def *descriptors;
+    ble_gatt_chr_flags flags;
+    uint8_t min_key_size;
+    uint16_t *val_handle;
+};
+
+struct ble_gatt_svc_def
+{
+    uint8_t type;
+    const ble_uuid_t *uuid;
+    const struct ble_gatt_svc_def **includes;
+    const struct ble_gatt_chr_def *characteristics;
+};
+
+struct ble_gatt_error
+{
+    uint16_t status;
+    uint16_t att_handle;
+};
+
+struct ble_gatt_svc
+{
+    uint16_t start_handle;
+    uint16_t end_handle;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_chr
+{
+    uint16_t def_handle;
+    uint16_t val_handle;
+    uint8_t properties;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_dsc
+{
+    uint16_t handle;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_attr
+{
+    uint16_t handle;
+    uint16_t offset;
+    struct os_mbuf *om;
+};
+
+typedef int ble_gatt_mtu_fn(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t mtu, void *arg);
+typedef int ble_gatt_disc_svc_fn(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                 const struct ble_gatt_svc *service, void *arg);
+typedef int ble_gatt_chr_fn(uint16_t conn_handle, const struct ble_gatt_error *error,
+                            const struct ble_gatt_chr *chr, void *arg);
+typedef int ble_gatt_dsc_fn(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t chr_val_handle,
+                            const struct ble_gatt_dsc *dsc, void *arg);
+typedef int ble_gatt_attr_fn(uint16_t conn_handle, const struct ble_gatt_error *error,
+                             struct ble_gatt_attr *attr, void *arg);
+
+/* L2CAP */
+struct ble_l2cap_chan;
+
+struct ble_l2cap_chan_info
+{
+    uint16_t scid;
+    uint16_t dcid;
+    uint16_t our_l2cap_mtu;
+    uint16_t peer_l2cap_mtu;
+    uint16_t psm;
+    uint16_t our_coc_mtu;
+    uint16_t peer_coc_mtu;
+};
+
+enum
+{
+    BLE_L2CAP_EVENT_COC_CONNECTED = 0,
+    BLE_L2CAP_EVENT_COC_DISCONNECTED,
+    BLE_L2CAP_EVENT_COC_ACCEPT,
+    BLE_L2CAP_EVENT_COC_DATA_RECEIVED,
+    BLE_L2CAP_EVENT_COC_TX_UNSTALLED,
+};
+
+struct ble_l2cap_event
+{
+    int type;
+    union
+    {
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+            struct ble_l2cap_chan *chan;
+        } connect;
+
+        struct
+        {
+            uint16_t conn_handle;
+            struct ble_l2cap_chan *chan;
+        } disconnect;
+
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t peer_sdu_size;
+            struct ble_l2cap_chan *chan;
+        } accept;
+
+        struct
+        {
+            uint16_t conn_handle;
+            struct ble_l2cap_chan *chan;
+            struct os_mbuf *sdu_rx;
+        } receive;
+
+        struct
+        {
+            uint16_t conn_handle;
+            struct ble_l2cap_chan *chan;
+            int status;
+        } tx_unstalled;
+    };
+};
+
+typedef int ble_l2cap_event_fn(struct ble_l2cap_event *event, void *arg);
+
+/* Syscfg */
+#define MYNEWT_VAL(name)                              MYNEWT_VAL_##name
+#define MYNEWT_VAL_BLE_MAX_CONNECTIONS                CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define MYNEWT_VAL_BLE_STORE_MAX_BONDS                CONFIG_BT_NIMBLE_MAX_BONDS
+#define MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM              CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/* OS */
+int os_mempool_init(struct os_mempool *mp, uint16_t blocks, uint32_t block_size, void *membuf, const char *name);
+int os_mbuf_pool_init(struct os_mbuf_pool *omp, struct os_mempool *mp, uint16_t buf_len, uint16_t nbufs);
+struct os_mbuf *os_mbuf_get(struct os_mbuf_pool *omp, uint16_t leadingspace);
+struct os_mbuf *os_mbuf_get_pkthdr(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len);
+struct os_mbuf *os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len);
+int os_msys_num_free(void);
+int os_mbuf_free_chain(struct os_mbuf *om);
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst);
+void os_mbuf_adj(struct os_mbuf *om, int req_len);
+
+/* NPL */
+void ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn, void *arg);
+void *ble_npl_event_get_arg(struct ble_npl_event *ev);
+bool ble_npl_event_is_queued(struct ble_npl_event *ev);
+void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
+void ble_npl_eventq_remove(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg);
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *co);
+bool ble_npl_callout_is_active(struct ble_npl_callout *co);
+ble_npl_time_t ble_npl_time_get(void);
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms);
+uint32_t ble_npl_time_ticks_to_ms32(ble_npl_time_t ticks);
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void);
+void nimble_port_init(void);
+void nimble_port_run(void);
+int nimble_port_stop(void);
+void nimble_port_freertos_init(void (*host_task)(void *arg));
+void nimble_port_freertos_deinit(void);
+
+/* Host */
+int ble_hs_util_ensure_addr(int prefer_random);
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type);
+int ble_hs_id_copy_addr(uint8_t id_addr_type, uint8_t *out_id_addr, int *out_is_nrpa);
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len, uint16_t *out_copy_len);
+int ble_hs_hci_util_set_data_len(uint16_t conn_handle, uint16_t tx_octets, uint16_t tx_time);
+int ble_hs_hci_util_rand(void *dst, int len);
+int ble_addr_cmp(const ble_addr_t *a, const ble_addr_t *b);
+int ble_uuid_cmp(const ble_uuid_t *uuid1, const ble_uuid_t *uuid2);
+void ble_uuid_copy(ble_uuid_any_t *dst, const ble_uuid_t *src);
+int ble_att_set_preferred_mtu(uint16_t mtu);
+uint16_t ble_att_mtu(uint16_t conn_handle);
+int ble_sm_inject_io(uint16_t conn_handle, struct ble_sm_io *pkey);
+int ble_sm_sc_oob_generate_data(struct ble_sm_sc_oob_data *oob_data);
+int ble_store_util_status_rr(struct ble_store_status_event *event, void *arg);
+int ble_store_util_bonded_peers(ble_addr_t *out_peer_id_addrs, int *out_num_peers, int max_peers);
+void ble_store_config_init(void);
+
+/* GAP */
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *adv_params, ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_adv_stop(void);
+int ble_gap_adv_active(void);
+int ble_gap_adv_set_data(const uint8_t *data, int data_len);
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int data_len);
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *adv_fields);
+int ble_gap_adv_rsp_set_fields(const struct ble_hs_adv_fields *rsp_fields);
+int ble_hs_adv_set_fields(const struct ble_hs_adv_fields *adv_fields, uint8_t *dst, uint8_t *dst_len,
+                          uint8_t max_len);
+int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc *out_desc);
+int ble_gap_conn_find_by_addr(const ble_addr_t *addr, struct ble_gap_conn_desc *out_desc);
+int ble_gap_conn_active(void);
+int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params *params);
+int ble_gap_set_prefered_le_phy(uint16_t conn_handle, uint8_t tx_phys_mask, uint8_t rx_phys_mask,
+                                uint16_t phy_opts);
+int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count);
+int ble_gap_unpair(const ble_addr_t *peer_addr);
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason);
+int ble_gap_security_initiate(uint16_t conn_handle);
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_disc_cancel(void);
+int ble_gap_disc_active(void);
+int ble_gap_connect(uint8_t own_addr_type, const ble_addr_t *peer_addr, int32_t duration_ms,
+                    const struct ble_gap_conn_params *params, ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_conn_cancel(void);
+const char *ble_svc_gap_device_name(void);
+int ble_svc_gap_device_name_set(const char *name);
+void ble_svc_gap_init(void);
+void ble_svc_gatt_init(void);
+
+/* GATT */
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs);
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om);
+int ble_gattc_exchange_mtu(uint16_t conn_handle, ble_gatt_mtu_fn *cb, void *cb_arg);
+int ble_gattc_disc_svc_by_uuid(uint16_t conn_handle, const ble_uuid_t *uuid, ble_gatt_disc_svc_fn *cb,
+                               void *cb_arg);
+int ble_gattc_disc_chrs_by_uuid(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                const ble_uuid_t *uuid, ble_gatt_chr_fn *cb, void *cb_arg);
+int ble_gattc_disc_all_dscs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_dsc_fn *cb, void *cb_arg);
+int ble_gattc_read(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_attr_fn *cb, void *cb_arg);
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len,
+                         ble_gatt_attr_fn *cb, void *cb_arg);
+
+/* L2CAP */
+int ble_l2cap_create_server(uint16_t psm, uint16_t mtu, ble_l2cap_event_fn *cb, void *cb_arg);
+int ble_l2cap_send(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_tx);
+int ble_l2cap_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx);
+int ble_l2cap_get_chan_info(struct ble_l2cap_chan *chan, struct ble_l2cap_chan_info *chan_info);
+int ble_l2cap_disconnect(struct ble_l2cap_chan *chan);
+
+/******************************************************************************/
+
+#endif /* _FAKE_NIMBLE_H_ */
\ No newline at end of file
@@ -0,0 +1 @@
+#include "fake_freertos.h"
\ No newline at end of file
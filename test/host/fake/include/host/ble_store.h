@@ -0,0 +1 @@
+#include "fake_nimble.h"
\ No newline at end of file
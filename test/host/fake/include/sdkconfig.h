@@ -0,0 +1,19 @@
+/*
+ *  sdkconfig.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _SDKCONFIG_H_
+#define _SDKCONFIG_H_
+
+/* Values of sdkconfig.esp32dev the firmware reads */
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS              3
+#define CONFIG_BT_NIMBLE_MAX_BONDS                    3
+#define CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM            2
+#define CONFIG_BT_NIMBLE_PINNED_TO_CORE               0
+#define CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU            256
+#define CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT            12
+#define CONFIG_BT_NIMBLE_MSYS1_BLOCK_SIZE             256
+
+#endif /* _SDKCONFIG_H_ */
\ No newline at end of file
@@ -0,0 +1,131 @@
+/*
+ *  test.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdio.h>
+
+#include "fake.h"
+#include "config.h"
+#include "ble_api.h"
+#include "gatt_server.h"
+#include "ble_session.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Host tests are plain executables: main() calls test_setup(), runs its
+ * cases with CHECK() and returns test_result(). One process per file,
+ * ble_api_init() runs once.
+ */
+#define TEST_TIMEOUT_MS                               2000
+#define TEST_PIN_CODE                                 123456
+
+#define CHECK(cond)                                                            \
+    do                                                                         \
+    {                                                                          \
+        if(!(cond))                                                            \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                   \
+        }                                                                      \
+    } while(0)
+
+#define TEST_RUN(fn)                                                           \
+    do                                                                         \
+    {                                                                          \
+        uint32_t failures = test_failures;                                     \
+        fn();                                                                  \
+        printf("%s %s\n", failures == test_failures ? "PASS" : "FAIL", #fn);   \
+    } while(0)
+
+/* Characteristics of the UART service, as a client discovers them */
+static const ble_uuid128_t test_rx_uuid =
+    BLE_UUID128_INIT(0xf6, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+static const ble_uuid128_t test_rx_stream_uuid =
+    BLE_UUID128_INIT(0xf8, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+static const ble_uuid128_t test_rx_ack_uuid =
+    BLE_UUID128_INIT(0xf9, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+static const ble_uuid128_t test_caps_uuid =
+    BLE_UUID128_INIT(0xfb, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+static const ble_uuid128_t test_stats_uuid =
+    BLE_UUID128_INIT(0xfa, 0x6d, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+static uint32_t test_failures;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+/**
+ * @brief  Wait condition: advertising
+ */
+static inline bool test_advertising(void *arg)
+{
+    return fake_adv_active();
+}
+
+/**
+ * @brief  Boot the firmware up to advertising, which waits for the key pair
+ */
+static inline void test_setup(void)
+{
+    fake_set_log_level(FAKE_LOG_ERROR);
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ble_api_init("host", TEST_PIN_CODE);
+    fake_sync();
+    CHECK(fake_run_until(test_advertising, NULL, TEST_TIMEOUT_MS));
+}
+
+/**
+ * @brief  Connect a peer, secure the link, exchange the MTU and subscribe to tx
+ * @retval Connection handle
+ */
+static inline uint16_t test_connect(uint8_t peer, uint16_t mtu)
+{
+    ble_addr_t addr = { BLE_ADDR_PUBLIC, { peer, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    uint16_t conn_handle;
+
+    fake_run_until(test_advertising, NULL, TEST_TIMEOUT_MS);
+    conn_handle = fake_connect(&addr);
+    fake_run();
+    fake_encrypt(conn_handle, true, true, 16);
+    fake_set_mtu(conn_handle, mtu);
+    fake_subscribe(conn_handle, gatt_server_get_tx_handle(), true);
+    fake_run();
+    return conn_handle;
+}
+
+/**
+ * @brief  Exit code of the test
+ */
+static inline int test_result(void)
+{
+    printf("%s: %u failure(s)\n", test_failures == 0 ? "OK" : "FAILED", test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
+
+/******************************************************************************/
+
+#endif /* _TEST_H_ */
\ No newline at end of file
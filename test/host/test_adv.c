@@ -0,0 +1,250 @@
+/*
+ *  test_adv.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_adv.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The fake clock runs in real time between fake_advance_ms() jumps, a
+ * latency may exceed the jumps by what the test itself took.
+ */
+#define TEST_SLACK_MS                                 500
+#define TEST_CONNECT_MS                               100
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static int64_t test_started_us;
+static uint16_t test_conn_handles[BLE_SESSION_MAX];
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint16_t test_peer(uint8_t peer);
+static void test_check_latency(uint32_t elapsed_ms);
+static void test_fast_then_slow(void);
+static void test_connect_slow(void);
+static void test_connect_fast(void);
+static void test_disconnect_restarts_fast(void);
+static void test_payload_changes(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Connect a central to the running advertisement, no pairing
+ * @retval Connection handle
+ */
+static uint16_t test_peer(uint8_t peer)
+{
+    ble_addr_t addr = { BLE_ADDR_PUBLIC, { peer, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    uint16_t conn_handle;
+
+    conn_handle = fake_connect(&addr);
+    CHECK(conn_handle != BLE_HS_CONN_HANDLE_NONE);
+    fake_run();
+    return conn_handle;
+}
+
+/**
+ * @brief  The last connection took elapsed_ms from the advertising start
+ */
+static void test_check_latency(uint32_t elapsed_ms)
+{
+    ble_adv_stats_t stats;
+
+    ble_adv_get_stats(&stats);
+    CHECK(stats.last_connect_ms >= elapsed_ms);
+    CHECK(stats.last_connect_ms < elapsed_ms + TEST_SLACK_MS);
+    CHECK(stats.max_connect_ms >= stats.last_connect_ms);
+}
+
+/**
+ * @brief  Boot advertises fast, the controller times the phase out and the
+ *         slow phase runs until a central connects, payloads set once
+ */
+static void test_fast_then_slow(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+
+    fake_gap_get_stats(&before);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+    CHECK(before.adv_starts == 1);
+    CHECK(before.adv_data_sets == 2);
+
+    fake_advance_ms(BLE_ADV_FAST_DURATION_MS - TEST_SLACK_MS);
+    fake_run();
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+
+    fake_advance_ms(TEST_SLACK_MS);
+    fake_run();
+    fake_gap_get_stats(&after);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_SLOW);
+    CHECK(fake_adv_active());
+    CHECK(after.adv_starts == before.adv_starts + 1);
+    CHECK(after.adv_data_sets == before.adv_data_sets);
+
+    /* BLE_ADV_DURATION_MS is forever */
+    fake_advance_ms(4 * BLE_ADV_FAST_DURATION_MS);
+    fake_run();
+    fake_gap_get_stats(&before);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_SLOW);
+    CHECK(before.adv_starts == after.adv_starts);
+}
+
+/**
+ * @brief  A central connecting in the slow phase is counted there, with
+ *         the time since boot advertised first
+ */
+static void test_connect_slow(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+    ble_adv_stats_t stats;
+
+    fake_gap_get_stats(&before);
+    test_conn_handles[0] = test_peer(1);
+    ble_adv_get_stats(&stats);
+    CHECK(stats.connects[BLE_ADV_PHASE_SLOW] == 1);
+    CHECK(stats.connects[BLE_ADV_PHASE_FAST] == 0);
+    test_check_latency((fake_time_us() - test_started_us) / 1000);
+
+    /* A slot is left, the next central gets the fast phase at once */
+    fake_gap_get_stats(&after);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+    CHECK(after.adv_starts == before.adv_starts + 1);
+    CHECK(after.adv_data_sets == before.adv_data_sets);
+}
+
+/**
+ * @brief  A central connecting in the fast phase is counted there, timed
+ *         from the restart after the previous connection
+ */
+static void test_connect_fast(void)
+{
+    ble_adv_stats_t before;
+    ble_adv_stats_t after;
+
+    ble_adv_get_stats(&before);
+    fake_advance_ms(TEST_CONNECT_MS);
+    test_conn_handles[1] = test_peer(2);
+    ble_adv_get_stats(&after);
+    CHECK(after.connects[BLE_ADV_PHASE_FAST] == 1);
+    CHECK(after.connects[BLE_ADV_PHASE_SLOW] == 1);
+    CHECK(after.max_connect_ms == before.max_connect_ms);
+    test_check_latency(TEST_CONNECT_MS);
+}
+
+/**
+ * @brief  The last slot taken stops advertising, a disconnect frees it and
+ *         advertises fast again
+ */
+static void test_disconnect_restarts_fast(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+    ble_adv_stats_t stats;
+
+    fake_advance_ms(BLE_ADV_FAST_DURATION_MS);
+    fake_run();
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_SLOW);
+    test_conn_handles[2] = test_peer(3);
+    CHECK(ble_session_count() == BLE_SESSION_MAX);
+    CHECK(!fake_adv_active());
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_IDLE);
+
+    fake_gap_get_stats(&before);
+    fake_advance_ms(BLE_ADV_FAST_DURATION_MS);
+    fake_disconnect(test_conn_handles[0], BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    fake_gap_get_stats(&after);
+    CHECK(fake_adv_active());
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+    CHECK(after.adv_starts == before.adv_starts + 1);
+    CHECK(after.adv_data_sets == before.adv_data_sets);
+
+    /* Latency counts from the disconnect, not from the last start */
+    fake_advance_ms(TEST_CONNECT_MS);
+    test_conn_handles[0] = test_peer(4);
+    ble_adv_get_stats(&stats);
+    CHECK(stats.connects[BLE_ADV_PHASE_FAST] == 2);
+    test_check_latency(TEST_CONNECT_MS);
+
+    fake_disconnect(test_conn_handles[0], BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+    fake_advance_ms(BLE_ADV_FAST_DURATION_MS);
+    fake_run();
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_SLOW);
+}
+
+/**
+ * @brief  Service data is updated in place, a new name waits for the next
+ *         start, and nothing is handed over again when unchanged
+ */
+static void test_payload_changes(void)
+{
+    const uint8_t data[] = { 0x01, 0x02, 0x03 };
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+
+    fake_gap_get_stats(&before);
+    CHECK(ble_adv_set_service_data(data, sizeof(data)) == ESP_OK);
+    fake_gap_get_stats(&after);
+    CHECK(after.adv_data_sets == before.adv_data_sets + 2);
+    CHECK(after.adv_starts == before.adv_starts);
+    CHECK(ble_adv_set_service_data(data, BLE_ADV_SERVICE_DATA_MAX + 1) == ESP_ERR_INVALID_SIZE);
+
+    CHECK(ble_adv_set_name("renamed") == ESP_OK);
+    fake_gap_get_stats(&before);
+    CHECK(before.adv_data_sets == after.adv_data_sets);
+
+    /* Connect fills the last slot, the disconnect restarts with the name */
+    test_conn_handles[0] = test_peer(5);
+    CHECK(!fake_adv_active());
+    fake_disconnect(test_conn_handles[0], BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    fake_gap_get_stats(&after);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_FAST);
+    CHECK(after.adv_data_sets == before.adv_data_sets + 2);
+
+    fake_advance_ms(BLE_ADV_FAST_DURATION_MS);
+    fake_run();
+    fake_gap_get_stats(&before);
+    CHECK(ble_adv_get_phase() == BLE_ADV_PHASE_SLOW);
+    CHECK(before.adv_starts == after.adv_starts + 1);
+    CHECK(before.adv_data_sets == after.adv_data_sets);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Advertising phases and reconnect latency against the fake controller
+ */
+int main(void)
+{
+    test_setup();
+    test_started_us = fake_time_us();
+
+    TEST_RUN(test_fast_then_slow);
+    TEST_RUN(test_connect_slow);
+    TEST_RUN(test_connect_fast);
+    TEST_RUN(test_disconnect_restarts_fast);
+    TEST_RUN(test_payload_changes);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,386 @@
+/*
+ *  test_batch.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_batch.h"
+#include "ble_trace.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The benchmark sends the same trace of small sensor records with and
+ * without batches. Air time is modelled on the LE 2M PHY, one notification
+ * per PDU with its empty acknowledgement: preamble, access address, LL
+ * header, L2CAP and ATT headers and CRC, 4 us a byte, plus two IFS.
+ */
+#define TEST_MTU                                      247
+#define TEST_RECORDS                                  20000
+#define TEST_RECORD_MIN                               8
+#define TEST_RECORD_MAX                               20
+#define TEST_PDU_OVERHEAD                             (2 + 4 + 2 + 4 + 3 + 3)
+#define TEST_ACK_US                                   ((2 + 4 + 2 + 3) * 4)
+#define TEST_IFS_US                                   150
+
+typedef struct
+{
+    uint32_t notifications;
+    uint32_t records;
+    uint32_t record_bytes;
+    uint32_t air_bytes;                 /* ATT values */
+    uint64_t air_us;
+    uint32_t errors;
+} test_link_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static uint16_t test_caps_handle;
+static bool test_batched;
+static test_link_t test_link;
+static uint32_t test_produced;          /* Next record of the producer */
+static uint32_t test_produce_until;
+static uint32_t test_overruns;          /* Calls the producer answers with more than size */
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint16_t test_record_size(uint32_t seq);
+static uint16_t test_fill(uint32_t seq, uint8_t *record);
+static size_t test_producer(uint16_t conn_handle, uint8_t *buffer, size_t size);
+static void test_record(const uint8_t *record, size_t size, void *arg);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static bool test_received_all(void *arg);
+static void test_set_caps(uint8_t caps);
+static void test_send(ble_tx_channel_t channel, uint32_t seq);
+static int64_t test_run(bool batched);
+static void test_batched_against_unbatched(void);
+static void test_deadline_flush(void);
+static void test_control_not_delayed(void);
+static void test_malformed_batch(void);
+static void test_producer_after_queue(void);
+static void test_producer_refused(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Size of a record of the trace
+ */
+static uint16_t test_record_size(uint32_t seq)
+{
+    return TEST_RECORD_MIN + (seq * 2654435761u >> 8) % (TEST_RECORD_MAX - TEST_RECORD_MIN + 1);
+}
+
+/**
+ * @brief  Contents of a record of the trace
+ * @retval Record size
+ */
+static uint16_t test_fill(uint32_t seq, uint8_t *record)
+{
+    uint16_t size = test_record_size(seq);
+    uint16_t i;
+
+    memcpy(record, &seq, sizeof(seq));
+    for(i = sizeof(seq); i < size; i++)
+    {
+        record[i] = (uint8_t)(seq + i);
+    }
+    return size;
+}
+
+/**
+ * @brief  Producer continuing the trace up to test_produce_until
+ */
+static size_t test_producer(uint16_t conn_handle, uint8_t *buffer, size_t size)
+{
+    if(test_produced >= test_produce_until || size < TEST_RECORD_MAX)
+    {
+        return 0;
+    }
+    if(test_overruns > 0)
+    {
+        test_overruns--;
+        return size + 1;
+    }
+    return test_fill(test_produced++, buffer);
+}
+
+/**
+ * @brief  One record as the client sees it, in order and intact
+ */
+static void test_record(const uint8_t *record, size_t size, void *arg)
+{
+    uint32_t seq;
+    size_t i;
+
+    memcpy(&seq, record, sizeof(seq));
+    test_link.errors += seq != test_link.records || size != test_record_size(seq);
+    for(i = sizeof(seq); i < size; i++)
+    {
+        test_link.errors += record[i] != (uint8_t)(seq + i);
+    }
+    test_link.record_bytes += size;
+    test_link.records++;
+}
+
+/**
+ * @brief  Client side of the tx characteristic, splits batches
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    if(attr_handle != gatt_server_get_tx_handle())
+    {
+        return;
+    }
+    test_link.notifications++;
+    test_link.air_bytes += length;
+    test_link.air_us += (TEST_PDU_OVERHEAD + length) * 4 + TEST_ACK_US + 2 * TEST_IFS_US;
+    if(!test_batched)
+    {
+        test_record(data, length, NULL);
+    }
+    else if(ble_batch_for_each(data, length, test_record, NULL) < 0)
+    {
+        test_link.errors++;
+    }
+}
+
+/**
+ * @brief  Wait condition: *arg records received
+ */
+static bool test_received_all(void *arg)
+{
+    return test_link.records >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Ask for features, as a client does
+ */
+static void test_set_caps(uint8_t caps)
+{
+    CHECK(fake_gatt_write(test_conn_handle, test_caps_handle, &caps, sizeof(caps)) == 0);
+    test_batched = caps & GATT_SERVER_CAP_BATCH;
+}
+
+/**
+ * @brief  Queue one record of the trace, waiting for room
+ */
+static void test_send(ble_tx_channel_t channel, uint32_t seq)
+{
+    uint8_t record[TEST_RECORD_MAX];
+    uint16_t size = test_fill(seq, record);
+
+    while(ble_api_tx_notify_channel(test_conn_handle, channel, record, size) == ESP_ERR_NO_MEM)
+    {
+        fake_run();
+    }
+}
+
+/**
+ * @brief  Send the trace and report what it cost on air
+ * @retval Modelled air time in us
+ */
+static int64_t test_run(bool batched)
+{
+    uint32_t expected = TEST_RECORDS;
+    int64_t start;
+    int64_t elapsed;
+    uint32_t seq;
+
+    test_set_caps(batched ? GATT_SERVER_CAP_BATCH : 0);
+    memset(&test_link, 0, sizeof(test_link));
+    start = fake_time_us();
+    for(seq = 0; seq < TEST_RECORDS; seq++)
+    {
+        test_send(BLE_TX_CHANNEL_BULK, seq);
+    }
+    CHECK(fake_run_until(test_received_all, &expected, TEST_TIMEOUT_MS));
+    elapsed = fake_time_us() - start;
+
+    CHECK(test_link.records == TEST_RECORDS);
+    CHECK(test_link.errors == 0);
+    printf("%-9s %u records in %u notifications, %.1f a notification, %u bytes on air, "
+           "%.0f B/s goodput at 2M, %.0f records/s on the host\n", batched ? "batched" : "unbatched",
+           test_link.records, test_link.notifications, test_link.records / (double)test_link.notifications,
+           test_link.air_bytes, test_link.record_bytes * 1e6 / test_link.air_us,
+           test_link.records * 1e6 / (elapsed > 0 ? elapsed : 1));
+    return test_link.air_us;
+}
+
+/**
+ * @brief  Batches carry the same records in a fraction of the notifications
+ *         and of the air time
+ */
+static void test_batched_against_unbatched(void)
+{
+    int64_t unbatched_us = test_run(false);
+    uint32_t unbatched = test_link.notifications;
+    int64_t batched_us = test_run(true);
+
+    CHECK(test_link.notifications * 8 < unbatched);
+    CHECK(batched_us * 3 < unbatched_us);
+}
+
+/**
+ * @brief  A partly filled batch waits for more records, at most the deadline
+ */
+static void test_deadline_flush(void)
+{
+    test_set_caps(GATT_SERVER_CAP_BATCH);
+    memset(&test_link, 0, sizeof(test_link));
+    test_send(BLE_TX_CHANNEL_BULK, 0);
+    test_send(BLE_TX_CHANNEL_BULK, 1);
+    fake_run();
+    CHECK(test_link.notifications == 0);
+
+    fake_advance_ms(BLE_TX_COALESCE_DEADLINE_MS);
+    fake_run();
+    CHECK(test_link.notifications == 1);
+    CHECK(test_link.records == 2);
+    CHECK(test_link.errors == 0);
+}
+
+/**
+ * @brief  Control records never wait for company
+ */
+static void test_control_not_delayed(void)
+{
+    test_set_caps(GATT_SERVER_CAP_BATCH);
+    memset(&test_link, 0, sizeof(test_link));
+    test_send(BLE_TX_CHANNEL_CONTROL, 0);
+    fake_run();
+    CHECK(test_link.notifications == 1);
+    CHECK(test_link.records == 1);
+}
+
+/**
+ * @brief  A truncated batch delivers its whole records and reports the error
+ */
+static void test_malformed_batch(void)
+{
+    uint8_t batch[2 * (BLE_BATCH_HEADER_MAX + TEST_RECORD_MAX)];
+    uint32_t seq = 0;
+    size_t length;
+
+    memset(&test_link, 0, sizeof(test_link));
+    memset(batch, 0, sizeof(batch));
+    length = ble_batch_put_header(batch, test_record_size(0));
+    memcpy(batch + length, &seq, sizeof(seq));
+    for(seq = sizeof(seq); seq < test_record_size(0); seq++)
+    {
+        batch[length + seq] = (uint8_t)seq;
+    }
+    length += test_record_size(0);
+    length += ble_batch_put_header(batch + length, 200);
+    CHECK(ble_batch_for_each(batch, length + 10, test_record, NULL) == -1);
+    CHECK(test_link.records == 1);
+    CHECK(test_link.errors == 0);
+    CHECK(ble_batch_for_each(batch, 0, test_record, NULL) == 0);
+}
+
+/**
+ * @brief  Queued records, even a batch still waiting for its deadline, go
+ *         out before anything the producer makes
+ */
+static void test_producer_after_queue(void)
+{
+    ble_tx_producer_stats_t stats;
+    uint32_t expected = 6;
+
+    test_set_caps(GATT_SERVER_CAP_BATCH);
+    memset(&test_link, 0, sizeof(test_link));
+    test_send(BLE_TX_CHANNEL_BULK, 0);
+    test_send(BLE_TX_CHANNEL_BULK, 1);
+    test_produced = 2;
+    test_produce_until = expected;
+    ble_api_register_tx_producer(test_producer);
+    fake_run();
+    ble_api_get_tx_producer_stats(&stats);
+    CHECK(stats.calls == 0);
+    CHECK(test_link.notifications == 0);
+
+    fake_advance_ms(BLE_TX_COALESCE_DEADLINE_MS);
+    CHECK(fake_run_until(test_received_all, &expected, TEST_TIMEOUT_MS));
+    ble_api_register_tx_producer(NULL);
+    CHECK(test_link.records == expected);
+    CHECK(test_link.errors == 0);
+    CHECK(test_link.notifications == 1 + expected - 2);
+}
+
+/**
+ * @brief  A producer answering more than its buffer holds is counted and
+ *         traced apart from an empty one, nothing of it is sent
+ */
+static void test_producer_refused(void)
+{
+    ble_trace_record_t records[BLE_TRACE_RING_SIZE];
+    ble_tx_producer_stats_t stats;
+    uint32_t expected = 2;
+    uint32_t traced = 0;
+    uint32_t count;
+    uint32_t i;
+
+    test_set_caps(GATT_SERVER_CAP_BATCH);
+    memset(&test_link, 0, sizeof(test_link));
+    test_produced = 0;
+    test_produce_until = expected;
+    test_overruns = 1;
+    ble_api_register_tx_producer(test_producer);
+    fake_run();
+    ble_api_get_tx_producer_stats(&stats);
+    CHECK(stats.refused == 1);
+    CHECK(stats.empty == 0);
+
+    fake_advance_ms(BLE_TX_PRODUCER_POLL_MS);
+    CHECK(fake_run_until(test_received_all, &expected, TEST_TIMEOUT_MS));
+    ble_api_get_tx_producer_stats(&stats);
+    ble_api_register_tx_producer(NULL);
+    CHECK(stats.refused == 1);
+    CHECK(stats.produced == expected);
+    CHECK(stats.calls == stats.produced + stats.empty + stats.refused);
+    CHECK(test_link.records == expected);
+    CHECK(test_link.errors == 0);
+
+    count = ble_trace_read(records, BLE_TRACE_RING_SIZE);
+    for(i = 0; i < count; i++)
+    {
+        traced += records[i].event == BLE_TRACE_EV_PRODUCER_REFUSED && records[i].arg0 == test_conn_handle;
+    }
+    CHECK(traced == 1);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Notification batches against single notifications
+ */
+int main(void)
+{
+    test_setup();
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_caps_handle = fake_gatt_find(&test_caps_uuid.u);
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_batched_against_unbatched);
+    TEST_RUN(test_deadline_flush);
+    TEST_RUN(test_control_not_delayed);
+    TEST_RUN(test_malformed_batch);
+    TEST_RUN(test_producer_after_queue);
+    TEST_RUN(test_producer_refused);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+/*
+ *  test_ble_api.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_PEER                                     0x01
+#define TEST_MTU                                      247
+#define TEST_PACKET_SIZE                              100
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static volatile uint32_t test_received;
+static volatile uint32_t test_received_bytes;
+static uint32_t test_notified;
+static uint32_t test_notified_bytes;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static bool test_notified_all(void *arg);
+static bool test_received_all(void *arg);
+static void test_connect_and_notify(void);
+static void test_write_reaches_worker(void);
+static void test_disconnect_releases(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Rx worker handler
+ */
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    test_received_bytes += size;
+    test_received++;
+}
+
+/**
+ * @brief  Count notifications on the tx characteristic
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    if(attr_handle == gatt_server_get_tx_handle())
+    {
+        test_notified_bytes += length;
+        test_notified++;
+    }
+}
+
+/**
+ * @brief  Wait condition: *arg notifications sent
+ */
+static bool test_notified_all(void *arg)
+{
+    return test_notified >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Wait condition: *arg writes handled
+ */
+static bool test_received_all(void *arg)
+{
+    return test_received >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  A subscribed peer gets queued packets as notifications
+ */
+static void test_connect_and_notify(void)
+{
+    uint8_t packet[TEST_PACKET_SIZE];
+    uint32_t expected = 4;
+    ble_stats_t stats;
+    uint16_t conn_handle;
+    uint32_t i;
+
+    conn_handle = test_connect(TEST_PEER, TEST_MTU);
+    test_conn_handle = conn_handle;
+    CHECK(conn_handle != BLE_HS_CONN_HANDLE_NONE);
+    CHECK(ble_session_find(conn_handle) != NULL);
+    CHECK(ble_att_mtu(conn_handle) == TEST_MTU);
+
+    memset(packet, 0xA5, sizeof(packet));
+    for(i = 0; i < expected; i++)
+    {
+        CHECK(ble_api_tx_notify_conn(conn_handle, packet, sizeof(packet)) == ESP_OK);
+    }
+    CHECK(fake_run_until(test_notified_all, &expected, TEST_TIMEOUT_MS));
+    CHECK(test_notified_bytes >= expected * TEST_PACKET_SIZE);
+
+    CHECK(ble_api_get_stats(conn_handle, &stats) == ESP_OK);
+    CHECK(stats.tx_packets == expected);
+    CHECK(stats.tx_bytes == expected * TEST_PACKET_SIZE);
+}
+
+/**
+ * @brief  Writes to the rx characteristic reach the rx worker
+ */
+static void test_write_reaches_worker(void)
+{
+    uint16_t rx_handle = fake_gatt_find(&test_rx_uuid.u);
+    uint16_t conn_handle = test_conn_handle;
+    uint8_t data[20] = "hello";
+    uint32_t expected = 3;
+    uint32_t i;
+
+    CHECK(rx_handle != 0);
+    for(i = 0; i < expected; i++)
+    {
+        CHECK(fake_gatt_write(conn_handle, rx_handle, data, sizeof(data)) == 0);
+    }
+    CHECK(fake_run_until(test_received_all, &expected, TEST_TIMEOUT_MS));
+    CHECK(test_received_bytes == expected * sizeof(data));
+}
+
+/**
+ * @brief  A disconnect closes the session, returns every mbuf and resumes advertising
+ */
+static void test_disconnect_releases(void)
+{
+    uint16_t conn_handle = test_conn_handle;
+
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    CHECK(ble_session_find(conn_handle) == NULL);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+    CHECK(fake_adv_active());
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Smoke test of the host target
+ */
+int main(void)
+{
+    test_setup();
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(test_rx_handler, 1));
+    fake_notify_set_hook(test_notify_hook, NULL);
+
+    TEST_RUN(test_connect_and_notify);
+    TEST_RUN(test_write_reaches_worker);
+    TEST_RUN(test_disconnect_releases);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+ *  test_boot_fast_start.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_boot.h"
+#include "ble_pair.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+_Static_assert(BLE_BOOT_FAST_START, "test_boot_fast_start links against ble_api_host_fast_start");
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static bool test_deferred_done(void *arg);
+static bool test_keys_ready(void *arg);
+static void test_advertise_first(void);
+static void test_keys_after_deferred(void);
+static void test_resync_keeps_keys(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Wait condition: the deferred boot stage ran
+ */
+static bool test_deferred_done(void *arg)
+{
+    ble_boot_times_t times;
+
+    ble_boot_get_times(&times);
+    return times.us[BLE_BOOT_DEFERRED_DONE] != 0;
+}
+
+/**
+ * @brief  Wait condition: the background key pair is ready
+ */
+static bool test_keys_ready(void *arg)
+{
+    ble_pair_stats_t stats;
+
+    ble_pair_get_stats(&stats);
+    return stats.keygen_us != 0;
+}
+
+/**
+ * @brief  Advertising starts before the deferred stage, without bonding
+ *         until the bond store is loaded
+ */
+static void test_advertise_first(void)
+{
+    ble_boot_times_t times;
+
+    ble_boot_get_times(&times);
+    CHECK(times.us[BLE_BOOT_ADVERTISING] != 0);
+    CHECK(times.us[BLE_BOOT_DEFERRED_DONE] == 0 ||
+          times.us[BLE_BOOT_DEFERRED_DONE] >= times.us[BLE_BOOT_ADVERTISING]);
+    if(times.us[BLE_BOOT_DEFERRED_DONE] == 0)
+    {
+        CHECK(ble_hs_cfg.sm_bonding == 0);
+    }
+}
+
+/**
+ * @brief  The deferred stage enables bonding and has the key pair
+ *         generated, the sync callback skipped it to advertise first
+ */
+static void test_keys_after_deferred(void)
+{
+    CHECK(fake_run_until(test_deferred_done, NULL, TEST_TIMEOUT_MS));
+    CHECK(ble_hs_cfg.sm_bonding != 0);
+    CHECK(fake_run_until(test_keys_ready, NULL, TEST_TIMEOUT_MS));
+    CHECK(fake_adv_active());
+}
+
+/**
+ * @brief  A host reset after the key pair advertises at once, the pair is
+ *         not generated again
+ */
+static void test_resync_keeps_keys(void)
+{
+    ble_pair_stats_t before;
+    ble_pair_stats_t after;
+
+    ble_pair_get_stats(&before);
+    ble_hs_cfg.reset_cb(BLE_HS_ETIMEOUT);
+    fake_sync();
+    CHECK(fake_run_until(test_advertising, NULL, TEST_TIMEOUT_MS));
+    fake_run();
+    ble_pair_get_stats(&after);
+    CHECK(after.keygen_us == before.keygen_us);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Fast start boot order against the fake platform
+ */
+int main(void)
+{
+    test_setup();
+
+    TEST_RUN(test_advertise_first);
+    TEST_RUN(test_keys_after_deferred);
+    TEST_RUN(test_resync_keeps_keys);
+    return test_result();
+}
\ No newline at end of file
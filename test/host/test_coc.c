@@ -0,0 +1,321 @@
+/*
+ *  test_coc.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_coc.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_MTU                                      247
+#define TEST_LOOPBACK_SDUS                            20000
+#define TEST_LOOPBACK_CREDITS                         FAKE_COC_ECHO_MAX
+#define TEST_SMALL_PEER_MTU                           512
+#define TEST_RECONNECTS                               (4 * BLE_COC_BUF_PER_CHANNEL * BLE_COC_MAX_CHANNELS)
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static uint8_t test_sdu[BLE_COC_MTU];
+static uint32_t test_received;
+static uint32_t test_received_bytes;
+static uint32_t test_corrupt;
+static uint32_t test_peer_received;
+static uint16_t test_peer_length;
+static uint32_t test_tx_ready;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_fill(uint8_t *sdu, uint32_t seq, uint16_t size);
+static bool test_check(const uint8_t *sdu, uint32_t seq, uint16_t size);
+static uint16_t test_size(uint32_t seq);
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static void test_peer_hook(uint16_t conn_handle, const uint8_t *data, uint16_t length, void *arg);
+static void test_tx_ready_handler(uint16_t conn_handle);
+static void test_no_channel_refused(void);
+static void test_loopback_in_order(void);
+static void test_credit_stall(void);
+static void test_peer_mtu_limits(void);
+static void test_msys_reserve(void);
+static void test_peer_sends(void);
+static void test_close_returns_buffers(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Numbered SDU, the pattern depends on the sequence number
+ */
+static void test_fill(uint8_t *sdu, uint32_t seq, uint16_t size)
+{
+    uint16_t i;
+
+    memcpy(sdu, &seq, sizeof(seq));
+    for(i = sizeof(seq); i < size; i++)
+    {
+        sdu[i] = (uint8_t)(seq + i);
+    }
+}
+
+/**
+ * @brief  Check an SDU made by test_fill()
+ */
+static bool test_check(const uint8_t *sdu, uint32_t seq, uint16_t size)
+{
+    uint32_t got;
+    uint16_t i;
+
+    memcpy(&got, sdu, sizeof(got));
+    if(got != seq || size != test_size(seq))
+    {
+        return false;
+    }
+    for(i = sizeof(seq); i < size; i++)
+    {
+        if(sdu[i] != (uint8_t)(seq + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  SDU sizes of the loopback run, one K-frame up to the full MTU
+ */
+static uint16_t test_size(uint32_t seq)
+{
+    return sizeof(uint32_t) + (seq * 2654435761u >> 8) % (BLE_COC_MTU - sizeof(uint32_t) + 1);
+}
+
+/**
+ * @brief  SDUs sent back by the peer
+ */
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    test_corrupt += !test_check(data, test_received, size);
+    test_received_bytes += size;
+    test_received++;
+}
+
+/**
+ * @brief  SDUs the peer received
+ */
+static void test_peer_hook(uint16_t conn_handle, const uint8_t *data, uint16_t length, void *arg)
+{
+    test_peer_received++;
+    test_peer_length = length;
+}
+
+/**
+ * @brief  Count tx ready callbacks
+ */
+static void test_tx_ready_handler(uint16_t conn_handle)
+{
+    test_tx_ready++;
+}
+
+/**
+ * @brief  Nothing is sent to a peer without an open channel
+ */
+static void test_no_channel_refused(void)
+{
+    CHECK(!ble_coc_is_connected(test_conn_handle));
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_ERR_INVALID_STATE);
+}
+
+/**
+ * @brief  SDUs of every size come back from a loopback peer once, in order
+ *         and intact, with the credits the peer returns as the only pacing
+ */
+static void test_loopback_in_order(void)
+{
+    uint32_t sent = 0;
+    uint32_t busy = 0;
+    int64_t start;
+    int64_t elapsed;
+    esp_err_t rc;
+
+    fake_coc_loopback(true);
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, TEST_LOOPBACK_CREDITS) == 0);
+    CHECK(ble_coc_is_connected(test_conn_handle));
+
+    start = fake_time_us();
+    while(sent < TEST_LOOPBACK_SDUS && fake_time_us() - start < 10 * 1000000LL)
+    {
+        test_fill(test_sdu, sent, test_size(sent));
+        rc = ble_coc_send(test_conn_handle, test_sdu, test_size(sent));
+        if(rc == ESP_OK)
+        {
+            sent++;
+            continue;
+        }
+        CHECK(rc == ESP_ERR_NO_MEM);
+        busy++;
+        fake_run();
+    }
+    fake_run();
+    elapsed = fake_time_us() - start;
+
+    CHECK(sent == TEST_LOOPBACK_SDUS);
+    CHECK(test_received == sent);
+    CHECK(test_corrupt == 0);
+    CHECK(fake_coc_peer_credits(test_conn_handle) == TEST_LOOPBACK_CREDITS);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+    printf("loopback: %u SDUs, %u bytes, %.0f SDU/s, %.0f B/s, %u sends waited for credits\n", test_received,
+           test_received_bytes, test_received * 1e6 / (elapsed > 0 ? elapsed : 1),
+           test_received_bytes * 1e6 / (elapsed > 0 ? elapsed : 1), busy);
+
+    fake_coc_loopback(false);
+    fake_coc_disconnect(test_conn_handle);
+    CHECK(!ble_coc_is_connected(test_conn_handle));
+}
+
+/**
+ * @brief  An SDU longer than the credits of the peer is accepted and stalls
+ *         the channel, the next one waits for the tx ready callback
+ */
+static void test_credit_stall(void)
+{
+    uint16_t frames = (BLE_COC_MTU + 2 + FAKE_COC_MPS - 1) / FAKE_COC_MPS;
+
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, frames / 2) == 0);
+    test_fill(test_sdu, 0, BLE_COC_MTU);
+    test_peer_received = 0;
+    test_tx_ready = 0;
+
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, BLE_COC_MTU) == ESP_OK);
+    CHECK(test_peer_received == 0);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_ERR_NO_MEM);
+
+    fake_coc_credits(test_conn_handle, 1);
+    CHECK(test_tx_ready == 0);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_ERR_NO_MEM);
+
+    fake_coc_credits(test_conn_handle, frames);
+    CHECK(test_tx_ready == 1);
+    CHECK(test_peer_received == 1);
+    CHECK(test_peer_length == BLE_COC_MTU);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_OK);
+    CHECK(test_peer_received == 2);
+    fake_coc_disconnect(test_conn_handle);
+}
+
+/**
+ * @brief  SDUs are limited to the MTU the peer announced
+ */
+static void test_peer_mtu_limits(void)
+{
+    CHECK(fake_coc_connect(test_conn_handle, TEST_SMALL_PEER_MTU, TEST_LOOPBACK_CREDITS) == 0);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, TEST_SMALL_PEER_MTU + 1) == ESP_ERR_INVALID_SIZE);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, TEST_SMALL_PEER_MTU) == ESP_OK);
+    fake_coc_disconnect(test_conn_handle);
+}
+
+/**
+ * @brief  Sends leave the msys reserve to RX and GATT
+ */
+static void test_msys_reserve(void)
+{
+    struct os_mbuf *taken[CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT];
+    uint32_t count = 0;
+
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, TEST_LOOPBACK_CREDITS) == 0);
+    while(os_msys_num_free() > BLE_TX_MSYS_RESERVE)
+    {
+        taken[count++] = os_msys_get_pkthdr(0, 0);
+    }
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_ERR_NO_MEM);
+    os_mbuf_free_chain(taken[--count]);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, 16) == ESP_OK);
+    while(count > 0)
+    {
+        os_mbuf_free_chain(taken[--count]);
+    }
+    fake_coc_disconnect(test_conn_handle);
+}
+
+/**
+ * @brief  Full size SDUs from the peer reach the flat handler back to back,
+ *         each one re-arms the receive buffer
+ */
+static void test_peer_sends(void)
+{
+    uint32_t i;
+
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, TEST_LOOPBACK_CREDITS) == 0);
+    test_received = 0;
+    test_corrupt = 0;
+    for(i = 0; i < 8; i++)
+    {
+        test_fill(test_sdu, i, test_size(i));
+        CHECK(fake_coc_send(test_conn_handle, test_sdu, test_size(i)) == 0);
+    }
+    CHECK(test_received == 8);
+    CHECK(test_corrupt == 0);
+    CHECK(fake_coc_send(test_conn_handle, test_sdu, BLE_COC_MTU + 1) == BLE_HS_EMSGSIZE);
+    fake_coc_disconnect(test_conn_handle);
+}
+
+/**
+ * @brief  Closing a channel, stalled or not and by either side, returns its
+ *         SDU buffers: reopening never runs out of them
+ */
+static void test_close_returns_buffers(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_RECONNECTS; i++)
+    {
+        CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, 1) == 0);
+        CHECK(ble_coc_send(test_conn_handle, test_sdu, BLE_COC_MTU) == ESP_OK);
+        fake_coc_disconnect(test_conn_handle);
+    }
+
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, 1) == 0);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, BLE_COC_MTU) == ESP_OK);
+    fake_disconnect(test_conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    CHECK(!ble_coc_is_connected(test_conn_handle));
+
+    test_conn_handle = test_connect(2, TEST_MTU);
+    CHECK(fake_coc_connect(test_conn_handle, BLE_COC_MTU, TEST_LOOPBACK_CREDITS) == 0);
+    CHECK(ble_coc_send(test_conn_handle, test_sdu, BLE_COC_MTU) == ESP_OK);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  L2CAP CoC transport against a loopback peer
+ */
+int main(void)
+{
+    test_setup();
+    ble_coc_register_rx_handler(test_rx_handler);
+    ble_coc_register_tx_ready_handler(test_tx_ready_handler);
+    fake_coc_set_hook(test_peer_hook, NULL);
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_no_channel_refused);
+    TEST_RUN(test_loopback_in_order);
+    TEST_RUN(test_credit_stall);
+    TEST_RUN(test_peer_mtu_limits);
+    TEST_RUN(test_msys_reserve);
+    TEST_RUN(test_peer_sends);
+    TEST_RUN(test_close_returns_buffers);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,558 @@
+/*
+ *  test_frame.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_frame.h"
+#include "ble_pool.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_MTU                                      247
+#define TEST_TX_MESSAGES                              3000
+#define TEST_RX_MESSAGES                              20000
+#define TEST_RX_FRAME_SIZE                            (TEST_MTU - BLE_FRAME_ATT_OVERHEAD)
+#define TEST_RX_FRAMES_MAX                            (BLE_FRAME_MAX_MESSAGE_SIZE / (TEST_RX_FRAME_SIZE - 1) + 2)
+#define TEST_RANDOM_FRAMES                            200000
+
+/* Ways the fuzzer damages a message */
+typedef enum
+{
+    TEST_MUTATE_NONE = 0,
+    TEST_MUTATE_DROP,                   /* One frame lost */
+    TEST_MUTATE_DUPLICATE,              /* One frame, not the last, sent twice */
+    TEST_MUTATE_SHORT,                  /* Start frame announces more than is sent */
+    TEST_MUTATE_NOISE,                  /* Continuation frames of no message in front of it */
+    TEST_MUTATE_MAX,
+} test_mutation_t;
+
+typedef struct
+{
+    uint16_t length;
+    uint8_t data[TEST_RX_FRAME_SIZE];
+} test_frame_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static uint16_t test_rx_handle;
+static uint32_t test_random_state = 0x2545F491u;
+static uint8_t test_message[BLE_FRAME_MAX_MESSAGE_SIZE];
+
+/* Client side reassembly of notified frames */
+static uint8_t test_client_buf[BLE_FRAME_MAX_MESSAGE_SIZE];
+static uint16_t test_client_total;
+static uint16_t test_client_len;
+static uint8_t test_client_seq;
+static uint32_t test_client_frames;
+static uint32_t test_client_messages;
+static uint32_t test_client_errors;
+
+/* Messages reassembled by the firmware */
+static bool test_rx_checking;
+static uint32_t test_rx_next_id;
+static uint32_t test_rx_delivered;
+static uint32_t test_rx_bytes;
+static uint32_t test_rx_errors;
+
+static test_frame_t test_frames[TEST_RX_FRAMES_MAX];
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint32_t test_random(void);
+static uint16_t test_message_size(uint32_t id);
+static void test_message_fill(uint8_t *message, uint32_t id, uint16_t size);
+static bool test_message_check(const uint8_t *message, uint32_t id, size_t size);
+static uint32_t test_frame_message(const uint8_t *message, uint16_t size, uint8_t *seq);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static void test_frame_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static void test_write_frame(const test_frame_t *frame, bool through_gatt);
+static uint32_t test_large_in_use(void);
+static void test_send_refused(void);
+static void test_tx_round_trip(void);
+static void test_tx_pending_limit(void);
+static void test_rx_fuzz(void);
+static void test_rx_random_frames(void);
+static void test_close_releases(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  xorshift, runs are the same every time
+ */
+static uint32_t test_random(void)
+{
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * @brief  Message sizes, mostly small with a long tail up to the maximum.
+ *         Every message is long enough to carry its id
+ */
+static uint16_t test_message_size(uint32_t id)
+{
+    uint32_t hash = id * 2654435761u;
+
+    if((hash >> 30) == 0)
+    {
+        return sizeof(id) + (hash >> 8) % (BLE_FRAME_MAX_MESSAGE_SIZE - sizeof(id) + 1);
+    }
+    return sizeof(id) + (hash >> 8) % 600;
+}
+
+/**
+ * @brief  Message content depends on its id and size
+ */
+static void test_message_fill(uint8_t *message, uint32_t id, uint16_t size)
+{
+    uint16_t i;
+
+    memcpy(message, &id, sizeof(id));
+    for(i = sizeof(id); i < size; i++)
+    {
+        message[i] = (uint8_t)(id * 31 + i * 7);
+    }
+}
+
+/**
+ * @brief  Check a message made by test_message_fill()
+ */
+static bool test_message_check(const uint8_t *message, uint32_t id, size_t size)
+{
+    uint32_t got;
+    size_t i;
+
+    if(size != test_message_size(id))
+    {
+        return false;
+    }
+    memcpy(&got, message, sizeof(got));
+    for(i = sizeof(got); i < size; i++)
+    {
+        if(message[i] != (uint8_t)(id * 31 + i * 7))
+        {
+            return false;
+        }
+    }
+    return got == id;
+}
+
+/**
+ * @brief  Split a message into test_frames the way a client does
+ * @retval Number of frames
+ */
+static uint32_t test_frame_message(const uint8_t *message, uint16_t size, uint8_t *seq)
+{
+    uint32_t count = 0;
+    uint16_t offset = 0;
+    uint16_t hdrlen;
+    uint16_t chunk;
+    test_frame_t *frame;
+
+    while(offset < size)
+    {
+        frame = &test_frames[count++];
+        frame->data[0] = *seq;
+        hdrlen = BLE_FRAME_HEADER_SIZE;
+        if(offset == 0)
+        {
+            frame->data[0] |= BLE_FRAME_START;
+            frame->data[1] = size & 0xFF;
+            frame->data[2] = size >> 8;
+            hdrlen = BLE_FRAME_START_HEADER_SIZE;
+        }
+        chunk = TEST_RX_FRAME_SIZE - hdrlen;
+        if(chunk >= size - offset)
+        {
+            chunk = size - offset;
+            frame->data[0] |= BLE_FRAME_END;
+        }
+        memcpy(frame->data + hdrlen, message + offset, chunk);
+        frame->length = hdrlen + chunk;
+        offset += chunk;
+        *seq = (*seq + 1) & BLE_FRAME_SEQ_MASK;
+    }
+    return count;
+}
+
+/**
+ * @brief  Client side of the tx characteristic: reassemble and check the
+ *         order, every message carries the next id
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    uint16_t offset = BLE_FRAME_HEADER_SIZE;
+
+    if(attr_handle != gatt_server_get_tx_handle() || length < BLE_FRAME_HEADER_SIZE)
+    {
+        return;
+    }
+    test_client_frames++;
+    if((data[0] & BLE_FRAME_SEQ_MASK) != test_client_seq)
+    {
+        test_client_errors++;
+    }
+    test_client_seq = (data[0] + 1) & BLE_FRAME_SEQ_MASK;
+    if(data[0] & BLE_FRAME_START)
+    {
+        test_client_total = data[1] | (data[2] << 8);
+        test_client_len = 0;
+        offset = BLE_FRAME_START_HEADER_SIZE;
+    }
+    if(test_client_len + length - offset > sizeof(test_client_buf))
+    {
+        test_client_errors++;
+        return;
+    }
+    memcpy(test_client_buf + test_client_len, data + offset, length - offset);
+    test_client_len += length - offset;
+    if(data[0] & BLE_FRAME_END)
+    {
+        if(test_client_len != test_client_total ||
+           !test_message_check(test_client_buf, test_client_messages, test_client_len))
+        {
+            test_client_errors++;
+        }
+        test_client_messages++;
+    }
+}
+
+/**
+ * @brief  Reassembled messages must be intact and come in id order, lost
+ *         ones skipped
+ */
+static void test_frame_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    uint32_t id;
+
+    test_rx_delivered++;
+    test_rx_bytes += size;
+    if(!test_rx_checking)
+    {
+        return;
+    }
+    if(size < sizeof(id))
+    {
+        test_rx_errors++;
+        return;
+    }
+    memcpy(&id, data, sizeof(id));
+    if(id < test_rx_next_id || !test_message_check(data, id, size))
+    {
+        test_rx_errors++;
+        return;
+    }
+    test_rx_next_id = id + 1;
+}
+
+/**
+ * @brief  Hand one frame to the firmware, as a GATT write or straight in
+ */
+static void test_write_frame(const test_frame_t *frame, bool through_gatt)
+{
+    if(through_gatt)
+    {
+        fake_gatt_write(test_conn_handle, test_rx_handle, frame->data, frame->length);
+    }
+    else
+    {
+        ble_frame_rx(test_conn_handle, frame->data, frame->length);
+    }
+}
+
+/**
+ * @brief  Blocks of the message pool in use
+ */
+static uint32_t test_large_in_use(void)
+{
+    ble_pool_stats_t stats;
+
+    ble_pool_get_stats(BLE_POOL_LARGE, &stats);
+    return stats.in_use;
+}
+
+/**
+ * @brief  Empty, oversized and unsubscribed sends are refused
+ */
+static void test_send_refused(void)
+{
+    CHECK(ble_frame_send(test_conn_handle, test_message, 0) == ESP_ERR_INVALID_SIZE);
+    CHECK(ble_frame_send(test_conn_handle, test_message, BLE_FRAME_MAX_MESSAGE_SIZE + 1) ==
+          ESP_ERR_INVALID_SIZE);
+    CHECK(ble_frame_send(BLE_HS_CONN_HANDLE_NONE, test_message, 16) == ESP_ERR_INVALID_STATE);
+}
+
+/**
+ * @brief  Messages of every size reach the client intact and in order, no
+ *         heap allocation on the way
+ */
+static void test_tx_round_trip(void)
+{
+    uint32_t allocs = fake_heap_allocs();
+    uint32_t bytes = 0;
+    uint32_t id = 0;
+    int64_t start;
+    int64_t elapsed;
+    esp_err_t rc;
+
+    start = fake_time_us();
+    while(id < TEST_TX_MESSAGES && fake_time_us() - start < 10 * 1000000LL)
+    {
+        test_message_fill(test_message, id, test_message_size(id));
+        rc = ble_frame_send(test_conn_handle, test_message, test_message_size(id));
+        if(rc == ESP_OK)
+        {
+            bytes += test_message_size(id);
+            id++;
+            continue;
+        }
+        CHECK(rc == ESP_ERR_NO_MEM);
+        fake_run();
+    }
+    fake_run();
+    elapsed = fake_time_us() - start;
+
+    CHECK(id == TEST_TX_MESSAGES);
+    CHECK(test_client_messages == TEST_TX_MESSAGES);
+    CHECK(test_client_errors == 0);
+    CHECK(fake_heap_allocs() == allocs);
+    CHECK(test_large_in_use() == 0);
+    printf("tx: %u messages, %u bytes in %u frames, %.0f msg/s, %.0f B/s\n", test_client_messages, bytes,
+           test_client_frames, test_client_messages * 1e6 / (elapsed > 0 ? elapsed : 1),
+           bytes * 1e6 / (elapsed > 0 ? elapsed : 1));
+}
+
+/**
+ * @brief  While the link is stuck at most BLE_FRAME_TX_PENDING messages wait
+ *         per peer, the rest is refused
+ */
+static void test_tx_pending_limit(void)
+{
+    uint32_t accepted = 0;
+    uint32_t id = test_client_messages;
+
+    fake_link_hold(true);
+    test_message_fill(test_message, id, test_message_size(id));
+    while(ble_frame_send(test_conn_handle, test_message, test_message_size(id)) == ESP_OK &&
+          accepted < 2 * BLE_FRAME_TX_PENDING)
+    {
+        accepted++;
+    }
+    CHECK(accepted == BLE_FRAME_TX_PENDING);
+    fake_link_release(test_conn_handle, FAKE_LINK_HELD_MAX);
+    fake_link_hold(false);
+    ble_frame_close(test_conn_handle);
+    CHECK(test_large_in_use() == 0);
+}
+
+/**
+ * @brief  Replay client messages, a share of them damaged, through the GATT
+ *         write path and straight in. Damaged messages are dropped, never
+ *         spliced, every intact one is delivered and nothing leaks
+ */
+static void test_rx_fuzz(void)
+{
+    uint32_t dropped = ble_frame_get_rx_dropped();
+    uint32_t expected = 0;
+    test_mutation_t mutation;
+    test_mutation_t previous = TEST_MUTATE_NONE;
+    uint32_t frames;
+    uint32_t victim;
+    uint32_t i;
+    uint32_t j;
+    uint8_t seq = 0;
+    uint16_t size;
+    int64_t start;
+    int64_t elapsed;
+    bool through_gatt;
+
+    test_rx_checking = true;
+    test_rx_next_id = 0;
+    test_rx_delivered = 0;
+    test_rx_bytes = 0;
+    start = fake_time_us();
+    for(i = 0; i < TEST_RX_MESSAGES; i++)
+    {
+        size = test_message_size(i);
+        test_message_fill(test_message, i, size);
+        frames = test_frame_message(test_message, size, &seq);
+        mutation = test_random() % 8 < 6 ? TEST_MUTATE_NONE : 1 + test_random() % (TEST_MUTATE_MAX - 1);
+        through_gatt = i & 1;
+        victim = test_random() % frames;
+
+        switch(mutation)
+        {
+        case TEST_MUTATE_DROP:
+            for(j = 0; j < frames; j++)
+            {
+                if(j != victim)
+                {
+                    test_write_frame(&test_frames[j], through_gatt);
+                }
+            }
+            break;
+
+        case TEST_MUTATE_DUPLICATE:
+            if(frames < 2)
+            {
+                mutation = TEST_MUTATE_NONE;
+                break;
+            }
+            victim %= frames - 1;
+            for(j = 0; j < frames; j++)
+            {
+                test_write_frame(&test_frames[j], through_gatt);
+                if(j == victim)
+                {
+                    test_write_frame(&test_frames[j], through_gatt);
+                }
+            }
+
+            /* A repeated start frame restarts the message, it gets through */
+            expected += victim == 0;
+            break;
+
+        case TEST_MUTATE_SHORT:
+            if(size == BLE_FRAME_MAX_MESSAGE_SIZE)
+            {
+                mutation = TEST_MUTATE_NONE;
+                break;
+            }
+            test_frames[0].data[1] = (size + 1) & 0xFF;
+            test_frames[0].data[2] = (size + 1) >> 8;
+            for(j = 0; j < frames; j++)
+            {
+                test_write_frame(&test_frames[j], through_gatt);
+            }
+            break;
+
+        case TEST_MUTATE_NOISE:
+            /* Never a start bit, and never behind a message that lost its
+             * end, so noise cannot pass for a message: frames carry no CRC */
+            for(j = 0; j < 3 && previous != TEST_MUTATE_DROP; j++)
+            {
+                test_frame_t noise = { .length = 1 + test_random() % TEST_RX_FRAME_SIZE };
+
+                memset(noise.data, (uint8_t)test_random(), noise.length);
+                noise.data[0] &= ~BLE_FRAME_START;
+                test_write_frame(&noise, through_gatt);
+            }
+            mutation = TEST_MUTATE_NONE;
+            break;
+
+        default:
+            break;
+        }
+
+        if(mutation == TEST_MUTATE_NONE)
+        {
+            for(j = 0; j < frames; j++)
+            {
+                test_write_frame(&test_frames[j], through_gatt);
+            }
+            expected++;
+        }
+        previous = mutation;
+    }
+    elapsed = fake_time_us() - start;
+    test_rx_checking = false;
+
+    /* The last message may be waiting for a start frame to abort it */
+    ble_frame_close(test_conn_handle);
+    CHECK(test_rx_errors == 0);
+    CHECK(test_rx_delivered == expected);
+    CHECK(ble_frame_get_rx_dropped() > dropped);
+    CHECK(test_large_in_use() == 0);
+    printf("rx: %u messages, %u delivered, %u dropped, %.0f msg/s, %.0f B/s delivered\n", TEST_RX_MESSAGES,
+           test_rx_delivered, ble_frame_get_rx_dropped() - dropped,
+           test_rx_delivered * 1e6 / (elapsed > 0 ? elapsed : 1), test_rx_bytes * 1e6 / (elapsed > 0 ? elapsed : 1));
+}
+
+/**
+ * @brief  Frames of random bytes and lengths, empty ones included, never
+ *         crash the reassembly or leak a buffer
+ */
+static void test_rx_random_frames(void)
+{
+    test_frame_t frame;
+    uint32_t i;
+    uint16_t j;
+
+    for(i = 0; i < TEST_RANDOM_FRAMES; i++)
+    {
+        frame.length = test_random() % (TEST_RX_FRAME_SIZE + 1);
+        for(j = 0; j < frame.length; j++)
+        {
+            frame.data[j] = (uint8_t)test_random();
+        }
+        test_write_frame(&frame, i & 1);
+    }
+    ble_frame_close(test_conn_handle);
+    CHECK(test_large_in_use() == 0);
+}
+
+/**
+ * @brief  A disconnect in the middle of a message frees the reassembly
+ *         buffer and the messages still waiting to be sent
+ */
+static void test_close_releases(void)
+{
+    uint8_t seq = 0;
+
+    test_message_fill(test_message, 0, BLE_FRAME_MAX_MESSAGE_SIZE);
+    test_frame_message(test_message, BLE_FRAME_MAX_MESSAGE_SIZE, &seq);
+    test_write_frame(&test_frames[0], true);
+    CHECK(test_large_in_use() == 1);
+
+    fake_link_hold(true);
+    CHECK(ble_frame_send(test_conn_handle, test_message, BLE_FRAME_MAX_MESSAGE_SIZE) == ESP_OK);
+    CHECK(test_large_in_use() == 2);
+
+    fake_disconnect(test_conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    fake_link_hold(false);
+    CHECK(test_large_in_use() == 0);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Framing of large messages, tx round trip, rx fuzzing
+ */
+int main(void)
+{
+    test_setup();
+    ESP_ERROR_CHECK(ble_frame_init(test_frame_handler));
+    gatt_server_register_rx_mbuf_handler(ble_frame_rx_mbuf);
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_rx_handle = fake_gatt_find(&test_rx_uuid.u);
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_send_refused);
+    TEST_RUN(test_tx_round_trip);
+    TEST_RUN(test_tx_pending_limit);
+    TEST_RUN(test_rx_fuzz);
+    TEST_RUN(test_rx_random_frames);
+    TEST_RUN(test_close_releases);
+    return test_result();
+}
\ No newline at end of file
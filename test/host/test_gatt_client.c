@@ -0,0 +1,354 @@
+/*
+ *  test_gatt_client.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "gatt_client.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Two peripherals of the fleet expose the same database. A first connection
+ * runs MTU exchange, three discoveries and the subscription, a reconnect
+ * from saved handles only the MTU exchange and the subscription.
+ */
+#define TEST_PROCS_DISCOVERY                          5
+#define TEST_PROCS_CACHED                             2
+#define TEST_PEERS                                    GATT_CLIENT_PEERS_MAX
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const ble_uuid16_t test_service_uuid = BLE_UUID16_INIT(0x181A);
+static const ble_uuid16_t test_chr_uuid = BLE_UUID16_INIT(0x2A6E);
+
+static const fake_peer_db_t test_db =
+{
+    &test_service_uuid.u, 0x0020, 0x002F, &test_chr_uuid.u, 0x0023, 0x0024
+};
+
+/* Firmware update of the peers, the service moved */
+static const fake_peer_db_t test_db_moved =
+{
+    &test_service_uuid.u, 0x0030, 0x003F, &test_chr_uuid.u, 0x0035, 0x0036
+};
+
+static const ble_addr_t test_peers[] =
+{
+    { BLE_ADDR_PUBLIC, { 0x01, 0xA0, 0x33, 0x44, 0x55, 0x66 } },
+    { BLE_ADDR_RANDOM, { 0x02, 0xA0, 0x33, 0x44, 0x55, 0xC6 } },
+    { BLE_ADDR_PUBLIC, { 0x03, 0xA0, 0x33, 0x44, 0x55, 0x66 } },
+};
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint16_t test_conn_handle(const ble_addr_t *addr);
+static void test_drop(const ble_addr_t *addr);
+static void test_parallel_discovery(void);
+static void test_poll_before_answers(void);
+static void test_cached_reconnect(void);
+static void test_stale_handles(void);
+static void test_remove_ready(void);
+static void test_remove_discovering(void);
+static void test_remove_connecting(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Connection handle of a peer
+ * @retval Handle, BLE_HS_CONN_HANDLE_NONE when not connected
+ */
+static uint16_t test_conn_handle(const ble_addr_t *addr)
+{
+    struct ble_gap_conn_desc desc;
+
+    if(ble_gap_conn_find_by_addr(addr, &desc) != 0)
+    {
+        return BLE_HS_CONN_HANDLE_NONE;
+    }
+    return desc.conn_handle;
+}
+
+/**
+ * @brief  A peer drops its connection, out of range for a moment
+ */
+static void test_drop(const ble_addr_t *addr)
+{
+    uint16_t conn_handle = test_conn_handle(addr);
+
+    CHECK(conn_handle != BLE_HS_CONN_HANDLE_NONE);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+}
+
+/**
+ * @brief  Peers added together discover side by side: the second connects
+ *         while the first discovers, their procedures are in flight at once
+ */
+static void test_parallel_discovery(void)
+{
+    gatt_client_stats_t stats;
+    fake_gap_stats_t gap;
+    uint8_t i;
+
+    for(i = 0; i < TEST_PEERS; i++)
+    {
+        CHECK(gatt_client_add(&test_peers[i]) == ESP_OK);
+    }
+    CHECK(gatt_client_add(&test_peers[0]) == ESP_ERR_INVALID_STATE);
+    CHECK(gatt_client_add(&test_peers[TEST_PEERS]) == ESP_ERR_NO_MEM);
+    fake_run();
+
+    gatt_client_get_stats(&stats);
+    fake_gap_get_stats(&gap);
+    CHECK(stats.connects == TEST_PEERS);
+    CHECK(stats.discoveries == TEST_PEERS);
+    CHECK(stats.cache_hits == 0);
+    CHECK(stats.errors == 0);
+    CHECK(gap.central_connects == TEST_PEERS);
+    CHECK(gap.gattc_procedures == TEST_PEERS * TEST_PROCS_DISCOVERY);
+    CHECK(gap.gattc_in_flight_max >= TEST_PEERS);
+    CHECK(gap.gattc_in_flight == 0);
+}
+
+/**
+ * @brief  A poll has every read in flight before the first answer, the
+ *         values of all peers land in the queue
+ */
+static void test_poll_before_answers(void)
+{
+    gatt_client_stats_t before;
+    gatt_client_stats_t after;
+    gatt_client_item_t item;
+    fake_gap_stats_t gap_before;
+    fake_gap_stats_t gap;
+    uint8_t i;
+
+    gatt_client_get_stats(&before);
+    fake_gap_get_stats(&gap_before);
+    fake_peer_hold(true);
+    CHECK(gatt_client_poll() == TEST_PEERS);
+    fake_run();
+    fake_gap_get_stats(&gap);
+    gatt_client_get_stats(&after);
+    CHECK(gap.gattc_reads - gap_before.gattc_reads == TEST_PEERS);
+    CHECK(gap.gattc_in_flight == TEST_PEERS);
+    CHECK(after.reads == before.reads);
+    CHECK(gatt_client_receive(&item) == ESP_ERR_NOT_FOUND);
+
+    fake_peer_hold(false);
+    fake_run();
+    gatt_client_get_stats(&after);
+    CHECK(after.reads - before.reads == TEST_PEERS);
+    CHECK(after.errors == before.errors);
+    for(i = 0; i < TEST_PEERS; i++)
+    {
+        CHECK(gatt_client_receive(&item) == ESP_OK);
+        CHECK(item.type == GATT_CLIENT_ITEM_READ);
+        CHECK(item.length == sizeof(item.addr.val));
+        CHECK(memcmp(item.data, item.addr.val, sizeof(item.addr.val)) == 0);
+    }
+    CHECK(gatt_client_receive(&item) == ESP_ERR_NOT_FOUND);
+}
+
+/**
+ * @brief  A dropped peer is reconnected and subscribed from its saved
+ *         handles, without discovery
+ */
+static void test_cached_reconnect(void)
+{
+    gatt_client_stats_t before;
+    gatt_client_stats_t after;
+    fake_gap_stats_t gap_before;
+    fake_gap_stats_t gap;
+
+    gatt_client_get_stats(&before);
+    fake_gap_get_stats(&gap_before);
+    test_drop(&test_peers[0]);
+    fake_run();
+
+    gatt_client_get_stats(&after);
+    fake_gap_get_stats(&gap);
+    CHECK(test_conn_handle(&test_peers[0]) != BLE_HS_CONN_HANDLE_NONE);
+    CHECK(after.connects - before.connects == 1);
+    CHECK(after.cache_hits - before.cache_hits == 1);
+    CHECK(after.discoveries == before.discoveries);
+    CHECK(gap.gattc_procedures - gap_before.gattc_procedures == TEST_PROCS_CACHED);
+    CHECK(gatt_client_poll() == TEST_PEERS);
+    fake_run();
+}
+
+/**
+ * @brief  Saved handles the peer rejects are forgotten and discovered
+ *         again, the new ones are saved for the next reconnect
+ */
+static void test_stale_handles(void)
+{
+    gatt_client_stats_t before;
+    gatt_client_stats_t after;
+    gatt_client_item_t item;
+    uint8_t i;
+
+    while(gatt_client_receive(&item) == ESP_OK);
+    fake_peer_set_db(&test_db_moved);
+    gatt_client_get_stats(&before);
+    for(i = 0; i < TEST_PEERS; i++)
+    {
+        test_drop(&test_peers[i]);
+    }
+    fake_run();
+    gatt_client_get_stats(&after);
+    CHECK(after.connects - before.connects == TEST_PEERS);
+    CHECK(after.discoveries - before.discoveries == TEST_PEERS);
+    CHECK(after.cache_hits == before.cache_hits);
+    CHECK(after.errors == before.errors);
+
+    /* Reads go to the new value handle */
+    CHECK(gatt_client_poll() == TEST_PEERS);
+    fake_run();
+    gatt_client_get_stats(&before);
+    CHECK(before.reads - after.reads == TEST_PEERS);
+    CHECK(before.errors == after.errors);
+
+    for(i = 0; i < TEST_PEERS; i++)
+    {
+        test_drop(&test_peers[i]);
+    }
+    fake_run();
+    gatt_client_get_stats(&after);
+    CHECK(after.cache_hits - before.cache_hits == TEST_PEERS);
+    CHECK(after.discoveries == before.discoveries);
+}
+
+/**
+ * @brief  A ready peer removed is disconnected and freed, not reconnected
+ */
+static void test_remove_ready(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+
+    fake_gap_get_stats(&before);
+    CHECK(gatt_client_remove(&test_peers[0]) == ESP_OK);
+    fake_run();
+    CHECK(test_conn_handle(&test_peers[0]) == BLE_HS_CONN_HANDLE_NONE);
+    CHECK(gatt_client_remove(&test_peers[0]) == ESP_ERR_NOT_FOUND);
+
+    fake_advance_ms(GATT_CLIENT_RETRY_MS);
+    fake_run();
+    fake_gap_get_stats(&after);
+    CHECK(after.terminations - before.terminations == 1);
+    CHECK(after.central_connects == before.central_connects);
+    CHECK(gatt_client_poll() == TEST_PEERS - 1);
+    fake_run();
+}
+
+/**
+ * @brief  A peer removed while its procedures are in flight is freed once
+ *         disconnected, the late answers are ignored
+ */
+static void test_remove_discovering(void)
+{
+    gatt_client_stats_t before;
+    gatt_client_stats_t after;
+    fake_gap_stats_t gap_before;
+    fake_gap_stats_t gap;
+
+    gatt_client_get_stats(&before);
+    fake_peer_hold(true);
+    CHECK(gatt_client_add(&test_peers[0]) == ESP_OK);
+    fake_run();
+    fake_gap_get_stats(&gap_before);
+    CHECK(test_conn_handle(&test_peers[0]) != BLE_HS_CONN_HANDLE_NONE);
+    CHECK(gap_before.gattc_in_flight == 1);
+
+    CHECK(gatt_client_remove(&test_peers[0]) == ESP_OK);
+    fake_run();
+    CHECK(test_conn_handle(&test_peers[0]) == BLE_HS_CONN_HANDLE_NONE);
+    CHECK(gatt_client_remove(&test_peers[0]) == ESP_ERR_NOT_FOUND);
+
+    fake_peer_hold(false);
+    fake_advance_ms(GATT_CLIENT_RETRY_MS);
+    fake_run();
+    gatt_client_get_stats(&after);
+    fake_gap_get_stats(&gap);
+    CHECK(gap.gattc_in_flight == 0);
+    CHECK(gap.gattc_procedures == gap_before.gattc_procedures);
+    CHECK(gap.central_connects == gap_before.central_connects);
+    CHECK(after.connects - before.connects == 1);
+    CHECK(after.discoveries == before.discoveries);
+    CHECK(after.errors == before.errors);
+}
+
+/**
+ * @brief  A peer removed before its connection completes has the attempt
+ *         cancelled, it is freed and not retried
+ */
+static void test_remove_connecting(void)
+{
+    gatt_client_stats_t before;
+    gatt_client_stats_t after;
+    fake_gap_stats_t gap_before;
+    fake_gap_stats_t gap;
+
+    gatt_client_get_stats(&before);
+    fake_peer_accept(false);
+    CHECK(gatt_client_add(&test_peers[TEST_PEERS]) == ESP_OK);
+    fake_run();
+    fake_gap_get_stats(&gap_before);
+    CHECK(ble_gap_conn_active());
+
+    CHECK(gatt_client_remove(&test_peers[TEST_PEERS]) == ESP_OK);
+    fake_run();
+    CHECK(!ble_gap_conn_active());
+    CHECK(gatt_client_remove(&test_peers[TEST_PEERS]) == ESP_ERR_NOT_FOUND);
+
+    fake_peer_accept(true);
+    fake_advance_ms(GATT_CLIENT_RETRY_MS);
+    fake_run();
+    gatt_client_get_stats(&after);
+    fake_gap_get_stats(&gap);
+    CHECK(gap.central_connects == gap_before.central_connects);
+    CHECK(test_conn_handle(&test_peers[TEST_PEERS]) == BLE_HS_CONN_HANDLE_NONE);
+    CHECK(after.connects == before.connects);
+
+    /* The slot is free for the next peer */
+    CHECK(gatt_client_add(&test_peers[0]) == ESP_OK);
+    fake_run();
+    gatt_client_get_stats(&after);
+    CHECK(after.connects - before.connects == 1);
+    CHECK(after.cache_hits - before.cache_hits == 1);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Central aggregator against fake peripherals
+ */
+int main(void)
+{
+    test_setup();
+    fake_peer_set_db(&test_db);
+    CHECK(gatt_client_init(&test_service_uuid.u, &test_chr_uuid.u) == ESP_OK);
+
+    TEST_RUN(test_parallel_discovery);
+    TEST_RUN(test_poll_before_answers);
+    TEST_RUN(test_cached_reconnect);
+    TEST_RUN(test_stale_handles);
+    TEST_RUN(test_remove_ready);
+    TEST_RUN(test_remove_discovering);
+    TEST_RUN(test_remove_connecting);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,427 @@
+/*
+ *  test_link.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_bond.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_MTU                                      247
+#define TEST_DATA_LEN_MAX                             251
+#define TEST_DATA_LEN_DFLT                            27
+#define TEST_CENTRAL_MIN_ITVL                         12      /* 15 ms, as many phones */
+
+/**
+ * Segment of a recorded ADAPTIVE trace, one sample per period up to
+ * until_ms with a constant backlog and rx_step bytes received per period.
+ * Every sample answers KEEP but the last one, which answers last.
+ */
+typedef struct
+{
+    uint32_t until_ms;
+    uint8_t backlog;
+    uint16_t rx_step;
+    uint8_t last;
+    uint8_t level;                      /* Level after the segment */
+    uint32_t deferred;                  /* Total after the segment */
+} test_adapt_trace_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+
+/* Recorded against the config.h defaults, checked below */
+static const test_adapt_trace_t test_adapt_trace[] =
+{
+    {  2750, 0,   0, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_BUSY, 0 },     /* Quiet, not long enough to relax */
+    {  3000, 0,   0, BLE_LINK_ADAPT_IDLE, BLE_LINK_ADAPT_IDLE, 0 },
+    {  4000, 1,  25, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_IDLE, 0 },     /* Between the thresholds */
+    {  4250, 6,   0, BLE_LINK_ADAPT_BUSY, BLE_LINK_ADAPT_BUSY, 0 },     /* Backlog burst, first sample */
+    {  4500, 0, 600, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_BUSY, 0 },     /* Rx burst */
+    {  8000, 2, 100, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_BUSY, 0 },     /* Between the thresholds, past IDLE_MS */
+    { 10750, 0,   0, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_BUSY, 0 },
+    { 11000, 0,   0, BLE_LINK_ADAPT_IDLE, BLE_LINK_ADAPT_IDLE, 0 },
+    { 11750, 5,   0, BLE_LINK_ADAPT_KEEP, BLE_LINK_ADAPT_IDLE, 3 },     /* Burst within MIN_GAP_MS */
+    { 12000, 5,   0, BLE_LINK_ADAPT_BUSY, BLE_LINK_ADAPT_BUSY, 3 },
+};
+
+_Static_assert(BLE_LINK_ADAPT_PERIOD_MS == 250 && BLE_LINK_ADAPT_BUSY_ITEMS == 4 && BLE_LINK_ADAPT_IDLE_ITEMS == 0 &&
+               BLE_LINK_ADAPT_BUSY_RX_BPS == 2000 && BLE_LINK_ADAPT_IDLE_RX_BPS == 200 &&
+               BLE_LINK_ADAPT_IDLE_MS == 3000 && BLE_LINK_ADAPT_MIN_GAP_MS == 1000,
+               "test_adapt_trace must be recorded again for the new BLE_LINK_ADAPT settings");
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static ble_link_info_t test_link(uint16_t conn_handle);
+static void test_default_profile(void);
+static void test_select_profiles(void);
+static void test_invalid_profile(void);
+static void test_central_refuses_interval(void);
+static void test_host_refuses_update(void);
+static void test_no_2m_phy(void);
+static void test_dle_refused(void);
+static void test_profile_none(void);
+static void test_bonded_reconnect(void);
+static void test_unpaired_cache_erased(void);
+static void test_adapt_update_refused(void);
+static void test_adapt_replay(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Link state of a connection, as the application reads it
+ */
+static ble_link_info_t test_link(uint16_t conn_handle)
+{
+    ble_link_info_t info;
+
+    memset(&info, 0, sizeof(info));
+    CHECK(ble_api_get_link_info(conn_handle, &info) == ESP_OK);
+    return info;
+}
+
+/**
+ * @brief  A new connection gets DLE, the 2M PHY, a short interval and the
+ *         MTU exchange of the default profile
+ */
+static void test_default_profile(void)
+{
+    ble_link_info_t info = test_link(test_conn_handle);
+    fake_gap_stats_t stats;
+
+    fake_gap_get_stats(&stats);
+    CHECK(info.profile == BLE_LINK_DEFAULT_PROFILE);
+    CHECK(info.fallback == 0);
+    CHECK(info.update_pending == 0);
+    CHECK(info.data_len == TEST_DATA_LEN_MAX);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_2M && info.rx_phy == BLE_HCI_LE_PHY_2M);
+    CHECK(info.conn_itvl == 12);
+    CHECK(info.conn_latency == 0);
+    CHECK(info.mtu == TEST_MTU);
+    CHECK(stats.data_len_requests == 1);
+    CHECK(stats.phy_requests == 1);
+    CHECK(stats.update_requests == 1);
+}
+
+/**
+ * @brief  Each profile drives the link to its own parameters and reports
+ *         what was negotiated
+ */
+static void test_select_profiles(void)
+{
+    ble_link_info_t info;
+
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_LOW_POWER) == ESP_OK);
+    CHECK(test_link(test_conn_handle).update_pending == 1);
+    fake_run();
+    info = test_link(test_conn_handle);
+    CHECK(info.profile == BLE_LINK_PROFILE_LOW_POWER);
+    CHECK(info.update_pending == 0);
+    CHECK(info.conn_itvl == 160 && info.conn_latency == 4 && info.supervision_timeout == 600);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_1M);
+    CHECK(info.fallback == 0);
+
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_LOW_LATENCY) == ESP_OK);
+    fake_run();
+    info = test_link(test_conn_handle);
+    CHECK(info.profile == BLE_LINK_PROFILE_LOW_LATENCY);
+    CHECK(info.conn_itvl == 6 && info.conn_latency == 0 && info.supervision_timeout == 200);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_2M);
+    CHECK(info.fallback == 0);
+}
+
+/**
+ * @brief  Unknown profiles and connections are refused
+ */
+static void test_invalid_profile(void)
+{
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_MAX) == ESP_ERR_INVALID_ARG);
+    CHECK(ble_api_set_link_profile(BLE_HS_CONN_HANDLE_NONE, BLE_LINK_PROFILE_BULK) == ESP_ERR_INVALID_STATE);
+    CHECK(test_link(test_conn_handle).profile == BLE_LINK_PROFILE_LOW_LATENCY);
+}
+
+/**
+ * @brief  A central that refuses the profile interval gets the relaxed one
+ *         once, the fallback is reported
+ */
+static void test_central_refuses_interval(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+    ble_link_info_t info;
+
+    fake_gap_set_central_min_itvl(TEST_CENTRAL_MIN_ITVL);
+    fake_gap_get_stats(&before);
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_LOW_LATENCY) == ESP_OK);
+    fake_run();
+    fake_gap_get_stats(&after);
+    info = test_link(test_conn_handle);
+
+    CHECK(after.update_requests - before.update_requests == 2);
+    CHECK(after.last_update.itvl_min == 12 && after.last_update.itvl_max == 12);
+    CHECK(info.fallback == BLE_LINK_FALLBACK_PARAMS);
+    CHECK(info.update_pending == 0);
+    CHECK(info.conn_itvl == 12);
+
+    /* The relaxed interval refused too: the link keeps running, no retry loop */
+    fake_gap_set_central_min_itvl(24);
+    fake_gap_get_stats(&before);
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_LOW_LATENCY) == ESP_OK);
+    fake_run();
+    fake_gap_get_stats(&after);
+    info = test_link(test_conn_handle);
+    CHECK(after.update_requests - before.update_requests == 2);
+    CHECK(info.fallback == BLE_LINK_FALLBACK_PARAMS);
+    CHECK(info.update_pending == 0);
+    CHECK(info.conn_itvl == 12);
+    fake_gap_set_central_min_itvl(0);
+}
+
+/**
+ * @brief  The host refusing the request falls back at once, nothing stays
+ *         pending
+ */
+static void test_host_refuses_update(void)
+{
+    ble_link_info_t info;
+
+    fake_gap_set_update_rc(BLE_HS_EINVAL);
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_BULK) == ESP_OK);
+    fake_run();
+    info = test_link(test_conn_handle);
+    CHECK(info.profile == BLE_LINK_PROFILE_BULK);
+    CHECK(info.fallback & BLE_LINK_FALLBACK_PARAMS);
+    CHECK(info.update_pending == 0);
+    CHECK(info.conn_itvl == 12);
+    fake_gap_set_update_rc(0);
+}
+
+/**
+ * @brief  A central without 2M keeps the link on 1M and says so
+ */
+static void test_no_2m_phy(void)
+{
+    uint16_t conn_handle;
+    ble_link_info_t info;
+
+    fake_gap_set_central_phys(BLE_HCI_LE_PHY_1M_PREF_MASK);
+    conn_handle = test_connect(2, TEST_MTU);
+    info = test_link(conn_handle);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_1M);
+    CHECK(info.fallback == BLE_LINK_FALLBACK_PHY);
+    CHECK(info.conn_itvl == 12);
+    fake_gap_set_central_phys(BLE_HCI_LE_PHY_1M_PREF_MASK | BLE_HCI_LE_PHY_2M_PREF_MASK);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+}
+
+/**
+ * @brief  A controller without DLE keeps 27 octet PDUs and says so
+ */
+static void test_dle_refused(void)
+{
+    uint16_t conn_handle;
+    ble_link_info_t info;
+
+    fake_gap_set_data_len_rc(BLE_HS_HCI_ERR(BLE_ERR_UNSUPP_REM_FEATURE));
+    conn_handle = test_connect(3, TEST_MTU);
+    info = test_link(conn_handle);
+    CHECK(info.data_len == TEST_DATA_LEN_DFLT);
+    CHECK(info.fallback == BLE_LINK_FALLBACK_DATA_LEN);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_2M);
+    fake_gap_set_data_len_rc(0);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+}
+
+/**
+ * @brief  With no profile nothing is requested, the central decides
+ */
+static void test_profile_none(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+    uint16_t conn_handle;
+    ble_link_info_t info;
+
+    ble_api_set_default_link_profile(BLE_LINK_PROFILE_NONE);
+    fake_gap_get_stats(&before);
+    conn_handle = test_connect(4, TEST_MTU);
+    fake_gap_get_stats(&after);
+    info = test_link(conn_handle);
+    CHECK(info.profile == BLE_LINK_PROFILE_NONE);
+    CHECK(after.update_requests == before.update_requests);
+    CHECK(after.phy_requests == before.phy_requests);
+    CHECK(after.data_len_requests == before.data_len_requests);
+    CHECK(info.tx_phy == BLE_HCI_LE_PHY_1M);
+    CHECK(info.data_len == TEST_DATA_LEN_DFLT);
+    ble_api_set_default_link_profile(BLE_LINK_DEFAULT_PROFILE);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+}
+
+/**
+ * @brief  A bonded peer is asked for what it ran with last time
+ */
+static void test_bonded_reconnect(void)
+{
+    fake_gap_stats_t stats;
+    uint16_t conn_handle;
+
+    conn_handle = test_connect(5, TEST_MTU);
+    CHECK(ble_api_set_link_profile(conn_handle, BLE_LINK_PROFILE_LOW_POWER) == ESP_OK);
+    fake_run();
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+
+    conn_handle = test_connect(5, TEST_MTU);
+    fake_gap_get_stats(&stats);
+    CHECK(test_link(conn_handle).profile == BLE_LINK_DEFAULT_PROFILE);
+    CHECK(stats.last_update.itvl_min == 160 && stats.last_update.itvl_max == 160);
+    CHECK(stats.last_update.latency == 4);
+    CHECK(test_link(conn_handle).conn_itvl == 160);
+    CHECK(test_link(conn_handle).tx_phy == BLE_HCI_LE_PHY_1M);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+}
+
+/**
+ * @brief  The link parameters of a peer are erased once its bond is gone,
+ *         those of the peers still bonded stay
+ */
+static void test_unpaired_cache_erased(void)
+{
+    ble_addr_t bonded = { BLE_ADDR_PUBLIC, { 5, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    ble_addr_t unpaired = { BLE_ADDR_PUBLIC, { 6, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    ble_link_cache_t cache;
+    uint16_t conn_handle;
+
+    conn_handle = test_connect(6, TEST_MTU);
+    fake_disconnect(conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    CHECK(ble_bond_load(&unpaired, &cache) == ESP_OK);
+    CHECK(ble_bond_load(&bonded, &cache) == ESP_OK);
+
+    CHECK(ble_gap_unpair(&unpaired) == 0);
+    CHECK(ble_bond_refresh() == 2);
+    CHECK(ble_bond_load(&unpaired, &cache) == ESP_ERR_NOT_FOUND);
+    CHECK(ble_bond_load(&bonded, &cache) == ESP_OK);
+}
+
+/**
+ * @brief  An ADAPTIVE level whose update the host refused is not recorded,
+ *         the next sample asks for it again
+ */
+static void test_adapt_update_refused(void)
+{
+    fake_gap_stats_t before;
+    fake_gap_stats_t after;
+    ble_link_info_t info;
+    uint32_t elapsed;
+
+    CHECK(ble_api_set_link_profile(test_conn_handle, BLE_LINK_PROFILE_ADAPTIVE) == ESP_OK);
+    fake_run();
+    CHECK(test_link(test_conn_handle).adapt.level == BLE_LINK_ADAPT_BUSY);
+
+    fake_gap_set_update_rc(BLE_HS_EINVAL);
+    fake_gap_get_stats(&before);
+    for(elapsed = 0; elapsed < BLE_LINK_ADAPT_IDLE_MS + BLE_LINK_ADAPT_MIN_GAP_MS; elapsed += BLE_LINK_ADAPT_PERIOD_MS)
+    {
+        fake_advance_ms(BLE_LINK_ADAPT_PERIOD_MS);
+        fake_run();
+    }
+    fake_gap_get_stats(&after);
+    info = test_link(test_conn_handle);
+    CHECK(after.update_requests - before.update_requests >= 4);
+    CHECK(info.adapt.level == BLE_LINK_ADAPT_BUSY);
+    CHECK(info.adapt.pending == BLE_LINK_ADAPT_KEEP);
+    CHECK(info.adapt.requests[BLE_LINK_ADAPT_IDLE] == 0);
+    CHECK(info.update_pending == 0);
+
+    /* Accepted on the very next sample, no rate limit to wait out */
+    fake_gap_set_update_rc(0);
+    fake_advance_ms(BLE_LINK_ADAPT_PERIOD_MS);
+    fake_run();
+    info = test_link(test_conn_handle);
+    CHECK(info.adapt.level == BLE_LINK_ADAPT_IDLE);
+    CHECK(info.adapt.requests[BLE_LINK_ADAPT_IDLE] == 1);
+    CHECK(info.update_pending == 0);
+    CHECK(info.conn_itvl == 160 && info.conn_latency == 4);
+}
+
+/**
+ * @brief  Replay a recorded trace through the controller alone, every
+ *         request it answers is issued and accepted at once
+ */
+static void test_adapt_replay(void)
+{
+    const test_adapt_trace_t *segment;
+    ble_link_adapt_level_t level;
+    ble_link_adapt_t adapt;
+    uint32_t rx_bytes = 0;
+    uint32_t now_ms = 0;
+    uint32_t i;
+
+    ble_link_adapt_init(&adapt, now_ms);
+    for(i = 0; i < sizeof(test_adapt_trace) / sizeof(test_adapt_trace[0]); i++)
+    {
+        segment = &test_adapt_trace[i];
+        while(now_ms < segment->until_ms)
+        {
+            now_ms += BLE_LINK_ADAPT_PERIOD_MS;
+            rx_bytes += segment->rx_step;
+            level = ble_link_adapt_sample(&adapt, segment->backlog, rx_bytes, now_ms);
+            CHECK(level == (now_ms == segment->until_ms ? segment->last : BLE_LINK_ADAPT_KEEP));
+            if(level != BLE_LINK_ADAPT_KEEP)
+            {
+                ble_link_adapt_requested(&adapt, level, now_ms);
+                ble_link_adapt_updated(&adapt, true);
+            }
+        }
+        CHECK(adapt.level == segment->level);
+        CHECK(adapt.deferred == segment->deferred);
+        CHECK(adapt.pending == BLE_LINK_ADAPT_KEEP);
+    }
+    CHECK(adapt.requests[BLE_LINK_ADAPT_IDLE] == 2);
+    CHECK(adapt.requests[BLE_LINK_ADAPT_BUSY] == 2);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Link profile negotiation and fallbacks against the fake GAP layer
+ */
+int main(void)
+{
+    test_setup();
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_default_profile);
+    TEST_RUN(test_select_profiles);
+    TEST_RUN(test_invalid_profile);
+    TEST_RUN(test_central_refuses_interval);
+    TEST_RUN(test_host_refuses_update);
+    TEST_RUN(test_no_2m_phy);
+    TEST_RUN(test_dle_refused);
+    TEST_RUN(test_profile_none);
+    TEST_RUN(test_bonded_reconnect);
+    TEST_RUN(test_unpaired_cache_erased);
+    TEST_RUN(test_adapt_update_refused);
+    TEST_RUN(test_adapt_replay);
+    return test_result();
+}
\ No newline at end of file
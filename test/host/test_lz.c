@@ -0,0 +1,419 @@
+/*
+ *  test_lz.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_lz.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Corpora are generated, the same on every run: telemetry JSON lines, ESP
+ * log lines, packed sensor records and random bytes. Each one is cut in
+ * notification sized blocks, encoded and committed block by block as the tx
+ * path does, decoded by a reference decoder and compared.
+ */
+#define TEST_MTU                                      247
+#define TEST_BLOCK_SIZE                               (TEST_MTU - 3 - BLE_LZ_HEADER_SIZE)
+#define TEST_CORPUS_SIZE                              (256 * 1024)
+#define TEST_LINK_MESSAGES                            300
+
+typedef enum
+{
+    TEST_CORPUS_TELEMETRY = 0,
+    TEST_CORPUS_LOGS,
+    TEST_CORPUS_RECORDS,
+    TEST_CORPUS_RANDOM,
+    TEST_CORPORA
+} test_corpus_t;
+
+/* Reference decoder, the whole stream stays in out */
+typedef struct
+{
+    uint8_t out[TEST_CORPUS_SIZE];
+    uint32_t length;
+    uint32_t history_start;             /* First byte matches may reach */
+    uint32_t errors;
+} test_decoder_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static const char *test_corpus_names[TEST_CORPORA] = { "telemetry", "logs", "records", "random" };
+static const char *test_log_templates[] = {
+    "I (%u) UART: rx %u bytes from conn %u\n",
+    "I (%u) GAP: connection update, itvl %u latency 0 timeout 400\n",
+    "W (%u) API: tx queue of conn %u at %u items\n",
+    "D (%u) GATT: notify %u bytes on handle 0x%04x\n",
+};
+
+static uint8_t test_corpus[TEST_CORPUS_SIZE];
+static uint8_t test_block[TEST_BLOCK_SIZE + BLE_LZ_HEADER_SIZE];
+static ble_lz_t test_lz;
+static test_decoder_t test_decoder;
+static uint32_t test_random_state;
+static uint16_t test_conn_handle;
+static uint32_t test_link_notified;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint32_t test_random(void);
+static void test_generate(test_corpus_t corpus);
+static void test_decode(test_decoder_t *decoder, const uint8_t *block, size_t length);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static bool test_link_notified_all(void *arg);
+static void test_corpus_round_trip(test_corpus_t corpus, uint32_t *encoded, int64_t *elapsed);
+static void test_corpora(void);
+static void test_uncommitted_block(void);
+static void test_reset_block(void);
+static void test_negotiated_link(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  xorshift
+ */
+static uint32_t test_random(void)
+{
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * @brief  Fill test_corpus with one corpus
+ */
+static void test_generate(test_corpus_t corpus)
+{
+    uint32_t length = 0;
+    uint32_t step = 0;
+    int16_t samples[8] = { 0 };
+    char line[128];
+    uint32_t i;
+    int size;
+
+    test_random_state = 0x9E3779B9u + corpus;
+    while(length < TEST_CORPUS_SIZE)
+    {
+        switch(corpus)
+        {
+        case TEST_CORPUS_TELEMETRY:
+            size = snprintf(line, sizeof(line), "{\"t\":%u,\"dev\":\"gw-%02u\",\"temp\":%u.%02u,\"hum\":%u.%u,\"rssi\":-%u}\n",
+                            1700000000 + step, step % 3, 20 + step / 500 % 5, test_random() % 100,
+                            40 + test_random() % 10, test_random() % 10, 60 + test_random() % 20);
+            break;
+        case TEST_CORPUS_LOGS:
+            size = snprintf(line, sizeof(line), test_log_templates[test_random() % 4], 1000 * step + test_random() % 1000,
+                            test_random() % 244, test_random() % 0x40);
+            break;
+        case TEST_CORPUS_RECORDS:
+            memcpy(line, &step, sizeof(step));
+            for(i = 0; i < 8; i++)
+            {
+                samples[i] += (int16_t)(test_random() % 7) - 3;
+            }
+            memcpy(line + sizeof(step), samples, sizeof(samples));
+            size = sizeof(step) + sizeof(samples);
+            break;
+        default:
+            for(i = 0; i < 16; i++)
+            {
+                line[i] = (char)test_random();
+            }
+            size = 16;
+            break;
+        }
+        if(size > (int)(TEST_CORPUS_SIZE - length))
+        {
+            size = TEST_CORPUS_SIZE - length;
+        }
+        memcpy(test_corpus + length, line, size);
+        length += size;
+        step++;
+    }
+}
+
+/**
+ * @brief  Decode one block as the client does, appending to decoder->out
+ */
+static void test_decode(test_decoder_t *decoder, const uint8_t *block, size_t length)
+{
+    uint32_t distance;
+    uint32_t count;
+    uint16_t token;
+    uint8_t control;
+    size_t pos = BLE_LZ_HEADER_SIZE;
+    uint8_t bit;
+
+    if(block[0] & BLE_LZ_BLOCK_RESET)
+    {
+        decoder->history_start = decoder->length;
+    }
+    if((block[0] & ~BLE_LZ_BLOCK_RESET) == BLE_LZ_BLOCK_RAW)
+    {
+        memcpy(decoder->out + decoder->length, block + pos, length - pos);
+        decoder->length += length - pos;
+        return;
+    }
+
+    while(pos < length)
+    {
+        control = block[pos++];
+        for(bit = 0; bit < 8 && pos < length; bit++)
+        {
+            if(!(control & (1 << bit)))
+            {
+                decoder->out[decoder->length++] = block[pos++];
+                continue;
+            }
+            if(pos + 2 > length)
+            {
+                decoder->errors++;
+                return;
+            }
+            token = block[pos] | (block[pos + 1] << 8);
+            pos += 2;
+            distance = (token >> 6) + 1;
+            count = (token & 0x3F) + BLE_LZ_MIN_MATCH;
+            if(distance > BLE_LZ_WINDOW_SIZE || distance > decoder->length - decoder->history_start ||
+               decoder->length + count > sizeof(decoder->out))
+            {
+                decoder->errors++;
+                return;
+            }
+            while(count-- > 0)
+            {
+                decoder->out[decoder->length] = decoder->out[decoder->length - distance];
+                decoder->length++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief  Client side of the tx characteristic, decodes every notification
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    if(attr_handle == gatt_server_get_tx_handle())
+    {
+        test_decode(&test_decoder, data, length);
+        test_link_notified++;
+    }
+}
+
+/**
+ * @brief  Wait condition: *arg notifications sent
+ */
+static bool test_link_notified_all(void *arg)
+{
+    return test_link_notified >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Encode one corpus in blocks, decode it back and compare
+ */
+static void test_corpus_round_trip(test_corpus_t corpus, uint32_t *encoded, int64_t *elapsed)
+{
+    uint32_t offset;
+    size_t size;
+    size_t length;
+    int64_t start;
+
+    test_generate(corpus);
+    ble_lz_reset(&test_lz);
+    memset(&test_decoder, 0, sizeof(test_decoder));
+    *encoded = 0;
+    *elapsed = 0;
+
+    for(offset = 0; offset < TEST_CORPUS_SIZE; offset += size)
+    {
+        size = TEST_CORPUS_SIZE - offset < TEST_BLOCK_SIZE ? TEST_CORPUS_SIZE - offset : TEST_BLOCK_SIZE;
+        start = fake_time_us();
+        length = ble_lz_encode(&test_lz, test_corpus + offset, size, test_block);
+        ble_lz_commit(&test_lz);
+        *elapsed += fake_time_us() - start;
+
+        CHECK(length <= size + BLE_LZ_HEADER_SIZE);
+        *encoded += length;
+        test_decode(&test_decoder, test_block, length);
+    }
+    CHECK(test_decoder.errors == 0);
+    CHECK(test_decoder.length == TEST_CORPUS_SIZE);
+    CHECK(memcmp(test_decoder.out, test_corpus, TEST_CORPUS_SIZE) == 0);
+}
+
+/**
+ * @brief  Every corpus comes back intact, text shrinks to less than half,
+ *         packed records a little, random data grows by the block header only
+ */
+static void test_corpora(void)
+{
+    uint32_t blocks = (TEST_CORPUS_SIZE + TEST_BLOCK_SIZE - 1) / TEST_BLOCK_SIZE;
+    uint32_t encoded;
+    int64_t elapsed;
+    double ratio;
+    uint8_t corpus;
+
+    for(corpus = 0; corpus < TEST_CORPORA; corpus++)
+    {
+        test_corpus_round_trip(corpus, &encoded, &elapsed);
+        ratio = TEST_CORPUS_SIZE / (double)encoded;
+        printf("%-10s %u -> %u bytes, ratio %.2f, encode %.1f MB/s\n", test_corpus_names[corpus],
+               TEST_CORPUS_SIZE, encoded, ratio, TEST_CORPUS_SIZE / (double)(elapsed > 0 ? elapsed : 1));
+        if(corpus == TEST_CORPUS_RANDOM)
+        {
+            CHECK(encoded == TEST_CORPUS_SIZE + blocks * BLE_LZ_HEADER_SIZE);
+        }
+        else if(corpus == TEST_CORPUS_RECORDS)
+        {
+            CHECK(ratio > 1.0);
+        }
+        else
+        {
+            CHECK(ratio > 2.0);
+        }
+    }
+}
+
+/**
+ * @brief  A block encoded but never sent leaves no trace in the history
+ */
+static void test_uncommitted_block(void)
+{
+    size_t length;
+
+    test_generate(TEST_CORPUS_LOGS);
+    ble_lz_reset(&test_lz);
+    memset(&test_decoder, 0, sizeof(test_decoder));
+
+    length = ble_lz_encode(&test_lz, test_corpus, TEST_BLOCK_SIZE, test_block);
+    ble_lz_commit(&test_lz);
+    test_decode(&test_decoder, test_block, length);
+
+    /* Encoded and dropped, as when the stack refuses the notification */
+    ble_lz_encode(&test_lz, test_corpus + TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, test_block);
+    length = ble_lz_encode(&test_lz, test_corpus + 2 * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, test_block);
+    ble_lz_commit(&test_lz);
+    test_decode(&test_decoder, test_block, length);
+
+    CHECK(test_decoder.errors == 0);
+    CHECK(test_decoder.length == 2 * TEST_BLOCK_SIZE);
+    CHECK(memcmp(test_decoder.out, test_corpus, TEST_BLOCK_SIZE) == 0);
+    CHECK(memcmp(test_decoder.out + TEST_BLOCK_SIZE, test_corpus + 2 * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE) == 0);
+}
+
+/**
+ * @brief  After a reset the first block says so and references nothing older
+ */
+static void test_reset_block(void)
+{
+    size_t length;
+
+    test_generate(TEST_CORPUS_TELEMETRY);
+    ble_lz_reset(&test_lz);
+    memset(&test_decoder, 0, sizeof(test_decoder));
+
+    length = ble_lz_encode(&test_lz, test_corpus, TEST_BLOCK_SIZE, test_block);
+    CHECK(test_block[0] & BLE_LZ_BLOCK_RESET);
+    ble_lz_commit(&test_lz);
+    test_decode(&test_decoder, test_block, length);
+    length = ble_lz_encode(&test_lz, test_corpus, TEST_BLOCK_SIZE, test_block);
+    CHECK(!(test_block[0] & BLE_LZ_BLOCK_RESET));
+    CHECK(length < TEST_BLOCK_SIZE / 4);
+    ble_lz_commit(&test_lz);
+    test_decode(&test_decoder, test_block, length);
+
+    ble_lz_reset(&test_lz);
+    length = ble_lz_encode(&test_lz, test_corpus, TEST_BLOCK_SIZE, test_block);
+    CHECK(test_block[0] & BLE_LZ_BLOCK_RESET);
+    ble_lz_commit(&test_lz);
+    test_decode(&test_decoder, test_block, length);
+
+    CHECK(test_decoder.errors == 0);
+    CHECK(test_decoder.length == 3 * TEST_BLOCK_SIZE);
+    CHECK(memcmp(test_decoder.out + 2 * TEST_BLOCK_SIZE, test_corpus, TEST_BLOCK_SIZE) == 0);
+}
+
+/**
+ * @brief  A client that enables compression gets LZ blocks it can decode into
+ *         what the application sent, and fewer bytes on air
+ */
+static void test_negotiated_link(void)
+{
+    uint16_t caps_handle = fake_gatt_find(&test_caps_uuid.u);
+    uint8_t caps = GATT_SERVER_CAP_LZ;
+    uint8_t value[2];
+    uint16_t length = 0;
+    uint32_t expected = 0;
+    uint32_t offset = 0;
+    uint32_t sent = 0;
+    ble_stats_t before;
+    ble_stats_t after;
+    int size;
+
+    test_generate(TEST_CORPUS_LOGS);
+    memset(&test_decoder, 0, sizeof(test_decoder));
+    CHECK(fake_gatt_write(test_conn_handle, caps_handle, &caps, sizeof(caps)) == 0);
+    CHECK(fake_gatt_read(test_conn_handle, caps_handle, value, sizeof(value), &length) == 0);
+    CHECK(length == 2 && value[1] == GATT_SERVER_CAP_LZ);
+    CHECK(ble_api_get_stats(test_conn_handle, &before) == ESP_OK);
+
+    while(sent < TEST_LINK_MESSAGES)
+    {
+        /* One log line per notification, as the application logs */
+        size = (const uint8_t *)memchr(test_corpus + offset, '\n', TEST_CORPUS_SIZE - offset) - (test_corpus + offset) + 1;
+        if(ble_api_tx_notify_conn(test_conn_handle, test_corpus + offset, size) != ESP_OK)
+        {
+            fake_run();
+            continue;
+        }
+        offset += size;
+        sent++;
+    }
+    expected = TEST_LINK_MESSAGES;
+    CHECK(fake_run_until(test_link_notified_all, &expected, TEST_TIMEOUT_MS));
+    CHECK(ble_api_get_stats(test_conn_handle, &after) == ESP_OK);
+
+    CHECK(test_decoder.errors == 0);
+    CHECK(test_decoder.length == offset);
+    CHECK(memcmp(test_decoder.out, test_corpus, offset) == 0);
+    CHECK(after.tx_bytes - before.tx_bytes == offset);
+    CHECK(after.tx_wire_bytes - before.tx_wire_bytes < offset);
+    printf("link: %u log lines, %u bytes, %u on air\n", TEST_LINK_MESSAGES, offset,
+           after.tx_wire_bytes - before.tx_wire_bytes);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  LZ ratio and throughput on generated corpora, negotiated link
+ */
+int main(void)
+{
+    test_setup();
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_corpora);
+    TEST_RUN(test_uncommitted_block);
+    TEST_RUN(test_reset_block);
+    TEST_RUN(test_negotiated_link);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,551 @@
+/*
+ *  test_ota.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <esp_crc.h>
+#include <esp_ota_ops.h>
+
+#include "test.h"
+#include "ble_ota.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The writer is given a flash backed by a temporary file through
+ * ble_ota_register_flash(). The file starts zeroed, not erased, so a write
+ * to a sector the writer forgot to erase reads back wrong. A client drives
+ * the OTA service as in ble_ota.h: BEGIN, windowed data writes resent from
+ * a NACK, END.
+ */
+#define TEST_MTU                                      247
+#define TEST_CHUNK_SIZE                               (TEST_MTU - 3 - BLE_OTA_DATA_HEADER_SIZE)
+#define TEST_FLASH_SIZE                               (0x110000 + 2 * FAKE_OTA_PARTITION_SIZE)
+#define TEST_SMALL_IMAGE                              20000
+#define TEST_FAIL_IMAGE                               (4 * BLE_OTA_BUFFER_SIZE)
+#define TEST_FULL_IMAGE                               FAKE_OTA_PARTITION_SIZE
+#define TEST_INTERRUPT_AT                             300000
+#define TEST_NO_FAILURE                               0xFFFFFFFF
+#define TEST_OPS                                      0x12
+
+typedef struct
+{
+    uint32_t count;                     /* Notifications of this op */
+    uint8_t status;                     /* Of the last one */
+    uint32_t offset;
+} test_answer_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/* 5c3a659e-897e-45e1-b016-007107c96e01 */
+static const ble_uuid128_t test_ota_control_uuid =
+    BLE_UUID128_INIT(0x01, 0x6e, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+/* 5c3a659e-897e-45e1-b016-007107c96e02 */
+static const ble_uuid128_t test_ota_data_uuid =
+    BLE_UUID128_INIT(0x02, 0x6e, 0xc9, 0x07, 0x71, 0x00, 0x16, 0xb0,
+                     0xe1, 0x45, 0x7e, 0x89, 0x9e, 0x65, 0x3a, 0x5c);
+
+static FILE *test_flash;
+static uint32_t test_flash_fail_at = TEST_NO_FAILURE;
+static uint32_t test_flash_erased;
+static uint32_t test_flash_written;
+static const esp_partition_t *test_boot;
+static esp_err_t test_boot_rc = ESP_OK;
+static SemaphoreHandle_t test_boot_gate;
+static volatile bool test_boot_entered;
+
+static uint8_t test_image[TEST_FULL_IMAGE];
+static uint8_t test_readback[TEST_FULL_IMAGE];
+static uint16_t test_conn_handle;
+static uint16_t test_control_handle;
+static uint16_t test_data_handle;
+static uint8_t test_peer = 1;
+static test_answer_t test_answers[TEST_OPS];
+static uint32_t test_progress;
+static ble_ota_state_t test_idle = BLE_OTA_STATE_IDLE;
+static ble_ota_state_t test_done = BLE_OTA_STATE_DONE;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static esp_err_t test_flash_erase(const esp_partition_t *partition, size_t offset, size_t size);
+static esp_err_t test_flash_write(const esp_partition_t *partition, size_t offset, const void *data, size_t size);
+static esp_err_t test_flash_set_boot(const esp_partition_t *partition);
+static void test_flash_read(const esp_partition_t *partition, size_t offset, void *data, size_t size);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static bool test_answered(void *arg);
+static bool test_boot_waiting(void *arg);
+static bool test_in_state(void *arg);
+static void test_client_connect(void);
+static void test_make_image(uint32_t size, uint32_t seed);
+static uint32_t test_command(uint8_t op, uint32_t size, uint32_t crc);
+static uint32_t test_send(uint32_t from, uint32_t to);
+static void test_nvs_not_ready(void);
+static void test_begin_refused(void);
+static void test_flash_error(void);
+static void test_crc_mismatch(void);
+static void test_close_while_finishing(void);
+static void test_resume_and_update(void);
+
+static const ble_ota_flash_t test_file_flash = {
+    .erase = test_flash_erase,
+    .write = test_flash_write,
+    .set_boot = test_flash_set_boot,
+};
+
+/******************************************************************************/
+
+/**
+ * @brief  Erase whole sectors to 0xFF
+ */
+static esp_err_t test_flash_erase(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    uint8_t sector[SPI_FLASH_SEC_SIZE];
+    size_t done;
+
+    if(offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0 || offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(sector, 0xFF, sizeof(sector));
+    fseek(test_flash, partition->address + offset, SEEK_SET);
+    for(done = 0; done < size; done += sizeof(sector))
+    {
+        fwrite(sector, 1, sizeof(sector), test_flash);
+    }
+    test_flash_erased += size;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Program, bits only go from 1 to 0 like on flash
+ */
+static esp_err_t test_flash_write(const esp_partition_t *partition, size_t offset, const void *data, size_t size)
+{
+    uint8_t cells[BLE_OTA_BUFFER_SIZE];
+    const uint8_t *bytes = data;
+    size_t i;
+
+    if(offset + size > partition->size || size > sizeof(cells))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if(test_flash_fail_at >= offset && test_flash_fail_at < offset + size)
+    {
+        return ESP_FAIL;
+    }
+    fseek(test_flash, partition->address + offset, SEEK_SET);
+    fread(cells, 1, size, test_flash);
+    for(i = 0; i < size; i++)
+    {
+        cells[i] &= bytes[i];
+    }
+    fseek(test_flash, partition->address + offset, SEEK_SET);
+    fwrite(cells, 1, size, test_flash);
+    test_flash_written += size;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Select the boot partition, may be held at the gate
+ */
+static esp_err_t test_flash_set_boot(const esp_partition_t *partition)
+{
+    test_boot_entered = true;
+    xSemaphoreTake(test_boot_gate, portMAX_DELAY);
+    xSemaphoreGive(test_boot_gate);
+    if(test_boot_rc == ESP_OK)
+    {
+        test_boot = partition;
+    }
+    return test_boot_rc;
+}
+
+/**
+ * @brief  Read back what the writer left in flash
+ */
+static void test_flash_read(const esp_partition_t *partition, size_t offset, void *data, size_t size)
+{
+    fflush(test_flash);
+    fseek(test_flash, partition->address + offset, SEEK_SET);
+    CHECK(fread(data, 1, size, test_flash) == size);
+}
+
+/**
+ * @brief  Client side of the control characteristic
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    test_answer_t *answer;
+
+    if(attr_handle != test_control_handle || length != BLE_OTA_NOTIFY_SIZE || data[0] >= TEST_OPS)
+    {
+        return;
+    }
+    answer = &test_answers[data[0]];
+    answer->count++;
+    answer->status = data[1];
+    answer->offset = data[2] | (data[3] << 8) | (data[4] << 16) | ((uint32_t)data[5] << 24);
+    if(data[0] == BLE_OTA_OP_PROGRESS && data[1] == BLE_OTA_STATUS_OK)
+    {
+        test_progress = answer->offset;
+    }
+}
+
+/**
+ * @brief  Wait condition: one more answer to the op in *arg
+ */
+static bool test_answered(void *arg)
+{
+    uint32_t *expected = arg;
+
+    return test_answers[expected[0]].count > expected[1];
+}
+
+/**
+ * @brief  Wait condition: the writer is selecting the boot partition
+ */
+static bool test_boot_waiting(void *arg)
+{
+    return test_boot_entered;
+}
+
+/**
+ * @brief  Wait condition: the transfer is in state *arg
+ */
+static bool test_in_state(void *arg)
+{
+    ble_ota_progress_t progress;
+
+    ble_ota_get_progress(&progress);
+    return progress.state == *(ble_ota_state_t *)arg;
+}
+
+/**
+ * @brief  Connect the next peer and subscribe to the control characteristic
+ */
+static void test_client_connect(void)
+{
+    test_conn_handle = test_connect(test_peer++, TEST_MTU);
+    fake_subscribe(test_conn_handle, test_control_handle, true);
+    fake_run();
+}
+
+/**
+ * @brief  Image contents, one per seed
+ */
+static void test_make_image(uint32_t size, uint32_t seed)
+{
+    uint32_t i;
+
+    for(i = 0; i < size; i++)
+    {
+        test_image[i] = (uint8_t)((i * 2654435761u + seed) >> 13);
+    }
+}
+
+/**
+ * @brief  Write a command and wait for its answer
+ * @retval Status of the answer, 0xFF if none came
+ */
+static uint32_t test_command(uint8_t op, uint32_t size, uint32_t crc)
+{
+    uint8_t command[1 + 2 * sizeof(uint32_t)];
+    uint32_t expected[2] = { op, test_answers[op].count };
+    uint16_t length = op == BLE_OTA_OP_BEGIN ? sizeof(command) : 1;
+
+    command[0] = op;
+    memcpy(command + 1, &size, sizeof(size));
+    memcpy(command + 5, &crc, sizeof(crc));
+    CHECK(fake_gatt_write(test_conn_handle, test_control_handle, command, length) == 0);
+    if(!fake_run_until(test_answered, expected, TEST_TIMEOUT_MS))
+    {
+        return 0xFF;
+    }
+    return test_answers[op].status;
+}
+
+/**
+ * @brief  Send image bytes from..to, never more than the window ahead of the
+ *         progress, resending from every NACK
+ * @retval Offset reached, short of to when the device gave up
+ */
+static uint32_t test_send(uint32_t from, uint32_t to)
+{
+    uint8_t write[BLE_OTA_DATA_HEADER_SIZE + TEST_CHUNK_SIZE];
+    uint32_t nacks = test_answers[BLE_OTA_OP_NACK].count;
+    uint32_t failures = test_answers[BLE_OTA_OP_PROGRESS].count;
+    uint32_t next = from;
+    uint32_t chunk;
+    int64_t start = fake_time_us();
+
+    test_progress = from;
+    while(next < to && fake_time_us() - start < 10 * TEST_TIMEOUT_MS * 1000LL)
+    {
+        if(test_answers[BLE_OTA_OP_NACK].count != nacks)
+        {
+            nacks = test_answers[BLE_OTA_OP_NACK].count;
+            next = test_answers[BLE_OTA_OP_NACK].offset;
+        }
+        if(test_answers[BLE_OTA_OP_PROGRESS].count != failures &&
+           test_answers[BLE_OTA_OP_PROGRESS].status != BLE_OTA_STATUS_OK)
+        {
+            break;
+        }
+        failures = test_answers[BLE_OTA_OP_PROGRESS].count;
+        if(next - test_progress >= BLE_OTA_WINDOW)
+        {
+            /* Let the writer catch up */
+            taskYIELD();
+            fake_run();
+            continue;
+        }
+
+        chunk = to - next < TEST_CHUNK_SIZE ? to - next : TEST_CHUNK_SIZE;
+        memcpy(write, &next, sizeof(next));
+        memcpy(write + BLE_OTA_DATA_HEADER_SIZE, test_image + next, chunk);
+        CHECK(fake_gatt_write(test_conn_handle, test_data_handle, write, BLE_OTA_DATA_HEADER_SIZE + chunk) == 0);
+        next += chunk;
+        fake_run();
+    }
+    return next;
+}
+
+/**
+ * @brief  The service is up before NVS, as in fast start while NVS is being
+ *         recovered: BEGIN is answered BUSY until NVS is ready
+ */
+static void test_nvs_not_ready(void)
+{
+    ble_ota_progress_t progress;
+
+    CHECK(nvs_flash_erase() == ESP_OK);
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_FAIL_IMAGE, 0) == BLE_OTA_STATUS_BUSY);
+    ble_ota_get_progress(&progress);
+    CHECK(progress.state == BLE_OTA_STATE_IDLE);
+
+    CHECK(nvs_flash_init() == ESP_OK);
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_FAIL_IMAGE, 0) == BLE_OTA_STATUS_OK);
+    CHECK(test_command(BLE_OTA_OP_ABORT, 0, 0) == BLE_OTA_STATUS_OK);
+    ble_ota_get_progress(&progress);
+    CHECK(progress.state == BLE_OTA_STATE_IDLE);
+    CHECK(test_flash_written == 0);
+}
+
+/**
+ * @brief  Bad sizes and commands out of sequence are answered INVALID, data
+ *         without a transfer is ignored
+ */
+static void test_begin_refused(void)
+{
+    ble_ota_progress_t progress;
+    uint8_t write[BLE_OTA_DATA_HEADER_SIZE + 16] = { 0 };
+
+    CHECK(test_command(BLE_OTA_OP_BEGIN, 0, 0) == BLE_OTA_STATUS_INVALID);
+    CHECK(test_command(BLE_OTA_OP_BEGIN, FAKE_OTA_PARTITION_SIZE + 1, 0) == BLE_OTA_STATUS_INVALID);
+    CHECK(test_command(BLE_OTA_OP_END, 0, 0) == BLE_OTA_STATUS_INVALID);
+    CHECK(fake_gatt_write(test_conn_handle, test_data_handle, write, sizeof(write)) == 0);
+    fake_run();
+    ble_ota_get_progress(&progress);
+    CHECK(progress.state == BLE_OTA_STATE_IDLE);
+    CHECK(test_flash_written == 0);
+}
+
+/**
+ * @brief  A failed flash write stops the transfer and is reported with the
+ *         offset that made it
+ */
+static void test_flash_error(void)
+{
+    ble_ota_progress_t progress;
+
+    test_make_image(TEST_FAIL_IMAGE, 1);
+    test_flash_fail_at = 2 * BLE_OTA_BUFFER_SIZE + 10;
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_FAIL_IMAGE, esp_crc32_le(0, test_image, TEST_FAIL_IMAGE)) ==
+          BLE_OTA_STATUS_OK);
+    CHECK(test_answers[BLE_OTA_OP_BEGIN].offset == 0);
+    CHECK(test_send(0, TEST_FAIL_IMAGE) <= TEST_FAIL_IMAGE);
+    CHECK(fake_run_until(test_in_state, &test_idle, TEST_TIMEOUT_MS));
+
+    CHECK(test_answers[BLE_OTA_OP_PROGRESS].status == BLE_OTA_STATUS_FLASH);
+    CHECK(test_answers[BLE_OTA_OP_PROGRESS].offset == 2 * BLE_OTA_BUFFER_SIZE);
+    ble_ota_get_progress(&progress);
+    CHECK(progress.written == 2 * BLE_OTA_BUFFER_SIZE);
+    test_flash_fail_at = TEST_NO_FAILURE;
+    CHECK(test_command(BLE_OTA_OP_ABORT, 0, 0) == BLE_OTA_STATUS_OK);
+}
+
+/**
+ * @brief  An image that does not match its CRC is written, then refused at END
+ */
+static void test_crc_mismatch(void)
+{
+    uint32_t crc;
+
+    test_make_image(TEST_SMALL_IMAGE, 2);
+    crc = esp_crc32_le(0, test_image, TEST_SMALL_IMAGE) ^ 1;
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_SMALL_IMAGE, crc) == BLE_OTA_STATUS_OK);
+    CHECK(test_send(0, TEST_SMALL_IMAGE) == TEST_SMALL_IMAGE);
+    CHECK(test_command(BLE_OTA_OP_END, 0, 0) == BLE_OTA_STATUS_CRC);
+    CHECK(test_answers[BLE_OTA_OP_END].offset == TEST_SMALL_IMAGE);
+    CHECK(fake_run_until(test_in_state, &test_idle, TEST_TIMEOUT_MS));
+    CHECK(test_boot == NULL);
+
+    test_flash_read(esp_ota_get_next_update_partition(NULL), 0, test_readback, TEST_SMALL_IMAGE);
+    CHECK(memcmp(test_readback, test_image, TEST_SMALL_IMAGE) == 0);
+}
+
+/**
+ * @brief  The owner leaving while END is checked does not end the transfer:
+ *         nobody else gets in until the check is over, a refused image then
+ *         leaves the service idle
+ */
+static void test_close_while_finishing(void)
+{
+    uint8_t command[1 + 2 * sizeof(uint32_t)] = { BLE_OTA_OP_BEGIN, 1 };
+    uint32_t restarts = fake_restarts();
+    ble_ota_progress_t progress;
+    uint32_t end[2];
+
+    test_make_image(TEST_SMALL_IMAGE, 3);
+    test_boot_rc = ESP_FAIL;
+    test_boot_entered = false;
+    xSemaphoreTake(test_boot_gate, portMAX_DELAY);
+
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_SMALL_IMAGE, esp_crc32_le(0, test_image, TEST_SMALL_IMAGE)) ==
+          BLE_OTA_STATUS_OK);
+    CHECK(test_send(0, TEST_SMALL_IMAGE) == TEST_SMALL_IMAGE);
+    end[0] = BLE_OTA_OP_END;
+    end[1] = test_answers[BLE_OTA_OP_END].count;
+    command[0] = BLE_OTA_OP_END;
+    CHECK(fake_gatt_write(test_conn_handle, test_control_handle, command, 1) == 0);
+    CHECK(fake_run_until(test_boot_waiting, NULL, TEST_TIMEOUT_MS));
+
+    fake_disconnect(test_conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    ble_ota_get_progress(&progress);
+    CHECK(progress.state == BLE_OTA_STATE_FINISHING);
+
+    test_client_connect();
+    command[0] = BLE_OTA_OP_BEGIN;
+    CHECK(fake_gatt_write(test_conn_handle, test_control_handle, command, sizeof(command)) ==
+          BLE_ATT_ERR_WRITE_NOT_PERMITTED);
+
+    xSemaphoreGive(test_boot_gate);
+    CHECK(fake_run_until(test_in_state, &test_idle, TEST_TIMEOUT_MS));
+    CHECK(!test_answered(end));
+    CHECK(test_boot == NULL);
+    CHECK(fake_restarts() == restarts);
+    test_boot_rc = ESP_OK;
+}
+
+/**
+ * @brief  A full partition image, interrupted by a disconnect, resumed from
+ *         the last committed offset on the next connection. The owner leaves
+ *         again during the END check, the device still boots the image
+ */
+static void test_resume_and_update(void)
+{
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    uint32_t crc;
+    uint32_t resume;
+    uint32_t erased;
+    uint32_t restarts = fake_restarts();
+    ble_ota_progress_t progress;
+    int64_t start;
+    int64_t elapsed;
+
+    test_make_image(TEST_FULL_IMAGE, 4);
+    crc = esp_crc32_le(0, test_image, TEST_FULL_IMAGE);
+    start = fake_time_us();
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_FULL_IMAGE, crc) == BLE_OTA_STATUS_OK);
+    CHECK(test_answers[BLE_OTA_OP_BEGIN].offset == 0);
+    CHECK(test_send(0, TEST_INTERRUPT_AT) == TEST_INTERRUPT_AT);
+
+    fake_disconnect(test_conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    CHECK(test_in_state(&test_idle));
+
+    /* Buffers already handed to the writer still land */
+    vTaskDelay(pdMS_TO_TICKS(50));
+    ble_ota_get_progress(&progress);
+    resume = progress.written / BLE_OTA_COMMIT_SIZE * BLE_OTA_COMMIT_SIZE;
+    CHECK(resume > 0);
+
+    test_client_connect();
+    erased = test_flash_erased;
+    CHECK(test_command(BLE_OTA_OP_BEGIN, TEST_FULL_IMAGE, crc) == BLE_OTA_STATUS_OK);
+    CHECK(test_answers[BLE_OTA_OP_BEGIN].offset == resume);
+    ble_ota_get_progress(&progress);
+    CHECK(progress.resumed_at == resume);
+    CHECK(test_send(resume, TEST_FULL_IMAGE) == TEST_FULL_IMAGE);
+    CHECK(test_flash_erased - erased == TEST_FULL_IMAGE - resume);
+
+    test_boot_entered = false;
+    xSemaphoreTake(test_boot_gate, portMAX_DELAY);
+    CHECK(fake_gatt_write(test_conn_handle, test_control_handle, (uint8_t[]){ BLE_OTA_OP_END }, 1) == 0);
+    CHECK(fake_run_until(test_boot_waiting, NULL, TEST_TIMEOUT_MS));
+    elapsed = fake_time_us() - start;
+    fake_disconnect(test_conn_handle, BLE_HS_HCI_ERR(BLE_ERR_REM_USER_CONN_TERM));
+    fake_run();
+    ble_ota_get_progress(&progress);
+    CHECK(progress.state == BLE_OTA_STATE_FINISHING);
+    xSemaphoreGive(test_boot_gate);
+    CHECK(fake_run_until(test_in_state, &test_done, TEST_TIMEOUT_MS));
+    CHECK(test_boot == partition);
+    test_flash_read(partition, 0, test_readback, TEST_FULL_IMAGE);
+    CHECK(memcmp(test_readback, test_image, TEST_FULL_IMAGE) == 0);
+    fake_advance_ms(BLE_OTA_REBOOT_DELAY_MS);
+    fake_run();
+    CHECK(fake_restarts() == restarts + 1);
+    printf("update: %u bytes, resumed at %u, %.0f ms without air time\n", TEST_FULL_IMAGE, resume, elapsed / 1e3);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  OTA transfer state machine against a file backed flash
+ */
+int main(void)
+{
+    uint8_t zero[SPI_FLASH_SEC_SIZE] = { 0 };
+    uint32_t i;
+
+    test_setup();
+    test_flash = tmpfile();
+    CHECK(test_flash != NULL);
+    for(i = 0; i < TEST_FLASH_SIZE; i += sizeof(zero))
+    {
+        fwrite(zero, 1, sizeof(zero), test_flash);
+    }
+    test_boot_gate = xSemaphoreCreateMutex();
+    CHECK(ble_ota_register_flash(&test_file_flash) == ESP_OK);
+    test_control_handle = fake_gatt_find(&test_ota_control_uuid.u);
+    test_data_handle = fake_gatt_find(&test_ota_data_uuid.u);
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_client_connect();
+
+    TEST_RUN(test_nvs_not_ready);
+    TEST_RUN(test_begin_refused);
+    TEST_RUN(test_flash_error);
+    TEST_RUN(test_crc_mismatch);
+    TEST_RUN(test_close_while_finishing);
+    TEST_RUN(test_resume_and_update);
+    fclose(test_flash);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,348 @@
+/*
+ *  test_pool.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include <stdlib.h>
+
+#include "test.h"
+#include "ble_pool.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The benchmark replays packet lifetimes: a ring of live buffers where every
+ * step frees the oldest one and allocates a new one, sizes drawn from a
+ * gateway mix of MTU packets, attribute values and framed messages. The same
+ * trace runs against the pool and against malloc.
+ */
+#define TEST_BENCH_STEPS                              2000000
+#define TEST_BENCH_LIVE                               8
+#define TEST_STRESS_TASKS                             4
+#define TEST_STRESS_STEPS                             200000
+
+typedef void *(*test_alloc_t)(size_t size);
+typedef void (*test_free_t)(void *block);
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static ble_pool_stats_t test_before[BLE_POOL_CLASSES];
+static volatile uint32_t test_stress_done;
+static volatile uint32_t test_stress_errors;
+static volatile uint32_t test_stress_misses;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_snapshot(void);
+static uint32_t test_in_use(ble_pool_class_t pool_class);
+static size_t test_bench_size(uint32_t step);
+static int64_t test_bench_run(test_alloc_t alloc_fn, test_free_t free_fn, uint32_t *misses);
+static void test_stress_task(void *arg);
+static void test_size_classes(void);
+static void test_fallback_and_fails(void);
+static void test_foreign_block(void);
+static void test_stress_tasks(void);
+static void test_bench_against_malloc(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Remember the counters, the firmware holds blocks of its own
+ */
+static void test_snapshot(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        ble_pool_get_stats(i, &test_before[i]);
+    }
+}
+
+/**
+ * @brief  Blocks taken from a class since test_snapshot()
+ */
+static uint32_t test_in_use(ble_pool_class_t pool_class)
+{
+    ble_pool_stats_t stats;
+
+    ble_pool_get_stats(pool_class, &stats);
+    return stats.in_use - test_before[pool_class].in_use;
+}
+
+/**
+ * @brief  Size of a benchmark allocation: mostly MTU packets, some attribute
+ *         values, now and then a framed message
+ */
+static size_t test_bench_size(uint32_t step)
+{
+    uint32_t hash = step * 2654435761u;
+    uint32_t pick = (hash >> 24) % 100;
+
+    if(pick < 80)
+    {
+        return 20 + (hash >> 8) % (BLE_POOL_SMALL_SIZE - 20 + 1);
+    }
+    if(pick < 97)
+    {
+        return BLE_POOL_SMALL_SIZE + 1 + (hash >> 8) % (BLE_POOL_MEDIUM_SIZE - BLE_POOL_SMALL_SIZE);
+    }
+    return BLE_POOL_MEDIUM_SIZE + 1 + (hash >> 8) % (BLE_POOL_LARGE_SIZE - BLE_POOL_MEDIUM_SIZE);
+}
+
+/**
+ * @brief  Replay the packet lifetime trace with one allocator
+ * @retval Elapsed time in us
+ */
+static int64_t test_bench_run(test_alloc_t alloc_fn, test_free_t free_fn, uint32_t *misses)
+{
+    void *live[TEST_BENCH_LIVE] = { NULL };
+    uint8_t *block;
+    int64_t start;
+    uint32_t step;
+    size_t size;
+
+    *misses = 0;
+    start = fake_time_us();
+    for(step = 0; step < TEST_BENCH_STEPS; step++)
+    {
+        free_fn(live[step % TEST_BENCH_LIVE]);
+        size = test_bench_size(step);
+        block = alloc_fn(size);
+        if(block == NULL)
+        {
+            (*misses)++;
+        }
+        else
+        {
+            /* Touch both ends, as a packet copy would */
+            block[0] = (uint8_t)step;
+            block[size - 1] = (uint8_t)step;
+        }
+        live[step % TEST_BENCH_LIVE] = block;
+    }
+    for(step = 0; step < TEST_BENCH_LIVE; step++)
+    {
+        free_fn(live[step]);
+    }
+    return fake_time_us() - start;
+}
+
+/**
+ * @brief  Take and return blocks, each one stamped with the task while held
+ */
+static void test_stress_task(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    uint32_t held[BLE_POOL_SMALL_COUNT / TEST_STRESS_TASKS];
+    uint32_t *blocks[BLE_POOL_SMALL_COUNT / TEST_STRESS_TASKS] = { NULL };
+    uint32_t step;
+    uint32_t slot;
+
+    for(step = 0; step < TEST_STRESS_STEPS; step++)
+    {
+        slot = step % (BLE_POOL_SMALL_COUNT / TEST_STRESS_TASKS);
+        if(blocks[slot] != NULL)
+        {
+            if(blocks[slot][0] != held[slot] || blocks[slot][1] != id)
+            {
+                test_stress_errors++;
+            }
+            ble_pool_free(blocks[slot]);
+        }
+        blocks[slot] = ble_pool_alloc(16 + step % (BLE_POOL_SMALL_SIZE - 16));
+        if(blocks[slot] == NULL)
+        {
+            test_stress_misses++;
+            continue;
+        }
+        held[slot] = step;
+        blocks[slot][0] = step;
+        blocks[slot][1] = id;
+    }
+    for(slot = 0; slot < BLE_POOL_SMALL_COUNT / TEST_STRESS_TASKS; slot++)
+    {
+        ble_pool_free(blocks[slot]);
+    }
+    __atomic_add_fetch(&test_stress_done, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  Requests land in the smallest class that fits, the counters follow
+ */
+static void test_size_classes(void)
+{
+    ble_pool_stats_t stats;
+    void *small;
+    void *medium;
+    void *large;
+
+    test_snapshot();
+    small = ble_pool_alloc(1);
+    medium = ble_pool_alloc(BLE_POOL_SMALL_SIZE + 1);
+    large = ble_pool_alloc(BLE_POOL_LARGE_SIZE);
+    CHECK(small != NULL && medium != NULL && large != NULL);
+    CHECK(ble_pool_alloc(BLE_POOL_LARGE_SIZE + 1) == NULL);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 1);
+    CHECK(test_in_use(BLE_POOL_MEDIUM) == 1);
+    CHECK(test_in_use(BLE_POOL_LARGE) == 1);
+
+    ble_pool_get_stats(BLE_POOL_LARGE, &stats);
+    CHECK(stats.block_size == BLE_POOL_LARGE_SIZE);
+    CHECK(stats.blocks == BLE_POOL_LARGE_COUNT);
+    CHECK(stats.peak >= stats.in_use);
+
+    ble_pool_free(small);
+    ble_pool_free(medium);
+    ble_pool_free(large);
+    ble_pool_free(NULL);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 0);
+    CHECK(test_in_use(BLE_POOL_MEDIUM) == 0);
+    CHECK(test_in_use(BLE_POOL_LARGE) == 0);
+}
+
+/**
+ * @brief  An empty class spills into the larger ones, only the class sized
+ *         for the request counts the miss, the peak stays at the high water
+ */
+static void test_fallback_and_fails(void)
+{
+    void *blocks[BLE_POOL_SMALL_COUNT + BLE_POOL_MEDIUM_COUNT + BLE_POOL_LARGE_COUNT];
+    ble_pool_stats_t small;
+    ble_pool_stats_t large;
+    uint32_t free_blocks;
+    uint32_t count = 0;
+    uint32_t i;
+
+    test_snapshot();
+    free_blocks = 0;
+    for(i = 0; i < BLE_POOL_CLASSES; i++)
+    {
+        free_blocks += test_before[i].blocks - test_before[i].in_use;
+    }
+    while((blocks[count] = ble_pool_alloc(1)) != NULL)
+    {
+        count++;
+    }
+    CHECK(count == free_blocks);
+    CHECK(test_in_use(BLE_POOL_LARGE) == test_before[BLE_POOL_LARGE].blocks - test_before[BLE_POOL_LARGE].in_use);
+
+    ble_pool_get_stats(BLE_POOL_SMALL, &small);
+    ble_pool_get_stats(BLE_POOL_LARGE, &large);
+    CHECK(small.fails == test_before[BLE_POOL_SMALL].fails + 1 + BLE_POOL_MEDIUM_COUNT + BLE_POOL_LARGE_COUNT
+          - test_before[BLE_POOL_MEDIUM].in_use - test_before[BLE_POOL_LARGE].in_use);
+    CHECK(large.fails == test_before[BLE_POOL_LARGE].fails);
+    CHECK(small.peak == small.blocks);
+
+    while(count > 0)
+    {
+        ble_pool_free(blocks[--count]);
+    }
+    ble_pool_get_stats(BLE_POOL_SMALL, &small);
+    CHECK(small.in_use == test_before[BLE_POOL_SMALL].in_use);
+    CHECK(small.peak == small.blocks);
+}
+
+/**
+ * @brief  Freeing memory the pool does not own changes nothing
+ */
+static void test_foreign_block(void)
+{
+    uint8_t foreign[16];
+    void *block;
+
+    test_snapshot();
+    block = ble_pool_alloc(1);
+    ble_pool_free(foreign);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 1);
+    ble_pool_free(block);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 0);
+}
+
+/**
+ * @brief  Tasks on separate threads share the pool, no block is ever handed
+ *         out twice and every one comes back
+ */
+static void test_stress_tasks(void)
+{
+    int64_t start;
+    uint32_t i;
+
+    test_snapshot();
+    start = fake_time_us();
+    for(i = 0; i < TEST_STRESS_TASKS; i++)
+    {
+        CHECK(xTaskCreate(test_stress_task, "pool", 4096, (void *)(uintptr_t)i, 5, NULL) == pdPASS);
+    }
+    while(test_stress_done < TEST_STRESS_TASKS && fake_time_us() - start < 60 * 1000000LL)
+    {
+        vTaskDelay(1);
+    }
+
+    CHECK(test_stress_done == TEST_STRESS_TASKS);
+    CHECK(test_stress_errors == 0);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 0);
+    CHECK(test_in_use(BLE_POOL_MEDIUM) == 0);
+    CHECK(test_in_use(BLE_POOL_LARGE) == 0);
+    printf("stress: %u tasks, %u steps each, %u misses\n", TEST_STRESS_TASKS, TEST_STRESS_STEPS,
+           test_stress_misses);
+}
+
+/**
+ * @brief  The lifetime trace against the pool and against malloc, the pool
+ *         serves it without a miss and without the heap
+ */
+static void test_bench_against_malloc(void)
+{
+    uint32_t allocs = fake_heap_allocs();
+    uint32_t pool_misses;
+    uint32_t malloc_misses;
+    int64_t pool_us;
+    int64_t malloc_us;
+
+    test_snapshot();
+    pool_us = test_bench_run(ble_pool_alloc, ble_pool_free, &pool_misses);
+    malloc_us = test_bench_run(malloc, free, &malloc_misses);
+
+    CHECK(pool_misses == 0);
+    CHECK(malloc_misses == 0);
+    CHECK(fake_heap_allocs() == allocs);
+    CHECK(test_in_use(BLE_POOL_SMALL) == 0);
+    CHECK(test_in_use(BLE_POOL_MEDIUM) == 0);
+    CHECK(test_in_use(BLE_POOL_LARGE) == 0);
+    printf("pool:   %u alloc/free pairs, %.1f ns each\n", TEST_BENCH_STEPS,
+           pool_us * 1e3 / TEST_BENCH_STEPS);
+    printf("malloc: %u alloc/free pairs, %.1f ns each\n", TEST_BENCH_STEPS,
+           malloc_us * 1e3 / TEST_BENCH_STEPS);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Packet pool classes, counters and concurrency, benchmark against malloc
+ */
+int main(void)
+{
+    test_setup();
+
+    TEST_RUN(test_size_classes);
+    TEST_RUN(test_fallback_and_fails);
+    TEST_RUN(test_stress_tasks);
+    TEST_RUN(test_bench_against_malloc);
+    TEST_RUN(test_foreign_block);
+    return test_result();
+}
\ No newline at end of file
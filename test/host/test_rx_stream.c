@@ -0,0 +1,345 @@
+/*
+ *  test_rx_stream.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * Replays write traces through the rx stream characteristic with a go-back-N
+ * client: it keeps up to the advertised window of writes unacked, resends
+ * from the sequence number of a NACK, and from the last ack after a timeout.
+ */
+#define TEST_MTU                                      247
+#define TEST_TRACE_LENGTH                             5000
+#define TEST_MAX_PAYLOAD                              (TEST_MTU - 3 - RX_STREAM_HEADER_SIZE)
+#define TEST_CLIENT_TIMEOUT_STEPS                     3
+#define TEST_CLIENT_GIVE_UP_STEPS                     1000
+
+typedef struct
+{
+    uint32_t total;                     /* Writes in the trace */
+    uint32_t loss_per_mille;            /* Writes lost on air */
+    uint32_t base;                      /* Oldest unacked write */
+    uint32_t next;                      /* Next write to send */
+    uint32_t window;
+    uint32_t sent;                      /* Writes sent, resends included */
+    uint32_t lost;
+    uint32_t acks;
+    uint32_t nacks;
+    uint32_t random;
+} test_client_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static uint16_t test_stream_handle;
+static uint16_t test_ack_handle;
+static test_client_t test_client;
+static uint32_t test_stream_next;       /* Trace index the server expects */
+static volatile uint32_t test_handled;
+static volatile uint32_t test_handled_bytes;
+static volatile uint32_t test_out_of_order;
+static SemaphoreHandle_t test_handler_gate;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static bool test_handled_all(void *arg);
+static void test_worker_drain(void);
+static uint32_t test_random(test_client_t *client);
+static uint16_t test_payload_size(uint32_t index);
+static void test_client_send(test_client_t *client, uint32_t index);
+static bool test_replay(uint32_t total, uint32_t loss_per_mille, const char *name);
+static void test_replay_lossless(void);
+static void test_replay_lossy(void);
+static void test_worker_full_nacks(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Client side of the ack characteristic, the sequence number is the
+ *         low 16 bits of the trace index
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    test_client_t *client = &test_client;
+    uint16_t seq;
+    uint32_t index;
+
+    if(attr_handle != test_ack_handle || length != RX_STREAM_ACK_SIZE)
+    {
+        return;
+    }
+    seq = data[1] | (data[2] << 8);
+    index = (client->base & ~0xFFFFu) | seq;
+    if(index < client->base)
+    {
+        index += 0x10000;
+    }
+    client->window = data[3] | (data[4] << 8);
+    if(index > client->next)
+    {
+        return;
+    }
+    client->base = index;
+    if(data[0] == RX_STREAM_NACK)
+    {
+        client->next = index;
+        client->nacks++;
+    }
+    else
+    {
+        client->acks++;
+    }
+}
+
+/**
+ * @brief  Rx worker handler, writes carry their trace index
+ */
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    uint32_t index;
+
+    xSemaphoreTake(test_handler_gate, portMAX_DELAY);
+    xSemaphoreGive(test_handler_gate);
+    memcpy(&index, data, sizeof(index));
+    test_out_of_order += index != test_handled;
+    test_handled_bytes += size;
+    test_handled++;
+}
+
+/**
+ * @brief  Wait condition: *arg writes handled
+ */
+static bool test_handled_all(void *arg)
+{
+    return test_handled >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Yield until the rx worker queue is empty
+ */
+static void test_worker_drain(void)
+{
+    gatt_server_rx_stats_t stats;
+    int64_t start = fake_time_us();
+
+    do
+    {
+        taskYIELD();
+        gatt_server_get_rx_stats(&stats);
+    } while(stats.depth > 0 && fake_time_us() - start < TEST_TIMEOUT_MS * 1000LL);
+}
+
+/**
+ * @brief  xorshift, the traces are the same on every run
+ */
+static uint32_t test_random(test_client_t *client)
+{
+    client->random ^= client->random << 13;
+    client->random ^= client->random >> 17;
+    client->random ^= client->random << 5;
+    return client->random;
+}
+
+/**
+ * @brief  Payload size of a trace write, mostly full MTU with short ones mixed in
+ */
+static uint16_t test_payload_size(uint32_t index)
+{
+    uint32_t hash = index * 2654435761u;
+
+    return (hash >> 28) < 12 ? TEST_MAX_PAYLOAD : sizeof(uint32_t) + (hash >> 8) % (TEST_MAX_PAYLOAD - 4);
+}
+
+/**
+ * @brief  Send one write of the trace, or lose it
+ */
+static void test_client_send(test_client_t *client, uint32_t index)
+{
+    uint8_t write[RX_STREAM_HEADER_SIZE + TEST_MAX_PAYLOAD];
+    uint16_t size = test_payload_size(index);
+
+    client->sent++;
+    if(test_random(client) % 1000 < client->loss_per_mille)
+    {
+        client->lost++;
+        return;
+    }
+    write[0] = index & 0xFF;
+    write[1] = (index >> 8) & 0xFF;
+    memset(write + RX_STREAM_HEADER_SIZE, (uint8_t)index, size);
+    memcpy(write + RX_STREAM_HEADER_SIZE, &index, sizeof(index));
+    fake_gatt_write(test_conn_handle, test_stream_handle, write, RX_STREAM_HEADER_SIZE + size);
+}
+
+/**
+ * @brief  Replay a trace until every write is acknowledged
+ * @retval true if the trace completed
+ */
+static bool test_replay(uint32_t total, uint32_t loss_per_mille, const char *name)
+{
+    test_client_t *client = &test_client;
+    uint32_t handled = test_handled;
+    uint32_t bytes = test_handled_bytes;
+    uint32_t stalled = 0;
+    uint32_t idle = 0;
+    uint32_t last_base;
+    int64_t skipped_us = 0;
+    int64_t start;
+    int64_t elapsed;
+
+    memset(client, 0, sizeof(*client));
+    client->base = test_stream_next;
+    client->next = client->base;
+    client->total = client->base + total;
+    client->window = BLE_RX_STREAM_WINDOW;
+    client->loss_per_mille = loss_per_mille;
+    client->random = 0x9E3779B9u;
+
+    start = fake_time_us();
+    while(client->base < client->total && idle < TEST_CLIENT_GIVE_UP_STEPS)
+    {
+        last_base = client->base;
+        while(client->next < client->total && client->next < client->base + client->window)
+        {
+            test_client_send(client, client->next++);
+        }
+        fake_run();
+        if(client->base != last_base)
+        {
+            stalled = 0;
+            idle = 0;
+            continue;
+        }
+
+        /* No progress: let the worker catch up and the delayed ack fire,
+         * then time out and resend. Skipped time is not throughput time */
+        idle++;
+        test_worker_drain();
+        fake_advance_ms(BLE_RX_STREAM_ACK_DELAY_MS);
+        skipped_us += BLE_RX_STREAM_ACK_DELAY_MS * 1000;
+        fake_run();
+        if(++stalled >= TEST_CLIENT_TIMEOUT_STEPS)
+        {
+            client->next = client->base;
+            stalled = 0;
+        }
+    }
+    while(test_handled - handled < total && fake_time_us() - start - skipped_us < TEST_TIMEOUT_MS * 1000LL)
+    {
+        vTaskDelay(1);
+    }
+    elapsed = fake_time_us() - start - skipped_us;
+    test_stream_next = client->base;
+
+    printf("%-8s %u writes, %u sent, %u lost, %u acks, %u nacks, %.0f writes/s, %.0f B/s\n", name, total,
+           client->sent, client->lost, client->acks, client->nacks,
+           (test_handled - handled) * 1e6 / (elapsed > 0 ? elapsed : 1),
+           (test_handled_bytes - bytes) * 1e6 / (elapsed > 0 ? elapsed : 1));
+    return client->base == client->total && test_handled - handled == total;
+}
+
+/**
+ * @brief  Without loss every write is delivered once and in order. The window
+ *         is wider than the worker queue, so a busy worker still costs NACKs
+ *         and resends, never a lost or repeated write.
+ */
+static void test_replay_lossless(void)
+{
+    CHECK(test_replay(TEST_TRACE_LENGTH, 0, "lossless"));
+    CHECK(test_client.lost == 0);
+    CHECK(test_client.acks > 0);
+    CHECK(test_out_of_order == 0);
+}
+
+/**
+ * @brief  Lost writes are NACKed and resent, the application still sees
+ *         every write once and in order
+ */
+static void test_replay_lossy(void)
+{
+    CHECK(test_replay(TEST_TRACE_LENGTH, 20, "lossy"));
+    CHECK(test_client.lost > 0);
+    CHECK(test_client.nacks > 0);
+    CHECK(test_out_of_order == 0);
+}
+
+/**
+ * @brief  A write the worker queue has no room for is NACKed, not acked,
+ *         and the resend is delivered
+ */
+static void test_worker_full_nacks(void)
+{
+    test_client_t *client = &test_client;
+    uint32_t start = test_stream_next;
+    uint32_t accepted;
+    uint32_t i;
+
+    memset(client, 0, sizeof(*client));
+    client->base = start;
+    client->next = start;
+    client->total = start + 2 * BLE_RX_QUEUE_LENGTH;
+    client->window = BLE_RX_STREAM_WINDOW;
+
+    xSemaphoreTake(test_handler_gate, portMAX_DELAY);
+    for(i = 0; i < 2 * BLE_RX_QUEUE_LENGTH; i++)
+    {
+        client->next = start + i + 1;
+        test_client_send(client, start + i);
+        fake_run();
+    }
+    accepted = client->base - start;
+    CHECK(client->nacks == 1);
+    CHECK(accepted >= BLE_RX_QUEUE_LENGTH && accepted < 2 * BLE_RX_QUEUE_LENGTH);
+    CHECK(ble_session_find(test_conn_handle)->rx_expected_seq == (uint16_t)client->base);
+
+    accepted += test_handled;
+    xSemaphoreGive(test_handler_gate);
+    CHECK(fake_run_until(test_handled_all, &accepted, TEST_TIMEOUT_MS));
+    test_stream_next = client->base;
+    CHECK(test_replay(client->total - client->base, 0, "resend"));
+    CHECK(test_out_of_order == 0);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Write without response stream with windowed acks
+ */
+int main(void)
+{
+    test_setup();
+    test_handler_gate = xSemaphoreCreateMutex();
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(test_rx_handler, 1));
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_stream_handle = fake_gatt_find(&test_rx_stream_uuid.u);
+    test_ack_handle = fake_gatt_find(&test_rx_ack_uuid.u);
+    test_conn_handle = test_connect(1, TEST_MTU);
+    fake_subscribe(test_conn_handle, test_ack_handle, true);
+    fake_run();
+
+    TEST_RUN(test_replay_lossless);
+    TEST_RUN(test_replay_lossy);
+    TEST_RUN(test_worker_full_nacks);
+    return test_result();
+}
\ No newline at end of file
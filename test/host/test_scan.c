@@ -0,0 +1,458 @@
+/*
+ *  test_scan.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_scan.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The replay is a minute of a busy site: beacons repeating one payload,
+ * sensors changing theirs every few reports and tags walking through the
+ * room, each on its own advertising interval. The gateway drains the table
+ * once a second, the way it would forward it upstream.
+ */
+#define TEST_DEVICES                                  300
+#define TEST_TRACE_MS                                 60000
+#define TEST_STEP_MS                                  10
+#define TEST_DRAIN_MS                                 1000
+#define TEST_DRAIN_MAX                                64
+#define TEST_ITVL_MIN_MS                              100
+#define TEST_ITVL_MAX_MS                              1000
+#define TEST_SENSOR_EVERY                             5       /* Reports between payload changes */
+#define TEST_DRAIN_TASKS                              2
+#define TEST_SWEEP_MS                                 1000    /* BLE_SCAN_SWEEP_MS of ble_scan.c */
+
+typedef enum
+{
+    TEST_BEACON = 0,
+    TEST_SENSOR,
+    TEST_TAG,
+    TEST_KINDS
+} test_kind_t;
+
+typedef struct
+{
+    uint32_t itvl_ms;
+    uint32_t next_ms;
+    uint32_t reports;
+    int8_t rssi;
+    uint8_t length;
+    uint8_t drained;
+} test_device_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static test_device_t test_devices[TEST_DEVICES];
+static uint32_t test_random_state;
+static volatile bool test_draining;
+static volatile uint32_t test_drain_done;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static uint32_t test_random(void);
+static test_kind_t test_kind(uint32_t index);
+static void test_addr(uint32_t index, ble_addr_t *addr);
+static uint32_t test_index(const ble_addr_t *addr);
+static void test_report(uint32_t index, uint32_t now_ms);
+static void test_scan_rsp(uint32_t index);
+static uint32_t test_drain(void);
+static void test_trace_init(void);
+static void test_drain_task(void *arg);
+static void test_replay(void);
+static void test_expiry(void);
+static void test_table_full(void);
+static void test_concurrent_drain(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Reproducible noise
+ */
+static uint32_t test_random(void)
+{
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * @brief  What a device of the trace is
+ */
+static test_kind_t test_kind(uint32_t index)
+{
+    return index % TEST_KINDS;
+}
+
+/**
+ * @brief  Address of a device of the trace, random static for tags
+ */
+static void test_addr(uint32_t index, ble_addr_t *addr)
+{
+    addr->type = test_kind(index) == TEST_TAG ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
+    addr->val[0] = index;
+    addr->val[1] = index >> 8;
+    addr->val[2] = 0x5c;
+    addr->val[3] = 0x3a;
+    addr->val[4] = 0x65;
+    addr->val[5] = test_kind(index) == TEST_TAG ? 0xc4 : 0x24;
+}
+
+/**
+ * @brief  Device of the trace an address belongs to
+ */
+static uint32_t test_index(const ble_addr_t *addr)
+{
+    return addr->val[0] | addr->val[1] << 8;
+}
+
+/**
+ * @brief  One advertising report of a device, as the controller hands it
+ */
+static void test_report(uint32_t index, uint32_t now_ms)
+{
+    test_device_t *device = &test_devices[index];
+    struct ble_gap_disc_desc desc = { 0 };
+    uint8_t data[BLE_SCAN_DATA_SIZE];
+    int32_t phase;
+    uint8_t i;
+
+    test_addr(index, &desc.addr);
+    for(i = 0; i < device->length; i++)
+    {
+        data[i] = index + i;
+    }
+    if(test_kind(index) == TEST_SENSOR)
+    {
+        data[device->length - 1] = device->reports / TEST_SENSOR_EVERY;
+    }
+
+    desc.event_type = BLE_HCI_ADV_RPT_EVTYPE_ADV_IND;
+    desc.length_data = device->length;
+    desc.data = data;
+    desc.rssi = device->rssi + (int32_t)(test_random() % 7) - 3;
+    if(test_kind(index) == TEST_TAG)
+    {
+        /* Walks away and back over 40 s, 1 dB a second */
+        phase = (now_ms / 1000 + index) % 40;
+        desc.rssi -= phase < 20 ? phase : 40 - phase;
+    }
+    fake_disc_report(&desc);
+    device->reports++;
+}
+
+/**
+ * @brief  The scan response of a device, answering an active scan
+ */
+static void test_scan_rsp(uint32_t index)
+{
+    struct ble_gap_disc_desc desc = { 0 };
+    uint8_t data[] = { 0x05, 0x09, 'T', 'e', 's', 't' };
+
+    test_addr(index, &desc.addr);
+    desc.event_type = BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP;
+    desc.length_data = sizeof(data);
+    desc.data = data;
+    desc.rssi = test_devices[index].rssi;
+    fake_disc_report(&desc);
+}
+
+/**
+ * @brief  Drain the changed devices as the gateway does
+ * @retval Devices drained
+ */
+static uint32_t test_drain(void)
+{
+    ble_scan_device_t devices[TEST_DRAIN_MAX];
+    uint32_t total = 0;
+    uint32_t count;
+    uint32_t i;
+
+    while((count = ble_scan_drain(devices, TEST_DRAIN_MAX)) > 0)
+    {
+        for(i = 0; i < count; i++)
+        {
+            CHECK(test_index(&devices[i].addr) < TEST_DEVICES);
+            test_devices[test_index(&devices[i].addr) % TEST_DEVICES].drained = 1;
+        }
+        total += count;
+    }
+    return total;
+}
+
+/**
+ * @brief  Intervals, payloads and base RSSI of the trace
+ */
+static void test_trace_init(void)
+{
+    uint32_t i;
+
+    test_random_state = 0x9E3779B9u;
+    for(i = 0; i < TEST_DEVICES; i++)
+    {
+        test_devices[i].itvl_ms = TEST_ITVL_MIN_MS + test_random() % (TEST_ITVL_MAX_MS - TEST_ITVL_MIN_MS);
+        test_devices[i].next_ms = test_random() % test_devices[i].itvl_ms;
+        test_devices[i].reports = 0;
+        test_devices[i].rssi = -40 - (int8_t)(test_random() % 50);
+        test_devices[i].length = 8 + test_random() % (BLE_SCAN_DATA_SIZE - 8 + 1);
+        test_devices[i].drained = 0;
+    }
+}
+
+/**
+ * @brief  Gateway task draining while the host task reports and sweeps
+ */
+static void test_drain_task(void *arg)
+{
+    ble_scan_device_t devices[TEST_DRAIN_MAX];
+
+    while(test_draining)
+    {
+        ble_scan_drain(devices, TEST_DRAIN_MAX);
+    }
+    __atomic_add_fetch(&test_drain_done, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  Every device is tracked and drained, repeated payloads are only
+ *         counted and the report path stays cheap
+ */
+static void test_replay(void)
+{
+    ble_scan_stats_t before;
+    ble_scan_stats_t after;
+    uint32_t reports = 0;
+    uint32_t drained = 0;
+    uint32_t missed = 0;
+    int64_t report_us = 0;
+    int64_t start;
+    uint32_t now;
+    uint32_t i;
+
+    test_trace_init();
+    ble_scan_get_stats(&before);
+    for(now = 0; now < TEST_TRACE_MS; now += TEST_STEP_MS)
+    {
+        start = fake_time_us();
+        for(i = 0; i < TEST_DEVICES; i++)
+        {
+            if(test_devices[i].next_ms <= now)
+            {
+                test_report(i, now);
+                test_devices[i].next_ms += test_devices[i].itvl_ms;
+                reports++;
+            }
+        }
+        report_us += fake_time_us() - start;
+
+        if(now % TEST_DRAIN_MS == 0)
+        {
+            drained += test_drain();
+        }
+        fake_advance_ms(TEST_STEP_MS);
+        fake_run();
+    }
+    drained += test_drain();
+    ble_scan_get_stats(&after);
+
+    for(i = 0; i < TEST_DEVICES; i++)
+    {
+        missed += !test_devices[i].drained;
+    }
+    printf("%u reports of %u devices, %u duplicates, %u drained, %.2f a report, %u probes at most, "
+           "%.1f ns a report\n", reports, after.devices, after.duplicates - before.duplicates, drained,
+           drained / (double)reports, after.max_probes, report_us * 1e3 / reports);
+
+    CHECK(after.reports - before.reports == reports);
+    CHECK(after.devices == TEST_DEVICES);
+    CHECK(after.full == before.full);
+    CHECK(after.expired == before.expired);
+    CHECK(missed == 0);
+    CHECK(after.duplicates - before.duplicates > reports / 2);
+    CHECK(drained * 4 < reports);
+    CHECK(after.max_probes < 32);
+}
+
+/**
+ * @brief  Devices unseen for BLE_SCAN_EXPIRY_MS are swept, the others stay.
+ *         One coming back in a freed slot starts clean
+ */
+static void test_expiry(void)
+{
+    ble_scan_device_t devices[TEST_DRAIN_MAX];
+    ble_scan_stats_t before;
+    ble_scan_stats_t stats;
+    uint32_t returned = 0;
+    uint32_t count;
+    uint32_t i;
+
+    ble_scan_get_stats(&before);
+    CHECK(before.devices == TEST_DEVICES);
+    for(i = 0; i < BLE_SCAN_EXPIRY_MS; i += TEST_SWEEP_MS / 2)
+    {
+        fake_advance_ms(TEST_SWEEP_MS / 2);
+        for(uint32_t index = 0; index < TEST_DEVICES; index += 2)
+        {
+            test_report(index, TEST_TRACE_MS + i);
+        }
+        fake_run();
+    }
+    fake_advance_ms(TEST_SWEEP_MS);
+    fake_run();
+
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == TEST_DEVICES / 2);
+    CHECK(stats.expired - before.expired == TEST_DEVICES / 2);
+
+    /* The clusters survived the removals: no device is added twice */
+    for(i = 0; i < TEST_DEVICES; i += 2)
+    {
+        test_report(i, TEST_TRACE_MS + BLE_SCAN_EXPIRY_MS);
+    }
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == TEST_DEVICES / 2);
+
+    /* The swept devices return through a scan response first, in slots the
+     * advertising reports of the previous occupants were left in */
+    test_drain();
+    for(i = 1; i < TEST_DEVICES; i += 2)
+    {
+        test_scan_rsp(i);
+    }
+    while((count = ble_scan_drain(devices, TEST_DRAIN_MAX)) > 0)
+    {
+        for(i = 0; i < count; i++)
+        {
+            CHECK(test_index(&devices[i].addr) % 2 == 1);
+            CHECK(devices[i].event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP);
+            CHECK(devices[i].data_len == 0);
+        }
+        returned += count;
+    }
+    ble_scan_get_stats(&stats);
+    CHECK(returned == TEST_DEVICES / 2);
+    CHECK(stats.devices == TEST_DEVICES);
+}
+
+/**
+ * @brief  New devices beyond 3/4 of the table are dropped and counted
+ */
+static void test_table_full(void)
+{
+    uint32_t limit = BLE_SCAN_TABLE_SIZE - BLE_SCAN_TABLE_SIZE / 4;
+    struct ble_gap_disc_desc desc = { 0 };
+    ble_scan_stats_t before;
+    ble_scan_stats_t stats;
+    uint8_t data[4] = { 0x03, 0x19, 0x00, 0x02 };
+    uint32_t i;
+
+    ble_scan_clear();
+    ble_scan_get_stats(&before);
+    CHECK(before.devices == 0);
+    desc.event_type = BLE_HCI_ADV_RPT_EVTYPE_NONCONN_IND;
+    desc.length_data = sizeof(data);
+    desc.data = data;
+    desc.rssi = -70;
+    for(i = 0; i < limit + 10; i++)
+    {
+        test_addr(i, &desc.addr);
+        desc.addr.val[2] = 0x7e;
+        fake_disc_report(&desc);
+    }
+
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == limit);
+    CHECK(stats.full - before.full == 10);
+    ble_scan_clear();
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == 0);
+}
+
+/**
+ * @brief  Gateway tasks drain while reports arrive and devices expire. The
+ *         sweep gives the lock back between chunks, the table stays whole
+ */
+static void test_concurrent_drain(void)
+{
+    ble_scan_stats_t before;
+    ble_scan_stats_t stats;
+    uint32_t round;
+    uint32_t i;
+
+    test_trace_init();
+    ble_scan_get_stats(&before);
+    test_draining = true;
+    test_drain_done = 0;
+    for(i = 0; i < TEST_DRAIN_TASKS; i++)
+    {
+        CHECK(xTaskCreate(test_drain_task, "drain", 4096, NULL, 5, NULL) == pdPASS);
+    }
+
+    /* Every round half of the devices is reported, then expires */
+    for(round = 0; round < 4; round++)
+    {
+        for(i = 0; i < TEST_DEVICES; i++)
+        {
+            if(i % 2 == round % 2)
+            {
+                test_report(i, 0);
+            }
+        }
+        fake_advance_ms(BLE_SCAN_EXPIRY_MS + TEST_SWEEP_MS);
+        fake_run();
+    }
+
+    test_draining = false;
+    while(__atomic_load_n(&test_drain_done, __ATOMIC_SEQ_CST) < TEST_DRAIN_TASKS)
+    {
+        vTaskDelay(1);
+    }
+
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == 0);
+    CHECK(stats.expired - before.expired == 4 * TEST_DEVICES / 2);
+    for(i = 0; i < TEST_DEVICES; i++)
+    {
+        test_report(i, 0);
+        test_report(i, 0);
+    }
+    ble_scan_get_stats(&stats);
+    CHECK(stats.devices == TEST_DEVICES);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Observer device table against a replayed scan
+ */
+int main(void)
+{
+    test_setup();
+    ble_scan_init();
+    CHECK(ble_scan_start(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER) == ESP_OK);
+
+    TEST_RUN(test_replay);
+    TEST_RUN(test_expiry);
+    TEST_RUN(test_table_full);
+    TEST_RUN(test_concurrent_drain);
+
+    CHECK(ble_scan_stop() == ESP_OK);
+    return test_result();
+}
\ No newline at end of file
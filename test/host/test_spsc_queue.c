@@ -0,0 +1,211 @@
+/*
+ *  test_spsc_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+#include "ble_spsc_queue.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_MTU                                      247
+#define TEST_STRESS_CAPACITY                          64
+#define TEST_STRESS_ITEMS                             2000000
+#define TEST_WRITE_SIZE                               64
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t check;
+    uint8_t payload[8];
+} test_item_t;
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static ble_spsc_queue_t test_queue;
+static test_item_t test_slots[TEST_STRESS_CAPACITY];
+static volatile bool test_producer_done;
+static volatile bool test_consumer_done;
+static volatile uint32_t test_consumer_errors;
+static volatile uint32_t test_producer_full;
+
+static uint16_t test_conn_handle;
+static SemaphoreHandle_t test_handler_gate;
+static volatile uint32_t test_handled;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_producer_task(void *arg);
+static void test_consumer_task(void *arg);
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static bool test_handled_all(void *arg);
+static void test_stress_two_tasks(void);
+static void test_worker_drops_when_full(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Push numbered items as fast as the queue takes them
+ */
+static void test_producer_task(void *arg)
+{
+    test_item_t *item;
+    uint32_t seq = 0;
+
+    while(seq < TEST_STRESS_ITEMS)
+    {
+        item = ble_spsc_queue_reserve(&test_queue);
+        if(item == NULL)
+        {
+            test_producer_full++;
+            taskYIELD();
+            continue;
+        }
+        item->seq = seq;
+        item->check = seq * 2654435761u;
+        memset(item->payload, (uint8_t)seq, sizeof(item->payload));
+        ble_spsc_queue_commit(&test_queue);
+        seq++;
+    }
+    test_producer_done = true;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  Pop items and check they come in order and intact
+ */
+static void test_consumer_task(void *arg)
+{
+    test_item_t *item;
+    uint32_t seq = 0;
+
+    while(seq < TEST_STRESS_ITEMS)
+    {
+        item = ble_spsc_queue_front(&test_queue);
+        if(item == NULL)
+        {
+            taskYIELD();
+            continue;
+        }
+        if(item->seq != seq || item->check != seq * 2654435761u || item->payload[7] != (uint8_t)seq)
+        {
+            test_consumer_errors++;
+        }
+        ble_spsc_queue_release(&test_queue);
+        seq++;
+    }
+    test_consumer_done = true;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  Rx worker handler, blocks while the gate is taken
+ */
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    xSemaphoreTake(test_handler_gate, portMAX_DELAY);
+    xSemaphoreGive(test_handler_gate);
+    test_handled++;
+}
+
+/**
+ * @brief  Wait condition: *arg packets handled
+ */
+static bool test_handled_all(void *arg)
+{
+    return test_handled >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  One producer and one consumer task on separate threads, every item
+ *         arrives once, in order and intact
+ */
+static void test_stress_two_tasks(void)
+{
+    int64_t start;
+    int64_t elapsed;
+
+    ble_spsc_queue_init(&test_queue, test_slots, sizeof(test_item_t), TEST_STRESS_CAPACITY);
+    start = fake_time_us();
+    CHECK(xTaskCreate(test_consumer_task, "consumer", 4096, NULL, 5, NULL) == pdPASS);
+    CHECK(xTaskCreate(test_producer_task, "producer", 4096, NULL, 5, NULL) == pdPASS);
+    while(!(test_producer_done && test_consumer_done) && fake_time_us() - start < 60 * 1000000LL)
+    {
+        vTaskDelay(1);
+    }
+    elapsed = fake_time_us() - start;
+
+    CHECK(test_producer_done && test_consumer_done);
+    CHECK(test_consumer_errors == 0);
+    CHECK(ble_spsc_queue_count(&test_queue) == 0);
+    printf("spsc: %u items in %lld us, %.1f Mitems/s, producer found the queue full %u times\n",
+           TEST_STRESS_ITEMS, (long long)elapsed, TEST_STRESS_ITEMS / (double)(elapsed > 0 ? elapsed : 1),
+           test_producer_full);
+}
+
+/**
+ * @brief  While the worker is stuck the host task keeps going: writes past
+ *         the queue are dropped, counted and answered with an ATT error, the
+ *         rest is delivered once the worker resumes
+ */
+static void test_worker_drops_when_full(void)
+{
+    uint16_t rx_handle = fake_gatt_find(&test_rx_uuid.u);
+    uint8_t data[TEST_WRITE_SIZE] = { 0 };
+    gatt_server_rx_stats_t stats;
+    uint32_t rejected = 0;
+    uint32_t accepted;
+    uint32_t i;
+    int rc;
+
+    xSemaphoreTake(test_handler_gate, portMAX_DELAY);
+    for(i = 0; i < 2 * BLE_RX_QUEUE_LENGTH; i++)
+    {
+        rc = fake_gatt_write(test_conn_handle, rx_handle, data, sizeof(data));
+        CHECK(rc == 0 || rc == BLE_ATT_ERR_INSUFFICIENT_RES);
+        rejected += rc == BLE_ATT_ERR_INSUFFICIENT_RES;
+        fake_run();
+    }
+    gatt_server_get_rx_stats(&stats);
+    CHECK(stats.dropped > 0);
+    CHECK(rejected == stats.dropped);
+    CHECK(stats.peak == BLE_RX_QUEUE_LENGTH);
+    accepted = 2 * BLE_RX_QUEUE_LENGTH - stats.dropped;
+    CHECK(accepted >= BLE_RX_QUEUE_LENGTH);
+
+    xSemaphoreGive(test_handler_gate);
+    CHECK(fake_run_until(test_handled_all, &accepted, TEST_TIMEOUT_MS));
+    gatt_server_get_rx_stats(&stats);
+    CHECK(stats.delivered == accepted);
+    CHECK(stats.depth == 0);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  SPSC queue under two threads, rx worker handoff
+ */
+int main(void)
+{
+    test_setup();
+    test_handler_gate = xSemaphoreCreateMutex();
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(test_rx_handler, 1));
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_stress_two_tasks);
+    TEST_RUN(test_worker_drops_when_full);
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,349 @@
+/*
+ *  test_stats.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/**
+ * The benchmark times what one packet costs the instrumentation, a count on
+ * each side and every latency sample of its way through, against what the
+ * whole notify path costs per packet.
+ */
+#define TEST_MTU                                      247
+#define TEST_WRITES                                   10
+#define TEST_WRITE_SIZE                               100
+#define TEST_NOTIFIES                                 5
+#define TEST_NOTIFY_SIZE                              50
+#define TEST_BENCH_SAMPLES                            2000000
+#define TEST_BENCH_PACKETS                            20000
+#define TEST_MAX_OVERHEAD_PERCENT                     10
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static volatile uint32_t test_handled;
+static uint32_t test_notified;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size);
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static bool test_handled_all(void *arg);
+static bool test_notified_all(void *arg);
+static uint32_t test_hist_total(const ble_stats_t *stats, ble_stats_hist_t hist);
+static void test_delta(const ble_stats_t *before, ble_stats_t *delta);
+static void test_traffic_counters(void);
+static void test_fail_counters(void);
+static void test_histogram_buckets(void);
+static void test_diff_wraps(void);
+static void test_stats_characteristic(void);
+static void test_overhead(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Rx worker handler
+ */
+static void test_rx_handler(uint16_t conn_handle, uint8_t *data, size_t size)
+{
+    test_handled++;
+}
+
+/**
+ * @brief  Count notifications of the tx characteristic
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    if(attr_handle == gatt_server_get_tx_handle())
+    {
+        test_notified++;
+    }
+}
+
+/**
+ * @brief  Wait condition: *arg writes handled
+ */
+static bool test_handled_all(void *arg)
+{
+    return test_handled >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Wait condition: *arg notifications sent
+ */
+static bool test_notified_all(void *arg)
+{
+    return test_notified >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Samples in one histogram
+ */
+static uint32_t test_hist_total(const ble_stats_t *stats, ble_stats_hist_t hist)
+{
+    uint32_t total = 0;
+    uint32_t bucket;
+
+    for(bucket = 0; bucket < BLE_STATS_HIST_BUCKETS; bucket++)
+    {
+        total += stats->hist[hist][bucket];
+    }
+    return total;
+}
+
+/**
+ * @brief  Counters of the test connection since before
+ */
+static void test_delta(const ble_stats_t *before, ble_stats_t *delta)
+{
+    ble_stats_t after;
+
+    CHECK(ble_api_get_stats(test_conn_handle, &after) == ESP_OK);
+    ble_stats_diff(before, &after, delta);
+}
+
+/**
+ * @brief  Writes and notifications are counted in packets and bytes, each
+ *         one leaves a sample in the histograms of its way
+ */
+static void test_traffic_counters(void)
+{
+    uint16_t rx_handle = fake_gatt_find(&test_rx_uuid.u);
+    uint8_t data[TEST_WRITE_SIZE] = { 0 };
+    uint32_t handled = test_handled;
+    uint32_t notified = test_notified + TEST_NOTIFIES;
+    ble_stats_t before;
+    ble_stats_t delta;
+    uint32_t i;
+
+    CHECK(ble_api_get_stats(test_conn_handle, &before) == ESP_OK);
+    for(i = 0; i < TEST_WRITES; i++)
+    {
+        handled++;
+        CHECK(fake_gatt_write(test_conn_handle, rx_handle, data, TEST_WRITE_SIZE) == 0);
+        CHECK(fake_run_until(test_handled_all, &handled, TEST_TIMEOUT_MS));
+    }
+    for(i = 0; i < TEST_NOTIFIES; i++)
+    {
+        CHECK(ble_api_tx_notify_conn(test_conn_handle, data, TEST_NOTIFY_SIZE) == ESP_OK);
+    }
+    CHECK(fake_run_until(test_notified_all, &notified, TEST_TIMEOUT_MS));
+    test_delta(&before, &delta);
+
+    CHECK(delta.rx_packets == TEST_WRITES);
+    CHECK(delta.rx_bytes == TEST_WRITES * TEST_WRITE_SIZE);
+    CHECK(delta.tx_packets == TEST_NOTIFIES);
+    CHECK(delta.tx_bytes == TEST_NOTIFIES * TEST_NOTIFY_SIZE);
+    CHECK(delta.tx_wire_bytes == TEST_NOTIFIES * TEST_NOTIFY_SIZE);
+    CHECK(delta.notify_fails == 0);
+    CHECK(delta.mbuf_fails == 0);
+    CHECK(test_hist_total(&delta, BLE_STATS_RX_TO_HANDLER) == TEST_WRITES);
+    CHECK(test_hist_total(&delta, BLE_STATS_HANDLER) == TEST_WRITES);
+    CHECK(test_hist_total(&delta, BLE_STATS_NOTIFY_TO_TX) == TEST_NOTIFIES);
+    CHECK(test_hist_total(&delta, BLE_STATS_CONTROL_TO_TX) + test_hist_total(&delta, BLE_STATS_REALTIME_TO_TX) +
+          test_hist_total(&delta, BLE_STATS_BULK_TO_TX) == TEST_NOTIFIES);
+}
+
+/**
+ * @brief  A stack out of mbufs is counted and retried, a refused notification
+ *         is counted and dropped
+ */
+static void test_fail_counters(void)
+{
+    uint8_t data[TEST_NOTIFY_SIZE] = { 0 };
+    uint32_t notified = test_notified + 2;
+    ble_stats_t before;
+    ble_stats_t delta;
+
+    CHECK(ble_api_get_stats(test_conn_handle, &before) == ESP_OK);
+    fake_notify_fail(BLE_HS_ENOMEM, 2);
+    CHECK(ble_api_tx_notify_conn(test_conn_handle, data, sizeof(data)) == ESP_OK);
+    fake_run();
+    fake_notify_fail(BLE_HS_EINVAL, 1);
+    CHECK(ble_api_tx_notify_conn(test_conn_handle, data, sizeof(data)) == ESP_OK);
+    CHECK(ble_api_tx_notify_conn(test_conn_handle, data, sizeof(data)) == ESP_OK);
+    CHECK(fake_run_until(test_notified_all, &notified, TEST_TIMEOUT_MS));
+    test_delta(&before, &delta);
+
+    CHECK(delta.mbuf_fails == 2);
+    CHECK(delta.notify_fails == 1);
+    CHECK(delta.tx_packets == 2);
+    CHECK(test_hist_total(&delta, BLE_STATS_NOTIFY_TO_TX) == 2);
+}
+
+/**
+ * @brief  Latencies land in the bucket of their bit length, percentiles
+ *         report the upper bound of the bucket
+ */
+static void test_histogram_buckets(void)
+{
+    ble_stats_t stats;
+    uint32_t i;
+
+    ble_stats_reset(&stats);
+    CHECK(ble_stats_percentile(stats.hist[BLE_STATS_HANDLER], 500) == 0);
+
+    /* Far enough from the bucket edges that the clock running on does not matter */
+    ble_stats_record(&stats, BLE_STATS_HANDLER, ble_stats_now() - 700);
+    ble_stats_record(&stats, BLE_STATS_HANDLER, ble_stats_now() - 3000);
+    ble_stats_record(&stats, BLE_STATS_HANDLER, ble_stats_now() - 10000000);
+    CHECK(stats.hist[BLE_STATS_HANDLER][10] == 1);
+    CHECK(stats.hist[BLE_STATS_HANDLER][12] == 1);
+    CHECK(stats.hist[BLE_STATS_HANDLER][BLE_STATS_HIST_BUCKETS - 1] == 1);
+    CHECK(test_hist_total(&stats, BLE_STATS_HANDLER) == 3);
+    CHECK(test_hist_total(&stats, BLE_STATS_RX_TO_HANDLER) == 0);
+
+    ble_stats_reset(&stats);
+    for(i = 0; i < 90; i++)
+    {
+        stats.hist[BLE_STATS_RX_TO_HANDLER][3]++;
+    }
+    for(i = 0; i < 10; i++)
+    {
+        stats.hist[BLE_STATS_RX_TO_HANDLER][10]++;
+    }
+    CHECK(ble_stats_percentile(stats.hist[BLE_STATS_RX_TO_HANDLER], 500) == 8);
+    CHECK(ble_stats_percentile(stats.hist[BLE_STATS_RX_TO_HANDLER], 900) == 8);
+    CHECK(ble_stats_percentile(stats.hist[BLE_STATS_RX_TO_HANDLER], 990) == 1024);
+}
+
+/**
+ * @brief  Snapshots taken across a counter wrap still diff right
+ */
+static void test_diff_wraps(void)
+{
+    ble_stats_t before;
+    ble_stats_t after;
+    ble_stats_t delta;
+
+    ble_stats_reset(&before);
+    ble_stats_reset(&after);
+    before.rx_bytes = 0xFFFFFFF0;
+    after.rx_bytes = 0x10;
+    before.hist[BLE_STATS_BULK_TO_TX][5] = 7;
+    after.hist[BLE_STATS_BULK_TO_TX][5] = 9;
+    ble_stats_diff(&before, &after, &delta);
+    CHECK(delta.rx_bytes == 0x20);
+    CHECK(delta.hist[BLE_STATS_BULK_TO_TX][5] == 2);
+    CHECK(delta.tx_packets == 0);
+}
+
+/**
+ * @brief  The diagnostics characteristic returns the counters of the reading
+ *         connection as the C API does
+ */
+static void test_stats_characteristic(void)
+{
+    uint16_t stats_handle = fake_gatt_find(&test_stats_uuid.u);
+    uint8_t value[sizeof(ble_stats_t) + 16];
+    ble_stats_t stats;
+    uint16_t length = 0;
+
+    CHECK(stats_handle != 0);
+    CHECK(ble_api_get_stats(test_conn_handle, &stats) == ESP_OK);
+    CHECK(stats.rx_packets > 0 && stats.tx_packets > 0);
+    CHECK(fake_gatt_read(test_conn_handle, stats_handle, value, sizeof(value), &length) == 0);
+    CHECK(length == sizeof(ble_stats_t));
+    CHECK(memcmp(value, &stats, sizeof(ble_stats_t)) == 0);
+    CHECK(fake_gatt_write(test_conn_handle, stats_handle, value, 4) != 0);
+    CHECK(ble_api_get_stats(BLE_HS_CONN_HANDLE_NONE, &stats) != ESP_OK);
+}
+
+/**
+ * @brief  Microbenchmark: the instrumentation of one packet costs a small
+ *         share of sending it. The clock reads are timed apart, they are the
+ *         platform clock and most of the cost on the host
+ */
+static void test_overhead(void)
+{
+    uint8_t data[TEST_NOTIFY_SIZE] = { 0 };
+    uint32_t notified = test_notified + TEST_BENCH_PACKETS;
+    uint32_t queued = 0;
+    volatile uint32_t stamp = 0;
+    ble_stats_t stats;
+    double sample_ns;
+    double clock_ns;
+    double update_ns;
+    double packet_ns;
+    int64_t start;
+    uint32_t i;
+
+    start = fake_time_us();
+    for(i = 0; i < TEST_BENCH_SAMPLES; i++)
+    {
+        stamp += ble_stats_now();
+    }
+    clock_ns = (fake_time_us() - start) * 1e3 / TEST_BENCH_SAMPLES;
+
+    ble_stats_reset(&stats);
+    start = fake_time_us();
+    for(i = 0; i < TEST_BENCH_SAMPLES; i++)
+    {
+        /* As ble_api_tx_notify_conn() stamps, the stack sends, NOTIFY_TX fires */
+        stamp = ble_stats_now();
+        ble_stats_tx(&stats, TEST_NOTIFY_SIZE);
+        stats.tx_wire_bytes += TEST_NOTIFY_SIZE;
+        ble_stats_record(&stats, BLE_STATS_NOTIFY_TO_TX, stamp);
+        ble_stats_record(&stats, BLE_STATS_BULK_TO_TX, stamp);
+    }
+    sample_ns = (fake_time_us() - start) * 1e3 / TEST_BENCH_SAMPLES;
+    update_ns = sample_ns > 3 * clock_ns ? sample_ns - 3 * clock_ns : 0;
+    CHECK(stats.tx_packets == TEST_BENCH_SAMPLES);
+    CHECK(test_hist_total(&stats, BLE_STATS_NOTIFY_TO_TX) == TEST_BENCH_SAMPLES);
+
+    start = fake_time_us();
+    while(queued < TEST_BENCH_PACKETS)
+    {
+        if(ble_api_tx_notify_conn(test_conn_handle, data, sizeof(data)) == ESP_OK)
+        {
+            queued++;
+            continue;
+        }
+        fake_run();
+    }
+    CHECK(fake_run_until(test_notified_all, &notified, TEST_TIMEOUT_MS));
+    packet_ns = (fake_time_us() - start) * 1e3 / TEST_BENCH_PACKETS;
+
+    printf("notify path: %.1f ns per packet, instrumentation %.1f ns of it: %.1f ns counters and histograms, "
+           "3 clock reads of %.1f ns\n", packet_ns, sample_ns, update_ns, clock_ns);
+    CHECK(update_ns * 100 < packet_ns * TEST_MAX_OVERHEAD_PERCENT);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  Per connection counters, histograms and the diagnostics characteristic
+ */
+int main(void)
+{
+    test_setup();
+    ESP_ERROR_CHECK(gatt_server_start_rx_worker(test_rx_handler, 1));
+    fake_notify_set_hook(test_notify_hook, NULL);
+    test_conn_handle = test_connect(1, TEST_MTU);
+
+    TEST_RUN(test_traffic_counters);
+    TEST_RUN(test_fail_counters);
+    TEST_RUN(test_histogram_buckets);
+    TEST_RUN(test_diff_wraps);
+    TEST_RUN(test_stats_characteristic);
+    TEST_RUN(test_overhead);
+    return test_result();
+}
\ No newline at end of file
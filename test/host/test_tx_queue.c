@@ -0,0 +1,204 @@
+/*
+ *  test_tx_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+
+#include "test.h"
+
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+#define TEST_MTU                                      247
+#define TEST_PACKET_SIZE                              200
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+static uint16_t test_conn_handle;
+static uint32_t test_next_seq;
+static uint32_t test_delivered;
+static uint32_t test_out_of_order;
+static int test_msys_min_free = CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT;
+static uint32_t test_throttle_on;
+static uint32_t test_throttle_off;
+
+/******************************************************************************/
+/*                                FUNCTIONS                                   */
+/******************************************************************************/
+
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg);
+static void test_watermark_handler(uint16_t conn_handle, bool throttled);
+static esp_err_t test_queue(uint32_t seq);
+static bool test_all_delivered(void *arg);
+static void test_full_queue_refuses(void);
+static void test_drain_keeps_msys_reserve(void);
+static void test_notify_failure_drops_packet(void);
+static void test_unsubscribed_refused(void);
+
+/******************************************************************************/
+
+/**
+ * @brief  Check the order of delivered packets and the msys low watermark
+ */
+static void test_notify_hook(uint16_t conn_handle, uint16_t attr_handle, const uint8_t *data, uint16_t length,
+                             void *arg)
+{
+    uint32_t seq;
+
+    if(attr_handle != gatt_server_get_tx_handle())
+    {
+        return;
+    }
+    memcpy(&seq, data, sizeof(seq));
+    test_out_of_order += seq != test_next_seq;
+    test_next_seq = seq + 1;
+    test_delivered++;
+    if(os_msys_num_free() < test_msys_min_free)
+    {
+        test_msys_min_free = os_msys_num_free();
+    }
+}
+
+/**
+ * @brief  Count watermark crossings
+ */
+static void test_watermark_handler(uint16_t conn_handle, bool throttled)
+{
+    if(throttled)
+    {
+        test_throttle_on++;
+    }
+    else
+    {
+        test_throttle_off++;
+    }
+}
+
+/**
+ * @brief  Queue one numbered packet
+ */
+static esp_err_t test_queue(uint32_t seq)
+{
+    uint8_t packet[TEST_PACKET_SIZE] = { 0 };
+
+    memcpy(packet, &seq, sizeof(seq));
+    return ble_api_tx_notify_conn(test_conn_handle, packet, sizeof(packet));
+}
+
+/**
+ * @brief  Wait condition: *arg packets delivered
+ */
+static bool test_all_delivered(void *arg)
+{
+    return test_delivered >= *(uint32_t *)arg;
+}
+
+/**
+ * @brief  Producers get ESP_ERR_NO_MEM and a throttle callback instead of an
+ *         assert once the queue is full
+ */
+static void test_full_queue_refuses(void)
+{
+    uint32_t queued = 0;
+
+    while(test_queue(queued) == ESP_OK)
+    {
+        queued++;
+    }
+    CHECK(queued == BLE_TX_QUEUE_LENGTH);
+    CHECK(test_queue(queued) == ESP_ERR_NO_MEM);
+    CHECK(test_throttle_on == 1);
+    CHECK(test_throttle_off == 0);
+}
+
+/**
+ * @brief  With the controller holding every notification the drain stops at
+ *         the msys reserve, resumes as the link acknowledges, keeps the order
+ *         and releases the throttle at the low watermark
+ */
+static void test_drain_keeps_msys_reserve(void)
+{
+    uint32_t expected = BLE_TX_QUEUE_LENGTH;
+
+    fake_run();
+    CHECK(test_delivered == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT - BLE_TX_MSYS_RESERVE);
+    CHECK(test_msys_min_free >= BLE_TX_MSYS_RESERVE);
+    CHECK(test_throttle_off == 0);
+
+    while(test_delivered < expected && fake_link_held(test_conn_handle) > 0)
+    {
+        fake_link_release(test_conn_handle, 1);
+        fake_advance_ms(BLE_TX_RETRY_MS);
+        fake_run();
+    }
+    CHECK(test_delivered == expected);
+    CHECK(test_out_of_order == 0);
+    CHECK(test_msys_min_free >= BLE_TX_MSYS_RESERVE);
+    CHECK(test_throttle_off == 1);
+    fake_link_release(test_conn_handle, FAKE_LINK_HELD_MAX);
+}
+
+/**
+ * @brief  A notification the stack refuses is counted and dropped, the
+ *         following ones still go out
+ */
+static void test_notify_failure_drops_packet(void)
+{
+    uint32_t expected = test_delivered + 2;
+    ble_stats_t stats;
+    uint32_t i;
+
+    fake_link_hold(false);
+    fake_notify_fail(BLE_HS_ECONTROLLER, 2);
+    test_next_seq = 2;
+    for(i = 0; i < 4; i++)
+    {
+        CHECK(test_queue(i) == ESP_OK);
+    }
+    CHECK(fake_run_until(test_all_delivered, &expected, TEST_TIMEOUT_MS));
+    CHECK(test_out_of_order == 0);
+    CHECK(ble_api_get_stats(test_conn_handle, &stats) == ESP_OK);
+    CHECK(stats.notify_fails == 2);
+    CHECK(os_msys_num_free() == CONFIG_BT_NIMBLE_MSYS1_BLOCK_COUNT);
+}
+
+/**
+ * @brief  Nothing is queued for a peer that is not subscribed
+ */
+static void test_unsubscribed_refused(void)
+{
+    fake_subscribe(test_conn_handle, gatt_server_get_tx_handle(), false);
+    fake_run();
+    CHECK(test_queue(0) == ESP_ERR_INVALID_STATE);
+    CHECK(ble_api_tx_notify((const uint8_t *)"x", 1) == ESP_ERR_INVALID_STATE);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief  TX queue backpressure
+ */
+int main(void)
+{
+    test_setup();
+    fake_notify_set_hook(test_notify_hook, NULL);
+    ble_api_register_tx_watermark_handler(test_watermark_handler);
+    test_conn_handle = test_connect(1, TEST_MTU);
+    fake_link_hold(true);
+
+    TEST_RUN(test_full_queue_refuses);
+    TEST_RUN(test_drain_keeps_msys_reserve);
+    TEST_RUN(test_notify_failure_drops_packet);
+    TEST_RUN(test_unsubscribed_refused);
+    return test_result();
+}
\ No newline at end of file
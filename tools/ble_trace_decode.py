@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Decode a BLE trace dump from the console log.
+
+ble_trace_dump() prints one "BLE_TRACE <index> <record hex>" line per record.
+Event, module and level names plus the argument names are read from
+src/ble_api/ble_trace.h so this tool never goes out of sync with the firmware.
+
+    idf.py monitor | tee ble.log
+    python3 tools/ble_trace_decode.py ble.log
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = os.path.join(os.path.dirname(__file__), "..", "src", "ble_api", "ble_trace.h")
+RECORD = struct.Struct("<IHBBII")
+LINE = re.compile(r"BLE_TRACE ([0-9a-fA-F]{8}) ([0-9a-fA-F]{%d})" % (RECORD.size * 2))
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+
+def parse_enum(text, prefix):
+    """Return {value: (name, [arg names])} of one enum of the header."""
+    entries = {}
+    value = 0
+    pattern = re.compile(r"^\s*%s(\w+)\s*(?:=\s*(\d+))?\s*,?\s*(?:/\*(.*)\*/)?" % prefix)
+    for line in text.splitlines():
+        match = pattern.match(line)
+        if not match:
+            continue
+        if match.group(2) is not None:
+            value = int(match.group(2))
+        args = [a.strip() for a in (match.group(3) or "").split(",") if a.strip()]
+        entries[value] = (match.group(1), args)
+        value += 1
+    return entries
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="console log, stdin when omitted")
+    parser.add_argument("--header", default=HEADER, help="path of ble_trace.h")
+    args = parser.parse_args()
+
+    with open(args.header) as f:
+        text = f.read()
+    modules = parse_enum(text, "BLE_TRACE_MODULE_")
+    events = parse_enum(text, "BLE_TRACE_EV_")
+
+    log = open(args.log, errors="replace") if args.log else sys.stdin
+    first = None
+    last_index = None
+    for line in log:
+        match = LINE.search(line)
+        if not match:
+            continue
+
+        index = int(match.group(1), 16)
+        timestamp, event, module, level, arg0, arg1 = RECORD.unpack(bytes.fromhex(match.group(2)))
+        if last_index is not None and index != last_index + 1:
+            print("--- %d records lost ---" % (index - last_index - 1))
+        last_index = index
+        if first is None:
+            first = timestamp
+
+        name, names = events.get(event, ("EVENT_%d" % event, []))
+        names = names + ["arg0", "arg1"][len(names):]
+        print("%12.3f ms %s %-6s %-16s %s=%d %s=%d" % (
+            ((timestamp - first) & 0xFFFFFFFF) / 1000.0,
+            LEVELS.get(level, "?"),
+            modules.get(module, ("MODULE_%d" % module, []))[0],
+            name, names[0], arg0, names[1], arg1))
+
+
+if __name__ == "__main__":
+    main()